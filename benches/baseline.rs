@@ -0,0 +1,316 @@
+//! CI regression gate: times each pipeline phase on the generated corpora and
+//! writes or checks a JSON baseline.
+//!
+//! ```text
+//! # record a baseline on the CI runner
+//! cargo bench --bench baseline -- --save target/embargo-baseline.json
+//! # later runs fail when a phase's median slows down by more than 25%
+//! cargo bench --bench baseline -- --compare target/embargo-baseline.json --threshold 0.25
+//! ```
+//!
+//! Sizes come from `EMBARGO_BENCH_FILES` (default `1000`) and the number
+//! of timed runs per phase from `EMBARGO_BENCH_SAMPLES` (default 5). Timings are
+//! only comparable between runs on the same machine.
+
+mod common;
+
+use anyhow::{bail, Context, Result};
+use common::Corpus;
+use embargo::formatters::{
+    BinaryFormatter, EmbargoFormatter, JsonCompactFormatter, LLMOptimizedFormatter,
+};
+use embargo::parsers::cache::ParseCache;
+use embargo::parsers::ParserFactory;
+use serde::{Deserialize, Serialize};
+use std::collections::BTreeMap;
+use std::hint::black_box;
+use std::io;
+use std::path::PathBuf;
+use std::time::Instant;
+
+const BASELINE_VERSION: u32 = 1;
+const DEFAULT_THRESHOLD: f64 = 0.25;
+
+#[derive(Debug, Serialize, Deserialize)]
+struct Baseline {
+    version: u32,
+    /// Corpus size (as a string, for JSON keys) -> phase -> measurement
+    scales: BTreeMap<String, BTreeMap<String, Measurement>>,
+}
+
+#[derive(Debug, Clone, Copy, Serialize, Deserialize)]
+struct Measurement {
+    median_ms: f64,
+    files_per_s: f64,
+    nodes_per_s: f64,
+}
+
+struct Options {
+    save: Option<PathBuf>,
+    compare: Option<PathBuf>,
+    threshold: f64,
+}
+
+fn parse_args() -> Result<Options> {
+    let mut options = Options {
+        save: None,
+        compare: None,
+        threshold: DEFAULT_THRESHOLD,
+    };
+    let mut args = std::env::args().skip(1);
+    while let Some(arg) = args.next() {
+        match arg.as_str() {
+            "--save" => options.save = Some(args.next().context("--save needs a path")?.into()),
+            "--compare" => {
+                options.compare = Some(args.next().context("--compare needs a path")?.into())
+            }
+            "--threshold" => {
+                options.threshold = args
+                    .next()
+                    .context("--threshold needs a fraction")?
+                    .parse::<f64>()
+                    .context("--threshold must be a number like 0.25")?
+            }
+            // cargo bench passes --bench to every bench target
+            _ => {}
+        }
+    }
+    Ok(options)
+}
+
+fn samples() -> usize {
+    std::env::var("EMBARGO_BENCH_SAMPLES")
+        .ok()
+        .and_then(|value| value.parse().ok())
+        .filter(|&samples| samples > 0)
+        .unwrap_or(5)
+}
+
+/// Median wall time of `samples` runs of `run`, after one untimed warm-up
+fn time<T>(samples: usize, mut setup: impl FnMut() -> T, mut run: impl FnMut(T)) -> f64 {
+    run(setup());
+    let mut times: Vec<f64> = (0..samples)
+        .map(|_| {
+            let input = setup();
+            let start = Instant::now();
+            run(input);
+            start.elapsed().as_secs_f64()
+        })
+        .collect();
+    times.sort_by(|a, b| a.total_cmp(b));
+    times[times.len() / 2]
+}
+
+fn measure_scale(files: usize, samples: usize) -> BTreeMap<String, Measurement> {
+    let corpus = Corpus::generate(files);
+    let factory = ParserFactory::new();
+    let scanned = common::scan(&corpus.root);
+    let results = common::parse_cold(&factory, &scanned);
+    let nodes = common::node_count(&results);
+    let graph = common::analyzed_graph(results.clone());
+
+    let mut phases: Vec<(&str, f64)> = Vec::new();
+    phases.push((
+        "scan",
+        time(
+            samples,
+            || (),
+            |()| drop(black_box(common::scan(&corpus.root))),
+        ),
+    ));
+    phases.push((
+        "parse_cold",
+        time(
+            samples,
+            || (),
+            |()| drop(black_box(common::parse_cold(&factory, &scanned))),
+        ),
+    ));
+
+    let memory = ParseCache::in_memory_only();
+    common::parse_cached(&memory, &factory, &scanned);
+    phases.push((
+        "cache_warm_memory",
+        time(
+            samples,
+            || (),
+            |()| drop(black_box(common::parse_cached(&memory, &factory, &scanned))),
+        ),
+    ));
+
+    let dir = tempfile::TempDir::new().expect("cache dir");
+    let open_pack = || ParseCache::new(Some(dir.path().to_path_buf())).expect("open cache");
+    common::parse_cached(&open_pack(), &factory, &scanned);
+    phases.push((
+        "cache_warm_pack",
+        time(samples, open_pack, |cache| {
+            drop(black_box(common::parse_cached(&cache, &factory, &scanned)))
+        }),
+    ));
+
+    phases.push((
+        "graph_build",
+        time(
+            samples,
+            || results.clone(),
+            |results| drop(black_box(common::build_graph(results))),
+        ),
+    ));
+    let (builder, call_sites) = common::build_graph(results.clone());
+    let unresolved = builder.build();
+    phases.push((
+        "resolve",
+        time(
+            samples,
+            || (),
+            |()| drop(black_box(common::resolve(&unresolved, &call_sites))),
+        ),
+    ));
+
+    phases.push((
+        "format_markdown",
+        time(
+            samples,
+            || (),
+            |()| {
+                EmbargoFormatter::new()
+                    .write_to(&graph, &mut io::sink())
+                    .unwrap()
+            },
+        ),
+    ));
+    phases.push((
+        "format_llm_optimized",
+        time(
+            samples,
+            || (),
+            |()| {
+                LLMOptimizedFormatter::new()
+                    .write_to(&graph, &mut io::sink())
+                    .unwrap()
+            },
+        ),
+    ));
+    phases.push((
+        "format_json_compact",
+        time(
+            samples,
+            || (),
+            |()| {
+                JsonCompactFormatter::new()
+                    .write_to(&graph, &mut io::sink())
+                    .unwrap()
+            },
+        ),
+    ));
+    phases.push((
+        "format_binary",
+        time(
+            samples,
+            || (),
+            |()| {
+                BinaryFormatter::new()
+                    .write_to(&graph, &mut io::sink())
+                    .unwrap()
+            },
+        ),
+    ));
+
+    phases
+        .into_iter()
+        .map(|(phase, seconds)| {
+            let seconds = seconds.max(f64::MIN_POSITIVE);
+            let measurement = Measurement {
+                median_ms: seconds * 1000.0,
+                files_per_s: scanned.len() as f64 / seconds,
+                nodes_per_s: nodes as f64 / seconds,
+            };
+            (phase.to_string(), measurement)
+        })
+        .collect()
+}
+
+/// Phases whose median grew by more than `threshold` against `baseline`
+fn regressions(baseline: &Baseline, current: &Baseline, threshold: f64) -> Vec<String> {
+    let mut slower = Vec::new();
+    for (scale, phases) in &current.scales {
+        let Some(previous) = baseline.scales.get(scale) else {
+            continue;
+        };
+        for (phase, measurement) in phases {
+            let Some(before) = previous.get(phase) else {
+                continue;
+            };
+            let change = measurement.median_ms / before.median_ms - 1.0;
+            eprintln!(
+                "{:>7} {:<22} {:>10.1}ms  (baseline {:>10.1}ms, {:+.1}%)",
+                scale,
+                phase,
+                measurement.median_ms,
+                before.median_ms,
+                change * 100.0
+            );
+            if change > threshold {
+                slower.push(format!(
+                    "{phase} at {scale} files ({:+.1}%)",
+                    change * 100.0
+                ));
+            }
+        }
+    }
+    slower
+}
+
+fn main() -> Result<()> {
+    let options = parse_args()?;
+    let samples = samples();
+
+    let mut current = Baseline {
+        version: BASELINE_VERSION,
+        scales: BTreeMap::new(),
+    };
+    for files in common::scales(&[1000]) {
+        eprintln!("Measuring {files} files ({samples} samples per phase)...");
+        current
+            .scales
+            .insert(files.to_string(), measure_scale(files, samples));
+    }
+
+    let json = serde_json::to_string_pretty(&current)?;
+    println!("{json}");
+    if let Some(path) = &options.save {
+        std::fs::write(path, &json)
+            .with_context(|| format!("failed to write {}", path.display()))?;
+        eprintln!("Baseline saved to {}", path.display());
+    }
+
+    if let Some(path) = &options.compare {
+        let contents = std::fs::read_to_string(path)
+            .with_context(|| format!("failed to read {}", path.display()))?;
+        let baseline: Baseline = serde_json::from_str(&contents)
+            .with_context(|| format!("invalid baseline {}", path.display()))?;
+        if baseline.version != BASELINE_VERSION {
+            bail!(
+                "baseline {} has version {}, expected {}",
+                path.display(),
+                baseline.version,
+                BASELINE_VERSION
+            );
+        }
+        let slower = regressions(&baseline, &current, options.threshold);
+        if !slower.is_empty() {
+            bail!(
+                "{} phase(s) regressed by more than {:.0}%: {}",
+                slower.len(),
+                options.threshold * 100.0,
+                slower.join(", ")
+            );
+        }
+        eprintln!(
+            "No phase regressed by more than {:.0}%",
+            options.threshold * 100.0
+        );
+    }
+
+    Ok(())
+}
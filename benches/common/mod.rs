@@ -0,0 +1,369 @@
+//! Shared pieces of the benchmark targets: a synthetic corpus generator and the
+//! pipeline phases, driven through the library's public API.
+//!
+//! Corpora are written once per size under `$TMP/embargo_bench_corpus/<files>`
+//! and reused by later runs. Sizes come from `EMBARGO_BENCH_FILES`, a comma
+//! separated list such as `1000,10000,100000`.
+
+#![allow(dead_code)]
+
+use embargo::core::graph::GraphBuilder;
+use embargo::core::scanner::FileInfo;
+use embargo::core::{CallSite, DependencyGraph, Edge, FileScanner, FunctionResolver};
+use embargo::parsers::cache::{CacheLookup, ParseCache};
+use embargo::parsers::{ParseResult, ParserFactory};
+use rayon::prelude::*;
+use std::fs;
+use std::path::{Path, PathBuf};
+
+/// Every language the generator writes, in rotation
+pub const LANGUAGES: [&str; 8] = [
+    "python",
+    "typescript",
+    "javascript",
+    "cpp",
+    "rust",
+    "java",
+    "go",
+    "csharp",
+];
+
+/// Bumped whenever the generated sources change, so stale corpora are rebuilt
+const CORPUS_VERSION: u32 = 1;
+const FILES_PER_DIR: usize = 100;
+
+/// Corpus sizes to benchmark, from `EMBARGO_BENCH_FILES` or `default`
+pub fn scales(default: &[usize]) -> Vec<usize> {
+    std::env::var("EMBARGO_BENCH_FILES")
+        .ok()
+        .map(|value| {
+            value
+                .split(',')
+                .filter_map(|size| size.trim().replace('_', "").parse().ok())
+                .filter(|&size| size > 0)
+                .collect::<Vec<usize>>()
+        })
+        .filter(|sizes| !sizes.is_empty())
+        .unwrap_or_else(|| default.to_vec())
+}
+
+/// A generated source tree of `files` files spread over all languages.
+pub struct Corpus {
+    pub root: PathBuf,
+    pub files: usize,
+}
+
+impl Corpus {
+    /// Returns the corpus of `files` files, generating it on first use.
+    ///
+    /// Each file declares a type with methods and two free functions, and calls
+    /// functions declared in other files, so the resolver has real work.
+    pub fn generate(files: usize) -> Corpus {
+        let root = std::env::temp_dir()
+            .join("embargo_bench_corpus")
+            .join(files.to_string());
+        let marker = root.join(format!(".complete-v{CORPUS_VERSION}"));
+        if !marker.exists() {
+            let _ = fs::remove_dir_all(&root);
+            (0..files).into_par_iter().for_each(|index| {
+                let path = root.join(relative_path(index));
+                fs::create_dir_all(path.parent().unwrap()).unwrap();
+                fs::write(&path, source(index, files)).unwrap();
+            });
+            fs::write(&marker, b"").unwrap();
+        }
+        Corpus { root, files }
+    }
+}
+
+fn relative_path(index: usize) -> PathBuf {
+    let language = LANGUAGES[index % LANGUAGES.len()];
+    let extension = match language {
+        "python" => "py",
+        "typescript" => "ts",
+        "javascript" => "js",
+        "cpp" => "cpp",
+        "rust" => "rs",
+        "java" => "java",
+        "go" => "go",
+        _ => "cs",
+    };
+    let group = index / FILES_PER_DIR;
+    PathBuf::from(format!("d{}", group / 10))
+        .join(format!("p{}", group % 10))
+        .join(format!("mod_{index}.{extension}"))
+}
+
+fn source(i: usize, files: usize) -> String {
+    // Callees in other files, possibly in other languages
+    let a = (i + 1) % files;
+    let b = (i * 7 + 3) % files;
+    match LANGUAGES[i % LANGUAGES.len()] {
+        "python" => format!(
+            r#"import os
+from mod_{a} import helper_{a}
+
+
+class Service{i}:
+    """Service number {i}."""
+
+    def __init__(self):
+        self.value = {i}
+
+    def process(self):
+        return helper_{a}(self.value) + compute_{b}()
+
+
+def helper_{i}(value):
+    return value * 2
+
+
+def compute_{i}():
+    return helper_{i}(1)
+"#
+        ),
+        "typescript" => format!(
+            r#"import {{ helper_{a} }} from "./mod_{a}";
+
+export interface Data{i} {{
+    value: number;
+}}
+
+export class Service{i} {{
+    constructor(private data: Data{i}) {{}}
+
+    process(): number {{
+        return helper_{a}(this.data.value) + compute_{b}();
+    }}
+}}
+
+export function helper_{i}(value: number): number {{
+    return value * 2;
+}}
+
+export function compute_{i}(): number {{
+    return helper_{i}(1);
+}}
+"#
+        ),
+        "javascript" => format!(
+            r#"import {{ helper_{a} }} from "./mod_{a}.js";
+
+export class Service{i} {{
+    constructor(value) {{
+        this.value = value;
+    }}
+
+    process() {{
+        return helper_{a}(this.value) + compute_{b}();
+    }}
+}}
+
+export function helper_{i}(value) {{
+    return value * 2;
+}}
+
+export const compute_{i} = () => helper_{i}(1);
+"#
+        ),
+        "cpp" => format!(
+            r#"#include <vector>
+
+namespace pkg {{
+
+int helper_{a}(int value);
+int compute_{b}();
+
+class Service{i} {{
+public:
+    int process() {{ return helper_{a}(value) + compute_{b}(); }}
+
+private:
+    int value = {i};
+}};
+
+int helper_{i}(int value) {{ return value * 2; }}
+
+int compute_{i}() {{ return helper_{i}(1); }}
+
+}}
+"#
+        ),
+        "rust" => format!(
+            r#"use crate::pkg::helper_{a};
+
+/// Service number {i}.
+pub struct Service{i} {{
+    value: i64,
+}}
+
+impl Service{i} {{
+    pub fn new() -> Self {{
+        Self {{ value: {i} }}
+    }}
+
+    pub fn process(&self) -> i64 {{
+        helper_{a}(self.value) + compute_{b}()
+    }}
+}}
+
+pub fn helper_{i}(value: i64) -> i64 {{
+    value * 2
+}}
+
+pub fn compute_{i}() -> i64 {{
+    helper_{i}(1)
+}}
+"#
+        ),
+        "java" => format!(
+            r#"package pkg;
+
+import java.util.List;
+
+public class Service{i} {{
+    private int value = {i};
+
+    public int process() {{
+        return helper_{a}(value) + compute_{b}();
+    }}
+
+    public static int helper_{i}(int value) {{
+        return value * 2;
+    }}
+
+    public static int compute_{i}() {{
+        return helper_{i}(1);
+    }}
+}}
+"#
+        ),
+        "go" => format!(
+            r#"package pkg
+
+import "fmt"
+
+type Service{i} struct {{
+	value int
+}}
+
+func (s *Service{i}) Process() int {{
+	return helper_{a}(s.value) + compute_{b}()
+}}
+
+func helper_{i}(value int) int {{
+	return value * 2
+}}
+
+func compute_{i}() int {{
+	fmt.Println("compute")
+	return helper_{i}(1)
+}}
+"#
+        ),
+        _ => format!(
+            r#"using System;
+
+namespace Pkg
+{{
+    public class Service{i}
+    {{
+        private int value = {i};
+
+        public int Process()
+        {{
+            return Helper_{a}(value) + Compute_{b}();
+        }}
+
+        public static int Helper_{i}(int value)
+        {{
+            return value * 2;
+        }}
+
+        public static int Compute_{i}()
+        {{
+            return Helper_{i}(1);
+        }}
+    }}
+}}
+"#
+        ),
+    }
+}
+
+pub fn scan(root: &Path) -> Vec<FileInfo> {
+    FileScanner::new()
+        .scan_directory(root, &LANGUAGES)
+        .expect("scan corpus")
+}
+
+/// Parses every file without a cache
+pub fn parse_cold(factory: &ParserFactory, files: &[FileInfo]) -> Vec<ParseResult> {
+    files
+        .par_iter()
+        .filter_map(|file| {
+            let parser = factory.get_parser(&file.language).ok()?;
+            parser.parse_file(&file.path).ok()
+        })
+        .collect()
+}
+
+/// Serves every file from `cache`, parsing (and storing) only on a miss
+pub fn parse_cached(
+    cache: &ParseCache,
+    factory: &ParserFactory,
+    files: &[FileInfo],
+) -> Vec<ParseResult> {
+    files
+        .par_iter()
+        .filter_map(|file| {
+            let lookup = cache.lookup_or_parse(&file.path, || {
+                factory.get_parser(&file.language)?.parse_file(&file.path)
+            });
+            match lookup.ok()? {
+                CacheLookup::Hit(result) | CacheLookup::Parsed(result) => Some(result),
+            }
+        })
+        .collect()
+}
+
+pub fn node_count(results: &[ParseResult]) -> usize {
+    results.iter().map(|result| result.nodes.len()).sum()
+}
+
+/// Moves parse results into a graph, as the analyzer does, and returns the
+/// call sites left to resolve
+pub fn build_graph(results: Vec<ParseResult>) -> (GraphBuilder, Vec<CallSite>) {
+    let mut builder = GraphBuilder::new();
+    builder.reserve(
+        node_count(&results),
+        results.iter().map(|result| result.edges.len()).sum(),
+    );
+    let mut call_sites = Vec::new();
+    for result in results {
+        for node in result.nodes {
+            builder.add_node(node);
+        }
+        for edge in result.edges {
+            builder.add_edge(edge);
+        }
+        call_sites.extend(result.call_sites.unwrap_or_default());
+    }
+    (builder, call_sites)
+}
+
+/// Indexes `graph` and resolves `call_sites` into call edges
+pub fn resolve(graph: &DependencyGraph, call_sites: &[CallSite]) -> Vec<Edge> {
+    let mut resolver = FunctionResolver::new();
+    resolver.build_indexes(graph).expect("index graph");
+    resolver.resolve_calls(graph, call_sites)
+}
+
+/// The complete graph the formatters see: parsed nodes plus resolved calls
+pub fn analyzed_graph(results: Vec<ParseResult>) -> DependencyGraph {
+    let (mut builder, call_sites) = build_graph(results);
+    for edge in resolve(builder.graph(), &call_sites) {
+        builder.add_edge(edge);
+    }
+    builder.build()
+}
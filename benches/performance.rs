@@ -1,6 +1,5 @@
 use criterion::{black_box, criterion_group, criterion_main, Criterion};
 use embargo::core::CodebaseAnalyzer;
-use std::path::Path;
 
 fn benchmark_analysis(c: &mut Criterion) {
     let mut group = c.benchmark_group("codebase_analysis");
@@ -122,7 +121,8 @@ export default Component{};
 }
 
 fn benchmark_cache_performance(c: &mut Criterion) {
-    use embargo::parsers::cache::ParseCache;
+    use embargo::parsers::cache::{CacheLookup, ParseCache};
+    use embargo::parsers::ParserFactory;
     use tempfile::TempDir;
 
     let mut group = c.benchmark_group("cache_performance");
@@ -132,16 +132,20 @@ fn benchmark_cache_performance(c: &mut Criterion) {
     let test_file = test_dir.path().join("test.py");
     std::fs::write(&test_file, "def test(): return 42").unwrap();
 
+    let factory = ParserFactory::new();
+    let parse = || factory.get_parser("python")?.parse_file(&test_file);
+
     group.bench_function("cache_store_and_retrieve", |b| {
         b.iter(|| {
-            let cache = ParseCache::new(None).unwrap();
-            // First access - cache miss
-            let needs_update = cache.needs_update(black_box(&test_file)).unwrap();
-            black_box(needs_update);
-
-            // Second access - should be cache hit
-            let needs_update_2 = cache.needs_update(black_box(&test_file)).unwrap();
-            black_box(needs_update_2);
+            let cache = ParseCache::in_memory_only();
+            // First access - cache miss, parses and stores
+            let miss = cache.lookup_or_parse(black_box(&test_file), parse).unwrap();
+            assert!(matches!(miss, CacheLookup::Parsed(_)));
+
+            // Second access - served from the cache
+            let hit = cache.lookup_or_parse(black_box(&test_file), parse).unwrap();
+            assert!(matches!(hit, CacheLookup::Hit(_)));
+            black_box(hit)
         });
     });
 
@@ -0,0 +1,226 @@
+//! Per-phase benchmarks over generated corpora of every supported language.
+//!
+//! ```text
+//! cargo bench --bench pipeline                              # 1k files
+//! EMBARGO_BENCH_FILES=1000,10000,100000 cargo bench --bench pipeline
+//! cargo bench --bench pipeline -- format                    # one group
+//! ```
+//!
+//! File phases report files/s; graph phases and formatters report nodes/s.
+
+mod common;
+
+use common::Corpus;
+use criterion::{
+    black_box, criterion_group, criterion_main, BatchSize, BenchmarkGroup, BenchmarkId, Criterion,
+    Throughput,
+};
+use embargo::core::incremental::{AnalysisState, FileChange};
+use embargo::core::FunctionResolver;
+use embargo::formatters::{
+    BinaryFormatter, EmbargoFormatter, JsonCompactFormatter, LLMOptimizedFormatter,
+};
+use embargo::parsers::cache::ParseCache;
+use embargo::parsers::limits::ParseLimits;
+use embargo::parsers::ParserFactory;
+use rayon::prelude::*;
+use std::io;
+use std::time::Duration;
+
+/// Fewer samples for large corpora, where one iteration takes seconds
+fn configure(group: &mut BenchmarkGroup<'_>, files: usize) {
+    if files >= 10_000 {
+        group.sample_size(10);
+        group.measurement_time(Duration::from_secs(30));
+    }
+}
+
+fn bench_scan(c: &mut Criterion) {
+    let mut group = c.benchmark_group("scan");
+    for files in common::scales(&[1000]) {
+        let corpus = Corpus::generate(files);
+        configure(&mut group, files);
+        group.throughput(Throughput::Elements(files as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(files), &corpus, |b, corpus| {
+            b.iter(|| black_box(common::scan(&corpus.root)))
+        });
+    }
+    group.finish();
+}
+
+fn bench_parse_cold(c: &mut Criterion) {
+    let factory = ParserFactory::new();
+    let mut group = c.benchmark_group("parse_cold");
+    for files in common::scales(&[1000]) {
+        let scanned = common::scan(&Corpus::generate(files).root);
+        configure(&mut group, files);
+        group.throughput(Throughput::Elements(scanned.len() as u64));
+        group.bench_with_input(
+            BenchmarkId::from_parameter(files),
+            &scanned,
+            |b, scanned| b.iter(|| black_box(common::parse_cold(&factory, scanned))),
+        );
+    }
+    group.finish();
+}
+
+fn bench_cache_warm(c: &mut Criterion) {
+    let factory = ParserFactory::new();
+    let mut group = c.benchmark_group("cache_warm");
+    for files in common::scales(&[1000]) {
+        let scanned = common::scan(&Corpus::generate(files).root);
+        configure(&mut group, files);
+        group.throughput(Throughput::Elements(scanned.len() as u64));
+
+        // Memory tier: every lookup is a hit in the in-process map
+        let memory = ParseCache::in_memory_only();
+        common::parse_cached(&memory, &factory, &scanned);
+        group.bench_with_input(BenchmarkId::new("memory", files), &scanned, |b, scanned| {
+            b.iter(|| black_box(common::parse_cached(&memory, &factory, scanned)))
+        });
+
+        // Pack tier: a fresh process opening a populated cache directory
+        let dir = tempfile::TempDir::new().unwrap();
+        let pack = ParseCache::new(Some(dir.path().to_path_buf())).unwrap();
+        common::parse_cached(&pack, &factory, &scanned);
+        drop(pack);
+        group.bench_with_input(BenchmarkId::new("pack", files), &scanned, |b, scanned| {
+            b.iter(|| {
+                let cache = ParseCache::new(Some(dir.path().to_path_buf())).unwrap();
+                black_box(common::parse_cached(&cache, &factory, scanned))
+            })
+        });
+    }
+    group.finish();
+}
+
+fn bench_graph(c: &mut Criterion) {
+    let factory = ParserFactory::new();
+    let mut build = c.benchmark_group("graph_build");
+    let mut corpora = Vec::new();
+    for files in common::scales(&[1000]) {
+        let results = common::parse_cold(&factory, &common::scan(&Corpus::generate(files).root));
+        configure(&mut build, files);
+        build.throughput(Throughput::Elements(common::node_count(&results) as u64));
+        build.bench_with_input(
+            BenchmarkId::from_parameter(files),
+            &results,
+            |b, results| {
+                b.iter_batched(
+                    || results.clone(),
+                    |results| black_box(common::build_graph(results)),
+                    BatchSize::LargeInput,
+                )
+            },
+        );
+        corpora.push((files, results));
+    }
+    build.finish();
+
+    let mut resolve = c.benchmark_group("resolve");
+    for (files, results) in corpora {
+        let nodes = common::node_count(&results);
+        let (builder, call_sites) = common::build_graph(results);
+        let graph = builder.build();
+        configure(&mut resolve, files);
+        resolve.throughput(Throughput::Elements(nodes as u64));
+        resolve.bench_function(BenchmarkId::from_parameter(files), |b| {
+            b.iter(|| black_box(common::resolve(&graph, &call_sites)))
+        });
+    }
+    resolve.finish();
+}
+
+/// One edited file applied to a full analysis state, against a clean build
+/// and resolution of the same parse results
+fn bench_incremental(c: &mut Criterion) {
+    let factory = ParserFactory::new();
+    let mut group = c.benchmark_group("incremental");
+    for files in common::scales(&[1000]) {
+        let corpus = Corpus::generate(files);
+        let parsed: Vec<_> = common::scan(&corpus.root)
+            .par_iter()
+            .filter_map(|file| {
+                let parser = factory.get_parser(&file.language).ok()?;
+                Some((file.path.clone(), parser.parse_file(&file.path).ok()?))
+            })
+            .collect();
+        let results: Vec<_> = parsed.iter().map(|(_, result)| result.clone()).collect();
+        let resolver = FunctionResolver::new();
+        let mut state = AnalysisState::new(
+            &corpus.root,
+            &common::LANGUAGES,
+            resolver.fuzzy_matching(),
+            resolver.cross_language(),
+            &ParseLimits::default(),
+        );
+        let changes = parsed
+            .iter()
+            .map(|(path, result)| FileChange::Updated {
+                path: path.clone(),
+                result: result.clone(),
+                stamp: None,
+            })
+            .collect();
+        state.apply(changes, &resolver).expect("apply corpus");
+        configure(&mut group, files);
+        group.throughput(Throughput::Elements(common::node_count(&results) as u64));
+
+        let (path, result) = &parsed[parsed.len() / 2];
+        group.bench_function(BenchmarkId::new("apply_one_file", files), |b| {
+            b.iter_batched(
+                || FileChange::Updated {
+                    path: path.clone(),
+                    result: result.clone(),
+                    stamp: None,
+                },
+                |change| black_box(state.apply(vec![change], &resolver).unwrap()),
+                BatchSize::SmallInput,
+            )
+        });
+        group.bench_function(BenchmarkId::new("full_build", files), |b| {
+            b.iter_batched(
+                || results.clone(),
+                |results| black_box(common::analyzed_graph(results)),
+                BatchSize::LargeInput,
+            )
+        });
+    }
+    group.finish();
+}
+
+fn bench_format(c: &mut Criterion) {
+    let factory = ParserFactory::new();
+    let mut group = c.benchmark_group("format");
+    for files in common::scales(&[1000]) {
+        let results = common::parse_cold(&factory, &common::scan(&Corpus::generate(files).root));
+        let graph = common::analyzed_graph(results);
+        configure(&mut group, files);
+        group.throughput(Throughput::Elements(graph.node_count() as u64));
+
+        group.bench_function(BenchmarkId::new("markdown", files), |b| {
+            b.iter(|| EmbargoFormatter::new().write_to(&graph, &mut io::sink()))
+        });
+        group.bench_function(BenchmarkId::new("llm_optimized", files), |b| {
+            b.iter(|| LLMOptimizedFormatter::new().write_to(&graph, &mut io::sink()))
+        });
+        group.bench_function(BenchmarkId::new("json_compact", files), |b| {
+            b.iter(|| JsonCompactFormatter::new().write_to(&graph, &mut io::sink()))
+        });
+        group.bench_function(BenchmarkId::new("binary", files), |b| {
+            b.iter(|| BinaryFormatter::new().write_to(&graph, &mut io::sink()))
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(
+    benches,
+    bench_scan,
+    bench_parse_cold,
+    bench_cache_warm,
+    bench_graph,
+    bench_incremental,
+    bench_format
+);
+criterion_main!(benches);
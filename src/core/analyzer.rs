@@ -2,11 +2,25 @@
 //!
 //! Coordinates file scanning, parsing, and dependency graph construction.
 
-use anyhow::Result;
-use std::path::Path;
+use anyhow::{anyhow, Result};
+use rayon::prelude::*;
+use std::collections::BTreeMap;
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, OnceLock};
+use std::time::Instant;
 
+use super::incremental::{file_stamp, AnalysisState, FileChange, UpdateSummary};
+use super::pipeline::{self, AssembledGraph, GraphAssembly};
+use super::profile::{Profiler, SpanGuard};
+use super::resolver::{CallType, ResolutionStats};
+use super::scanner::FileInfo;
+use super::shard::{self, GraphShard};
 use super::{DependencyGraph, FileScanner, FunctionResolver};
-use crate::parsers::{cache::ParseCache, ParserFactory};
+use crate::parsers::cache::{
+    default_cache_dir, CacheLookup, CacheValidation, ParseCache, DEFAULT_MAX_MEMORY_BYTES,
+};
+use crate::parsers::limits::{parse_limited, LimitReason, ParseLimits};
+use crate::parsers::{ParseResult, ParserFactory};
 
 /// Main orchestrator for codebase analysis.
 ///
@@ -16,7 +30,29 @@ pub struct CodebaseAnalyzer {
     file_scanner: FileScanner,
     parser_factory: ParserFactory,
     function_resolver: FunctionResolver,
-    parse_cache: ParseCache,
+    /// Opened on first analysis so the pack file is only read with the final settings
+    parse_cache: OnceLock<ParseCache>,
+    cache_dir: Option<PathBuf>,
+    cache_validation: CacheValidation,
+    cache_max_bytes: usize,
+    cache_max_entries: Option<usize>,
+    /// Files over these are outlined instead of parsed in full
+    parse_limits: ParseLimits,
+    /// Dedicated worker pool when the job count is capped; `None` uses rayon's global pool
+    thread_pool: Option<rayon::ThreadPool>,
+    profiler: Option<Arc<Profiler>>,
+}
+
+/// Capacity of each queue between scan, parse and graph stages
+const PIPELINE_QUEUE_DEPTH: usize = 256;
+/// Outlined files listed by name in the run summary
+const LIMITED_FILES_SHOWN: usize = 10;
+
+/// Outcome of the parse stage for a single file.
+enum ParseOutcome {
+    Cached(ParseResult),
+    Parsed(ParseResult),
+    Failed,
 }
 
 impl CodebaseAnalyzer {
@@ -26,137 +62,601 @@ impl CodebaseAnalyzer {
             file_scanner: FileScanner::new(),
             parser_factory: ParserFactory::new(),
             function_resolver: FunctionResolver::new(),
-            parse_cache: ParseCache::new(None).unwrap_or_else(|err| {
-                eprintln!("Warning: Failed to initialize disk parse cache: {err}");
-                ParseCache::in_memory_only()
-            }),
+            parse_cache: OnceLock::new(),
+            cache_dir: None,
+            cache_validation: CacheValidation::default(),
+            cache_max_bytes: DEFAULT_MAX_MEMORY_BYTES,
+            cache_max_entries: None,
+            parse_limits: ParseLimits::default(),
+            thread_pool: None,
+            profiler: None,
         }
     }
 
+    /// Caps the number of worker threads used for scanning, parsing and resolution.
+    ///
+    /// `None` or `Some(0)` uses every available core.
+    pub fn with_jobs(mut self, jobs: Option<usize>) -> Self {
+        self.file_scanner = FileScanner::new().with_threads(jobs.unwrap_or(0));
+        self.thread_pool = match jobs {
+            Some(n) if n > 0 => match rayon::ThreadPoolBuilder::new().num_threads(n).build() {
+                Ok(pool) => Some(pool),
+                Err(err) => {
+                    eprintln!("Warning: Failed to create {n}-thread pool, using default: {err}");
+                    None
+                }
+            },
+            _ => None,
+        };
+        self
+    }
+
+    /// Relocates the on-disk parse cache and selects how entries are validated.
+    ///
+    /// Pointing several checkouts of one repo at the same `cache_dir` lets them
+    /// share parse results; content-hash validation keeps those hits valid after
+    /// a checkout rewrites mtimes.
+    pub fn with_cache_options(
+        mut self,
+        cache_dir: Option<PathBuf>,
+        validation: CacheValidation,
+    ) -> Self {
+        self.cache_dir = cache_dir;
+        self.cache_validation = validation;
+        self.parse_cache = OnceLock::new();
+        self
+    }
+
+    /// Bounds the in-memory parse cache by approximate bytes and optionally entries.
+    pub fn with_cache_limits(mut self, max_bytes: usize, max_entries: Option<usize>) -> Self {
+        self.cache_max_bytes = max_bytes;
+        self.cache_max_entries = max_entries;
+        self.parse_cache = OnceLock::new();
+        self
+    }
+
+    /// Sets the size, line and generated-code limits above which files get a
+    /// declarations-only outline parse.
+    pub fn with_parse_limits(mut self, limits: ParseLimits) -> Self {
+        self.parse_limits = limits;
+        self.parse_cache = OnceLock::new();
+        self
+    }
+
+    /// Enables or disables fuzzy resolution of simple calls that have no exact match.
+    pub fn with_fuzzy_matching(mut self, enabled: bool) -> Self {
+        self.function_resolver = self.function_resolver.with_fuzzy_matching(enabled);
+        self
+    }
+
+    /// Enables or disables resolving outbound calls (HTTP requests) to the
+    /// exported entry points of other files and languages.
+    pub fn with_cross_language(mut self, enabled: bool) -> Self {
+        self.function_resolver = self.function_resolver.with_cross_language(enabled);
+        self
+    }
+
+    /// Records phase spans and counters of every following analysis into `profiler`.
+    pub fn with_profiler(mut self, profiler: Arc<Profiler>) -> Self {
+        self.profiler = Some(profiler);
+        self
+    }
+
     /// Analyzes a codebase and builds a dependency graph.
     ///
     /// Scans the directory for source files, parses them using language-specific
     /// parsers, and constructs a graph of code entities and their relationships.
     pub fn analyze(&mut self, root_path: &Path, languages: &[&str]) -> Result<DependencyGraph> {
-        println!("Scanning files...");
-        let files = self.file_scanner.scan_directory(root_path, languages)?;
-        println!("Found {} files to analyze", files.len());
-
-        let mut graph_builder = super::graph::GraphBuilder::new();
-
-        println!("Parsing files with cache optimization...");
-
-        // Check which files need reparsing
-        let mut cached_count = 0;
-        let mut parse_results = Vec::with_capacity(files.len());
-
-        // Process files with cache checking (sequential for cache access)
-        for file_info in &files {
-            match self.parse_cache.needs_update(&file_info.path) {
-                Ok(needs_update) => {
-                    if !needs_update {
-                        if let Some(cached_result) = self.parse_cache.get(&file_info.path) {
-                            parse_results.push(cached_result);
-                            cached_count += 1;
-                            continue;
-                        }
-                    }
-                }
-                Err(err) => {
-                    eprintln!(
-                        "Warning: Failed to validate cache entry for {}: {}",
-                        file_info.path.display(),
-                        err
-                    );
-                }
-            }
+        self.run_analysis(root_path, languages)
+    }
 
-            // Parse file if not cached or cache miss
-            if let Ok(parser) = self.parser_factory.get_parser(&file_info.language) {
-                match parser.parse_file(&file_info.path) {
-                    Ok(result) => {
-                        // Store in cache for next time
-                        if let Err(e) = self.parse_cache.store(&file_info.path, &result) {
-                            eprintln!(
-                                "Warning: Failed to cache {}: {}",
-                                file_info.path.display(),
-                                e
-                            );
-                        }
-                        parse_results.push(result);
-                    }
-                    Err(e) => {
-                        eprintln!(
-                            "Warning: Failed to parse {}: {}",
-                            file_info.path.display(),
-                            e
-                        );
-                    }
-                }
-            } else {
-                eprintln!(
-                    "Warning: Unsupported language '{}' for file {}",
-                    file_info.language,
-                    file_info.path.display()
-                );
-            }
+    /// Analyzes one subtree into a shard for [`Self::merge_shards`].
+    ///
+    /// Calls are resolved inside the subtree with exact matching only; the
+    /// rest stay in the shard unresolved, with the routes it exports.
+    pub fn analyze_shard(&self, root_path: &Path, languages: &[&str]) -> Result<GraphShard> {
+        let parse_results = self.parse_tree(root_path, languages)?;
+        eprintln!("Resolving calls inside the shard...");
+        let (shard, stats) = {
+            let _span = self.span("resolve");
+            self.in_pool(|| {
+                GraphShard::from_results(
+                    root_path,
+                    languages,
+                    parse_results,
+                    &self.function_resolver,
+                )
+            })?
+        };
+        if let Some(profiler) = &self.profiler {
+            profiler.add("shard.nodes", shard.nodes.len() as u64);
+            profiler.add("shard.unresolved_sites", shard.unresolved().count() as u64);
+            profile_resolution(profiler, &stats);
         }
+        eprintln!(
+            "Shard of {}: {} nodes, {} edges, {} call sites left for the merge",
+            root_path.display(),
+            shard.nodes.len(),
+            shard.edge_count(),
+            shard.unresolved().count()
+        );
+        Ok(shard)
+    }
 
-        println!(
-            "Cache hits: {}, Parsed: {}",
-            cached_count,
-            parse_results.len() - cached_count
+    /// Loads the shards at `paths` and merges them into one graph, resolving
+    /// the call sites each shard left open against every other shard.
+    pub fn merge_shards(&self, paths: &[PathBuf]) -> Result<DependencyGraph> {
+        let shards = {
+            let _span = self.span("shard_load");
+            paths
+                .iter()
+                .map(|path| GraphShard::load(path))
+                .collect::<Result<Vec<_>>>()?
+        };
+        let (graph, summary) = {
+            let _span = self.span("merge");
+            self.in_pool(|| shard::merge(shards, &self.function_resolver))?
+        };
+        if summary.duplicate_nodes > 0 {
+            eprintln!(
+                "Warning: {} nodes appear in more than one shard; kept the first copy",
+                summary.duplicate_nodes
+            );
+        }
+        if let Some(profiler) = &self.profiler {
+            profiler.add("merge.shards", summary.shards as u64);
+            profiler.add("merge.cross_shard_sites", summary.cross_shard_sites as u64);
+            profiler.add("merge.cross_shard_edges", summary.cross_shard_edges as u64);
+            profiler.add("graph.nodes", graph.node_count() as u64);
+            profiler.add("graph.edges", graph.edge_count() as u64);
+            profile_resolution(profiler, &summary.memo);
+        }
+        eprintln!(
+            "Merged {} shards: resolved {} of {} cross-shard call sites",
+            summary.shards, summary.cross_shard_edges, summary.cross_shard_sites
         );
+        Ok(graph)
+    }
 
-        println!("Building dependency graph...");
+    /// Analyzes a codebase, reusing the state left by the previous incremental run.
+    ///
+    /// `changed` lists the added, modified or deleted files; relative paths are
+    /// taken relative to `root_path`. With `None`, changes are detected by
+    /// rescanning and comparing modification times and sizes. Only the changed
+    /// files are re-parsed and only the call sites their edit can affect are
+    /// re-resolved. Without a usable saved state this runs a full analysis and
+    /// saves its state for the next call.
+    pub fn analyze_incremental(
+        &mut self,
+        root_path: &Path,
+        languages: &[&str],
+        changed: Option<&[PathBuf]>,
+    ) -> Result<DependencyGraph> {
+        let mut state = self.open_state(root_path, languages);
+        let (graph, _) = self.update_state(&mut state, root_path, languages, changed)?;
+        self.save_state(&state, root_path, languages);
+        Ok(graph)
+    }
 
-        // Pre-calculate total capacity to avoid reallocations
-        let total_nodes: usize = parse_results.iter().map(|r| r.nodes.len()).sum();
-        let _total_edges: usize = parse_results.iter().map(|r| r.edges.len()).sum();
+    /// Loads the saved state for `root_path` and `languages`, or starts an empty one
+    pub fn open_state(&self, root_path: &Path, languages: &[&str]) -> AnalysisState {
+        let fuzzy = self.function_resolver.fuzzy_matching();
+        let cross = self.function_resolver.cross_language();
+        AnalysisState::load(&self.state_path(root_path, languages))
+            .filter(|state| state.matches(root_path, languages, fuzzy, cross, &self.parse_limits))
+            .unwrap_or_else(|| {
+                eprintln!("No reusable analysis state; running a full analysis");
+                AnalysisState::new(root_path, languages, fuzzy, cross, &self.parse_limits)
+            })
+    }
 
-        // Pre-allocate collections with known capacity
-        let mut all_nodes = Vec::with_capacity(total_nodes);
-        let mut all_call_sites: Vec<crate::core::CallSite> = Vec::new();
+    /// Persists `state` for the next [`open_state`](Self::open_state)
+    pub fn save_state(&self, state: &AnalysisState, root_path: &Path, languages: &[&str]) {
+        if let Err(err) = state.save(&self.state_path(root_path, languages)) {
+            eprintln!("Warning: Failed to save analysis state: {err}");
+        }
+    }
 
-        for mut parse_result in parse_results {
-            for node in &parse_result.nodes {
-                // Retain a separate copy for the resolver indexes
-                all_nodes.push(node.clone());
-            }
+    /// Applies file changes to `state` and returns the updated graph.
+    ///
+    /// Long-running callers can keep `state` in memory between updates instead
+    /// of going through [`analyze_incremental`](Self::analyze_incremental).
+    pub fn update_state(
+        &self,
+        state: &mut AnalysisState,
+        root_path: &Path,
+        languages: &[&str],
+        changed: Option<&[PathBuf]>,
+    ) -> Result<(DependencyGraph, UpdateSummary)> {
+        self.in_pool(|| self.apply_changes(state, root_path, languages, changed))
+    }
 
-            for node in parse_result.nodes.drain(..) {
-                graph_builder.add_node(node);
+    fn apply_changes(
+        &self,
+        state: &mut AnalysisState,
+        root_path: &Path,
+        languages: &[&str],
+        changed: Option<&[PathBuf]>,
+    ) -> Result<(DependencyGraph, UpdateSummary)> {
+        let scan_span = self.span("scan");
+        // Recorded files a scan would no longer report: deleted, or now ignored
+        let mut removed: Vec<PathBuf> = Vec::new();
+        let files = match changed {
+            Some(paths) if state.file_count() > 0 => {
+                let paths: Vec<PathBuf> = paths
+                    .iter()
+                    .map(|path| rooted_path(root_path, path))
+                    .collect();
+                let files = self
+                    .file_scanner
+                    .classify_paths(root_path, &paths, languages);
+                let kept: std::collections::HashSet<&Path> =
+                    files.iter().map(|file| file.path.as_path()).collect();
+                removed.extend(
+                    paths
+                        .iter()
+                        .filter(|path| !kept.contains(path.as_path()) && state.contains(path))
+                        .cloned(),
+                );
+                files
             }
-
-            for edge in parse_result.edges {
-                graph_builder.add_edge(edge);
+            _ => {
+                let files = self.file_scanner.scan_directory(root_path, languages)?;
+                let mut changed_files = Vec::new();
+                let mut seen = std::collections::HashSet::with_capacity(files.len());
+                for file in files {
+                    seen.insert(file.path.clone());
+                    let recorded = state.stamp(&file.path);
+                    if recorded.is_none() || recorded != Some(file_stamp(&file.path)) {
+                        changed_files.push(file);
+                    }
+                }
+                removed.extend(
+                    state
+                        .stamps()
+                        .map(|(path, _)| path.to_path_buf())
+                        .filter(|path| !seen.contains(path)),
+                );
+                changed_files
             }
+        };
+        drop(scan_span);
 
-            if let Some(call_sites) = parse_result.call_sites {
-                all_call_sites.extend(call_sites);
-            }
+        // Deleted files and files that no longer parse both drop their records
+        let mut changes: Vec<FileChange> = files
+            .par_iter()
+            .filter_map(|file_info| {
+                if !file_info.path.is_file() {
+                    return state
+                        .contains(&file_info.path)
+                        .then(|| FileChange::Removed(file_info.path.clone()));
+                }
+                let stamp = file_stamp(&file_info.path);
+                Some(match self.parse_with_cache(file_info) {
+                    ParseOutcome::Cached(result) | ParseOutcome::Parsed(result) => {
+                        FileChange::Updated {
+                            path: file_info.path.clone(),
+                            result,
+                            stamp,
+                        }
+                    }
+                    ParseOutcome::Failed => FileChange::Removed(file_info.path.clone()),
+                })
+            })
+            .collect();
+        changes.extend(removed.into_iter().map(FileChange::Removed));
+        self.report_limited(changes.iter().filter_map(|change| match change {
+            FileChange::Updated { path, result, .. } => Some((path.as_path(), result.limited?)),
+            FileChange::Removed(_) => None,
+        }));
+
+        let (graph, summary) = {
+            let _span = self.span("incremental_apply");
+            state.apply(changes, &self.function_resolver)?
+        };
+        if let Some(profiler) = &self.profiler {
+            profiler.add("files.changed", summary.files_changed as u64);
+            profiler.add("call_sites", summary.call_sites_total as u64);
+            profiler.add("call_sites.resolved", summary.call_sites_resolved as u64);
+            profile_resolution(profiler, &summary.memo);
         }
+        eprintln!(
+            "Incremental update: {} changed files, re-resolved {} of {} call sites, {} call edges",
+            summary.files_changed,
+            summary.call_sites_resolved,
+            summary.call_sites_total,
+            summary.call_edges
+        );
+        Ok((graph, summary))
+    }
+
+    /// Runs `op` on the capped worker pool if one was configured
+    fn in_pool<R: Send>(&self, op: impl FnOnce() -> R + Send) -> R {
+        match &self.thread_pool {
+            Some(pool) => pool.install(op),
+            None => op(),
+        }
+    }
+
+    fn state_path(&self, root_path: &Path, languages: &[&str]) -> PathBuf {
+        let cache_dir = self.cache_dir.clone().unwrap_or_else(default_cache_dir);
+        AnalysisState::path_in(&cache_dir, root_path, languages)
+    }
 
-        println!("Resolving function calls...");
+    fn run_analysis(&self, root_path: &Path, languages: &[&str]) -> Result<DependencyGraph> {
+        // Nodes are moved into the graph as each file is parsed; the resolver
+        // indexes the graph's node storage rather than keeping its own copies
+        let mut assembly = GraphAssembly::new();
+        self.parse_stream(root_path, languages, |path, result| {
+            assembly.add(path, result)
+        })?;
+
+        eprintln!("Building dependency graph...");
+        let build_span = self.span("graph_build");
+        let assembled = assembly.finish();
+        drop(build_span);
+        self.report_limited(assembled.limited_files());
+        let AssembledGraph {
+            builder: mut graph_builder,
+            call_sites: all_call_sites,
+            exports: all_exports,
+            ..
+        } = assembled;
+        if let Some(profiler) = &self.profiler {
+            profiler.add("call_sites", all_call_sites.len() as u64);
+            profiler.add("contracts.exports", all_exports.len() as u64);
+        }
+
+        eprintln!("Resolving function calls...");
 
         // Build function resolution index using optimized parallel processing
         let mut resolver = self.function_resolver.clone();
-        resolver.build_indexes(&all_nodes)?;
+        {
+            let _span = self.span("index_build");
+            self.in_pool(|| resolver.build_indexes(graph_builder.graph()))?;
+            resolver.index_exports(&all_exports);
+        }
 
         // Resolve function calls into edges when call sites are available
         if !all_call_sites.is_empty() {
-            let call_edges = resolver.resolve_calls(&all_call_sites);
+            let resolve_span = self.span("resolve");
+            let (call_edges, memo_stats) = self.in_pool(|| {
+                resolver.resolve_calls_with_stats(graph_builder.graph(), &all_call_sites)
+            });
+            drop(resolve_span);
+            drop(all_call_sites);
             let mut added = 0usize;
             for edge in call_edges {
                 if graph_builder.add_edge(edge).is_some() {
                     added += 1;
                 }
             }
-            println!("Resolved {} call edges", added);
+            eprintln!(
+                "Resolved {} call edges ({:.1}% of {} call sites served from the resolution memo)",
+                added,
+                memo_stats.hit_rate() * 100.0,
+                memo_stats.lookups
+            );
+            if memo_stats.contract_matches > 0 {
+                eprintln!(
+                    "Matched {} outbound calls to cross-language routes",
+                    memo_stats.contract_matches
+                );
+            }
+            if let Some(profiler) = &self.profiler {
+                profiler.add("graph.call_edges", added as u64);
+                profile_resolution(profiler, &memo_stats);
+            }
         } else {
-            println!("No call sites detected; skipping call resolution");
+            eprintln!("No call sites detected; skipping call resolution");
+        }
+
+        if let Some(profiler) = &self.profiler {
+            profiler.add("graph.nodes", graph_builder.graph().node_count() as u64);
+            profiler.add("graph.edges", graph_builder.graph().edge_count() as u64);
+            let cache = self.parse_cache().stats();
+            profiler.add("cache.memory_entries", cache.memory_entries as u64);
+            profiler.add("cache.memory_bytes", cache.memory_bytes as u64);
+            profiler.add("cache.pack_entries", cache.disk_cache_size as u64);
         }
 
         Ok(graph_builder.build())
     }
+
+    /// Scans `root_path` and parses every file, serving what it can from the
+    /// parse cache; results are in path order.
+    fn parse_tree(&self, root_path: &Path, languages: &[&str]) -> Result<Vec<ParseResult>> {
+        // Results arrive in completion order; keying by path restores scan order
+        let mut parsed: BTreeMap<PathBuf, ParseResult> = BTreeMap::new();
+        self.parse_stream(root_path, languages, |path, result| {
+            parsed.insert(path, result);
+        })?;
+        self.report_limited(
+            parsed
+                .iter()
+                .filter_map(|(path, result)| Some((path.as_path(), result.limited?))),
+        );
+        Ok(parsed.into_values().collect())
+    }
+
+    /// Scans `root_path` and parses every file, serving what it can from the
+    /// parse cache, and hands each result to `on_result` in completion order.
+    fn parse_stream(
+        &self,
+        root_path: &Path,
+        languages: &[&str],
+        mut on_result: impl FnMut(PathBuf, ParseResult),
+    ) -> Result<()> {
+        eprintln!("Scanning and parsing files with cache optimization...");
+
+        // walker -> parse workers -> this thread, so parsing starts with the
+        // first discovered file and a slow filesystem overlaps with parsing
+        // instead of preceding it
+        let mut file_count = 0usize;
+        let mut cached_count = 0usize;
+        let mut parsed_count = 0usize;
+        pipeline::run_stages(
+            PIPELINE_QUEUE_DEPTH,
+            self.thread_pool.as_ref(),
+            |send| {
+                let _span = self.span("scan");
+                self.file_scanner
+                    .scan_with(root_path, languages, |file_info| send(file_info))
+            },
+            |file_info: FileInfo| {
+                let outcome = self.parse_with_cache(&file_info);
+                (file_info.path, outcome)
+            },
+            |(path, outcome)| {
+                file_count += 1;
+                match outcome {
+                    ParseOutcome::Cached(result) => {
+                        cached_count += 1;
+                        on_result(path, result);
+                    }
+                    ParseOutcome::Parsed(result) => {
+                        parsed_count += 1;
+                        on_result(path, result);
+                    }
+                    ParseOutcome::Failed => {}
+                }
+            },
+        )?;
+
+        eprintln!("Found {} files to analyze", file_count);
+        eprintln!("Cache hits: {}, Parsed: {}", cached_count, parsed_count);
+        if let Some(profiler) = &self.profiler {
+            profiler.add("files.scanned", file_count as u64);
+        }
+        Ok(())
+    }
+
+    /// Lists the files that were only outlined, with the limit each one hit
+    fn report_limited<'p>(&self, limited: impl Iterator<Item = (&'p Path, LimitReason)>) {
+        let limited: Vec<(&Path, LimitReason)> = limited.collect();
+        if limited.is_empty() {
+            return;
+        }
+        let timeouts = limited
+            .iter()
+            .filter(|(_, reason)| *reason == LimitReason::Timeout)
+            .count();
+        eprintln!(
+            "Outlined {} files over the parse limits (declarations only, no call sites):",
+            limited.len()
+        );
+        for (path, reason) in limited.iter().take(LIMITED_FILES_SHOWN) {
+            eprintln!("  {} ({})", path.display(), reason);
+        }
+        if limited.len() > LIMITED_FILES_SHOWN {
+            eprintln!("  ... and {} more", limited.len() - LIMITED_FILES_SHOWN);
+        }
+        if let Some(profiler) = &self.profiler {
+            profiler.add("files.outlined", limited.len() as u64);
+            profiler.add("files.parse_timeouts", timeouts as u64);
+        }
+    }
+
+    /// A span on the configured profiler, if any
+    fn span(&self, name: &'static str) -> Option<SpanGuard<'_>> {
+        self.profiler.as_deref().map(|profiler| profiler.span(name))
+    }
+
+    fn parse_cache(&self) -> &ParseCache {
+        self.parse_cache.get_or_init(|| {
+            ParseCache::new(self.cache_dir.clone())
+                .unwrap_or_else(|err| {
+                    eprintln!("Warning: Failed to initialize disk parse cache: {err}");
+                    ParseCache::in_memory_only()
+                })
+                .with_validation(self.cache_validation)
+                .with_parse_limits(&self.parse_limits)
+                .with_memory_limits(self.cache_max_bytes, self.cache_max_entries)
+        })
+    }
+
+    /// Serves a file from the parse cache, or parses and caches it.
+    ///
+    /// Safe to call from multiple workers: the cache is backed by a concurrent map
+    /// and each call owns its parser instance.
+    fn parse_with_cache(&self, file_info: &FileInfo) -> ParseOutcome {
+        let profiler = self.profiler.as_deref();
+        let lookup_start = Instant::now();
+        let lookup = self.parse_cache().lookup_or_parse(&file_info.path, || {
+            let _span = profiler.map(|p| p.span_with("parse", file_info.language.as_str()));
+            if let Some(profiler) = profiler {
+                let bytes = std::fs::metadata(&file_info.path).map_or(0, |meta| meta.len());
+                profiler.add("bytes.parsed", bytes);
+            }
+            let parser = self
+                .parser_factory
+                .get_parser(&file_info.language)
+                .map_err(|_| anyhow!("unsupported language '{}'", file_info.language))?;
+            parse_limited(&*parser, &file_info.path, &self.parse_limits)
+        });
+        if let Some(profiler) = profiler {
+            // Includes the parse itself on a miss
+            profiler.record(
+                "cache_lookup",
+                Some(file_info.language.clone()),
+                lookup_start,
+                lookup_start.elapsed(),
+            );
+            let counter = match &lookup {
+                Ok(CacheLookup::Hit(_)) => "cache.hits",
+                Ok(CacheLookup::Parsed(_)) => "cache.misses",
+                Err(_) => "parse.failures",
+            };
+            profiler.add(counter, 1);
+        }
+
+        match lookup {
+            Ok(CacheLookup::Hit(result)) => ParseOutcome::Cached(result),
+            Ok(CacheLookup::Parsed(result)) => ParseOutcome::Parsed(result),
+            Err(e) => {
+                eprintln!(
+                    "Warning: Failed to parse {}: {}",
+                    file_info.path.display(),
+                    e
+                );
+                ParseOutcome::Failed
+            }
+        }
+    }
+}
+
+/// Adds one resolver run's memo, fuzzy and per-call-type counters to `profiler`
+fn profile_resolution(profiler: &Profiler, stats: &ResolutionStats) {
+    profiler.add("resolve.memo_lookups", stats.lookups as u64);
+    profiler.add("resolve.memo_hits", stats.hits as u64);
+    profiler.add("resolve.fuzzy_lookups", stats.fuzzy_lookups as u64);
+    profiler.add("resolve.fuzzy_matches", stats.fuzzy_matches as u64);
+    profiler.add("resolve.contract_matches", stats.contract_matches as u64);
+    for call_type in CallType::ALL {
+        let by_type = &stats.by_call_type[call_type as usize];
+        if by_type.sites == 0 {
+            continue;
+        }
+        let name = call_type.as_str();
+        profiler.add(&format!("resolve.{name}.sites"), by_type.sites as u64);
+        profiler.add(&format!("resolve.{name}.resolved"), by_type.resolved as u64);
+        profiler.add_time("resolve_cpu", name, by_type.resolve_time);
+    }
+}
+
+/// `path` in the form the scanner reports files under `root`
+fn rooted_path(root: &Path, path: &Path) -> PathBuf {
+    if path.is_relative() {
+        return root.join(path);
+    }
+    if path.starts_with(root) {
+        return path.to_path_buf();
+    }
+    match std::fs::canonicalize(root) {
+        Ok(canonical_root) => match path.strip_prefix(&canonical_root) {
+            Ok(relative) => root.join(relative),
+            Err(_) => path.to_path_buf(),
+        },
+        Err(_) => path.to_path_buf(),
+    }
 }
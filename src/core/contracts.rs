@@ -0,0 +1,276 @@
+//! Cross-language call contracts: HTTP routes a function serves and the
+//! client calls that reach them (see `cross-language-call-resolution.md`).
+//!
+//! The call-site pass of each parser records a [`NodeExport`] for every route
+//! registration it walks past (`@app.get("/users/{id}")`, `router.post("/x",
+//! handler)`) and tags outbound calls (`fetch("/users/1")`,
+//! `requests.get(url)`) with an [`http_call_context`]. [`ContractRegistry`]
+//! compiles the exports of a run into a [`RouteTrie`], and call sites that
+//! same-language resolution leaves open are matched against it in one
+//! parallel pass, so no file is read twice.
+
+use serde::{Deserialize, Serialize};
+
+use crate::core::fast_hash::FastMap;
+use crate::core::{CallSite, Edge, EdgeType, NodeId};
+
+/// Protocol of HTTP route exports
+pub const HTTP: &str = "http";
+
+const HTTP_CONTEXT_PREFIX: &str = "protocol=http;method=";
+
+/// An entry point a node exposes to other languages.
+#[derive(Debug, Clone, PartialEq, Eq, Serialize, Deserialize)]
+pub struct NodeExport {
+    pub node_id: NodeId,
+    /// e.g. `http`
+    pub protocol: String,
+    /// `METHOD /path` for HTTP, with `*` for a route serving any method
+    pub signature: String,
+}
+
+impl NodeExport {
+    pub fn http(node_id: NodeId, method: &str, path: &str) -> Self {
+        Self {
+            node_id,
+            protocol: HTTP.to_string(),
+            signature: format!("{} {}", method, path),
+        }
+    }
+}
+
+/// Call-site context of an outbound HTTP request
+pub fn http_call_context(method: &str, path: &str) -> String {
+    format!("{}{};path={}", HTTP_CONTEXT_PREFIX, method, path)
+}
+
+/// `(method, path)` of a context made by [`http_call_context`]
+pub fn parse_http_call(context: &str) -> Option<(&str, &str)> {
+    context
+        .strip_prefix(HTTP_CONTEXT_PREFIX)?
+        .split_once(";path=")
+}
+
+/// Whether `call_site` is an outbound call the registry can resolve
+pub fn is_contract_call(call_site: &CallSite) -> bool {
+    call_site
+        .context
+        .as_deref()
+        .map_or(false, |context| context.starts_with(HTTP_CONTEXT_PREFIX))
+}
+
+/// Upper-case HTTP method named by a client or router method (`get`, `post`)
+pub fn http_method(name: &str) -> Option<&'static str> {
+    const METHODS: [&str; 7] = ["GET", "POST", "PUT", "PATCH", "DELETE", "HEAD", "OPTIONS"];
+    METHODS
+        .into_iter()
+        .find(|method| method.eq_ignore_ascii_case(name))
+}
+
+/// Receivers that conventionally register routes: `app`, `router`, `apiRouter`
+pub fn is_router(receiver: &str) -> bool {
+    matches!(receiver, "app" | "router" | "server")
+        || receiver.ends_with("Router")
+        || receiver.ends_with("_router")
+}
+
+/// Contents of the quoted words in `text`: `POST`, `PUT` in `["POST", 'PUT']`
+pub fn quoted_words(text: &str) -> impl Iterator<Item = &str> {
+    text.split(['"', '\'']).skip(1).step_by(2)
+}
+
+/// Path of a string literal naming a route or URL.
+///
+/// Drops string prefixes and quotes, a leading `${base}` interpolation, the
+/// scheme and host, the query and the fragment; `None` unless what is left
+/// is an absolute path.
+pub fn route_path(literal: &str) -> Option<String> {
+    let text = literal.trim_start_matches(|c: char| c.is_ascii_alphabetic());
+    let quote = text
+        .chars()
+        .next()
+        .filter(|c| matches!(c, '"' | '\'' | '`'))?;
+    let mut path = text.trim_matches(quote);
+    if let Some(rest) = path.strip_prefix("${") {
+        path = &rest[rest.find('}')? + 1..];
+    }
+    if let Some((_, rest)) = path.split_once("://") {
+        path = &rest[rest.find('/')?..];
+    }
+    let path = path.split(['?', '#']).next()?;
+    if !path.starts_with('/') {
+        return None;
+    }
+    match path.trim_end_matches('/') {
+        "" => Some("/".to_string()),
+        path => Some(path.to_string()),
+    }
+}
+
+fn segments(path: &str) -> impl Iterator<Item = &str> + Clone {
+    path.split('/').filter(|segment| !segment.is_empty())
+}
+
+/// Route parameters (`:id`, `{id}`, `<int:id>`, `*`) and client-side
+/// interpolations (`${id}`, f-string `{id}`) match any one segment
+fn is_parameter(segment: &str) -> bool {
+    segment.starts_with(':')
+        || (segment.starts_with('{') && segment.ends_with('}'))
+        || (segment.starts_with('<') && segment.ends_with('>'))
+        || segment.contains("${")
+        || segment == "*"
+}
+
+/// Route patterns by path segment; literal segments are tried before parameters.
+#[derive(Debug, Clone, Default)]
+pub struct RouteTrie {
+    nodes: Vec<TrieNode>,
+    /// Number of inserted routes
+    len: usize,
+}
+
+#[derive(Debug, Clone, Default)]
+struct TrieNode {
+    literals: FastMap<Box<str>, u32>,
+    parameter: Option<u32>,
+    routes: Vec<Route>,
+}
+
+#[derive(Debug, Clone)]
+struct Route {
+    method: Box<str>,
+    pattern: Box<str>,
+    target: NodeId,
+}
+
+/// Route a request path resolved to.
+#[derive(Debug, Clone, Copy)]
+pub struct RouteMatch<'t> {
+    pub target: NodeId,
+    pub method: &'t str,
+    pub pattern: &'t str,
+    /// Every segment and the method matched literally
+    pub exact: bool,
+}
+
+impl RouteTrie {
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    pub fn insert(&mut self, method: &str, pattern: &str, target: NodeId) {
+        if self.nodes.is_empty() {
+            self.nodes.push(TrieNode::default());
+        }
+        let mut at = 0;
+        for segment in segments(pattern) {
+            let next = self.nodes.len() as u32;
+            let node = &mut self.nodes[at];
+            let child = if is_parameter(segment) {
+                *node.parameter.get_or_insert(next)
+            } else {
+                *node.literals.entry(segment.into()).or_insert(next)
+            };
+            if child == next {
+                self.nodes.push(TrieNode::default());
+            }
+            at = child as usize;
+        }
+        self.nodes[at].routes.push(Route {
+            method: method.into(),
+            pattern: pattern.into(),
+            target,
+        });
+        self.len += 1;
+    }
+
+    /// Most specific route serving `method` on `path`
+    pub fn lookup(&self, method: &str, path: &str) -> Option<RouteMatch<'_>> {
+        if self.nodes.is_empty() {
+            return None;
+        }
+        self.walk(0, segments(path), method, true)
+    }
+
+    fn walk<'p>(
+        &self,
+        at: usize,
+        mut rest: impl Iterator<Item = &'p str> + Clone,
+        method: &str,
+        exact: bool,
+    ) -> Option<RouteMatch<'_>> {
+        let node = &self.nodes[at];
+        let Some(segment) = rest.next() else {
+            return Self::route(node, method, exact);
+        };
+        if !is_parameter(segment) {
+            if let Some(&child) = node.literals.get(segment) {
+                if let Some(found) = self.walk(child as usize, rest.clone(), method, exact) {
+                    return Some(found);
+                }
+            }
+        }
+        self.walk(node.parameter? as usize, rest, method, false)
+    }
+
+    fn route<'t>(node: &'t TrieNode, method: &str, exact: bool) -> Option<RouteMatch<'t>> {
+        let found = |route: &'t Route, exact| RouteMatch {
+            target: route.target,
+            method: &route.method,
+            pattern: &route.pattern,
+            exact,
+        };
+        if let Some(route) = node
+            .routes
+            .iter()
+            .find(|route| route.method.eq_ignore_ascii_case(method))
+        {
+            return Some(found(route, exact));
+        }
+        node.routes
+            .iter()
+            .find(|route| &*route.method == "*" || method == "*")
+            .map(|route| found(route, false))
+    }
+}
+
+/// Index of the contracts exported by one analysis run.
+#[derive(Debug, Clone, Default)]
+pub struct ContractRegistry {
+    http_routes: RouteTrie,
+}
+
+impl ContractRegistry {
+    pub fn build(exports: &[NodeExport]) -> Self {
+        let mut registry = Self::default();
+        for export in exports {
+            if export.protocol != HTTP {
+                continue;
+            }
+            if let Some((method, pattern)) = export.signature.split_once(' ') {
+                registry.http_routes.insert(method, pattern, export.node_id);
+            }
+        }
+        registry
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.http_routes.is_empty()
+    }
+
+    /// Call edge from an outbound call to the export it reaches.
+    ///
+    /// The context carries the protocol, a confidence (`high` when path and
+    /// method matched literally, else `medium`) and the matched route.
+    pub fn resolve(&self, call_site: &CallSite) -> Option<Edge> {
+        let (method, path) = parse_http_call(call_site.context.as_deref()?)?;
+        let route = self.http_routes.lookup(method, path)?;
+        let confidence = if route.exact { "high" } else { "medium" };
+        Some(
+            Edge::new(EdgeType::Call, call_site.caller_id, route.target).with_context(format!(
+                "protocol:http;confidence:{};route:{} {};line:{}",
+                confidence, route.method, route.pattern, call_site.line_number
+            )),
+        )
+    }
+}
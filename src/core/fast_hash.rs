@@ -0,0 +1,78 @@
+//! Non-cryptographic hashing for the resolver's in-process maps.
+//!
+//! The std `HashMap` default (SipHash) guards against collision attacks on
+//! untrusted keys. The resolver hashes names and ids from the analyzed tree
+//! millions of times per run and does not need that protection. Names are
+//! hashed once with xxh3, and the maps mix the resulting words with the
+//! multiply-rotate step of rustc's FxHasher.
+
+use std::collections::HashMap;
+use std::hash::{BuildHasherDefault, Hasher};
+use xxhash_rust::xxh3::xxh3_64;
+
+const SEED: u64 = 0x51_7c_c1_b7_27_22_0a_95;
+
+/// Fx-style hasher: cheap for integer keys and pre-hashed `u64` keys.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct FastHasher {
+    hash: u64,
+}
+
+impl FastHasher {
+    #[inline]
+    fn add_word(&mut self, word: u64) {
+        self.hash = (self.hash.rotate_left(5) ^ word).wrapping_mul(SEED);
+    }
+}
+
+impl Hasher for FastHasher {
+    #[inline]
+    fn write(&mut self, bytes: &[u8]) {
+        let mut chunks = bytes.chunks_exact(8);
+        for chunk in &mut chunks {
+            self.add_word(u64::from_le_bytes(chunk.try_into().unwrap()));
+        }
+        let rest = chunks.remainder();
+        if !rest.is_empty() {
+            let mut word = [0u8; 8];
+            word[..rest.len()].copy_from_slice(rest);
+            self.add_word(u64::from_le_bytes(word));
+        }
+    }
+
+    #[inline]
+    fn write_u8(&mut self, value: u8) {
+        self.add_word(value as u64);
+    }
+
+    #[inline]
+    fn write_u32(&mut self, value: u32) {
+        self.add_word(value as u64);
+    }
+
+    #[inline]
+    fn write_u64(&mut self, value: u64) {
+        self.add_word(value);
+    }
+
+    #[inline]
+    fn write_usize(&mut self, value: usize) {
+        self.add_word(value as u64);
+    }
+
+    #[inline]
+    fn finish(&self) -> u64 {
+        self.hash
+    }
+}
+
+pub type FastBuildHasher = BuildHasherDefault<FastHasher>;
+
+/// `HashMap` using [`FastHasher`]
+pub type FastMap<K, V> = HashMap<K, V, FastBuildHasher>;
+
+/// Stable 64-bit hash of a name, used as the key of the resolver indexes
+#[inline]
+pub fn hash_name(name: &str) -> u64 {
+    xxh3_64(name.as_bytes())
+}
@@ -0,0 +1,148 @@
+//! Focused views: the dependency neighborhood of a few files or symbols.
+//!
+//! Agents usually need the code around what they are editing, not the whole
+//! repository. [`focus`] finds the nodes a list of targets names, walks call
+//! and import edges out from them in both directions up to a depth, and
+//! returns the subgraph they span for any formatter to render.
+
+use anyhow::{bail, Result};
+use petgraph::graph::NodeIndex;
+use std::collections::{HashSet, VecDeque};
+use std::path::Path;
+
+use super::graph::GraphBuilder;
+use super::{DependencyGraph, EdgeType, GraphIndex};
+
+/// Edges a focus walk follows, callers and importers as well as callees
+const WALK_EDGES: [EdgeType; 2] = [EdgeType::Call, EdgeType::Import];
+
+/// Outcome of a [`focus`].
+#[derive(Debug, Clone, Default)]
+pub struct FocusSummary {
+    /// Nodes the targets named directly
+    pub seeds: usize,
+    /// Nodes in the focused graph, seeds included
+    pub nodes: usize,
+    /// Targets that named nothing
+    pub unmatched: Vec<String>,
+}
+
+/// Subgraph within `depth` call or import edges of what `targets` name.
+///
+/// A target names a file when it is a path or a path suffix of one (all of
+/// its nodes), and otherwise a symbol: every node of that name, or with a
+/// `Type::name` or `Type.name` qualifier only those contained in a `Type`.
+/// A type also brings the members it contains. Fails when no target names
+/// anything.
+pub fn focus(
+    graph: &DependencyGraph,
+    targets: &[String],
+    depth: usize,
+) -> Result<(DependencyGraph, FocusSummary)> {
+    let index = GraphIndex::new(graph);
+    let mut summary = FocusSummary::default();
+    let mut seeds = Vec::new();
+    for target in targets {
+        let matched = seeds_of(&index, target);
+        if matched.is_empty() {
+            summary.unmatched.push(target.clone());
+        }
+        seeds.extend(matched);
+    }
+    if seeds.is_empty() {
+        bail!("--focus {} matched no file or symbol", targets.join(","));
+    }
+
+    let mut included = vec![false; graph.node_count()];
+    let mut queue = VecDeque::new();
+    for seed in seeds {
+        if !included[seed.index()] {
+            included[seed.index()] = true;
+            summary.seeds += 1;
+            queue.push_back((seed, 0));
+        }
+    }
+    while let Some((node, distance)) = queue.pop_front() {
+        if distance == depth {
+            continue;
+        }
+        for edge_type in WALK_EDGES {
+            let targets = index.targets_of(node, edge_type);
+            let sources = index.sources_of(node, edge_type);
+            for &next in targets.iter().chain(sources) {
+                if !included[next.index()] {
+                    included[next.index()] = true;
+                    queue.push_back((next, distance + 1));
+                }
+            }
+        }
+    }
+
+    let nodes: Vec<NodeIndex> = graph
+        .node_indices()
+        .filter(|node| included[node.index()])
+        .collect();
+    summary.nodes = nodes.len();
+    Ok((subgraph(&index, &nodes), summary))
+}
+
+/// Nodes `target` names, a type's members included
+fn seeds_of(index: &GraphIndex, target: &str) -> Vec<NodeIndex> {
+    let path = Path::new(target);
+    let mut seeds: Vec<NodeIndex> = index
+        .files()
+        .filter(|(file, _)| *file == path || file.ends_with(path))
+        .flat_map(|(_, nodes)| nodes.iter().copied())
+        .collect();
+    if !seeds.is_empty() {
+        return seeds;
+    }
+
+    let (owner, name) = match target.rsplit_once("::").or_else(|| target.rsplit_once('.')) {
+        Some((owner, name)) => (Some(owner.rsplit(['.', ':']).next().unwrap_or(owner)), name),
+        None => (None, target),
+    };
+    let graph = index.graph();
+    seeds = graph
+        .node_indices()
+        .filter(|&node| graph[node].name == name)
+        .filter(|&node| {
+            owner.map_or(true, |owner| {
+                index
+                    .sources_of(node, EdgeType::Contains)
+                    .iter()
+                    .any(|&parent| graph[parent].name == owner)
+            })
+        })
+        .collect();
+
+    // Members of the named types, nested ones included
+    let mut seen: HashSet<NodeIndex> = seeds.iter().copied().collect();
+    let mut next = 0;
+    while next < seeds.len() {
+        for &member in index.targets_of(seeds[next], EdgeType::Contains) {
+            if seen.insert(member) {
+                seeds.push(member);
+            }
+        }
+        next += 1;
+    }
+    seeds
+}
+
+/// `nodes` in graph order with the edges among them
+fn subgraph(index: &GraphIndex, nodes: &[NodeIndex]) -> DependencyGraph {
+    let graph = index.graph();
+    let mut graph_builder = GraphBuilder::new();
+    graph_builder.reserve(nodes.len(), nodes.len());
+    for &node in nodes {
+        graph_builder.add_node(graph[node].clone());
+    }
+    for &node in nodes {
+        // Edges leaving the neighborhood find no target and are dropped
+        for (edge, _) in index.outgoing(node) {
+            graph_builder.add_edge(edge.clone());
+        }
+    }
+    graph_builder.build()
+}
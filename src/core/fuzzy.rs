@@ -0,0 +1,170 @@
+//! Approximate name matching for call resolution.
+//!
+//! A BK-tree over the lowercased names of free functions, built once per
+//! resolver index. Queries only visit subtrees whose edge distance can still be
+//! within the bound, instead of scanning every function.
+
+/// Names longer than this are neither indexed nor queried; keeps the distance
+/// kernel on fixed-size stack rows.
+pub const MAX_FUZZY_NAME_LEN: usize = 64;
+
+/// BK-tree keyed by ASCII-lowercased name bytes.
+#[derive(Debug, Clone)]
+pub struct FuzzyIndex<T> {
+    nodes: Vec<BkNode<T>>,
+}
+
+#[derive(Debug, Clone)]
+struct BkNode<T> {
+    key: Box<[u8]>,
+    value: T,
+    /// (distance to this node, child index)
+    children: Vec<(u8, u32)>,
+}
+
+impl<T: Copy> FuzzyIndex<T> {
+    pub fn new() -> Self {
+        Self { nodes: Vec::new() }
+    }
+
+    /// Adds `name`; the first value inserted for a given lowercased name wins.
+    pub fn insert(&mut self, name: &str, value: T) {
+        let mut buf = [0u8; MAX_FUZZY_NAME_LEN];
+        let Some(key) = lowercase_key(name, &mut buf) else {
+            return;
+        };
+
+        if self.nodes.is_empty() {
+            self.nodes.push(BkNode::new(key, value));
+            return;
+        }
+
+        let mut current = 0usize;
+        loop {
+            let distance = bounded_levenshtein(key, &self.nodes[current].key, MAX_FUZZY_NAME_LEN);
+            if distance == 0 {
+                return;
+            }
+            let distance = distance as u8;
+            match self.nodes[current]
+                .children
+                .iter()
+                .find(|(edge, _)| *edge == distance)
+            {
+                Some(&(_, child)) => current = child as usize,
+                None => {
+                    let child = self.nodes.len() as u32;
+                    self.nodes.push(BkNode::new(key, value));
+                    self.nodes[current].children.push((distance, child));
+                    return;
+                }
+            }
+        }
+    }
+
+    /// Returns the closest value within `max_distance` of `name` (case-insensitive).
+    ///
+    /// Ties go to the name inserted first, so results do not depend on hash order.
+    pub fn closest(&self, name: &str, max_distance: usize) -> Option<(T, usize)> {
+        let mut buf = [0u8; MAX_FUZZY_NAME_LEN];
+        let query = lowercase_key(name, &mut buf)?;
+        if self.nodes.is_empty() {
+            return None;
+        }
+
+        let mut best: Option<(usize, usize)> = None; // (distance, node index)
+        let mut pending = vec![0u32];
+        while let Some(index) = pending.pop() {
+            let node = &self.nodes[index as usize];
+            // Distances past the widest child edge plus the bound can neither
+            // match nor reach a child, so the kernel may stop there
+            let widest_edge = node.children.iter().map(|&(edge, _)| edge as usize).max();
+            let cutoff = widest_edge.unwrap_or(0) + max_distance;
+            let distance = bounded_levenshtein(query, &node.key, cutoff);
+
+            if distance <= max_distance {
+                let better = match best {
+                    None => true,
+                    Some((best_distance, best_index)) => {
+                        (distance, index as usize) < (best_distance, best_index)
+                    }
+                };
+                if better {
+                    best = Some((distance, index as usize));
+                }
+            }
+
+            // Triangle inequality: only children within max_distance of our
+            // distance can hold a match
+            let low = distance.saturating_sub(max_distance);
+            let high = distance + max_distance;
+            for &(edge, child) in &node.children {
+                if (low..=high).contains(&(edge as usize)) {
+                    pending.push(child);
+                }
+            }
+        }
+
+        best.map(|(distance, index)| (self.nodes[index].value, distance))
+    }
+}
+
+impl<T> BkNode<T> {
+    fn new(key: &[u8], value: T) -> Self {
+        Self {
+            key: key.into(),
+            value,
+            children: Vec::new(),
+        }
+    }
+}
+
+/// Writes the ASCII-lowercased bytes of `name` into `buf`; `None` if too long.
+fn lowercase_key<'b>(name: &str, buf: &'b mut [u8; MAX_FUZZY_NAME_LEN]) -> Option<&'b [u8]> {
+    let bytes = name.as_bytes();
+    if bytes.len() > MAX_FUZZY_NAME_LEN {
+        return None;
+    }
+    let key = &mut buf[..bytes.len()];
+    key.copy_from_slice(bytes);
+    key.make_ascii_lowercase();
+    Some(key)
+}
+
+/// Byte-wise Levenshtein distance, saturating at `bound + 1`.
+///
+/// Runs on two stack rows and stops as soon as every cell in a row exceeds
+/// `bound`. Inputs must be at most [`MAX_FUZZY_NAME_LEN`] bytes.
+pub fn bounded_levenshtein(a: &[u8], b: &[u8], bound: usize) -> usize {
+    debug_assert!(a.len() <= MAX_FUZZY_NAME_LEN && b.len() <= MAX_FUZZY_NAME_LEN);
+    if a.len().abs_diff(b.len()) > bound {
+        return bound + 1;
+    }
+    if a.is_empty() || b.is_empty() {
+        return a.len().max(b.len());
+    }
+
+    let mut previous = [0usize; MAX_FUZZY_NAME_LEN + 1];
+    let mut current = [0usize; MAX_FUZZY_NAME_LEN + 1];
+    for (j, cell) in previous.iter_mut().enumerate().take(b.len() + 1) {
+        *cell = j;
+    }
+
+    for (i, &ca) in a.iter().enumerate() {
+        current[0] = i + 1;
+        let mut row_min = current[0];
+        for (j, &cb) in b.iter().enumerate() {
+            let substitution = previous[j] + usize::from(ca != cb);
+            let deletion = previous[j + 1] + 1;
+            let insertion = current[j] + 1;
+            current[j + 1] = substitution.min(deletion).min(insertion);
+            row_min = row_min.min(current[j + 1]);
+        }
+        if row_min > bound {
+            return bound + 1;
+        }
+        std::mem::swap(&mut previous, &mut current);
+    }
+
+    previous[b.len()].min(bound + 1)
+}
@@ -5,7 +5,10 @@
 use petgraph::{graph::NodeIndex, Directed, Graph};
 use serde::{Deserialize, Serialize};
 use std::collections::HashMap;
-use std::path::PathBuf;
+use std::fmt;
+use std::ops::Deref;
+
+use super::interner::{FilePath, NodeId};
 
 /// Type of code entity in the dependency graph.
 #[derive(Debug, Clone, Serialize, Deserialize, PartialEq, Eq, Hash, Copy)]
@@ -24,6 +27,38 @@ pub enum NodeType {
     Enum,
 }
 
+/// Source language of a code entity.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, PartialOrd, Ord, Serialize, Deserialize)]
+pub enum Language {
+    Python,
+    TypeScript,
+    JavaScript,
+    Cpp,
+    Rust,
+    Java,
+    Go,
+    CSharp,
+    /// A language name no parser produces
+    Unknown,
+}
+
+/// Visibility modifier of a code entity.
+#[derive(Debug, Clone, PartialEq, Eq, Hash, Serialize, Deserialize)]
+pub enum Visibility {
+    Public,
+    Private,
+    Protected,
+    Internal,
+    /// Java's default, package-private access
+    Package,
+    /// Python: a name imported from another module
+    External,
+    /// Python: a function defined inside another
+    Nested,
+    /// Any other modifier, kept verbatim
+    Other(Box<str>),
+}
+
 /// Type of relationship between code entities.
 #[derive(Debug, Clone, Serialize, Deserialize, PartialEq, Eq, Hash, Copy)]
 pub enum EdgeType {
@@ -45,23 +80,23 @@ pub enum EdgeType {
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct Node {
     /// Unique identifier: `filepath:type:name:line`
-    pub id: String,
+    pub id: NodeId,
     /// Entity name
     pub name: String,
     /// Entity type
     pub node_type: NodeType,
-    /// Source file path
-    pub file_path: PathBuf,
+    /// Source file path, interned
+    pub file_path: FilePath,
     /// Line number where entity is defined
     pub line_number: usize,
     /// Programming language
-    pub language: String,
+    pub language: Language,
     /// Function/method signature with parameters and types
     pub signature: Option<String>,
     /// Documentation string
     pub docstring: Option<String>,
     /// Visibility modifier (public, private, etc.)
-    pub visibility: Option<String>,
+    pub visibility: Option<Visibility>,
 }
 
 /// An edge representing a relationship between two code entities.
@@ -70,9 +105,9 @@ pub struct Edge {
     /// Type of relationship
     pub edge_type: EdgeType,
     /// Source node identifier
-    pub source_id: String,
+    pub source_id: NodeId,
     /// Target node identifier
-    pub target_id: String,
+    pub target_id: NodeId,
     /// Additional context about the relationship
     pub context: Option<String>,
 }
@@ -80,22 +115,151 @@ pub struct Edge {
 /// Directed graph of code dependencies using petgraph.
 pub type DependencyGraph = Graph<Node, Edge, Directed>;
 
+impl EdgeType {
+    /// Every edge type, in declaration order (`edge_type as usize` indexes it)
+    pub const ALL: [EdgeType; 6] = [
+        EdgeType::Import,
+        EdgeType::Call,
+        EdgeType::Inheritance,
+        EdgeType::Implements,
+        EdgeType::Uses,
+        EdgeType::Contains,
+    ];
+}
+
+impl Language {
+    /// The language a parser name (`"python"`, `"cpp"`, ...) stands for
+    pub fn from_name(name: &str) -> Self {
+        match name {
+            "python" => Language::Python,
+            "typescript" => Language::TypeScript,
+            "javascript" => Language::JavaScript,
+            "cpp" => Language::Cpp,
+            "rust" => Language::Rust,
+            "java" => Language::Java,
+            "go" => Language::Go,
+            "csharp" => Language::CSharp,
+            _ => Language::Unknown,
+        }
+    }
+
+    /// The parser name, as rendered in output
+    pub fn as_str(self) -> &'static str {
+        match self {
+            Language::Python => "python",
+            Language::TypeScript => "typescript",
+            Language::JavaScript => "javascript",
+            Language::Cpp => "cpp",
+            Language::Rust => "rust",
+            Language::Java => "java",
+            Language::Go => "go",
+            Language::CSharp => "csharp",
+            Language::Unknown => "unknown",
+        }
+    }
+}
+
+impl fmt::Display for Language {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str(self.as_str())
+    }
+}
+
+impl From<&str> for Language {
+    fn from(name: &str) -> Self {
+        Language::from_name(name)
+    }
+}
+
+impl From<String> for Language {
+    fn from(name: String) -> Self {
+        Language::from_name(&name)
+    }
+}
+
+impl PartialEq<str> for Language {
+    fn eq(&self, other: &str) -> bool {
+        self.as_str() == other
+    }
+}
+
+impl PartialEq<&str> for Language {
+    fn eq(&self, other: &&str) -> bool {
+        self.as_str() == *other
+    }
+}
+
+impl Visibility {
+    pub fn from_modifier(modifier: &str) -> Self {
+        match modifier {
+            "public" => Visibility::Public,
+            "private" => Visibility::Private,
+            "protected" => Visibility::Protected,
+            "internal" => Visibility::Internal,
+            "package" => Visibility::Package,
+            "external" => Visibility::External,
+            "nested" => Visibility::Nested,
+            other => Visibility::Other(other.into()),
+        }
+    }
+
+    pub fn as_str(&self) -> &str {
+        match self {
+            Visibility::Public => "public",
+            Visibility::Private => "private",
+            Visibility::Protected => "protected",
+            Visibility::Internal => "internal",
+            Visibility::Package => "package",
+            Visibility::External => "external",
+            Visibility::Nested => "nested",
+            Visibility::Other(modifier) => modifier,
+        }
+    }
+}
+
+/// Reads as the modifier text, so `Option<Visibility>::as_deref` gives `Option<&str>`
+impl Deref for Visibility {
+    type Target = str;
+
+    fn deref(&self) -> &str {
+        self.as_str()
+    }
+}
+
+impl fmt::Display for Visibility {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str(self.as_str())
+    }
+}
+
+impl From<&str> for Visibility {
+    fn from(modifier: &str) -> Self {
+        Visibility::from_modifier(modifier)
+    }
+}
+
+impl From<String> for Visibility {
+    fn from(modifier: String) -> Self {
+        Visibility::from_modifier(&modifier)
+    }
+}
+
 impl Node {
     pub fn new(
-        id: String,
+        id: impl Into<NodeId>,
         name: String,
         node_type: NodeType,
-        file_path: PathBuf,
+        file_path: impl Into<FilePath>,
         line_number: usize,
-        language: String,
+        language: impl Into<Language>,
     ) -> Self {
         Self {
-            id,
+            id: id.into(),
             name,
             node_type,
-            file_path,
+            file_path: file_path.into(),
             line_number,
-            language,
+            language: language.into(),
             signature: None,
             docstring: None,
             visibility: None,
@@ -112,18 +276,22 @@ impl Node {
         self
     }
 
-    pub fn with_visibility(mut self, visibility: String) -> Self {
-        self.visibility = Some(visibility);
+    pub fn with_visibility(mut self, visibility: impl Into<Visibility>) -> Self {
+        self.visibility = Some(visibility.into());
         self
     }
 }
 
 impl Edge {
-    pub fn new(edge_type: EdgeType, source_id: String, target_id: String) -> Self {
+    pub fn new(
+        edge_type: EdgeType,
+        source_id: impl Into<NodeId>,
+        target_id: impl Into<NodeId>,
+    ) -> Self {
         Self {
             edge_type,
-            source_id,
-            target_id,
+            source_id: source_id.into(),
+            target_id: target_id.into(),
             context: None,
         }
     }
@@ -137,7 +305,7 @@ impl Edge {
 /// Builder for constructing dependency graphs incrementally.
 pub struct GraphBuilder {
     graph: DependencyGraph,
-    node_map: HashMap<String, NodeIndex>,
+    node_map: HashMap<NodeId, NodeIndex>,
 }
 
 impl GraphBuilder {
@@ -150,7 +318,7 @@ impl GraphBuilder {
     }
 
     pub fn add_node(&mut self, node: Node) -> NodeIndex {
-        let id = node.id.clone();
+        let id = node.id;
         let index = self.graph.add_node(node);
         self.node_map.insert(id, index);
         index
@@ -162,12 +330,75 @@ impl GraphBuilder {
         Some(self.graph.add_edge(*source_idx, *target_idx, edge))
     }
 
+    /// Like [`Self::add_edge`], but only between nodes with an index below `end`,
+    /// as if the nodes from `end` on had not been added yet.
+    pub fn add_edge_before(
+        &mut self,
+        edge: Edge,
+        end: usize,
+    ) -> Option<petgraph::graph::EdgeIndex> {
+        let source_idx = *self.node_map.get(&edge.source_id)?;
+        let target_idx = *self.node_map.get(&edge.target_id)?;
+        if source_idx.index() >= end || target_idx.index() >= end {
+            return None;
+        }
+        Some(self.graph.add_edge(source_idx, target_idx, edge))
+    }
+
+    /// Points the node's id back at `index`, as a fresh [`Self::add_node`] of it would.
+    pub fn index_node(&mut self, index: NodeIndex) {
+        self.node_map.insert(self.graph[index].id, index);
+    }
+
+    /// Number of distinct node ids; below the node count when ids repeat.
+    pub fn id_count(&self) -> usize {
+        self.node_map.len()
+    }
+
+    /// Moves the nodes into the order of `order`, which lists every node index
+    /// once. Edges stay between the same nodes.
+    pub fn reorder_nodes(&mut self, order: &[NodeIndex]) {
+        let (nodes, edges) = std::mem::take(&mut self.graph).into_nodes_edges();
+        debug_assert_eq!(order.len(), nodes.len());
+        let mut nodes: Vec<Option<Node>> = nodes.into_iter().map(|n| Some(n.weight)).collect();
+        let mut moved_to = vec![NodeIndex::end(); nodes.len()];
+        self.graph.reserve_nodes(nodes.len());
+        self.graph.reserve_edges(edges.len());
+        for &index in order {
+            let node = nodes[index.index()].take().expect("node listed twice");
+            moved_to[index.index()] = self.graph.add_node(node);
+        }
+        for edge in edges {
+            let (source, target) = (edge.source(), edge.target());
+            self.graph.add_edge(
+                moved_to[source.index()],
+                moved_to[target.index()],
+                edge.weight,
+            );
+        }
+        for index in self.node_map.values_mut() {
+            *index = moved_to[index.index()];
+        }
+    }
+
+    /// Reserves room for `nodes` more nodes and `edges` more edges.
+    pub fn reserve(&mut self, nodes: usize, edges: usize) {
+        self.graph.reserve_nodes(nodes);
+        self.graph.reserve_edges(edges);
+        self.node_map.reserve(nodes);
+    }
+
+    /// The graph built so far.
+    pub fn graph(&self) -> &DependencyGraph {
+        &self.graph
+    }
+
     pub fn build(self) -> DependencyGraph {
         self.graph
     }
 
     #[allow(dead_code)]
     pub fn get_node_index(&self, id: &str) -> Option<NodeIndex> {
-        self.node_map.get(id).copied()
+        self.node_map.get(&NodeId::lookup(id)?).copied()
     }
 }
@@ -0,0 +1,422 @@
+//! Read-only query index over a finished dependency graph.
+//!
+//! petgraph keeps each node's edges in a linked list, so every neighbour query
+//! chases pointers and the formatters used to collect them into a fresh `Vec`
+//! per call. [`GraphIndex`] is built once from the final graph and holds:
+//!
+//! - CSR adjacency in both directions, for all edges and per [`EdgeType`],
+//!   in petgraph's own iteration order so rendered output does not change
+//! - in/out degrees, read off the CSR offsets
+//! - nodes grouped by file
+//! - call depths, memoized in one pass over the call graph's strongly
+//!   connected components
+
+use petgraph::graph::{EdgeIndex, NodeIndex};
+use petgraph::visit::EdgeRef;
+use petgraph::Direction;
+use std::collections::{HashMap, VecDeque};
+use std::ops::Range;
+use std::path::Path;
+
+use super::graph::{DependencyGraph, Edge, EdgeType, Node};
+
+/// One direction of compressed sparse row adjacency
+#[derive(Default)]
+struct Adjacency {
+    /// `node_count + 1` offsets into `edges` and `neighbors`
+    offsets: Vec<u32>,
+    edges: Vec<EdgeIndex>,
+    /// The other endpoint of each edge
+    neighbors: Vec<NodeIndex>,
+}
+
+impl Adjacency {
+    fn with_capacity(nodes: usize, edges: usize) -> Self {
+        let mut offsets = Vec::with_capacity(nodes + 1);
+        offsets.push(0);
+        Self {
+            offsets,
+            edges: Vec::with_capacity(edges),
+            neighbors: Vec::with_capacity(edges),
+        }
+    }
+
+    fn push(&mut self, edge: EdgeIndex, neighbor: NodeIndex) {
+        self.edges.push(edge);
+        self.neighbors.push(neighbor);
+    }
+
+    fn end_node(&mut self) {
+        self.offsets.push(self.edges.len() as u32);
+    }
+
+    fn range(&self, node: NodeIndex) -> Range<usize> {
+        match (
+            self.offsets.get(node.index()),
+            self.offsets.get(node.index() + 1),
+        ) {
+            (Some(&start), Some(&end)) => start as usize..end as usize,
+            _ => 0..0,
+        }
+    }
+}
+
+/// Both directions of one edge set
+#[derive(Default)]
+struct Csr {
+    outgoing: Adjacency,
+    incoming: Adjacency,
+}
+
+/// Adjacency, degree, file and call depth lookups for one graph.
+pub struct GraphIndex<'g> {
+    graph: &'g DependencyGraph,
+    all: Csr,
+    /// Indexed by `EdgeType as usize`
+    by_type: Vec<Csr>,
+    /// Node indices grouped by file, in node order within each file
+    file_nodes: Vec<NodeIndex>,
+    /// Each file's path and range in `file_nodes`, sorted by path
+    files: Vec<(&'g Path, Range<usize>)>,
+    /// Length of the longest call chain starting at each node
+    call_depths: Vec<u32>,
+}
+
+impl<'g> GraphIndex<'g> {
+    pub fn new(graph: &'g DependencyGraph) -> Self {
+        let (all_out, by_type_out) = Self::adjacency(graph, Direction::Outgoing);
+        let (all_in, by_type_in) = Self::adjacency(graph, Direction::Incoming);
+        let by_type = by_type_out
+            .into_iter()
+            .zip(by_type_in)
+            .map(|(outgoing, incoming)| Csr { outgoing, incoming })
+            .collect();
+        let (file_nodes, files) = Self::group_by_file(graph);
+
+        let mut index = Self {
+            graph,
+            all: Csr {
+                outgoing: all_out,
+                incoming: all_in,
+            },
+            by_type,
+            file_nodes,
+            files,
+            call_depths: Vec::new(),
+        };
+        index.call_depths = index.compute_call_depths();
+        index
+    }
+
+    fn adjacency(graph: &DependencyGraph, direction: Direction) -> (Adjacency, Vec<Adjacency>) {
+        let (nodes, edges) = (graph.node_count(), graph.edge_count());
+        let mut all = Adjacency::with_capacity(nodes, edges);
+        let mut by_type: Vec<Adjacency> = EdgeType::ALL
+            .iter()
+            .map(|_| Adjacency::with_capacity(nodes, 0))
+            .collect();
+
+        for node in graph.node_indices() {
+            for edge_ref in graph.edges_directed(node, direction) {
+                let neighbor = match direction {
+                    Direction::Outgoing => edge_ref.target(),
+                    Direction::Incoming => edge_ref.source(),
+                };
+                all.push(edge_ref.id(), neighbor);
+                by_type[edge_ref.weight().edge_type as usize].push(edge_ref.id(), neighbor);
+            }
+            all.end_node();
+            for adjacency in &mut by_type {
+                adjacency.end_node();
+            }
+        }
+        (all, by_type)
+    }
+
+    fn group_by_file(
+        graph: &'g DependencyGraph,
+    ) -> (Vec<NodeIndex>, Vec<(&'g Path, Range<usize>)>) {
+        let mut groups: HashMap<&'g Path, Vec<NodeIndex>> = HashMap::new();
+        for node in graph.node_indices() {
+            groups
+                .entry(graph[node].file_path.as_path())
+                .or_default()
+                .push(node);
+        }
+        let mut groups: Vec<(&'g Path, Vec<NodeIndex>)> = groups.into_iter().collect();
+        groups.sort_unstable_by(|a, b| a.0.cmp(b.0));
+
+        let mut file_nodes = Vec::with_capacity(graph.node_count());
+        let mut files = Vec::with_capacity(groups.len());
+        for (path, nodes) in groups {
+            let start = file_nodes.len();
+            file_nodes.extend(nodes);
+            files.push((path, start..file_nodes.len()));
+        }
+        (file_nodes, files)
+    }
+
+    pub fn graph(&self) -> &'g DependencyGraph {
+        self.graph
+    }
+
+    pub fn node(&self, node: NodeIndex) -> &'g Node {
+        &self.graph[node]
+    }
+
+    /// All outgoing edges of `node` with their targets
+    pub fn outgoing(&self, node: NodeIndex) -> Neighbors<'_, 'g> {
+        self.neighbors(&self.all.outgoing, node)
+    }
+
+    /// All incoming edges of `node` with their sources
+    #[allow(dead_code)]
+    pub fn incoming(&self, node: NodeIndex) -> Neighbors<'_, 'g> {
+        self.neighbors(&self.all.incoming, node)
+    }
+
+    /// Outgoing edges of `node` of one type
+    pub fn outgoing_of(&self, node: NodeIndex, edge_type: EdgeType) -> Neighbors<'_, 'g> {
+        self.neighbors(&self.by_type[edge_type as usize].outgoing, node)
+    }
+
+    /// Incoming edges of `node` of one type
+    pub fn incoming_of(&self, node: NodeIndex, edge_type: EdgeType) -> Neighbors<'_, 'g> {
+        self.neighbors(&self.by_type[edge_type as usize].incoming, node)
+    }
+
+    /// Target indices of `node`'s outgoing edges of one type
+    pub fn targets_of(&self, node: NodeIndex, edge_type: EdgeType) -> &[NodeIndex] {
+        let adjacency = &self.by_type[edge_type as usize].outgoing;
+        &adjacency.neighbors[adjacency.range(node)]
+    }
+
+    /// Source indices of `node`'s incoming edges of one type
+    pub fn sources_of(&self, node: NodeIndex, edge_type: EdgeType) -> &[NodeIndex] {
+        let adjacency = &self.by_type[edge_type as usize].incoming;
+        &adjacency.neighbors[adjacency.range(node)]
+    }
+
+    pub fn out_degree(&self, node: NodeIndex) -> usize {
+        self.all.outgoing.range(node).len()
+    }
+
+    pub fn in_degree(&self, node: NodeIndex) -> usize {
+        self.all.incoming.range(node).len()
+    }
+
+    /// Number of edges of one type in the graph
+    pub fn edge_count_of(&self, edge_type: EdgeType) -> usize {
+        self.by_type[edge_type as usize].outgoing.edges.len()
+    }
+
+    /// Files in path order, each with its nodes in graph order
+    pub fn files(&self) -> impl Iterator<Item = (&'g Path, &[NodeIndex])> + '_ {
+        self.files
+            .iter()
+            .map(|(path, range)| (*path, &self.file_nodes[range.clone()]))
+    }
+
+    /// Number of nodes on the longest call chain starting at `node`.
+    ///
+    /// A chain never visits a function twice, so a self call adds nothing and
+    /// a chain entering a simple cycle can go around it once before leaving.
+    /// Members of a component with several cycles all get its size plus its
+    /// deepest exit.
+    pub fn call_depth(&self, node: NodeIndex) -> usize {
+        self.call_depths
+            .get(node.index())
+            .map_or(0, |&depth| depth as usize)
+    }
+
+    fn neighbors<'i>(&'i self, adjacency: &'i Adjacency, node: NodeIndex) -> Neighbors<'i, 'g> {
+        let range = adjacency.range(node);
+        Neighbors {
+            graph: self.graph,
+            edges: adjacency.edges[range.clone()].iter(),
+            neighbors: adjacency.neighbors[range].iter(),
+        }
+    }
+
+    /// Call depth per node, from Tarjan's algorithm over the call edges.
+    ///
+    /// Components complete in reverse topological order, so the depths of
+    /// everything a component calls are known by the time it completes.
+    fn compute_call_depths(&self) -> Vec<u32> {
+        const UNVISITED: u32 = u32::MAX;
+        let node_count = self.graph.node_count();
+        let calls = &self.by_type[EdgeType::Call as usize].outgoing;
+
+        let mut order = vec![UNVISITED; node_count];
+        let mut low = vec![0u32; node_count];
+        let mut on_stack = vec![false; node_count];
+        let mut component = vec![UNVISITED; node_count];
+        let mut components = 0u32;
+        let mut depths = vec![0u32; node_count];
+        let mut stack: Vec<usize> = Vec::new();
+        // (node, next position in its call list)
+        let mut frames: Vec<(usize, usize)> = Vec::new();
+        let mut counter = 0u32;
+
+        for root in 0..node_count {
+            if order[root] != UNVISITED {
+                continue;
+            }
+            order[root] = counter;
+            low[root] = counter;
+            counter += 1;
+            stack.push(root);
+            on_stack[root] = true;
+            frames.push((root, calls.offsets[root] as usize));
+
+            while let Some(frame) = frames.last_mut() {
+                let (node, position) = *frame;
+                if position < calls.offsets[node + 1] as usize {
+                    frame.1 += 1;
+                    let next = calls.neighbors[position].index();
+                    if order[next] == UNVISITED {
+                        order[next] = counter;
+                        low[next] = counter;
+                        counter += 1;
+                        stack.push(next);
+                        on_stack[next] = true;
+                        frames.push((next, calls.offsets[next] as usize));
+                    } else if on_stack[next] {
+                        low[node] = low[node].min(order[next]);
+                    }
+                    continue;
+                }
+
+                frames.pop();
+                if let Some(&(parent, _)) = frames.last() {
+                    low[parent] = low[parent].min(low[node]);
+                }
+                if low[node] != order[node] {
+                    continue;
+                }
+
+                // `node` roots a component: pop it and take its depths
+                let id = components;
+                components += 1;
+                let members_start = stack
+                    .iter()
+                    .rposition(|&member| member == node)
+                    .unwrap_or(0);
+                let members = stack.split_off(members_start);
+                for &member in &members {
+                    on_stack[member] = false;
+                    component[member] = id;
+                }
+                component_depths(calls, &members, &component, &mut depths);
+            }
+        }
+
+        depths
+    }
+}
+
+/// Fills in `depths` of a completed call component from the depths of what it calls.
+///
+/// Matches the longest simple call chain from each member: a lone function
+/// adds one to its deepest callee, and a chain from a member of a simple cycle
+/// goes around it as far as the exit that leads deepest. When a component has
+/// several cycles the longest simple path is costly to find, so every member
+/// gets the component's size plus its deepest exit, which over-counts only
+/// when no simple path visits every member.
+fn component_depths(calls: &Adjacency, members: &[usize], component: &[u32], depths: &mut [u32]) {
+    let id = component[members[0]];
+    let callees = |member: usize| {
+        let range = calls.offsets[member] as usize..calls.offsets[member + 1] as usize;
+        calls.neighbors[range].iter().map(|callee| callee.index())
+    };
+    // One for the member plus the deepest chain leaving the component from it
+    let exit_depth = |member: usize| {
+        1 + callees(member)
+            .filter(|&callee| component[callee] != id)
+            .map(|callee| depths[callee])
+            .max()
+            .unwrap_or(0)
+    };
+
+    if let [member] = *members {
+        depths[member] = exit_depth(member);
+        return;
+    }
+
+    // A simple cycle: each member calls exactly one other member
+    let mut successor = HashMap::with_capacity(members.len());
+    let mut simple = true;
+    for &member in members {
+        let mut inside = callees(member).filter(|&callee| component[callee] == id);
+        let Some(next) = inside.next() else {
+            simple = false;
+            break;
+        };
+        if inside.any(|callee| callee != next) {
+            simple = false;
+            break;
+        }
+        successor.insert(member, next);
+    }
+    if !simple {
+        let deepest_exit = members.iter().map(|&member| exit_depth(member)).max();
+        let depth = members.len() as u32 - 1 + deepest_exit.unwrap_or(1);
+        for &member in members {
+            depths[member] = depth;
+        }
+        return;
+    }
+
+    // The chain from ring position `i` ends at some `i + j` (j < len) and is
+    // `j + exit_depth` long: a sliding-window maximum over the ring twice around
+    let len = members.len();
+    let mut ring = Vec::with_capacity(len);
+    let mut member = members[0];
+    for _ in 0..len {
+        ring.push(member);
+        member = successor[&member];
+    }
+    let exits: Vec<u32> = ring.iter().map(|&member| exit_depth(member)).collect();
+    let reach = |position: usize| position as u32 + exits[position % len];
+    let mut window: VecDeque<usize> = VecDeque::new();
+    for position in 0..2 * len - 1 {
+        while window
+            .back()
+            .is_some_and(|&last| reach(last) <= reach(position))
+        {
+            window.pop_back();
+        }
+        window.push_back(position);
+        if position + 1 < len {
+            continue;
+        }
+        let start = position + 1 - len;
+        while window.front().is_some_and(|&first| first < start) {
+            window.pop_front();
+        }
+        depths[ring[start]] = reach(window[0]) - start as u32;
+    }
+}
+
+/// Edges of one node from a [`GraphIndex`], each with the node at its other end
+pub struct Neighbors<'i, 'g> {
+    graph: &'g DependencyGraph,
+    edges: std::slice::Iter<'i, EdgeIndex>,
+    neighbors: std::slice::Iter<'i, NodeIndex>,
+}
+
+impl<'i, 'g> Iterator for Neighbors<'i, 'g> {
+    type Item = (&'g Edge, &'g Node);
+
+    fn next(&mut self) -> Option<Self::Item> {
+        let edge = *self.edges.next()?;
+        let neighbor = *self.neighbors.next()?;
+        Some((&self.graph[edge], &self.graph[neighbor]))
+    }
+
+    fn size_hint(&self) -> (usize, Option<usize>) {
+        self.edges.size_hint()
+    }
+}
+
+impl ExactSizeIterator for Neighbors<'_, '_> {}
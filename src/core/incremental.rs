@@ -0,0 +1,379 @@
+//! Incremental re-analysis.
+//!
+//! An [`AnalysisState`] keeps, per source file, the nodes, edges and call sites
+//! the parser produced together with the call edges they resolved to. Applying
+//! a set of changed files swaps only those files' records, rebuilds the graph
+//! from the records and re-resolves just the call sites whose lookup name was
+//! added or removed by the change (or could now fuzzy-match one). Every other
+//! call edge is reused as is.
+
+use anyhow::{Context, Result};
+use serde::{Deserialize, Serialize};
+use std::collections::{BTreeMap, HashSet};
+use std::fs;
+use std::io::Write;
+use std::path::{Path, PathBuf};
+use std::process::Command;
+use std::time::UNIX_EPOCH;
+
+use super::contracts;
+use super::fuzzy::FuzzyIndex;
+use super::graph::GraphBuilder;
+use super::resolver::{ResolutionStats, FUZZY_MAX_DISTANCE};
+use super::{CallSite, DependencyGraph, Edge, FunctionResolver, Node, NodeExport, NodeType};
+use crate::parsers::limits::{LimitReason, ParseLimits};
+use crate::parsers::ParseResult;
+
+/// Bumped whenever the serialized layout of [`AnalysisState`] changes
+const STATE_VERSION: u32 = 6;
+
+/// Persisted analysis of one root directory and language set.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct AnalysisState {
+    version: u32,
+    root: PathBuf,
+    languages: Vec<String>,
+    fuzzy_matching: bool,
+    cross_language: bool,
+    /// [`ParseLimits::fingerprint`] of the limits the records were parsed under
+    limits: u64,
+    /// Ordered by path, matching the order the scanner feeds a full run
+    files: BTreeMap<PathBuf, FileRecord>,
+}
+
+/// Everything one file contributed to the last analysis.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct FileRecord {
+    /// Modification time (ns) and size when the file was parsed
+    pub stamp: Option<(u64, u64)>,
+    pub nodes: Vec<Node>,
+    pub edges: Vec<Edge>,
+    pub call_sites: Vec<CallSite>,
+    pub exports: Vec<NodeExport>,
+    /// Resolution of each entry of `call_sites`, in the same order
+    resolved: Vec<Option<Edge>>,
+}
+
+/// A file to add, replace or drop when updating an [`AnalysisState`].
+pub enum FileChange {
+    Updated {
+        path: PathBuf,
+        result: ParseResult,
+        stamp: Option<(u64, u64)>,
+    },
+    Removed(PathBuf),
+}
+
+/// What an [`AnalysisState::apply`] call had to redo.
+#[derive(Debug, Clone, Copy, Default)]
+pub struct UpdateSummary {
+    pub files_changed: usize,
+    pub call_sites_total: usize,
+    pub call_sites_resolved: usize,
+    pub call_edges: usize,
+    pub memo: ResolutionStats,
+}
+
+impl AnalysisState {
+    pub fn new(
+        root: &Path,
+        languages: &[&str],
+        fuzzy_matching: bool,
+        cross_language: bool,
+        limits: &ParseLimits,
+    ) -> Self {
+        Self {
+            version: STATE_VERSION,
+            root: root.to_path_buf(),
+            languages: languages.iter().map(|lang| lang.to_string()).collect(),
+            fuzzy_matching,
+            cross_language,
+            limits: limits.fingerprint(),
+            files: BTreeMap::new(),
+        }
+    }
+
+    /// State file for `root` and `languages` inside `cache_dir`
+    pub fn path_in(cache_dir: &Path, root: &Path, languages: &[&str]) -> PathBuf {
+        use std::hash::{Hash, Hasher};
+        let mut hasher = std::collections::hash_map::DefaultHasher::new();
+        fs::canonicalize(root)
+            .unwrap_or_else(|_| root.to_path_buf())
+            .hash(&mut hasher);
+        languages.hash(&mut hasher);
+        cache_dir.join(format!("analysis-{:016x}.state", hasher.finish()))
+    }
+
+    /// Loads a saved state; `None` if it is missing, unreadable or from another version
+    pub fn load(path: &Path) -> Option<Self> {
+        let bytes = fs::read(path).ok()?;
+        match bincode::deserialize::<Self>(&bytes) {
+            Ok(state) if state.version == STATE_VERSION => Some(state),
+            Ok(_) => None,
+            Err(err) => {
+                eprintln!(
+                    "Warning: Ignoring unreadable analysis state {}: {err}",
+                    path.display()
+                );
+                None
+            }
+        }
+    }
+
+    /// Writes the state next to `path` and renames it into place
+    pub fn save(&self, path: &Path) -> Result<()> {
+        if let Some(parent) = path.parent() {
+            fs::create_dir_all(parent)?;
+        }
+        let bytes = bincode::serialize(self)?;
+        let tmp = path.with_extension("state.tmp");
+        let mut file = fs::File::create(&tmp)
+            .with_context(|| format!("failed to create {}", tmp.display()))?;
+        file.write_all(&bytes)?;
+        drop(file);
+        fs::rename(&tmp, path).with_context(|| format!("failed to replace {}", path.display()))?;
+        Ok(())
+    }
+
+    /// Whether this state was built for the same inputs, parse limits and resolver settings
+    pub fn matches(
+        &self,
+        root: &Path,
+        languages: &[&str],
+        fuzzy_matching: bool,
+        cross_language: bool,
+        limits: &ParseLimits,
+    ) -> bool {
+        self.root == root
+            && self.fuzzy_matching == fuzzy_matching
+            && self.cross_language == cross_language
+            && self.limits == limits.fingerprint()
+            && self
+                .languages
+                .iter()
+                .map(String::as_str)
+                .eq(languages.iter().copied())
+    }
+
+    pub fn file_count(&self) -> usize {
+        self.files.len()
+    }
+
+    /// Recorded stamp of every analyzed file
+    pub fn stamps(&self) -> impl Iterator<Item = (&Path, Option<(u64, u64)>)> {
+        self.files
+            .iter()
+            .map(|(path, record)| (path.as_path(), record.stamp))
+    }
+
+    /// Recorded stamp of `path`; `None` if the file is not part of the state
+    pub fn stamp(&self, path: &Path) -> Option<Option<(u64, u64)>> {
+        self.files.get(path).map(|record| record.stamp)
+    }
+
+    pub fn contains(&self, path: &Path) -> bool {
+        self.files.contains_key(path)
+    }
+
+    /// Applies `changes` and returns the updated graph.
+    ///
+    /// The graph is rebuilt from the stored records in path order, exactly as a
+    /// full run would assemble it, so node and edge order match a clean analysis.
+    ///
+    /// The rebuild and the resolver's indexes are linear in the whole graph,
+    /// but they only copy records: nothing is parsed and only stale call sites
+    /// are resolved, which is where a clean run spends its time. Patching the
+    /// graph in place instead would renumber nodes on removal and break that
+    /// order. `cargo bench --bench pipeline -- incremental` compares one edited
+    /// file against a full build.
+    pub fn apply(
+        &mut self,
+        changes: Vec<FileChange>,
+        resolver: &FunctionResolver,
+    ) -> Result<(DependencyGraph, UpdateSummary)> {
+        let mut summary = UpdateSummary {
+            files_changed: changes.len(),
+            ..UpdateSummary::default()
+        };
+
+        // Swap in the changed records, remembering every function name that
+        // appeared or disappeared
+        let mut changed_names: HashSet<String> = HashSet::new();
+        let mut fresh: HashSet<PathBuf> = HashSet::new();
+        for change in changes {
+            let (path, record) = match change {
+                FileChange::Updated {
+                    path,
+                    result,
+                    stamp,
+                } => {
+                    // No stamp for a timed-out outline, so the next scan retries it
+                    let stamp = stamp.filter(|_| result.limited != Some(LimitReason::Timeout));
+                    let call_sites = result.call_sites.unwrap_or_default();
+                    let record = FileRecord {
+                        stamp,
+                        resolved: vec![None; call_sites.len()],
+                        nodes: result.nodes,
+                        edges: result.edges,
+                        call_sites,
+                        exports: result.exports,
+                    };
+                    (path, Some(record))
+                }
+                FileChange::Removed(path) => (path, None),
+            };
+
+            if let Some(old) = self.files.remove(&path) {
+                changed_names.extend(function_names(&old.nodes));
+            }
+            fresh.remove(&path);
+            if let Some(record) = record {
+                changed_names.extend(function_names(&record.nodes));
+                fresh.insert(path.clone());
+                self.files.insert(path, record);
+            }
+        }
+
+        let mut graph_builder = GraphBuilder::new();
+        let total_nodes = self.files.values().map(|r| r.nodes.len()).sum();
+        let total_edges = self
+            .files
+            .values()
+            .map(|r| r.edges.len() + r.call_sites.len())
+            .sum();
+        graph_builder.reserve(total_nodes, total_edges);
+        for record in self.files.values() {
+            for node in &record.nodes {
+                graph_builder.add_node(node.clone());
+            }
+            for edge in &record.edges {
+                graph_builder.add_edge(edge.clone());
+            }
+        }
+
+        let mut resolver = resolver.clone();
+        resolver.build_indexes(graph_builder.graph())?;
+        let exports: Vec<NodeExport> = self
+            .files
+            .values()
+            .flat_map(|record| record.exports.iter().cloned())
+            .collect();
+        resolver.index_exports(&exports);
+
+        // Names within fuzzy distance of a changed name may now resolve differently
+        let mut near_changed = FuzzyIndex::new();
+        if resolver.fuzzy_matching() {
+            for name in &changed_names {
+                near_changed.insert(name, ());
+            }
+        }
+
+        let mut pending: Vec<(&PathBuf, usize)> = Vec::new();
+        let mut pending_sites: Vec<&CallSite> = Vec::new();
+        for (path, record) in &self.files {
+            summary.call_sites_total += record.call_sites.len();
+            let all = fresh.contains(path);
+            for (index, call_site) in record.call_sites.iter().enumerate() {
+                // Outbound requests are few and depend on every file's exports
+                let stale = all
+                    || contracts::is_contract_call(call_site)
+                    || changed_names.contains(FunctionResolver::lookup_name(call_site))
+                    || (resolver.may_fuzzy_match(call_site)
+                        && record.resolved[index]
+                            .as_ref()
+                            .map_or(true, |edge| is_fuzzy_edge(edge))
+                        && near_changed
+                            .closest(&call_site.called_name, FUZZY_MAX_DISTANCE)
+                            .is_some());
+                if stale {
+                    pending.push((path, index));
+                    pending_sites.push(call_site);
+                }
+            }
+        }
+
+        let (resolved, memo) = resolver.resolve_call_sites(graph_builder.graph(), &pending_sites);
+        summary.call_sites_resolved = pending_sites.len();
+        summary.memo = memo;
+        let pending: Vec<(PathBuf, usize)> = pending
+            .into_iter()
+            .map(|(path, index)| (path.clone(), index))
+            .collect();
+        drop(pending_sites);
+        for ((path, index), edge) in pending.into_iter().zip(resolved) {
+            if let Some(record) = self.files.get_mut(&path) {
+                record.resolved[index] = edge;
+            }
+        }
+
+        // Call edges go in after all parsed edges, in call-site order, as in a full run
+        for record in self.files.values() {
+            for edge in record.resolved.iter().flatten() {
+                if graph_builder.add_edge(edge.clone()).is_some() {
+                    summary.call_edges += 1;
+                }
+            }
+        }
+
+        Ok((graph_builder.build(), summary))
+    }
+}
+
+fn function_names(nodes: &[Node]) -> impl Iterator<Item = String> + '_ {
+    nodes
+        .iter()
+        .filter(|node| node.node_type == NodeType::Function)
+        .map(|node| node.name.clone())
+}
+
+fn is_fuzzy_edge(edge: &Edge) -> bool {
+    edge.context
+        .as_deref()
+        .map_or(false, |context| context.starts_with("fuzzy_match:"))
+}
+
+/// Modification time (ns) and size of `path`, if it can be read
+pub fn file_stamp(path: &Path) -> Option<(u64, u64)> {
+    let metadata = fs::metadata(path).ok()?;
+    let modified = metadata
+        .modified()
+        .ok()?
+        .duration_since(UNIX_EPOCH)
+        .unwrap_or_default()
+        .as_nanos() as u64;
+    Some((modified, metadata.len()))
+}
+
+/// Files under `root` that differ from git revision `rev`, plus untracked files
+///
+/// Paths are joined onto `root`, the form the scanner reports them in.
+pub fn git_changed_paths(root: &Path, rev: &str) -> Result<Vec<PathBuf>> {
+    let mut paths = Vec::new();
+    for args in [
+        vec!["diff", "--name-only", "--relative", rev, "--"],
+        vec!["ls-files", "--others", "--exclude-standard"],
+    ] {
+        let output = Command::new("git")
+            .arg("-C")
+            .arg(root)
+            .args(&args)
+            .output()
+            .context("failed to run git")?;
+        if !output.status.success() {
+            anyhow::bail!(
+                "git {} failed: {}",
+                args[0],
+                String::from_utf8_lossy(&output.stderr).trim()
+            );
+        }
+        paths.extend(
+            String::from_utf8_lossy(&output.stdout)
+                .lines()
+                .filter(|line| !line.is_empty())
+                .map(|line| root.join(line)),
+        );
+    }
+    paths.sort();
+    paths.dedup();
+    Ok(paths)
+}
@@ -0,0 +1,380 @@
+//! Interned node identifiers and file paths.
+//!
+//! Parsers format each node id (`filepath:type:name:line`) once and intern it;
+//! nodes, edges, call sites, the graph builder and the resolver then carry a
+//! 4-byte [`NodeId`]. The string form is only looked up at output time through
+//! `Display` and `Serialize`, so cached and rendered ids are unchanged.
+//!
+//! Every node of a file names the same path, so nodes carry a 4-byte
+//! [`FilePath`] into a second table instead of a `PathBuf` each.
+//!
+//! Both tables are process-wide and append-only: an entry is never freed, even
+//! once no node refers to it. A one-shot run interns each id once. A long
+//! `--watch` session also keeps the ids of every earlier version of an edited
+//! file, since ids carry line numbers; that growth is bounded by the edits made
+//! and is reclaimed by restarting the watcher.
+
+use dashmap::DashMap;
+use serde::de::{self, Visitor};
+use serde::{Deserialize, Deserializer, Serialize, Serializer};
+use std::cmp::Ordering;
+use std::ffi::OsStr;
+use std::fmt;
+use std::hash::Hash;
+use std::ops::Deref;
+use std::path::{Path, PathBuf};
+use std::sync::{Mutex, OnceLock};
+
+/// Compact handle to an interned node id string.
+///
+/// Ids are process-wide: equal strings always intern to the same `NodeId`, so
+/// comparing and hashing ids never touches the string. The table is append-only
+/// and lives for the rest of the process.
+#[derive(Clone, Copy, PartialEq, Eq, Hash)]
+pub struct NodeId(u32);
+
+/// Compact handle to an interned source file path.
+///
+/// Same scheme as [`NodeId`], keyed on the path's OS string, so paths that
+/// are not valid UTF-8 stay distinct. Paths are interned in normalized form
+/// (`a//b` and `a/./b` as `a/b`), so handles are equal exactly when the paths
+/// compare equal, and ordering follows `Path` as it does for `PathBuf`. The
+/// path is reached through `Deref`.
+#[derive(Clone, Copy, PartialEq, Eq, Hash)]
+pub struct FilePath(u32);
+
+/// Append-only table of `T` values; handles are indices into `values`
+struct Interner<T: ?Sized + 'static> {
+    ids: DashMap<&'static T, u32>,
+    values: Arena<T>,
+    /// Next free handle; held while adding so racing threads agree on one handle
+    len: Mutex<u32>,
+}
+
+/// Size of the first arena chunk as a power of two; each later chunk doubles
+const FIRST_CHUNK_BITS: u32 = 10;
+/// Enough doubling chunks to hold every `u32` handle
+const ARENA_CHUNKS: usize = (u32::BITS + 1 - FIRST_CHUNK_BITS) as usize;
+
+/// Append-only slots read without locking.
+///
+/// Chunks are allocated on first use and never move, so a published slot
+/// stays valid while later chunks are added; reading one is two acquire loads.
+struct Arena<T: ?Sized + 'static> {
+    chunks: [OnceLock<Box<[OnceLock<&'static T>]>>; ARENA_CHUNKS],
+}
+
+impl<T: ?Sized + 'static> Arena<T> {
+    fn new() -> Self {
+        Self {
+            chunks: std::array::from_fn(|_| OnceLock::new()),
+        }
+    }
+
+    /// Chunk and offset of `handle`
+    fn locate(handle: u32) -> (usize, usize) {
+        let pos = u64::from(handle) + (1 << FIRST_CHUNK_BITS);
+        let bit = u64::BITS - 1 - pos.leading_zeros();
+        (
+            (bit - FIRST_CHUNK_BITS) as usize,
+            (pos - (1 << bit)) as usize,
+        )
+    }
+
+    fn set(&self, handle: u32, value: &'static T) {
+        let (chunk, offset) = Self::locate(handle);
+        let slots = self.chunks[chunk].get_or_init(|| {
+            (0..1usize << (chunk as u32 + FIRST_CHUNK_BITS))
+                .map(|_| OnceLock::new())
+                .collect()
+        });
+        let _ = slots[offset].set(value);
+    }
+
+    fn get(&self, handle: u32) -> &'static T {
+        let (chunk, offset) = Self::locate(handle);
+        self.chunks[chunk]
+            .get()
+            .and_then(|slots| slots[offset].get())
+            .copied()
+            .expect("handle was never interned")
+    }
+}
+
+impl<T: ?Sized + Eq + Hash + 'static> Interner<T>
+where
+    for<'a> Box<T>: From<&'a T>,
+{
+    fn new() -> Self {
+        Self {
+            ids: DashMap::new(),
+            values: Arena::new(),
+            len: Mutex::new(0),
+        }
+    }
+
+    fn intern(&self, value: &T) -> u32 {
+        if let Some(existing) = self.ids.get(value) {
+            return *existing;
+        }
+
+        let mut len = self.len.lock().unwrap_or_else(|e| e.into_inner());
+        if let Some(existing) = self.ids.get(value) {
+            return *existing;
+        }
+        let stored: &'static T = Box::leak(Box::from(value));
+        let handle = *len;
+        // Published before the handle can be found, so any holder can resolve it
+        self.values.set(handle, stored);
+        *len += 1;
+        self.ids.insert(stored, handle);
+        handle
+    }
+
+    /// Makes `value` another key of an existing `handle`
+    fn alias(&self, value: &T, handle: u32) {
+        if !self.ids.contains_key(value) {
+            self.ids.insert(Box::leak(Box::from(value)), handle);
+        }
+    }
+
+    fn lookup(&self, value: &T) -> Option<u32> {
+        self.ids.get(value).map(|existing| *existing)
+    }
+
+    fn resolve(&self, handle: u32) -> &'static T {
+        self.values.get(handle)
+    }
+}
+
+fn node_ids() -> &'static Interner<str> {
+    static NODE_IDS: OnceLock<Interner<str>> = OnceLock::new();
+    NODE_IDS.get_or_init(Interner::new)
+}
+
+fn file_paths() -> &'static Interner<OsStr> {
+    static FILE_PATHS: OnceLock<Interner<OsStr>> = OnceLock::new();
+    FILE_PATHS.get_or_init(Interner::new)
+}
+
+impl NodeId {
+    /// Returns the id for `id`, interning it on first sight.
+    pub fn intern(id: &str) -> Self {
+        NodeId(node_ids().intern(id))
+    }
+
+    /// Returns the id for `id` if it has been interned, without adding it.
+    pub fn lookup(id: &str) -> Option<Self> {
+        node_ids().lookup(id).map(NodeId)
+    }
+
+    /// The original id string.
+    pub fn as_str(self) -> &'static str {
+        node_ids().resolve(self.0)
+    }
+}
+
+impl fmt::Display for NodeId {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str(self.as_str())
+    }
+}
+
+impl fmt::Debug for NodeId {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(f, "NodeId({:?})", self.as_str())
+    }
+}
+
+impl From<&str> for NodeId {
+    fn from(id: &str) -> Self {
+        NodeId::intern(id)
+    }
+}
+
+impl From<String> for NodeId {
+    fn from(id: String) -> Self {
+        NodeId::intern(&id)
+    }
+}
+
+impl From<&String> for NodeId {
+    fn from(id: &String) -> Self {
+        NodeId::intern(id)
+    }
+}
+
+impl PartialEq<str> for NodeId {
+    fn eq(&self, other: &str) -> bool {
+        self.as_str() == other
+    }
+}
+
+impl PartialEq<&str> for NodeId {
+    fn eq(&self, other: &&str) -> bool {
+        self.as_str() == *other
+    }
+}
+
+impl Serialize for NodeId {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        serializer.serialize_str(self.as_str())
+    }
+}
+
+impl<'de> Deserialize<'de> for NodeId {
+    fn deserialize<D: Deserializer<'de>>(deserializer: D) -> Result<Self, D::Error> {
+        struct NodeIdVisitor;
+
+        impl<'de> Visitor<'de> for NodeIdVisitor {
+            type Value = NodeId;
+
+            fn expecting(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+                f.write_str("a node id string")
+            }
+
+            fn visit_str<E: de::Error>(self, value: &str) -> Result<NodeId, E> {
+                Ok(NodeId::intern(value))
+            }
+        }
+
+        deserializer.deserialize_str(NodeIdVisitor)
+    }
+}
+
+impl FilePath {
+    /// Returns the handle for `path`, interning it on first sight.
+    pub fn intern(path: &Path) -> Self {
+        let table = file_paths();
+        if let Some(handle) = table.lookup(path.as_os_str()) {
+            return FilePath(handle);
+        }
+        // Other spellings of the same path share the normalized entry
+        let normalized: PathBuf = path.components().collect();
+        let handle = table.intern(normalized.as_os_str());
+        if normalized.as_os_str() != path.as_os_str() {
+            table.alias(path.as_os_str(), handle);
+        }
+        FilePath(handle)
+    }
+
+    pub fn as_path(self) -> &'static Path {
+        Path::new(file_paths().resolve(self.0))
+    }
+
+    /// The path as UTF-8; `None` if it is not valid UTF-8
+    pub fn to_str(self) -> Option<&'static str> {
+        self.as_path().to_str()
+    }
+}
+
+impl Deref for FilePath {
+    type Target = Path;
+
+    fn deref(&self) -> &Path {
+        self.as_path()
+    }
+}
+
+impl AsRef<Path> for FilePath {
+    fn as_ref(&self) -> &Path {
+        self.as_path()
+    }
+}
+
+/// Path order, as with `PathBuf`, not interning order; equal handles are
+/// exactly the paths that compare equal
+impl Ord for FilePath {
+    fn cmp(&self, other: &Self) -> Ordering {
+        if self == other {
+            return Ordering::Equal;
+        }
+        self.as_path().cmp(other.as_path())
+    }
+}
+
+impl PartialOrd for FilePath {
+    fn partial_cmp(&self, other: &Self) -> Option<Ordering> {
+        Some(self.cmp(other))
+    }
+}
+
+impl fmt::Debug for FilePath {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(f, "FilePath({:?})", self.as_path())
+    }
+}
+
+impl From<&Path> for FilePath {
+    fn from(path: &Path) -> Self {
+        FilePath::intern(path)
+    }
+}
+
+impl From<PathBuf> for FilePath {
+    fn from(path: PathBuf) -> Self {
+        FilePath::intern(&path)
+    }
+}
+
+impl From<&PathBuf> for FilePath {
+    fn from(path: &PathBuf) -> Self {
+        FilePath::intern(path)
+    }
+}
+
+impl From<&str> for FilePath {
+    fn from(path: &str) -> Self {
+        FilePath::intern(Path::new(path))
+    }
+}
+
+impl PartialEq<Path> for FilePath {
+    fn eq(&self, other: &Path) -> bool {
+        self.as_path() == other
+    }
+}
+
+impl PartialEq<&Path> for FilePath {
+    fn eq(&self, other: &&Path) -> bool {
+        self.as_path() == *other
+    }
+}
+
+impl PartialEq<PathBuf> for FilePath {
+    fn eq(&self, other: &PathBuf) -> bool {
+        self.as_path() == other.as_path()
+    }
+}
+
+/// As a string, failing for a non UTF-8 path like `PathBuf` does
+impl Serialize for FilePath {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        match self.to_str() {
+            Some(path) => serializer.serialize_str(path),
+            None => Err(serde::ser::Error::custom(
+                "path contains invalid UTF-8 characters",
+            )),
+        }
+    }
+}
+
+impl<'de> Deserialize<'de> for FilePath {
+    fn deserialize<D: Deserializer<'de>>(deserializer: D) -> Result<Self, D::Error> {
+        struct FilePathVisitor;
+
+        impl<'de> Visitor<'de> for FilePathVisitor {
+            type Value = FilePath;
+
+            fn expecting(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+                f.write_str("a file path string")
+            }
+
+            fn visit_str<E: de::Error>(self, value: &str) -> Result<FilePath, E> {
+                Ok(FilePath::from(value))
+            }
+        }
+
+        deserializer.deserialize_str(FilePathVisitor)
+    }
+}
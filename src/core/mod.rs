@@ -1,9 +1,25 @@
 pub mod analyzer;
+pub mod contracts;
+pub mod fast_hash;
+pub mod focus;
+pub mod fuzzy;
 pub mod graph;
+pub mod graph_index;
+pub mod incremental;
+pub mod interner;
+pub mod pipeline;
+pub mod profile;
 pub mod resolver;
 pub mod scanner;
+pub mod shard;
+mod symbols;
+pub mod watcher;
 
 pub use analyzer::CodebaseAnalyzer;
-pub use graph::{DependencyGraph, Edge, EdgeType, Node, NodeType};
+pub use contracts::NodeExport;
+pub use graph::{DependencyGraph, Edge, EdgeType, Language, Node, NodeType, Visibility};
+pub use graph_index::GraphIndex;
+pub use interner::{FilePath, NodeId};
+pub use profile::Profiler;
 pub use resolver::{CallSite, CallSiteExtractor, FunctionResolver};
 pub use scanner::FileScanner;
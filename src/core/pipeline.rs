@@ -0,0 +1,190 @@
+//! Streaming stages between the scanner, the parse workers and the graph.
+//!
+//! Files are parsed in completion order; [`GraphAssembly`] takes each result as
+//! it arrives and restores path order once, when the last file is in.
+
+use anyhow::{anyhow, Result};
+use petgraph::graph::NodeIndex;
+use rayon::prelude::*;
+use std::ops::Range;
+use std::path::{Path, PathBuf};
+use std::sync::mpsc;
+
+use super::graph::{Edge, GraphBuilder};
+use super::{CallSite, NodeExport};
+use crate::parsers::limits::LimitReason;
+use crate::parsers::ParseResult;
+
+/// Runs `produce` on its own thread and `work` on the worker pool (rayon's
+/// global pool when `pool` is `None`), handing each result to `consume` on the
+/// calling thread as soon as it is done.
+///
+/// Each hop is a queue of `depth` items, so work starts with the first item
+/// produced. Fails with the producer's error, or when any stage panicked.
+pub fn run_stages<T, U, P, W, C>(
+    depth: usize,
+    pool: Option<&rayon::ThreadPool>,
+    produce: P,
+    work: W,
+    mut consume: C,
+) -> Result<()>
+where
+    T: Send,
+    U: Send,
+    P: FnOnce(&(dyn Fn(T) + Sync)) -> Result<()> + Send,
+    W: Fn(T) -> U + Sync + Send,
+    C: FnMut(U),
+{
+    let (item_tx, item_rx) = mpsc::sync_channel::<T>(depth);
+    let (result_tx, result_rx) = mpsc::sync_channel::<U>(depth);
+
+    std::thread::scope(|scope| {
+        let producer = scope.spawn(move || {
+            produce(&|item| {
+                // Only fails once the workers are gone, which ends the run anyway
+                let _ = item_tx.send(item);
+            })
+        });
+        let workers = scope.spawn(move || {
+            let run = || {
+                item_rx
+                    .into_iter()
+                    .par_bridge()
+                    .for_each_with(result_tx, |results, item| {
+                        let _ = results.send(work(item));
+                    })
+            };
+            match pool {
+                Some(pool) => pool.install(run),
+                None => run(),
+            }
+        });
+
+        for result in result_rx {
+            consume(result);
+        }
+
+        workers
+            .join()
+            .map_err(|_| anyhow!("parse worker panicked"))?;
+        producer
+            .join()
+            .unwrap_or_else(|_| Err(anyhow!("directory walker panicked")))
+    })
+}
+
+/// A parsed file whose nodes are already in the builder
+struct AssembledFile {
+    path: PathBuf,
+    /// Node indices in arrival order
+    nodes: Range<usize>,
+    edges: Vec<Edge>,
+    call_sites: Vec<CallSite>,
+    exports: Vec<NodeExport>,
+    limited: Option<LimitReason>,
+}
+
+/// Builds the graph from parse results arriving in any order.
+///
+/// Nodes go into the builder as each file arrives; edges wait for
+/// [`Self::finish`], which sorts the nodes by path and adds the edges exactly as
+/// adding the files one by one in path order would.
+pub struct GraphAssembly {
+    builder: GraphBuilder,
+    files: Vec<AssembledFile>,
+}
+
+/// What [`GraphAssembly::finish`] hands to call resolution, all in path order
+pub struct AssembledGraph {
+    pub builder: GraphBuilder,
+    pub call_sites: Vec<CallSite>,
+    pub exports: Vec<NodeExport>,
+    /// Files that were only outlined, with the limit each one hit
+    pub limited: Vec<(PathBuf, LimitReason)>,
+}
+
+impl GraphAssembly {
+    pub fn new() -> Self {
+        Self {
+            builder: GraphBuilder::new(),
+            files: Vec::new(),
+        }
+    }
+
+    /// Adds the nodes of one file and keeps the rest for [`Self::finish`].
+    pub fn add(&mut self, path: PathBuf, result: ParseResult) {
+        let start = self.builder.graph().node_count();
+        for node in result.nodes {
+            self.builder.add_node(node);
+        }
+        self.files.push(AssembledFile {
+            path,
+            nodes: start..self.builder.graph().node_count(),
+            edges: result.edges,
+            call_sites: result.call_sites.unwrap_or_default(),
+            exports: result.exports,
+            limited: result.limited,
+        });
+    }
+
+    pub fn finish(mut self) -> AssembledGraph {
+        self.files.sort_by(|a, b| a.path.cmp(&b.path));
+        let order: Vec<NodeIndex> = self
+            .files
+            .iter()
+            .flat_map(|file| file.nodes.clone())
+            .map(NodeIndex::new)
+            .collect();
+        if order
+            .iter()
+            .enumerate()
+            .any(|(i, index)| index.index() != i)
+        {
+            self.builder.reorder_nodes(&order);
+        }
+
+        // With repeated ids an edge binds to the latest copy added before it,
+        // so each file's ids are pointed back at its own nodes first
+        let ids_repeat = self.builder.id_count() < order.len();
+        let mut assembled = AssembledGraph {
+            builder: self.builder,
+            call_sites: Vec::new(),
+            exports: Vec::new(),
+            limited: Vec::new(),
+        };
+        let mut end = 0;
+        for file in self.files {
+            let start = end;
+            end += file.nodes.len();
+            if ids_repeat {
+                for index in start..end {
+                    assembled.builder.index_node(NodeIndex::new(index));
+                }
+            }
+            for edge in file.edges {
+                assembled.builder.add_edge_before(edge, end);
+            }
+            assembled.call_sites.extend(file.call_sites);
+            assembled.exports.extend(file.exports);
+            if let Some(reason) = file.limited {
+                assembled.limited.push((file.path, reason));
+            }
+        }
+        assembled
+    }
+}
+
+impl Default for GraphAssembly {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl AssembledGraph {
+    /// The outlined files as borrowed pairs, for reporting
+    pub fn limited_files(&self) -> impl Iterator<Item = (&Path, LimitReason)> {
+        self.limited
+            .iter()
+            .map(|(path, reason)| (path.as_path(), *reason))
+    }
+}
@@ -0,0 +1,264 @@
+//! Opt-in phase profiler behind `--stats` and `--trace`.
+//!
+//! The analyzer and the CLI record timed spans (scan, per-file parse and cache
+//! lookup, graph build, index build, resolve, format) and named counters into
+//! one [`Profiler`]. At exit it is rendered either as a JSON summary with
+//! per-phase totals or as a Chrome trace (`chrome://tracing`, Perfetto) with
+//! one event per span on the thread that ran it.
+//!
+//! Durations of spans that run on several workers at once are summed, so a
+//! phase's `total_ms` is CPU time and can exceed the wall time of the run.
+
+use anyhow::Result;
+use serde::Serialize;
+use serde_json::json;
+use std::collections::BTreeMap;
+use std::io::Write;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::Mutex;
+use std::time::{Duration, Instant};
+
+/// Version of the `--stats json` layout
+pub const STATS_VERSION: u32 = 1;
+
+/// Collects spans and counters from every thread of one run.
+pub struct Profiler {
+    epoch: Instant,
+    spans: Mutex<Vec<SpanRecord>>,
+    /// Accumulated time that is too fine-grained for trace events
+    times: Mutex<BTreeMap<(&'static str, String), PhaseStats>>,
+    counters: Mutex<BTreeMap<String, u64>>,
+}
+
+struct SpanRecord {
+    name: &'static str,
+    detail: Option<String>,
+    start: Duration,
+    duration: Duration,
+    thread: u64,
+}
+
+/// Aggregate of every span or timing recorded under one name.
+#[derive(Debug, Clone, Copy, Default, Serialize)]
+pub struct PhaseStats {
+    pub count: u64,
+    pub total_ms: f64,
+    pub max_ms: f64,
+}
+
+impl PhaseStats {
+    fn add(&mut self, duration: Duration) {
+        let ms = duration.as_secs_f64() * 1000.0;
+        self.count += 1;
+        self.total_ms += ms;
+        self.max_ms = self.max_ms.max(ms);
+    }
+}
+
+/// One phase of the summary, split by detail (language, call type, format)
+#[derive(Debug, Clone, Default, Serialize)]
+pub struct PhaseSummary {
+    #[serde(flatten)]
+    pub stats: PhaseStats,
+    #[serde(skip_serializing_if = "BTreeMap::is_empty")]
+    pub by: BTreeMap<String, PhaseStats>,
+}
+
+/// The `--stats json` document
+#[derive(Debug, Clone, Serialize)]
+pub struct ProfileSummary {
+    pub version: u32,
+    pub wall_ms: f64,
+    pub phases: BTreeMap<String, PhaseSummary>,
+    pub counters: BTreeMap<String, u64>,
+    /// `cache.hits / (cache.hits + cache.misses)`, when the cache was used
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub cache_hit_ratio: Option<f64>,
+    /// `resolve.memo_hits / resolve.memo_lookups`, when calls were resolved
+    #[serde(skip_serializing_if = "Option::is_none")]
+    pub memo_hit_ratio: Option<f64>,
+}
+
+/// Records a span from its creation until it is dropped.
+pub struct SpanGuard<'p> {
+    profiler: &'p Profiler,
+    name: &'static str,
+    detail: Option<String>,
+    start: Instant,
+}
+
+impl Drop for SpanGuard<'_> {
+    fn drop(&mut self) {
+        self.profiler.record(
+            self.name,
+            self.detail.take(),
+            self.start,
+            self.start.elapsed(),
+        );
+    }
+}
+
+/// Small stable id for the current thread, for trace events
+fn thread_id() -> u64 {
+    static NEXT: AtomicU64 = AtomicU64::new(1);
+    thread_local! {
+        static ID: u64 = NEXT.fetch_add(1, Ordering::Relaxed);
+    }
+    ID.with(|id| *id)
+}
+
+impl Profiler {
+    pub fn new() -> Self {
+        Self {
+            epoch: Instant::now(),
+            spans: Mutex::new(Vec::new()),
+            times: Mutex::new(BTreeMap::new()),
+            counters: Mutex::new(BTreeMap::new()),
+        }
+    }
+
+    pub fn span(&self, name: &'static str) -> SpanGuard<'_> {
+        self.start(name, None)
+    }
+
+    /// A span broken down by `detail` in the summary, e.g. parse by language
+    pub fn span_with(&self, name: &'static str, detail: impl Into<String>) -> SpanGuard<'_> {
+        self.start(name, Some(detail.into()))
+    }
+
+    fn start(&self, name: &'static str, detail: Option<String>) -> SpanGuard<'_> {
+        SpanGuard {
+            profiler: self,
+            name,
+            detail,
+            start: Instant::now(),
+        }
+    }
+
+    /// Records a span that has already finished
+    pub fn record(
+        &self,
+        name: &'static str,
+        detail: Option<String>,
+        start: Instant,
+        duration: Duration,
+    ) {
+        let record = SpanRecord {
+            name,
+            detail,
+            start: start.saturating_duration_since(self.epoch),
+            duration,
+            thread: thread_id(),
+        };
+        self.spans.lock().unwrap().push(record);
+    }
+
+    /// Adds time to a phase without emitting a trace event
+    pub fn add_time(&self, name: &'static str, detail: impl Into<String>, duration: Duration) {
+        self.times
+            .lock()
+            .unwrap()
+            .entry((name, detail.into()))
+            .or_default()
+            .add(duration);
+    }
+
+    pub fn add(&self, counter: &str, value: u64) {
+        let mut counters = self.counters.lock().unwrap();
+        match counters.get_mut(counter) {
+            Some(total) => *total += value,
+            None => {
+                counters.insert(counter.to_string(), value);
+            }
+        }
+    }
+
+    pub fn summary(&self) -> ProfileSummary {
+        let mut phases: BTreeMap<String, PhaseSummary> = BTreeMap::new();
+        for span in self.spans.lock().unwrap().iter() {
+            let phase = phases.entry(span.name.to_string()).or_default();
+            phase.stats.add(span.duration);
+            if let Some(detail) = &span.detail {
+                phase
+                    .by
+                    .entry(detail.clone())
+                    .or_default()
+                    .add(span.duration);
+            }
+        }
+        for ((name, detail), stats) in self.times.lock().unwrap().iter() {
+            let phase = phases.entry(name.to_string()).or_default();
+            phase.stats.count += stats.count;
+            phase.stats.total_ms += stats.total_ms;
+            phase.stats.max_ms = phase.stats.max_ms.max(stats.max_ms);
+            phase.by.insert(detail.clone(), *stats);
+        }
+
+        let counters = self.counters.lock().unwrap().clone();
+        let ratio = |part: &str, whole: u64| {
+            (whole > 0).then(|| counters.get(part).copied().unwrap_or(0) as f64 / whole as f64)
+        };
+        let cache_lookups = ["cache.hits", "cache.misses"]
+            .iter()
+            .filter_map(|name| counters.get(*name))
+            .sum();
+        let cache_hit_ratio = ratio("cache.hits", cache_lookups);
+        let memo_hit_ratio = ratio(
+            "resolve.memo_hits",
+            counters.get("resolve.memo_lookups").copied().unwrap_or(0),
+        );
+
+        ProfileSummary {
+            version: STATS_VERSION,
+            wall_ms: self.epoch.elapsed().as_secs_f64() * 1000.0,
+            phases,
+            counters,
+            cache_hit_ratio,
+            memo_hit_ratio,
+        }
+    }
+
+    pub fn write_stats_json<W: Write>(&self, out: &mut W) -> Result<()> {
+        serde_json::to_writer_pretty(&mut *out, &self.summary())?;
+        writeln!(out)?;
+        Ok(())
+    }
+
+    /// Writes every span as a complete ("X") event of the Chrome trace format,
+    /// with the counters attached as trace metadata
+    pub fn write_chrome_trace<W: Write>(&self, out: &mut W) -> Result<()> {
+        let spans = self.spans.lock().unwrap();
+        let events: Vec<serde_json::Value> = spans
+            .iter()
+            .map(|span| {
+                let mut event = json!({
+                    "name": span.name,
+                    "cat": "embargo",
+                    "ph": "X",
+                    "ts": span.start.as_secs_f64() * 1e6,
+                    "dur": span.duration.as_secs_f64() * 1e6,
+                    "pid": std::process::id(),
+                    "tid": span.thread,
+                });
+                if let Some(detail) = &span.detail {
+                    event["args"] = json!({ "detail": detail });
+                }
+                event
+            })
+            .collect();
+        let trace = json!({
+            "traceEvents": events,
+            "displayTimeUnit": "ms",
+            "otherData": *self.counters.lock().unwrap(),
+        });
+        serde_json::to_writer(&mut *out, &trace)?;
+        writeln!(out)?;
+        Ok(())
+    }
+}
+
+impl Default for Profiler {
+    fn default() -> Self {
+        Self::new()
+    }
+}
@@ -1,13 +1,29 @@
 //! Function call resolution.
 //!
 //! Maps function calls to their definitions using hash-based O(1) lookup.
+//! Index entries refer to nodes of the built [`DependencyGraph`] by `NodeIndex`
+//! instead of copying names, paths and signatures out of them.
+//!
+//! Each name's definitions are sorted by language and file, so common names
+//! (`init`, `run`, `get`) are first looked up in the caller's own file, then
+//! in its language, and only then across the whole codebase. Qualified names
+//! go through the module and type tables of [`SymbolTable`].
 
 use anyhow::Result;
+use dashmap::DashMap;
+use petgraph::graph::NodeIndex;
 use rayon::prelude::*;
-use std::collections::HashMap;
-use std::path::{Path, PathBuf};
-
-use crate::core::{Edge, EdgeType, Node, NodeType};
+use std::hash::{Hash, Hasher};
+use std::path::Path;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::time::{Duration, Instant};
+
+use crate::core::contracts::{self, ContractRegistry, NodeExport};
+use crate::core::fast_hash::{hash_name, FastBuildHasher, FastHasher, FastMap};
+use crate::core::fuzzy::FuzzyIndex;
+use crate::core::symbols::{self, split_qualified, Candidates, Scope, SymbolTable};
+use crate::core::{DependencyGraph, Edge, EdgeType, Node, NodeId, NodeType};
+use crate::parsers::common::{walk_tree, KindTable, Visitor};
 
 /// Fast hash-based function call resolver.
 ///
@@ -15,52 +31,56 @@ use crate::core::{Edge, EdgeType, Node, NodeType};
 /// and qualified name support.
 #[derive(Debug, Clone)]
 pub struct FunctionResolver {
-    /// Hash map for O(1) function name lookup
-    function_index: HashMap<u64, Vec<FunctionEntry>>,
+    /// Free functions by name hash
+    function_index: FastMap<u64, Candidates<FunctionEntry>>,
+
+    /// Functions declared inside a class or interface, by name hash
+    method_index: FastMap<u64, Candidates<MethodEntry>>,
+
+    /// Module, type member and import alias tables for qualified calls
+    symbols: SymbolTable<FunctionEntry>,
+
+    /// Language and file of every graph node, for scoping a caller's lookups
+    scopes: FastMap<NodeId, Scope>,
 
-    /// Method resolution for class.method calls
-    method_index: HashMap<u64, Vec<MethodEntry>>,
+    /// Approximate name index for unresolved simple calls
+    fuzzy_index: FuzzyIndex<FunctionEntry>,
 
-    /// Import mapping for qualified names (module.function)
-    import_mapping: HashMap<String, String>,
+    /// Whether unresolved simple calls fall back to fuzzy matching
+    fuzzy_matching: bool,
+
+    /// Routes and other entry points outbound calls can reach across languages
+    contracts: ContractRegistry,
+
+    /// Whether [`index_exports`](Self::index_exports) fills `contracts`
+    cross_language: bool,
 }
 
-#[derive(Debug, Clone)]
+/// Maximum edit distance accepted by fuzzy matching
+pub const FUZZY_MAX_DISTANCE: usize = 2;
+
+/// Indexed function; name, path and signature are read from the graph node
+#[derive(Debug, Clone, Copy)]
 pub struct FunctionEntry {
-    pub node_id: String,
-    pub name: String,
-    #[allow(dead_code)]
-    pub file_path: PathBuf,
-    #[allow(dead_code)]
-    pub line_number: usize,
-    #[allow(dead_code)]
-    pub signature: Option<String>,
-    #[allow(dead_code)]
-    pub class_context: Option<String>,
-    #[allow(dead_code)]
-    pub module_context: String,
+    pub node: NodeIndex,
+    pub node_id: NodeId,
 }
 
+/// Indexed method together with the class it was declared in
 #[derive(Debug, Clone)]
 pub struct MethodEntry {
     #[allow(dead_code)]
-    pub node_id: String,
-    pub name: String,
+    pub node: NodeIndex,
+    pub node_id: NodeId,
     #[allow(dead_code)]
     pub class_name: String,
-    #[allow(dead_code)]
-    pub file_path: PathBuf,
-    #[allow(dead_code)]
-    pub line_number: usize,
-    #[allow(dead_code)]
-    pub signature: Option<String>,
 }
 
 /// A function call site extracted from source code.
 #[derive(Debug, Clone, serde::Serialize, serde::Deserialize)]
 pub struct CallSite {
     /// ID of the calling function
-    pub caller_id: String,
+    pub caller_id: NodeId,
     /// Name of the called function
     pub called_name: String,
     /// Type of call
@@ -72,7 +92,7 @@ pub struct CallSite {
 }
 
 /// Type of function call.
-#[derive(Debug, Clone, PartialEq, serde::Serialize, serde::Deserialize)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, serde::Serialize, serde::Deserialize)]
 pub enum CallType {
     /// Direct function call: `function_name()`
     SimpleCall,
@@ -89,180 +109,431 @@ pub enum CallType {
     ConstructorCall,
 }
 
+impl CallType {
+    /// Every call type, in declaration order (`call_type as usize` indexes it)
+    pub const ALL: [CallType; 6] = [
+        CallType::SimpleCall,
+        CallType::MethodCall,
+        CallType::QualifiedCall,
+        CallType::AttributeCall,
+        CallType::DynamicCall,
+        CallType::ConstructorCall,
+    ];
+
+    pub fn as_str(self) -> &'static str {
+        match self {
+            CallType::SimpleCall => "simple",
+            CallType::MethodCall => "method",
+            CallType::QualifiedCall => "qualified",
+            CallType::AttributeCall => "attribute",
+            CallType::DynamicCall => "dynamic",
+            CallType::ConstructorCall => "constructor",
+        }
+    }
+}
+
 impl FunctionResolver {
     pub fn new() -> Self {
         Self {
-            function_index: HashMap::new(),
-            method_index: HashMap::new(),
-            import_mapping: HashMap::new(),
+            function_index: FastMap::default(),
+            method_index: FastMap::default(),
+            symbols: SymbolTable::default(),
+            scopes: FastMap::default(),
+            fuzzy_index: FuzzyIndex::new(),
+            fuzzy_matching: true,
+            contracts: ContractRegistry::default(),
+            cross_language: true,
         }
     }
 
-    /// Build indexes from all parsed nodes for fast lookup
-    pub fn build_indexes(&mut self, nodes: &[Node]) -> Result<()> {
-        // Pre-calculate capacity to avoid rehashing
-        let estimated_functions = nodes.len() / 4; // Rough estimate
+    /// Enable or disable the fuzzy fallback for unresolved simple calls
+    pub fn with_fuzzy_matching(mut self, enabled: bool) -> Self {
+        self.fuzzy_matching = enabled;
+        self
+    }
 
-        // Clear and reserve capacity
-        self.function_index.clear();
-        self.function_index.reserve(estimated_functions);
-        self.method_index.clear();
-        self.method_index.reserve(estimated_functions);
-        self.import_mapping.clear();
+    /// Enable or disable matching outbound calls against cross-language contracts
+    pub fn with_cross_language(mut self, enabled: bool) -> Self {
+        self.cross_language = enabled;
+        self
+    }
 
-        // Build function and method indexes in parallel with better allocation
-        let function_nodes: Vec<_> = nodes
-            .par_iter()
-            .filter(|node| matches!(node.node_type, NodeType::Function))
-            .collect();
+    /// Index the entry points parsers exported, for the cross-language stage
+    /// of call resolution; call after [`build_indexes`](Self::build_indexes)
+    pub fn index_exports(&mut self, exports: &[NodeExport]) {
+        self.contracts = if self.cross_language {
+            ContractRegistry::build(exports)
+        } else {
+            ContractRegistry::default()
+        };
+    }
+
+    /// Build indexes over the nodes of `graph` for fast lookup
+    ///
+    /// The same graph must be passed to [`resolve_calls`](Self::resolve_calls).
+    pub fn build_indexes(&mut self, graph: &DependencyGraph) -> Result<()> {
+        let nodes = graph.raw_nodes();
+
+        self.fuzzy_index = FuzzyIndex::new();
 
-        let (functions, methods): (Vec<_>, Vec<_>) = function_nodes
+        // File ordinals follow path order, so sorted candidates keep files apart
+        let mut files: Vec<&Path> = nodes
+            .iter()
+            .map(|raw| raw.weight.file_path.as_path())
+            .collect();
+        files.par_sort_unstable();
+        files.dedup();
+        let node_scopes: Vec<Scope> = nodes
             .par_iter()
-            .map(|node| self.create_function_entry(node))
-            .partition(|entry| entry.is_function());
+            .map(|raw| Scope {
+                language: Scope::language_shard(raw.weight.language),
+                file: files
+                    .binary_search(&raw.weight.file_path.as_path())
+                    .unwrap_or_default() as u32,
+            })
+            .collect();
+        self.scopes = nodes
+            .iter()
+            .zip(&node_scopes)
+            .map(|(raw, scope)| (raw.weight.id, *scope))
+            .collect();
 
-        // Build function index
-        for entry in functions {
-            if let FunctionOrMethod::Function(func) = entry {
-                let hash = Self::compute_hash(&func.name);
-                self.function_index
-                    .entry(hash)
-                    .or_insert_with(Vec::new)
-                    .push(func);
+        // Every function is indexed by name; those declared in a class or
+        // interface are method candidates as well
+        let owners = symbols::owners(graph);
+        let mut function_groups: FastMap<u64, Vec<(Scope, FunctionEntry)>> = FastMap::default();
+        let mut method_groups: FastMap<u64, Vec<(Scope, MethodEntry)>> = FastMap::default();
+        for (index, raw) in nodes.iter().enumerate() {
+            let node = &raw.weight;
+            if node.node_type != NodeType::Function {
+                continue;
+            }
+            let entry = FunctionEntry {
+                node: NodeIndex::new(index),
+                node_id: node.id,
+            };
+            let scope = node_scopes[index];
+            let hash = hash_name(&node.name);
+            function_groups
+                .entry(hash)
+                .or_default()
+                .push((scope, entry));
+            if let Some(owner) = owners.get(&entry.node) {
+                method_groups.entry(hash).or_default().push((
+                    scope,
+                    MethodEntry {
+                        node: entry.node,
+                        node_id: entry.node_id,
+                        class_name: graph[*owner].name.clone(),
+                    },
+                ));
             }
-        }
 
-        // Build method index
-        for entry in methods {
-            if let FunctionOrMethod::Method(method) = entry {
-                let hash = Self::compute_hash(&method.name);
-                self.method_index
-                    .entry(hash)
-                    .or_insert_with(Vec::new)
-                    .push(method);
+            // Short names match too much of the index to be useful
+            if self.fuzzy_matching && node.name.len() > 3 {
+                self.fuzzy_index.insert(&node.name, entry);
             }
         }
-
-        // Build import mapping
-        self.build_import_mapping(nodes)?;
+        self.function_index = function_groups
+            .into_par_iter()
+            .map(|(hash, entries)| (hash, Candidates::new(entries)))
+            .collect();
+        self.method_index = method_groups
+            .into_par_iter()
+            .map(|(hash, entries)| (hash, Candidates::new(entries)))
+            .collect();
+        self.symbols = SymbolTable::build(graph, &node_scopes, &owners, |node| FunctionEntry {
+            node,
+            node_id: graph[node].id,
+        });
 
         Ok(())
     }
 
     /// Resolve function calls to their definitions and create edges
-    pub fn resolve_calls(&self, call_sites: &[CallSite]) -> Vec<Edge> {
-        call_sites
+    #[allow(dead_code)]
+    pub fn resolve_calls(&self, graph: &DependencyGraph, call_sites: &[CallSite]) -> Vec<Edge> {
+        self.resolve_calls_with_stats(graph, call_sites).0
+    }
+
+    /// Like [`resolve_calls`](Self::resolve_calls), also reporting how often the
+    /// per-run resolution memo answered a call site
+    pub fn resolve_calls_with_stats(
+        &self,
+        graph: &DependencyGraph,
+        call_sites: &[CallSite],
+    ) -> (Vec<Edge>, ResolutionStats) {
+        let memo = ResolutionMemo::default();
+        let mut edges: Vec<Option<Edge>> = call_sites
             .par_iter()
-            .filter_map(|call_site| self.resolve_single_call(call_site))
-            .collect()
+            .map(|call_site| self.resolve_memoized(graph, call_site, &memo))
+            .collect();
+        let mut stats = memo.stats();
+        stats.contract_matches = self.resolve_contract_calls(call_sites, &mut edges);
+        (edges.into_iter().flatten().collect(), stats)
+    }
+
+    /// Resolve each call site in order, keeping `None` for sites without a target
+    pub fn resolve_call_sites(
+        &self,
+        graph: &DependencyGraph,
+        call_sites: &[&CallSite],
+    ) -> (Vec<Option<Edge>>, ResolutionStats) {
+        let memo = ResolutionMemo::default();
+        let mut edges: Vec<Option<Edge>> = call_sites
+            .par_iter()
+            .map(|call_site| self.resolve_memoized(graph, call_site, &memo))
+            .collect();
+        let mut stats = memo.stats();
+        stats.contract_matches = self.resolve_contract_calls(call_sites, &mut edges);
+        (edges, stats)
+    }
+
+    /// Cross-language stage: matches outbound calls left unresolved by the
+    /// same-language indexes against the contract registry, in parallel.
+    /// Returns the number of calls it resolved.
+    fn resolve_contract_calls<S>(&self, call_sites: &[S], edges: &mut [Option<Edge>]) -> usize
+    where
+        S: std::borrow::Borrow<CallSite> + Sync,
+    {
+        if self.contracts.is_empty() {
+            return 0;
+        }
+        edges
+            .par_iter_mut()
+            .zip(call_sites)
+            .filter(|(edge, call_site)| {
+                edge.is_none() && contracts::is_contract_call(call_site.borrow())
+            })
+            .map(|(edge, call_site)| {
+                *edge = self.contracts.resolve(call_site.borrow());
+                edge.is_some() as usize
+            })
+            .sum()
+    }
+
+    /// Whether unresolved simple calls fall back to fuzzy matching
+    pub fn fuzzy_matching(&self) -> bool {
+        self.fuzzy_matching
+    }
+
+    /// Whether outbound calls are matched against cross-language contracts
+    pub fn cross_language(&self) -> bool {
+        self.cross_language
+    }
+
+    /// Function name the indexes are searched for when resolving `call_site`
+    ///
+    /// Outside of fuzzy matching, a call site's resolution only changes when a
+    /// function with this name is added or removed.
+    pub fn lookup_name(call_site: &CallSite) -> &str {
+        match call_site.call_type {
+            CallType::MethodCall | CallType::AttributeCall | CallType::QualifiedCall => {
+                split_qualified(&call_site.called_name)
+                    .map_or(call_site.called_name.as_str(), |(_, name)| name)
+            }
+            CallType::SimpleCall | CallType::DynamicCall | CallType::ConstructorCall => {
+                &call_site.called_name
+            }
+        }
+    }
+
+    /// Whether `call_site` can resolve through the fuzzy fallback
+    pub fn may_fuzzy_match(&self, call_site: &CallSite) -> bool {
+        self.fuzzy_matching
+            && !contracts::is_contract_call(call_site)
+            && match call_site.call_type {
+                CallType::SimpleCall => true,
+                CallType::QualifiedCall => split_qualified(&call_site.called_name).is_none(),
+                _ => false,
+            }
+    }
+
+    /// Resolve a call site, reusing the outcome of an identical earlier lookup
+    ///
+    /// Negative outcomes are memoized as well, so a missing name is only hashed,
+    /// scored and fuzzy-matched once per run.
+    fn resolve_memoized(
+        &self,
+        graph: &DependencyGraph,
+        call_site: &CallSite,
+        memo: &ResolutionMemo,
+    ) -> Option<Edge> {
+        let scope = self.memo_scope(call_site);
+        let key = ResolutionMemo::key_hash(call_site, scope);
+        if let Some(cached) = memo.get(key, call_site, scope) {
+            memo.record_hit(call_site.call_type, cached.is_some());
+            return cached.map(|resolution| resolution.to_edge(call_site));
+        }
+
+        let start = Instant::now();
+        let edge = self.resolve_single_call(graph, call_site, memo);
+        memo.record_resolution(call_site.call_type, edge.is_some(), start.elapsed());
+        memo.insert(key, call_site, scope, edge.as_ref());
+        edge
     }
 
     /// Resolve a single function call with multiple strategies
     #[allow(dead_code)]
-    fn resolve_single_call(&self, call_site: &CallSite) -> Option<Edge> {
+    fn resolve_single_call(
+        &self,
+        graph: &DependencyGraph,
+        call_site: &CallSite,
+        memo: &ResolutionMemo,
+    ) -> Option<Edge> {
         match call_site.call_type {
-            CallType::SimpleCall => self.resolve_simple_call(call_site),
+            CallType::SimpleCall => self.resolve_simple_call(graph, call_site, memo),
             CallType::MethodCall => self.resolve_method_call(call_site),
-            CallType::QualifiedCall => self.resolve_qualified_call(call_site),
+            CallType::QualifiedCall => self.resolve_qualified_call(graph, call_site, memo),
             CallType::AttributeCall => self.resolve_attribute_call(call_site),
             CallType::DynamicCall => self.resolve_dynamic_call(call_site),
-            CallType::ConstructorCall => self.resolve_constructor_call(call_site),
+            CallType::ConstructorCall => self.resolve_constructor_call(graph, call_site),
         }
     }
 
     #[allow(dead_code)]
-    fn resolve_simple_call(&self, call_site: &CallSite) -> Option<Edge> {
-        let hash = Self::compute_hash(&call_site.called_name);
+    fn resolve_simple_call(
+        &self,
+        graph: &DependencyGraph,
+        call_site: &CallSite,
+        memo: &ResolutionMemo,
+    ) -> Option<Edge> {
+        let hash = hash_name(&call_site.called_name);
 
         // Try exact match first
         if let Some(candidates) = self.function_index.get(&hash) {
             // Prefer functions in the same file/module
-            let best_candidate = self.select_best_candidate(candidates, call_site)?;
+            let candidates = candidates.preferred(self.caller_scope(call_site));
+            let best_candidate = self.select_best_candidate(graph, candidates, call_site)?;
 
             return Some(
-                Edge::new(
-                    EdgeType::Call,
-                    call_site.caller_id.clone(),
-                    best_candidate.node_id.clone(),
-                )
-                .with_context(format!("line:{}", call_site.line_number)),
+                Edge::new(EdgeType::Call, call_site.caller_id, best_candidate.node_id)
+                    .with_context(format!("line:{}", call_site.line_number)),
             );
         }
 
-        // Try fuzzy matching for typos/variations
-        self.fuzzy_resolve_function(call_site)
+        // Try fuzzy matching for typos/variations; outbound requests are left
+        // to the contract registry instead
+        if contracts::is_contract_call(call_site) {
+            return None;
+        }
+        let edge = self.fuzzy_resolve_function(call_site);
+        if self.fuzzy_matching {
+            memo.record_fuzzy(edge.is_some());
+        }
+        edge
     }
 
+    /// `obj.method()`: a method of the receiver's type when the receiver names
+    /// one, else a method or function of that name in the caller's file, else
+    /// any method of that name
     #[allow(dead_code)]
     fn resolve_method_call(&self, call_site: &CallSite) -> Option<Edge> {
-        let method_name = self.extract_method_name(&call_site.called_name)?;
-        let hash = Self::compute_hash(&method_name);
-
-        if let Some(candidates) = self.method_index.get(&hash) {
-            // Try to determine the class context from the call site
-            let class_context = self.infer_class_context(call_site);
-            let best_candidate = self.select_best_method_candidate(candidates, &class_context)?;
-
-            return Some(
-                Edge::new(
-                    EdgeType::Call,
-                    call_site.caller_id.clone(),
-                    best_candidate.node_id.clone(),
-                )
-                .with_context(format!("method_call:line:{}", call_site.line_number)),
-            );
-        }
-
-        None
+        let caller = self.caller_scope(call_site);
+        let (qualifier, name) = split_qualified(&call_site.called_name).map_or(
+            (None, call_site.called_name.as_str()),
+            |(qualifier, name)| (Some(qualifier), name),
+        );
+        let target = qualifier
+            .and_then(|qualifier| self.resolve_member(qualifier, name, caller))
+            .or_else(|| self.resolve_method_name(name, caller, true))?;
+        Some(self.call_edge(call_site, target, "method_call:"))
     }
 
+    /// `module.function()`, `Type::method()` or `alias.function()`
     #[allow(dead_code)]
-    fn resolve_qualified_call(&self, call_site: &CallSite) -> Option<Edge> {
-        let parts: Vec<&str> = call_site.called_name.split('.').collect();
-        if parts.len() < 2 {
-            return self.resolve_simple_call(call_site);
-        }
-
-        let module_name = parts[..parts.len() - 1].join(".");
-        let function_name = parts[parts.len() - 1];
-
-        // Check import mapping first
-        if let Some(resolved_module) = self.import_mapping.get(&module_name) {
-            let full_name = format!("{}.{}", resolved_module, function_name);
-            return self.resolve_by_full_name(&full_name, call_site);
-        }
-
-        // Try direct module resolution
-        self.resolve_by_module_and_function(&module_name, function_name, call_site)
+    fn resolve_qualified_call(
+        &self,
+        graph: &DependencyGraph,
+        call_site: &CallSite,
+        memo: &ResolutionMemo,
+    ) -> Option<Edge> {
+        let Some((qualifier, name)) = split_qualified(&call_site.called_name) else {
+            return self.resolve_simple_call(graph, call_site, memo);
+        };
+        let caller = self.caller_scope(call_site);
+        // An unknown qualifier is usually an external module (`os.path`,
+        // `std::mem`), so only the caller's own file is trusted after that
+        let target = self
+            .resolve_member(qualifier, name, caller)
+            .or_else(|| self.resolve_method_name(name, caller, false))?;
+        Some(self.call_edge(call_site, target, "qualified_call:"))
     }
 
+    /// `obj.attr.method()`: resolved like a method call on the last receiver
     #[allow(dead_code)]
     fn resolve_attribute_call(&self, call_site: &CallSite) -> Option<Edge> {
-        // For complex attribute chains like obj.attr.method()
-        // We need to trace through the attribute access chain
-        let parts: Vec<&str> = call_site.called_name.split('.').collect();
-        if parts.is_empty() {
-            return None;
-        }
-
-        let method_name = parts[parts.len() - 1];
-        let hash = Self::compute_hash(&method_name);
+        let (qualifier, name) = split_qualified(&call_site.called_name)?;
+        let caller = self.caller_scope(call_site);
+        let target = self
+            .resolve_member(qualifier, name, caller)
+            .or_else(|| self.resolve_method_name(name, caller, true))?;
+        Some(self.call_edge(call_site, target, "attribute_call:"))
+    }
 
-        if let Some(candidates) = self.method_index.get(&hash) {
-            // Use heuristics to select the most likely candidate
-            let best_candidate = self.select_attribute_candidate(candidates, call_site)?;
+    /// Definition `qualifier.name` refers to, through the symbol table
+    fn resolve_member(&self, qualifier: &str, name: &str, caller: Option<Scope>) -> Option<NodeId> {
+        match qualifier {
+            // The caller's own type, which lives in the caller's file
+            "self" | "this" | "cls" | "Self" => self
+                .function_index
+                .get(&hash_name(name))?
+                .in_file(caller)
+                .first()
+                .map(|entry| entry.node_id),
+            // A parent type or the crate root, usually elsewhere in the language
+            "super" | "super()" | "crate" => {
+                let hash = hash_name(name);
+                let target = match self.method_index.get(&hash) {
+                    Some(methods) => methods.preferred(caller).first()?.node_id,
+                    None => {
+                        self.function_index
+                            .get(&hash)?
+                            .preferred(caller)
+                            .first()?
+                            .node_id
+                    }
+                };
+                Some(target)
+            }
+            _ => self
+                .symbols
+                .lookup(qualifier, name, caller)
+                .first()
+                .map(|entry| entry.node_id),
+        }
+    }
 
-            return Some(
-                Edge::new(
-                    EdgeType::Call,
-                    call_site.caller_id.clone(),
-                    best_candidate.node_id.clone(),
-                )
-                .with_context(format!("attribute_call:line:{}", call_site.line_number)),
-            );
+    /// A method or function called `name` in the caller's file, then, with
+    /// `any_file`, a method of that name anywhere, nearest scope first
+    fn resolve_method_name(
+        &self,
+        name: &str,
+        caller: Option<Scope>,
+        any_file: bool,
+    ) -> Option<NodeId> {
+        let hash = hash_name(name);
+        if let Some(entry) = self
+            .function_index
+            .get(&hash)
+            .and_then(|functions| functions.in_file(caller).first())
+        {
+            return Some(entry.node_id);
+        }
+        if !any_file {
+            return None;
         }
+        self.method_index
+            .get(&hash)?
+            .preferred(caller)
+            .first()
+            .map(|entry| entry.node_id)
+    }
 
-        None
+    /// Call edge to `target` with context `{prefix}line:{line}`
+    fn call_edge(&self, call_site: &CallSite, target: NodeId, prefix: &str) -> Edge {
+        Edge::new(EdgeType::Call, call_site.caller_id, target)
+            .with_context(format!("{}line:{}", prefix, call_site.line_number))
     }
 
     #[allow(dead_code)]
@@ -284,32 +555,29 @@ impl FunctionResolver {
     }
 
     #[allow(dead_code)]
-    fn resolve_constructor_call(&self, call_site: &CallSite) -> Option<Edge> {
+    fn resolve_constructor_call(
+        &self,
+        graph: &DependencyGraph,
+        call_site: &CallSite,
+    ) -> Option<Edge> {
         // For constructor calls like "new ClassName()" or direct instantiation
         // Try to resolve to the class constructor or the class itself
 
         let class_name = &call_site.called_name;
 
         // First try to find a class with this name
-        let hash = Self::compute_hash(class_name);
+        let hash = hash_name(class_name);
 
         // Look for constructor methods in our function index
         if let Some(candidates) = self.function_index.get(&hash) {
-            for candidate in candidates {
+            for candidate in candidates.preferred(self.caller_scope(call_site)) {
                 // Look for constructors, init methods, or the class name itself
-                if &candidate.name == class_name
-                    || candidate.name == "__init__"
-                    || candidate.name == "constructor"
-                    || candidate
-                        .class_context
-                        .as_ref()
-                        .map(|c| c == class_name)
-                        .unwrap_or(false)
-                {
+                let name = &graph[candidate.node].name;
+                if name == class_name || name == "__init__" || name == "constructor" {
                     return Some(Edge::new(
                         EdgeType::Call,
-                        call_site.caller_id.clone(),
-                        candidate.node_id.clone(),
+                        call_site.caller_id,
+                        candidate.node_id,
                     ));
                 }
             }
@@ -318,23 +586,45 @@ impl FunctionResolver {
         // If no specific constructor found, create an external class reference
         Some(Edge::new(
             EdgeType::Call,
-            call_site.caller_id.clone(),
+            call_site.caller_id,
             format!("external:class:{}:0", class_name),
         ))
     }
 
-    /// Compute stable hash for function names with optimized hashing
-    fn compute_hash(name: &str) -> u64 {
-        use std::hash::{Hash, Hasher};
-        let mut hasher = std::collections::hash_map::DefaultHasher::new();
-        name.hash(&mut hasher);
-        hasher.finish()
+    /// Scope of the function making the call; `None` for module-level calls
+    fn caller_scope(&self, call_site: &CallSite) -> Option<Scope> {
+        self.scopes.get(&call_site.caller_id).copied()
+    }
+
+    /// The part of the caller's scope that `call_site`'s resolution depends on.
+    ///
+    /// Lookups only single out the caller's file when it defines a function of
+    /// the looked-up name or aliases the call's qualifier in an import. Callers
+    /// in any other file of the language get the same answer, so their memo
+    /// entry is keyed on the language alone.
+    fn memo_scope(&self, call_site: &CallSite) -> Option<Scope> {
+        let scope = self.caller_scope(call_site)?;
+        let defines_name = self
+            .function_index
+            .get(&hash_name(Self::lookup_name(call_site)))
+            .is_some_and(|functions| !functions.in_file(Some(scope)).is_empty());
+        let aliases_qualifier = split_qualified(&call_site.called_name)
+            .is_some_and(|(qualifier, _)| self.symbols.has_alias(scope, qualifier));
+        if defines_name || aliases_qualifier {
+            Some(scope)
+        } else {
+            Some(Scope {
+                file: u32::MAX,
+                ..scope
+            })
+        }
     }
 
     /// Select the best candidate from multiple matches using heuristics
     #[allow(dead_code)]
     fn select_best_candidate<'a>(
         &self,
+        graph: &DependencyGraph,
         candidates: &'a [FunctionEntry],
         call_site: &CallSite,
     ) -> Option<&'a FunctionEntry> {
@@ -352,26 +642,22 @@ impl FunctionResolver {
         let mut best_score = 0;
 
         for candidate in candidates {
+            let node = &graph[candidate.node];
             let mut score = 0;
 
             // Prefer same file (fast path check)
             if let Some(ctx) = context_ref {
-                if ctx.contains(&*candidate.file_path.to_string_lossy()) {
+                if ctx.contains(&*node.file_path.to_string_lossy()) {
                     score += 100;
                 }
                 // Prefer same module
-                if ctx.contains(&candidate.module_context) {
+                if ctx.contains(Self::module_of(&node.file_path)) {
                     score += 50;
                 }
             }
 
-            // Prefer functions without class context for simple calls
-            if candidate.class_context.is_none() {
-                score += 25;
-            }
-
             // Prefer exact name matches (in case of hash collisions)
-            if candidate.name == call_site.called_name {
+            if node.name == call_site.called_name {
                 score += 200;
             }
 
@@ -387,242 +673,306 @@ impl FunctionResolver {
     /// Fuzzy matching for function names (handles typos, case differences)
     #[allow(dead_code)]
     fn fuzzy_resolve_function(&self, call_site: &CallSite) -> Option<Edge> {
-        let target = call_site.called_name.to_lowercase();
-        let mut best_match: Option<(&FunctionEntry, usize)> = None;
-
-        // Only check if the name is reasonably similar (Levenshtein distance)
-        for candidates in self.function_index.values() {
-            for candidate in candidates {
-                let distance = self.levenshtein_distance(&target, &candidate.name.to_lowercase());
-
-                // Only consider matches with distance <= 2 for reasonable-length names
-                if distance <= 2 && candidate.name.len() > 3 {
-                    if best_match.is_none() || distance < best_match.unwrap().1 {
-                        best_match = Some((candidate, distance));
-                    }
-                }
-            }
+        if !self.fuzzy_matching {
+            return None;
         }
 
-        if let Some((candidate, _distance)) = best_match {
-            return Some(
-                Edge::new(
-                    EdgeType::Call,
-                    call_site.caller_id.clone(),
-                    candidate.node_id.clone(),
-                )
+        let (candidate, _distance) = self
+            .fuzzy_index
+            .closest(&call_site.called_name, FUZZY_MAX_DISTANCE)?;
+
+        Some(
+            Edge::new(EdgeType::Call, call_site.caller_id, candidate.node_id)
                 .with_context(format!("fuzzy_match:line:{}", call_site.line_number)),
-            );
-        }
+        )
+    }
 
-        None
+    /// Module name a file contributes to, e.g. `utils` for `src/utils.py`
+    fn module_of(file_path: &Path) -> &str {
+        file_path
+            .file_stem()
+            .and_then(|s| s.to_str())
+            .unwrap_or("unknown")
     }
 
-    /// Simple Levenshtein distance calculation
     #[allow(dead_code)]
-    fn levenshtein_distance(&self, s1: &str, s2: &str) -> usize {
-        let len1 = s1.len();
-        let len2 = s2.len();
-
-        if len1 == 0 {
-            return len2;
-        }
-        if len2 == 0 {
-            return len1;
-        }
-
-        let mut matrix = vec![vec![0; len2 + 1]; len1 + 1];
+    fn resolve_dynamic_patterns(&self, _call_site: &CallSite) -> Option<Edge> {
+        None // TODO: Implement dynamic pattern resolution
+    }
 
-        // Initialize first row and column
-        for i in 0..=len1 {
-            matrix[i][0] = i;
-        }
-        for j in 0..=len2 {
-            matrix[0][j] = j;
-        }
+    #[allow(dead_code)]
+    fn resolve_with_context(&self, _call_site: &CallSite, _context: &str) -> Option<Edge> {
+        None // TODO: Implement context-based resolution
+    }
+}
 
-        let s1_chars: Vec<char> = s1.chars().collect();
-        let s2_chars: Vec<char> = s2.chars().collect();
+/// Memo hit and per-call-type counters for one
+/// [`FunctionResolver::resolve_calls_with_stats`] run
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct ResolutionStats {
+    pub lookups: usize,
+    pub hits: usize,
+    /// Fuzzy index searches, and how many of them found a target
+    pub fuzzy_lookups: usize,
+    pub fuzzy_matches: usize,
+    /// Indexed by `CallType as usize`
+    pub by_call_type: [CallTypeStats; CallType::ALL.len()],
+    /// Calls resolved by the cross-language contract stage
+    pub contract_matches: usize,
+}
 
-        for i in 1..=len1 {
-            for j in 1..=len2 {
-                let cost = if s1_chars[i - 1] == s2_chars[j - 1] {
-                    0
-                } else {
-                    1
-                };
+/// Resolution counters of one [`CallType`]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct CallTypeStats {
+    pub sites: usize,
+    pub resolved: usize,
+    /// Time spent resolving memo misses, summed over all workers
+    pub resolve_time: Duration,
+}
 
-                matrix[i][j] = std::cmp::min(
-                    std::cmp::min(
-                        matrix[i - 1][j] + 1, // deletion
-                        matrix[i][j - 1] + 1, // insertion
-                    ),
-                    matrix[i - 1][j - 1] + cost, // substitution
-                );
-            }
+impl ResolutionStats {
+    /// Fraction of call sites answered from the memo, in `0.0..=1.0`
+    pub fn hit_rate(&self) -> f64 {
+        if self.lookups == 0 {
+            0.0
+        } else {
+            self.hits as f64 / self.lookups as f64
         }
-
-        matrix[len1][len2]
     }
+}
 
-    // Helper methods for different resolution strategies
-    fn create_function_entry(&self, node: &Node) -> FunctionOrMethod {
-        // Determine if this is a method (has class context) or function
-        let class_context = self.extract_class_from_id(&node.id);
+/// Per-run memo of call resolutions, shared by the rayon workers
+///
+/// Resolution only reads the called name, call type, call-site context and the
+/// caller's scope, so those form the key, with the scope narrowed to the
+/// language when the caller's file plays no part (see
+/// [`FunctionResolver::memo_scope`]); caller id and line number are filled
+/// back in per site.
+#[derive(Default)]
+struct ResolutionMemo {
+    entries: DashMap<u64, MemoEntry, FastBuildHasher>,
+    lookups: AtomicUsize,
+    hits: AtomicUsize,
+    fuzzy_lookups: AtomicUsize,
+    fuzzy_matches: AtomicUsize,
+    by_call_type: [CallTypeCounters; CallType::ALL.len()],
+}
 
-        if let Some(class_name) = class_context {
-            FunctionOrMethod::Method(MethodEntry {
-                node_id: node.id.clone(),
-                name: node.name.clone(),
-                class_name,
-                file_path: node.file_path.clone(),
-                line_number: node.line_number,
-                signature: node.signature.clone(),
-            })
-        } else {
-            FunctionOrMethod::Function(FunctionEntry {
-                node_id: node.id.clone(),
-                name: node.name.clone(),
-                file_path: node.file_path.clone(),
-                line_number: node.line_number,
-                signature: node.signature.clone(),
-                class_context: None,
-                module_context: self.extract_module_from_path(&node.file_path),
-            })
-        }
-    }
+#[derive(Default)]
+struct CallTypeCounters {
+    sites: AtomicUsize,
+    resolved: AtomicUsize,
+    resolve_nanos: AtomicU64,
+}
 
-    fn extract_class_from_id(&self, node_id: &str) -> Option<String> {
-        // Parse node IDs to extract class context
-        // Example: "file.py:class:MyClass:42" -> Some("MyClass")
-        let parts: Vec<&str> = node_id.split(':').collect();
-        if parts.len() >= 3 && parts[1] == "class" {
-            return Some(parts[2].to_string());
-        }
-        None
-    }
+struct MemoEntry {
+    called_name: Box<str>,
+    call_type: CallType,
+    context: Option<Box<str>>,
+    scope: Option<Scope>,
+    resolution: Option<Resolution>,
+}
 
-    fn extract_module_from_path(&self, file_path: &Path) -> String {
-        file_path
-            .file_stem()
-            .and_then(|s| s.to_str())
-            .unwrap_or("unknown")
-            .to_string()
-    }
+/// Line-independent part of a resolved call edge
+#[derive(Clone)]
+struct Resolution {
+    target_id: NodeId,
+    context: ResolvedContext,
+}
 
-    fn build_import_mapping(&mut self, nodes: &[Node]) -> Result<()> {
-        for node in nodes {
-            if node.node_type == NodeType::Module {
-                // Parse import statements to build module mapping
-                // This is language-specific and would need refinement
-                if node.name.contains("import") {
-                    self.parse_import_statement(&node.name);
-                }
-            }
-        }
-        Ok(())
-    }
+#[derive(Clone)]
+enum ResolvedContext {
+    None,
+    /// `{prefix}line:{line_number}`, e.g. `fuzzy_match:line:12`
+    Line(Box<str>),
+    Fixed(Box<str>),
+}
 
-    fn parse_import_statement(&mut self, import_stmt: &str) {
-        // Simple import parsing - would need language-specific refinement
-        if import_stmt.contains("from") && import_stmt.contains("import") {
-            // Handle "from module import function"
-            if let Some(parts) = self.parse_from_import(import_stmt) {
-                for (alias, original) in parts {
-                    self.import_mapping.insert(alias, original);
-                }
-            }
-        }
+impl ResolutionMemo {
+    fn key_hash(call_site: &CallSite, scope: Option<Scope>) -> u64 {
+        let mut hasher = FastHasher::default();
+        call_site.called_name.hash(&mut hasher);
+        call_site.call_type.hash(&mut hasher);
+        call_site.context.hash(&mut hasher);
+        scope.hash(&mut hasher);
+        hasher.finish()
     }
 
-    fn parse_from_import(&self, _stmt: &str) -> Option<Vec<(String, String)>> {
-        // Simplified parsing - production code would use proper AST analysis
-        None // TODO: Implement proper import parsing
+    /// `Some(outcome)` when an identical call site was already resolved
+    fn get(
+        &self,
+        key: u64,
+        call_site: &CallSite,
+        scope: Option<Scope>,
+    ) -> Option<Option<Resolution>> {
+        self.lookups.fetch_add(1, Ordering::Relaxed);
+        let entry = self.entries.get(&key)?;
+        if !entry.matches(call_site, scope) {
+            // Hash collision: resolve this site directly
+            return None;
+        }
+        self.hits.fetch_add(1, Ordering::Relaxed);
+        Some(entry.resolution.clone())
     }
 
-    // Additional helper methods would go here...
-    #[allow(dead_code)]
-    fn extract_method_name(&self, called_name: &str) -> Option<String> {
-        called_name.split('.').last().map(|s| s.to_string())
+    fn insert(&self, key: u64, call_site: &CallSite, scope: Option<Scope>, edge: Option<&Edge>) {
+        self.entries.entry(key).or_insert_with(|| MemoEntry {
+            called_name: call_site.called_name.as_str().into(),
+            call_type: call_site.call_type,
+            context: call_site.context.as_deref().map(Into::into),
+            scope,
+            resolution: edge.map(|edge| Resolution::from_edge(edge, call_site.line_number)),
+        });
     }
 
-    #[allow(dead_code)]
-    fn infer_class_context(&self, _call_site: &CallSite) -> Option<String> {
-        // Would analyze the calling context to determine likely class
-        None // TODO: Implement class inference
+    fn record_hit(&self, call_type: CallType, resolved: bool) {
+        let counters = &self.by_call_type[call_type as usize];
+        counters.sites.fetch_add(1, Ordering::Relaxed);
+        counters
+            .resolved
+            .fetch_add(resolved as usize, Ordering::Relaxed);
     }
 
-    #[allow(dead_code)]
-    fn select_best_method_candidate<'a>(
-        &self,
-        candidates: &'a [MethodEntry],
-        _class_context: &Option<String>,
-    ) -> Option<&'a MethodEntry> {
-        candidates.first() // Simplified selection
+    fn record_resolution(&self, call_type: CallType, resolved: bool, elapsed: Duration) {
+        self.record_hit(call_type, resolved);
+        self.by_call_type[call_type as usize]
+            .resolve_nanos
+            .fetch_add(elapsed.as_nanos() as u64, Ordering::Relaxed);
     }
 
-    #[allow(dead_code)]
-    fn resolve_by_full_name(&self, _full_name: &str, _call_site: &CallSite) -> Option<Edge> {
-        None // TODO: Implement full name resolution
+    fn record_fuzzy(&self, matched: bool) {
+        self.fuzzy_lookups.fetch_add(1, Ordering::Relaxed);
+        self.fuzzy_matches
+            .fetch_add(matched as usize, Ordering::Relaxed);
     }
 
-    #[allow(dead_code)]
-    fn resolve_by_module_and_function(
-        &self,
-        _module: &str,
-        _function: &str,
-        _call_site: &CallSite,
-    ) -> Option<Edge> {
-        None // TODO: Implement module-based resolution
+    fn stats(&self) -> ResolutionStats {
+        ResolutionStats {
+            lookups: self.lookups.load(Ordering::Relaxed),
+            hits: self.hits.load(Ordering::Relaxed),
+            fuzzy_lookups: self.fuzzy_lookups.load(Ordering::Relaxed),
+            fuzzy_matches: self.fuzzy_matches.load(Ordering::Relaxed),
+            by_call_type: std::array::from_fn(|index| {
+                let counters = &self.by_call_type[index];
+                CallTypeStats {
+                    sites: counters.sites.load(Ordering::Relaxed),
+                    resolved: counters.resolved.load(Ordering::Relaxed),
+                    resolve_time: Duration::from_nanos(
+                        counters.resolve_nanos.load(Ordering::Relaxed),
+                    ),
+                }
+            }),
+            contract_matches: 0,
+        }
     }
+}
 
-    #[allow(dead_code)]
-    fn select_attribute_candidate<'a>(
-        &self,
-        candidates: &'a [MethodEntry],
-        _call_site: &CallSite,
-    ) -> Option<&'a MethodEntry> {
-        candidates.first() // Simplified selection
+impl MemoEntry {
+    fn matches(&self, call_site: &CallSite, scope: Option<Scope>) -> bool {
+        self.scope == scope
+            && *self.called_name == *call_site.called_name
+            && self.call_type == call_site.call_type
+            && self.context.as_deref() == call_site.context.as_deref()
     }
+}
 
-    #[allow(dead_code)]
-    fn resolve_dynamic_patterns(&self, _call_site: &CallSite) -> Option<Edge> {
-        None // TODO: Implement dynamic pattern resolution
+impl Resolution {
+    fn from_edge(edge: &Edge, line_number: usize) -> Self {
+        let context = match edge.context.as_deref() {
+            None => ResolvedContext::None,
+            Some(context) => match context.strip_suffix(&format!("line:{}", line_number)) {
+                Some(prefix) => ResolvedContext::Line(prefix.into()),
+                None => ResolvedContext::Fixed(context.into()),
+            },
+        };
+        Self {
+            target_id: edge.target_id,
+            context,
+        }
     }
 
-    #[allow(dead_code)]
-    fn resolve_with_context(&self, _call_site: &CallSite, _context: &str) -> Option<Edge> {
-        None // TODO: Implement context-based resolution
+    fn to_edge(&self, call_site: &CallSite) -> Edge {
+        let edge = Edge::new(EdgeType::Call, call_site.caller_id, self.target_id);
+        match &self.context {
+            ResolvedContext::None => edge,
+            ResolvedContext::Line(prefix) => {
+                edge.with_context(format!("{}line:{}", prefix, call_site.line_number))
+            }
+            ResolvedContext::Fixed(context) => edge.with_context(context.to_string()),
+        }
     }
 }
 
-#[derive(Debug, Clone)]
-enum FunctionOrMethod {
-    Function(FunctionEntry),
-    Method(MethodEntry),
+/// What a node means to call-site extraction
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum CallRole {
+    /// Opens a caller scope
+    Function,
+    /// A call or instantiation
+    Call,
 }
 
-impl FunctionOrMethod {
-    fn is_function(&self) -> bool {
-        matches!(self, FunctionOrMethod::Function(_))
-    }
-}
+/// Call-site node kinds of one grammar, see [`CallSiteExtractor::kinds`]
+pub type CallKinds = KindTable<CallRole>;
 
 /// Optimized call site extractor that identifies function calls during AST traversal
-pub struct CallSiteExtractor {
+///
+/// Runs standalone through [`extract_from_ast`](Self::extract_from_ast), or
+/// inside a parser's own [`Visitor`] by forwarding `enter`/`leave` between
+/// [`begin`](Self::begin) and [`finish`](Self::finish).
+pub struct CallSiteExtractor<'k> {
+    kinds: &'k CallKinds,
     call_sites: Vec<CallSite>,
-    current_function: Option<String>,
-    current_function_line: Option<usize>,
+    /// Id of the enclosing function, interned once on entry
+    current_caller: Option<NodeId>,
     current_file: Option<String>,
+    /// Routes registered in the file, bound to nodes by [`take_exports`](Self::take_exports)
+    routes: Vec<RouteRegistration>,
 }
 
-impl CallSiteExtractor {
-    pub fn new() -> Self {
+/// A route registration seen during the walk, before its handler is bound
+struct RouteRegistration {
+    method: String,
+    path: String,
+    handler: RouteHandler,
+}
+
+enum RouteHandler {
+    /// The function enclosing an inline handler
+    Node(NodeId),
+    /// A function of the file, by name and, for decorated functions, line
+    Function { name: String, line: Option<usize> },
+}
+
+impl<'k> CallSiteExtractor<'k> {
+    /// Resolves the function and call node kinds of `language` to kind ids
+    pub fn kinds(language: tree_sitter::Language) -> CallKinds {
+        use CallRole::{Call, Function};
+        KindTable::new(
+            language,
+            &[
+                ("function_definition", Function),     // Python/C++
+                ("function_declaration", Function),    // TypeScript/JavaScript
+                ("method_definition", Function),       // TypeScript/JavaScript
+                ("constructor_declaration", Function), // C++
+                ("destructor_declaration", Function),  // C++
+                ("function_item", Function),           // Rust
+                ("call", Call),                        // Python
+                ("call_expression", Call),             // TypeScript/JavaScript/C++/Rust
+                ("new_expression", Call),              // C++ class instantiation
+                ("constructor_call", Call),            // C++ constructor calls
+                ("macro_invocation", Call),            // Rust macro calls (like println!)
+            ],
+        )
+    }
+
+    pub fn new(kinds: &'k CallKinds) -> Self {
         Self {
+            kinds,
             call_sites: Vec::new(),
-            current_function: None,
-            current_function_line: None,
+            current_caller: None,
             current_file: None,
+            routes: Vec::new(),
         }
     }
 
@@ -632,58 +982,94 @@ impl CallSiteExtractor {
         source: &[u8],
         file_path: &std::path::Path,
     ) -> Vec<CallSite> {
+        self.begin(file_path);
+        walk_tree(
+            *root,
+            &mut CallSiteVisitor {
+                extractor: self,
+                source,
+            },
+        );
+        self.finish()
+    }
+
+    /// Starts collecting call sites for `file_path`
+    pub fn begin(&mut self, file_path: &std::path::Path) {
         self.call_sites.clear();
+        self.routes.clear();
+        self.current_caller = None;
         self.current_file = Some(
             file_path
                 .to_string_lossy()
                 .replace('/', "_")
                 .replace('\\', "_"),
         );
-        self.traverse_ast(root, source);
+    }
+
+    /// Takes the call sites collected since [`begin`](Self::begin)
+    pub fn finish(&mut self) -> Vec<CallSite> {
         std::mem::take(&mut self.call_sites)
     }
 
-    fn traverse_ast(&mut self, node: &tree_sitter::Node, source: &[u8]) {
-        // Track current function context for different languages
-        if self.is_function_node(node) {
-            if let Some((func_name, line_num)) = self.extract_function_info(node, source) {
-                self.current_function = Some(func_name);
-                self.current_function_line = Some(line_num);
-            }
-        }
+    /// Takes the routes registered since [`begin`](Self::begin), bound to the
+    /// function nodes of the file that handle them
+    pub fn take_exports(&mut self, nodes: &[Node]) -> Vec<NodeExport> {
+        std::mem::take(&mut self.routes)
+            .into_iter()
+            .filter_map(|route| {
+                let node_id = match route.handler {
+                    RouteHandler::Node(node_id) => node_id,
+                    RouteHandler::Function { name, line } => {
+                        nodes
+                            .iter()
+                            .find(|node| {
+                                node.node_type == NodeType::Function
+                                    && node.name == name
+                                    && line.map_or(true, |line| node.line_number == line)
+                            })?
+                            .id
+                    }
+                };
+                Some(NodeExport::http(node_id, &route.method, &route.path))
+            })
+            .collect()
+    }
 
-        // Extract call sites (including class instantiations)
-        if self.is_call_node(node) {
-            if let Some(call_site) = self.extract_call_site(node, source) {
-                self.call_sites.push(call_site);
+    pub fn enter(&mut self, node: &tree_sitter::Node, source: &[u8]) {
+        match self.kinds.get(node) {
+            // Track current function context for different languages
+            Some(CallRole::Function) => {
+                if let Some((func_name, line_num)) = self.extract_function_info(node, source) {
+                    // Same format as generate_node_id: "file_path_with_underscores:type:name:line"
+                    self.current_caller = Some(NodeId::intern(&format!(
+                        "{}:function:{}:{}",
+                        self.current_file.as_deref().unwrap_or("unknown"),
+                        func_name,
+                        line_num
+                    )));
+                }
             }
+            // Extract call sites (including class instantiations)
+            Some(CallRole::Call) => {
+                if let Some(mut call_site) = self.extract_call_site(node, source) {
+                    let called_name = &call_site.called_name;
+                    if let Some(context) = self.detect_contract(node, source, called_name) {
+                        call_site.context = Some(context);
+                    }
+                    self.call_sites.push(call_site);
+                }
+            }
+            None => {}
         }
+    }
 
-        // Recursively process children
-        let mut cursor = node.walk();
-        for child in node.children(&mut cursor) {
-            self.traverse_ast(&child, source);
-        }
-
+    pub fn leave(&mut self, node: &tree_sitter::Node) {
         // Clear function context when exiting function
-        if self.is_function_node(node) {
-            self.current_function = None;
-            self.current_function_line = None;
+        if self.kinds.get(node) == Some(CallRole::Function) {
+            self.current_caller = None;
         }
     }
 
-    fn is_function_node(&self, node: &tree_sitter::Node) -> bool {
-        matches!(
-            node.kind(),
-            "function_definition" |        // Python/C++
-            "function_declaration" |       // TypeScript/JavaScript
-            "method_definition" |          // TypeScript/JavaScript
-            "constructor_declaration" |    // C++
-            "destructor_declaration" |     // C++
-            "function_item" // Rust
-        )
-    }
-
     fn extract_function_info(
         &self,
         node: &tree_sitter::Node,
@@ -734,17 +1120,6 @@ impl CallSiteExtractor {
         }
     }
 
-    fn is_call_node(&self, node: &tree_sitter::Node) -> bool {
-        matches!(
-            node.kind(),
-            "call" |                    // Python
-            "call_expression" |         // TypeScript/JavaScript/C++/Rust
-            "new_expression" |          // C++ class instantiation
-            "constructor_call" |        // C++ constructor calls
-            "macro_invocation" // Rust macro calls (like println!)
-        )
-    }
-
     fn extract_call_site(&self, node: &tree_sitter::Node, source: &[u8]) -> Option<CallSite> {
         let (called_name, call_type) = self.extract_called_function_info(node, source)?;
 
@@ -752,19 +1127,9 @@ impl CallSiteExtractor {
             return None;
         }
 
-        // Build proper caller ID that matches the node ID format used in the parsers
-        let caller_id = if let Some(ref current_func) = self.current_function {
-            // Build a proper node ID that matches the exact format used by generate_node_id
-            // Format: "file_path_with_underscores:type:name:line_number"
-            format!(
-                "{}:function:{}:{}",
-                self.current_file.as_deref().unwrap_or("unknown"),
-                current_func,
-                self.current_function_line.unwrap_or(0)
-            )
-        } else {
-            "module_level".to_string()
-        };
+        let caller_id = self
+            .current_caller
+            .unwrap_or_else(|| NodeId::intern("module_level"));
 
         Some(CallSite {
             caller_id,
@@ -775,6 +1140,102 @@ impl CallSiteExtractor {
         })
     }
 
+    /// Records the route a call registers, or returns the call-site context of
+    /// an outbound HTTP request; both need a path literal as first argument
+    fn detect_contract(
+        &mut self,
+        node: &tree_sitter::Node,
+        source: &[u8],
+        called_name: &str,
+    ) -> Option<String> {
+        let arguments = node.child_by_field_name("arguments")?;
+        let mut cursor = arguments.walk();
+        let mut arguments = arguments.named_children(&mut cursor);
+        let path = contracts::route_path(self.extract_text(&arguments.next()?, source))?;
+        let rest: Vec<tree_sitter::Node> = arguments.collect();
+        let (receiver, verb) = split_qualified(called_name)
+            .map_or(("", called_name), |(receiver, verb)| {
+                (symbols::last_segment(receiver), verb)
+            });
+
+        // Python route decorators: @app.get("/users/{id}"), @bp.route("/x", methods=["POST"])
+        if let Some(decorator) = node.parent().filter(|parent| parent.kind() == "decorator") {
+            let methods: Vec<String> = match contracts::http_method(verb) {
+                Some(method) => vec![method.to_string()],
+                None if matches!(verb, "route" | "api_route") => {
+                    let listed: Vec<String> = rest
+                        .iter()
+                        .map(|argument| self.extract_text(argument, source))
+                        .find(|text| text.starts_with("methods"))
+                        .map(|text| {
+                            contracts::quoted_words(text)
+                                .map(str::to_uppercase)
+                                .collect()
+                        })
+                        .unwrap_or_default();
+                    if listed.is_empty() {
+                        vec!["GET".to_string()]
+                    } else {
+                        listed
+                    }
+                }
+                None => return None,
+            };
+            let definition = decorator.parent()?.child_by_field_name("definition")?;
+            let (name, line) = self.extract_function_info(&definition, source)?;
+            for method in methods {
+                self.routes.push(RouteRegistration {
+                    method,
+                    path: path.clone(),
+                    handler: RouteHandler::Function {
+                        name: name.clone(),
+                        line: Some(line),
+                    },
+                });
+            }
+            return None;
+        }
+
+        // Express-style registration: router.get("/users/:id", auth, handler)
+        let registered = contracts::http_method(verb).or((verb == "all").then_some("*"));
+        if let (Some(method), true, Some(handler)) =
+            (registered, contracts::is_router(receiver), rest.last())
+        {
+            let handler = match handler.kind() {
+                "identifier" => RouteHandler::Function {
+                    name: self.extract_text(handler, source).to_string(),
+                    line: None,
+                },
+                "arrow_function" | "function_expression" | "function" => {
+                    RouteHandler::Node(self.current_caller?)
+                }
+                _ => return None,
+            };
+            self.routes.push(RouteRegistration {
+                method: method.to_string(),
+                path,
+                handler,
+            });
+            return None;
+        }
+
+        // Clients: fetch(url, { method: "POST" }), axios.get(url), requests.post(url)
+        let method = if verb == "fetch" {
+            rest.first()
+                .and_then(|options| {
+                    let (_, after) = self.extract_text(options, source).split_once("method")?;
+                    contracts::quoted_words(after).next()
+                })
+                .and_then(contracts::http_method)
+                .unwrap_or("GET")
+        } else if receiver.is_empty() {
+            return None;
+        } else {
+            contracts::http_method(verb)?
+        };
+        Some(contracts::http_call_context(method, &path))
+    }
+
     fn extract_called_function_info(
         &self,
         node: &tree_sitter::Node,
@@ -829,7 +1290,7 @@ impl CallSiteExtractor {
             _ => None,
         }
     }
-
+                
     fn extract_function_name_from_node(
         &self,
         function_node: &tree_sitter::Node,
@@ -858,9 +1319,13 @@ impl CallSiteExtractor {
                     // super().method() - parent method call
                     return full_text[8..].to_string();
                 }
+
+                // module.func or obj.method: keep the receiver for the symbol table
+                if is_dotted_path(full_text) {
+                    return full_text.to_string();
+                }
                 
-                // For other attribute access like module.func or obj.method
-                // Look for the attribute identifier
+                // Otherwise look for the attribute identifier
                 let mut cursor = function_node.walk();
                 for child in function_node.children(&mut cursor) {
                     if child.kind() == "identifier" && child.start_byte() > function_node.start_byte() {
@@ -871,7 +1336,7 @@ impl CallSiteExtractor {
                         }
                     }
                 }
-                
+
                 // Fallback: return the full attribute chain
                 full_text.to_string()
             }
@@ -945,6 +1410,10 @@ impl CallSiteExtractor {
                 }
             }
             "field_expression" => CallType::MethodCall, // obj.method()
+            // JS/TS obj.method() and Go pkg.Func()
+            "member_expression" | "selector_expression" if is_dotted_path(called_name) => {
+                CallType::QualifiedCall
+            }
             "qualified_identifier" => CallType::QualifiedCall, // namespace::func() or Class::method()
             "scoped_identifier" => CallType::QualifiedCall, // Rust std::println, crate::module::function
             "generic_function" => CallType::QualifiedCall,  // Rust Vec::<i32>::new()
@@ -980,3 +1449,31 @@ impl CallSiteExtractor {
         std::str::from_utf8(&source[node.byte_range()]).unwrap_or("")
     }
 }
+
+/// `a.b.c` made of plain identifiers only, without calls or subscripts
+fn is_dotted_path(text: &str) -> bool {
+    let is_part = |part: &str| {
+        !part.is_empty()
+            && part
+                .chars()
+                .all(|c| c.is_alphanumeric() || c == '_' || c == '$')
+    };
+    text.contains('.') && text.split('.').all(is_part)
+}
+
+/// Drives a standalone [`CallSiteExtractor`] through [`walk_tree`]
+struct CallSiteVisitor<'e, 'k, 's> {
+    extractor: &'e mut CallSiteExtractor<'k>,
+    source: &'s [u8],
+}
+
+impl<'tree> Visitor<'tree> for CallSiteVisitor<'_, '_, '_> {
+    fn enter(&mut self, node: tree_sitter::Node<'tree>) -> bool {
+        self.extractor.enter(&node, self.source);
+        true
+    }
+
+    fn leave(&mut self, node: tree_sitter::Node<'tree>) {
+        self.extractor.leave(&node);
+    }
+}
@@ -1,7 +1,19 @@
+//! Source file discovery.
+//!
+//! Walks the tree in parallel with the `ignore` crate, so `.gitignore`,
+//! `.git/info/exclude` and `.embargoignore` rules prune whole directories before
+//! they are read. Entries are classified from their directory entry type and
+//! extension without an extra stat.
+
 use anyhow::Result;
-use rayon::prelude::*;
+use ignore::gitignore::{Gitignore, GitignoreBuilder};
+use ignore::{Match, WalkBuilder, WalkState};
+use std::collections::HashMap;
 use std::path::{Path, PathBuf};
-use walkdir::WalkDir;
+use std::sync::Mutex;
+
+/// Per-directory ignore file read in addition to `.gitignore`, same syntax
+pub const IGNORE_FILE_NAME: &str = ".embargoignore";
 
 #[derive(Debug, Clone)]
 pub struct FileInfo {
@@ -11,44 +23,119 @@ pub struct FileInfo {
     pub extension: String,
 }
 
-pub struct FileScanner;
+pub struct FileScanner {
+    /// Walker threads; 0 lets the walker pick from the available cores
+    threads: usize,
+}
 
 impl FileScanner {
     pub fn new() -> Self {
-        Self
+        Self { threads: 0 }
+    }
+
+    /// Caps the number of directory walker threads (0 = automatic)
+    pub fn with_threads(mut self, threads: usize) -> Self {
+        self.threads = threads;
+        self
     }
 
     pub fn scan_directory(&self, root_path: &Path, languages: &[&str]) -> Result<Vec<FileInfo>> {
+        let files = Mutex::new(Vec::new());
+        self.scan_with(root_path, languages, |file| {
+            files.lock().unwrap_or_else(|e| e.into_inner()).push(file);
+        })?;
+        let mut files = files.into_inner().unwrap_or_else(|e| e.into_inner());
+
+        // Walker threads finish in any order; sort for reproducible runs
+        files.sort_unstable_by(|a, b| a.path.cmp(&b.path));
+
+        Ok(files)
+    }
+
+    /// Walks `root_path` and hands each matching file to `on_file` as soon as it
+    /// is found, from whichever walker thread found it.
+    pub fn scan_with<F>(&self, root_path: &Path, languages: &[&str], on_file: F) -> Result<()>
+    where
+        F: Fn(FileInfo) + Sync,
+    {
         let supported_extensions = self.get_extensions_for_languages(languages);
+        let on_file = &on_file;
+        let supported_extensions = &supported_extensions;
 
-        // Collect all entries first for parallel processing
-        let entries: Vec<_> = WalkDir::new(root_path)
+        WalkBuilder::new(root_path)
             .follow_links(false)
-            .into_iter()
-            .filter_map(|e| e.ok())
-            .filter(|entry| entry.path().is_file())
-            .collect();
-
-        // Process entries in parallel
-        let files: Vec<FileInfo> = entries
-            .par_iter()
-            .filter_map(|entry| {
-                let path = entry.path();
-                path.extension()
-                    .and_then(|ext| ext.to_str())
-                    .and_then(|extension| {
-                        supported_extensions
-                            .get(extension)
-                            .map(|language| FileInfo {
-                                path: path.to_path_buf(),
-                                language: language.clone(),
-                                extension: extension.to_string(),
-                            })
-                    })
-            })
-            .collect();
+            // Hidden files were always scanned; only ignore rules prune now
+            .hidden(false)
+            .require_git(false)
+            .add_custom_ignore_filename(IGNORE_FILE_NAME)
+            .filter_entry(|entry| entry.file_name() != ".git")
+            .threads(self.threads)
+            .build_parallel()
+            .run(|| {
+                Box::new(move |entry| {
+                    let Ok(entry) = entry else {
+                        return WalkState::Continue;
+                    };
+                    let is_file = match entry.file_type() {
+                        Some(file_type) if file_type.is_file() => true,
+                        // Symlinks are only followed to decide whether they name a file
+                        Some(file_type) if file_type.is_symlink() => entry.path().is_file(),
+                        _ => false,
+                    };
+                    if !is_file {
+                        return WalkState::Continue;
+                    }
 
-        Ok(files)
+                    let path = entry.path();
+                    let info =
+                        path.extension()
+                            .and_then(|ext| ext.to_str())
+                            .and_then(|extension| {
+                                supported_extensions
+                                    .get(extension)
+                                    .map(|language| FileInfo {
+                                        path: path.to_path_buf(),
+                                        language: language.clone(),
+                                        extension: extension.to_string(),
+                                    })
+                            });
+                    if let Some(info) = info {
+                        on_file(info);
+                    }
+                    WalkState::Continue
+                })
+            });
+
+        Ok(())
+    }
+
+    /// Keeps the paths a scan of `root_path` would report: an extension of one
+    /// of `languages` and not excluded by the ignore rules the walk applies.
+    ///
+    /// Paths are not required to exist, so deleted files are classified as well.
+    pub fn classify_paths(
+        &self,
+        root_path: &Path,
+        paths: &[PathBuf],
+        languages: &[&str],
+    ) -> Vec<FileInfo> {
+        let supported_extensions = self.get_extensions_for_languages(languages);
+        let mut ignore_rules = IgnoreRules::new(root_path);
+        paths
+            .iter()
+            .filter_map(|path| {
+                let extension = path.extension()?.to_str()?;
+                let language = supported_extensions.get(extension)?;
+                if ignore_rules.is_ignored(path) {
+                    return None;
+                }
+                Some(FileInfo {
+                    path: path.clone(),
+                    language: language.clone(),
+                    extension: extension.to_string(),
+                })
+            })
+            .collect()
     }
 
     fn get_extensions_for_languages(
@@ -102,3 +189,99 @@ impl FileScanner {
         extensions
     }
 }
+
+/// The walk's ignore rules, for paths that were not found by walking.
+///
+/// As in the walk, ignore files apply to everything below their directory and
+/// deeper ones win, `.embargoignore` rules take precedence over `.gitignore`
+/// ones, an ignored directory hides everything in it and nothing under `.git`
+/// is reported. Ignore files in directories above the root are not consulted.
+struct IgnoreRules {
+    root: PathBuf,
+    /// Matchers of each directory visited so far, loaded on first use
+    dirs: HashMap<PathBuf, DirRules>,
+    /// `.git/info/exclude` and the global gitignore, below every ignore file
+    fallback: Vec<Gitignore>,
+}
+
+#[derive(Default)]
+struct DirRules {
+    custom: Option<Gitignore>,
+    git: Option<Gitignore>,
+}
+
+impl IgnoreRules {
+    fn new(root: &Path) -> Self {
+        let mut fallback = Vec::new();
+        fallback.extend(load_ignore_file(root, &root.join(".git/info/exclude")));
+        fallback.push(Gitignore::global().0);
+        Self {
+            root: root.to_path_buf(),
+            dirs: HashMap::new(),
+            fallback,
+        }
+    }
+
+    /// Whether a walk of the root would skip `path`; paths outside it never are
+    fn is_ignored(&mut self, path: &Path) -> bool {
+        let Ok(relative) = path.strip_prefix(&self.root) else {
+            return false;
+        };
+        if relative.components().any(|part| part.as_os_str() == ".git") {
+            return true;
+        }
+
+        // Each directory on the way down, then the file, against the rules above it
+        let parts: Vec<_> = relative.components().collect();
+        let mut governing = vec![self.root.clone()];
+        let mut current = self.root.clone();
+        for (depth, part) in parts.iter().enumerate() {
+            let dir = &governing[governing.len() - 1];
+            if !self.dirs.contains_key(dir) {
+                let rules = DirRules {
+                    custom: load_ignore_file(dir, &dir.join(IGNORE_FILE_NAME)),
+                    git: load_ignore_file(dir, &dir.join(".gitignore")),
+                };
+                self.dirs.insert(dir.clone(), rules);
+            }
+            current.push(part);
+            let is_dir = depth + 1 < parts.len();
+            if self.matched(&governing, &current, is_dir) {
+                return true;
+            }
+            governing.push(current.clone());
+        }
+        false
+    }
+
+    /// Decision of the innermost rule matching `candidate`, ignore files first
+    fn matched(&self, governing: &[PathBuf], candidate: &Path, is_dir: bool) -> bool {
+        let custom = governing
+            .iter()
+            .rev()
+            .filter_map(|dir| self.dirs[dir].custom.as_ref());
+        let git = governing
+            .iter()
+            .rev()
+            .filter_map(|dir| self.dirs[dir].git.as_ref());
+        for matcher in custom.chain(git).chain(&self.fallback) {
+            match matcher.matched(candidate, is_dir) {
+                Match::Ignore(_) => return true,
+                Match::Whitelist(_) => return false,
+                Match::None => {}
+            }
+        }
+        false
+    }
+}
+
+/// Matcher for the ignore file at `file`, rooted at `dir`; `None` if there is none
+fn load_ignore_file(dir: &Path, file: &Path) -> Option<Gitignore> {
+    if !file.is_file() {
+        return None;
+    }
+    let mut builder = GitignoreBuilder::new(dir);
+    // Like the walk, keep the rules that parsed when some lines do not
+    let _ = builder.add(file);
+    builder.build().ok()
+}
@@ -0,0 +1,252 @@
+//! Sharded analysis.
+//!
+//! A [`GraphShard`] is the partial graph of one subtree (a package of a
+//! monorepo): its nodes, its parsed edges, its call sites with the edges of
+//! those no other subtree can change, and the routes the subtree exports.
+//! Shards are analyzed independently, possibly on different machines, and
+//! [`merge`] combines them, resolving only the call sites their shards left
+//! open against the merged graph. The merged graph is the one a single run
+//! over the union of the subtrees builds.
+
+use anyhow::{Context, Result};
+use serde::{Deserialize, Serialize};
+use std::collections::{HashMap, HashSet};
+use std::fs;
+use std::io::Write;
+use std::path::{Path, PathBuf};
+
+use super::graph::GraphBuilder;
+use super::resolver::{CallType, ResolutionStats};
+use super::{CallSite, DependencyGraph, Edge, FunctionResolver, Node, NodeExport, NodeId};
+use crate::parsers::ParseResult;
+
+/// Bumped whenever the serialized layout of [`GraphShard`] changes
+const SHARD_VERSION: u32 = 3;
+
+/// Partial graph of one analyzed subtree.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub struct GraphShard {
+    version: u32,
+    /// Subtree the shard was analyzed from
+    pub root: PathBuf,
+    pub languages: Vec<String>,
+    pub nodes: Vec<Node>,
+    /// Parsed edges, including those whose far end lies in another shard
+    pub edges: Vec<Edge>,
+    /// Every call site, in parse order
+    pub calls: Vec<ShardCall>,
+    pub exports: Vec<NodeExport>,
+}
+
+/// A call site of a shard, resolved or left for the merge.
+#[derive(Debug, Clone, Serialize, Deserialize)]
+pub enum ShardCall {
+    /// Resolved to a function in the caller's own file, which no other shard
+    /// can outrank
+    Resolved(Edge),
+    Open(CallSite),
+}
+
+/// Outcome of a [`merge`].
+#[derive(Debug, Clone, Copy, Default)]
+pub struct MergeSummary {
+    pub shards: usize,
+    /// Nodes found in more than one shard; only the first copy is kept
+    pub duplicate_nodes: usize,
+    /// Call sites left unresolved by their shard
+    pub cross_shard_sites: usize,
+    /// Of those, the ones that resolved against the merged graph
+    pub cross_shard_edges: usize,
+    pub memo: ResolutionStats,
+}
+
+impl GraphShard {
+    /// Assembles the shard of `root` from its files' parse results.
+    ///
+    /// Only simple calls to a function in the caller's own file are resolved
+    /// here: the caller's file is searched first, so the target is the same
+    /// whatever the other shards define. Anything else could pick a different
+    /// target, or a fuzzy match, once the whole tree is indexed, and is
+    /// deferred to [`merge`].
+    pub fn from_results(
+        root: &Path,
+        languages: &[&str],
+        results: Vec<ParseResult>,
+        resolver: &FunctionResolver,
+    ) -> Result<(Self, ResolutionStats)> {
+        let mut shard = Self {
+            version: SHARD_VERSION,
+            root: root.to_path_buf(),
+            languages: languages.iter().map(|lang| lang.to_string()).collect(),
+            nodes: Vec::new(),
+            edges: Vec::new(),
+            calls: Vec::new(),
+            exports: Vec::new(),
+        };
+        let mut call_sites = Vec::new();
+        for result in results {
+            shard.nodes.extend(result.nodes);
+            shard.edges.extend(result.edges);
+            call_sites.extend(result.call_sites.unwrap_or_default());
+            shard.exports.extend(result.exports);
+        }
+
+        let graph_builder = build_graph(&shard.nodes, &shard.edges);
+        let mut resolver = resolver.clone().with_fuzzy_matching(false);
+        resolver.build_indexes(graph_builder.graph())?;
+        resolver.index_exports(&shard.exports);
+        let sites: Vec<&CallSite> = call_sites.iter().collect();
+        let (resolved, stats) = resolver.resolve_call_sites(graph_builder.graph(), &sites);
+        drop(sites);
+        let files: HashMap<NodeId, &Path> = shard
+            .nodes
+            .iter()
+            .map(|node| (node.id, node.file_path.as_ref()))
+            .collect();
+        let in_callers_file = |call_site: &CallSite, edge: &Edge| {
+            call_site.call_type == CallType::SimpleCall
+                && files
+                    .get(&edge.target_id)
+                    .is_some_and(|file| files.get(&call_site.caller_id) == Some(file))
+        };
+        let calls = call_sites
+            .into_iter()
+            .zip(resolved)
+            .map(|(call_site, edge)| match edge {
+                Some(edge) if in_callers_file(&call_site, &edge) => ShardCall::Resolved(edge),
+                _ => ShardCall::Open(call_site),
+            })
+            .collect();
+        drop(files);
+        shard.calls = calls;
+        Ok((shard, stats))
+    }
+
+    /// Call sites left for the merge
+    pub fn unresolved(&self) -> impl Iterator<Item = &CallSite> {
+        self.calls.iter().filter_map(|call| match call {
+            ShardCall::Open(call_site) => Some(call_site),
+            ShardCall::Resolved(_) => None,
+        })
+    }
+
+    /// Parsed edges and the call edges resolved inside the shard
+    pub fn edge_count(&self) -> usize {
+        self.edges.len() + self.calls.len() - self.unresolved().count()
+    }
+
+    pub fn load(path: &Path) -> Result<Self> {
+        let bytes = fs::read(path).with_context(|| format!("failed to read {}", path.display()))?;
+        let shard: Self = bincode::deserialize(&bytes)
+            .with_context(|| format!("{} is not a graph shard", path.display()))?;
+        if shard.version != SHARD_VERSION {
+            anyhow::bail!(
+                "{} is a version {} shard, expected version {}; re-run the shard analysis",
+                path.display(),
+                shard.version,
+                SHARD_VERSION
+            );
+        }
+        Ok(shard)
+    }
+
+    /// Writes the shard next to `path` and renames it into place
+    pub fn save(&self, path: &Path) -> Result<()> {
+        if let Some(parent) = path
+            .parent()
+            .filter(|parent| !parent.as_os_str().is_empty())
+        {
+            fs::create_dir_all(parent)?;
+        }
+        let bytes = bincode::serialize(self)?;
+        let tmp = path.with_extension("shard.tmp");
+        let mut file = fs::File::create(&tmp)
+            .with_context(|| format!("failed to create {}", tmp.display()))?;
+        file.write_all(&bytes)?;
+        drop(file);
+        fs::rename(&tmp, path).with_context(|| format!("failed to replace {}", path.display()))?;
+        Ok(())
+    }
+}
+
+/// Combines `shards` into one graph and resolves their open call sites across shards.
+///
+/// Nodes, parsed edges and then call edges are laid out in file path order,
+/// the order a single run over the union of the subtrees produces, so output
+/// does not depend on how the tree was split or the order of `shards`.
+pub fn merge(
+    mut shards: Vec<GraphShard>,
+    resolver: &FunctionResolver,
+) -> Result<(DependencyGraph, MergeSummary)> {
+    let mut summary = MergeSummary {
+        shards: shards.len(),
+        ..MergeSummary::default()
+    };
+    // Disjoint subtrees in path order hold their files in path order
+    shards.sort_by(|a, b| a.root.cmp(&b.root));
+    let mut seen: HashSet<NodeId> = HashSet::new();
+    let mut nodes = Vec::new();
+    let mut edges = Vec::new();
+    let mut calls = Vec::new();
+    let mut exports = Vec::new();
+    for shard in shards {
+        for node in shard.nodes {
+            if seen.insert(node.id) {
+                nodes.push(node);
+            } else {
+                summary.duplicate_nodes += 1;
+            }
+        }
+        edges.extend(shard.edges);
+        calls.extend(shard.calls);
+        exports.extend(shard.exports);
+    }
+    nodes.sort_by(|a, b| a.file_path.cmp(&b.file_path));
+
+    let mut graph_builder = build_graph(&nodes, &edges);
+    drop(edges);
+    let mut resolver = resolver.clone();
+    resolver.build_indexes(graph_builder.graph())?;
+    resolver.index_exports(&exports);
+
+    let sites: Vec<&CallSite> = calls
+        .iter()
+        .filter_map(|call| match call {
+            ShardCall::Open(call_site) => Some(call_site),
+            ShardCall::Resolved(_) => None,
+        })
+        .collect();
+    let (resolved, memo) = resolver.resolve_call_sites(graph_builder.graph(), &sites);
+    summary.cross_shard_sites = sites.len();
+    summary.memo = memo;
+    drop(sites);
+
+    // Call edges in call site order, each shard's own among the merged ones
+    let mut resolved = resolved.into_iter();
+    for call in calls {
+        match call {
+            ShardCall::Resolved(edge) => {
+                graph_builder.add_edge(edge);
+            }
+            ShardCall::Open(_) => {
+                let edge = resolved.next().flatten();
+                if edge.and_then(|edge| graph_builder.add_edge(edge)).is_some() {
+                    summary.cross_shard_edges += 1;
+                }
+            }
+        }
+    }
+    Ok((graph_builder.build(), summary))
+}
+
+fn build_graph(nodes: &[Node], edges: &[Edge]) -> GraphBuilder {
+    let mut graph_builder = GraphBuilder::new();
+    graph_builder.reserve(nodes.len(), edges.len());
+    for node in nodes {
+        graph_builder.add_node(node.clone());
+    }
+    for edge in edges {
+        graph_builder.add_edge(edge.clone());
+    }
+    graph_builder
+}
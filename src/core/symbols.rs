@@ -0,0 +1,365 @@
+//! Module and type symbol tables for qualified call resolution.
+//!
+//! Built once per [`FunctionResolver`](super::FunctionResolver) index from the
+//! graph, so `module.function()`, `Type::method()` and `alias.function()` calls
+//! resolve with a hash lookup on slices of the called name:
+//!
+//! - module symbols: `(module, name)` to the free functions a module defines.
+//!   A file belongs to the module named by its stem (its directory for
+//!   `__init__`, `index`, `mod`, `lib` and `main` files) and to any package or
+//!   namespace it declares.
+//! - type members: `(type, name)` to the functions a class or interface contains
+//! - import aliases: per file, the module an alias stands for
+//!   (`import numpy as np`, `import * as u from "./utils"`, `use a::b as c`)
+
+use petgraph::graph::NodeIndex;
+use std::path::Path;
+
+use crate::core::fast_hash::{hash_name, FastMap};
+use crate::core::{DependencyGraph, EdgeType, Language, NodeType};
+
+/// Where a definition or caller lives: language shard, then file ordinal
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub(crate) struct Scope {
+    pub language: u8,
+    pub file: u32,
+}
+
+impl Scope {
+    /// Languages that import each other's definitions share a shard
+    pub fn language_shard(language: Language) -> u8 {
+        match language {
+            Language::Python => 0,
+            Language::TypeScript | Language::JavaScript => 1,
+            Language::Cpp => 2,
+            Language::Rust => 3,
+            Language::Java => 4,
+            Language::Go => 5,
+            Language::CSharp => 6,
+            Language::Unknown => u8::MAX,
+        }
+    }
+}
+
+/// Definitions sharing one name, sorted by [`Scope`] and then graph order
+#[derive(Debug, Clone)]
+pub(crate) struct Candidates<E> {
+    scopes: Vec<Scope>,
+    entries: Vec<E>,
+}
+
+impl<E> Candidates<E> {
+    /// `entries` must be in graph order; the sort keeps it within each scope
+    pub fn new(mut entries: Vec<(Scope, E)>) -> Self {
+        entries.sort_by_key(|(scope, _)| *scope);
+        let (scopes, entries) = entries.into_iter().unzip();
+        Self { scopes, entries }
+    }
+
+    /// The candidates in `caller`'s file, else in its language, else all of them
+    pub fn preferred(&self, caller: Option<Scope>) -> &[E] {
+        let Some(caller) = caller.filter(|_| self.entries.len() > 1) else {
+            return &self.entries;
+        };
+        let (start, end) = self.language_range(caller);
+        if start == end {
+            return &self.entries;
+        }
+        match self.file_range(caller, start, end) {
+            (file_start, file_end) if file_start < file_end => &self.entries[file_start..file_end],
+            _ => &self.entries[start..end],
+        }
+    }
+
+    /// Only the candidates in `caller`'s own file
+    pub fn in_file(&self, caller: Option<Scope>) -> &[E] {
+        let Some(caller) = caller else {
+            return &[];
+        };
+        let (start, end) = self.language_range(caller);
+        let (file_start, file_end) = self.file_range(caller, start, end);
+        &self.entries[file_start..file_end]
+    }
+
+    fn language_range(&self, caller: Scope) -> (usize, usize) {
+        let start = self
+            .scopes
+            .partition_point(|scope| scope.language < caller.language);
+        let end = self
+            .scopes
+            .partition_point(|scope| scope.language <= caller.language);
+        (start, end)
+    }
+
+    fn file_range(&self, caller: Scope, start: usize, end: usize) -> (usize, usize) {
+        let in_language = &self.scopes[start..end];
+        (
+            start + in_language.partition_point(|scope| scope.file < caller.file),
+            start + in_language.partition_point(|scope| scope.file <= caller.file),
+        )
+    }
+}
+
+/// `(qualifier, name)` of `a.b.name` or `a::b::name`, split at the last separator
+pub(crate) fn split_qualified(called_name: &str) -> Option<(&str, &str)> {
+    let dot = called_name.rfind('.').map(|at| (at, at + 1));
+    let path = called_name.rfind("::").map(|at| (at, at + 2));
+    let (end, start) = dot.max(path)?;
+    let (qualifier, name) = (&called_name[..end], &called_name[start..]);
+    (!qualifier.is_empty() && !name.is_empty()).then_some((qualifier, name))
+}
+
+/// Last segment of a qualifier, without generic arguments: `vector` for
+/// `std::vector<int>`, `Vec` for `Vec::<u8>`
+pub(crate) fn last_segment(qualifier: &str) -> &str {
+    let qualifier = qualifier
+        .split('<')
+        .next()
+        .unwrap_or(qualifier)
+        .trim_end_matches(':');
+    split_qualified(qualifier).map_or(qualifier, |(_, segment)| segment)
+}
+
+/// Module names a file contributes: its stem, or its directory for package roots
+fn path_module_name(path: &Path) -> Option<&str> {
+    let stem = path.file_stem()?.to_str()?;
+    match stem {
+        "__init__" | "index" | "mod" | "lib" | "main" => path.parent()?.file_name()?.to_str(),
+        _ => Some(stem),
+    }
+}
+
+/// Module name of a path in an import statement: `utils` for `"../lib/utils.js"`
+fn import_path_module(path: &str) -> Option<&str> {
+    let path = path.trim_matches(|c| c == '"' || c == '\'' || c == '`');
+    path_module_name(Path::new(path))
+}
+
+/// Kind segment of a node id: `import` in `src_a.py:import:import os:1`
+fn id_kind(id: &str) -> Option<&str> {
+    id.split(':').nth(1)
+}
+
+fn is_identifier(text: &str) -> bool {
+    !text.is_empty()
+        && text
+            .chars()
+            .all(|c| c.is_alphanumeric() || c == '_' || c == '$')
+}
+
+/// `(alias, module)` pairs an import statement binds under a new name
+fn import_aliases<'t>(language: &str, statement: &'t str) -> Vec<(&'t str, &'t str)> {
+    let statement = statement.trim().trim_end_matches(';');
+    let mut aliases = Vec::new();
+    match language {
+        "go" => {
+            // Import spec: `alias "path/to/pkg"`
+            if let Some((alias, path)) = statement.split_once(char::is_whitespace) {
+                if let (true, Some(module)) =
+                    (is_identifier(alias), import_path_module(path.trim()))
+                {
+                    aliases.push((alias, module));
+                }
+            }
+            return aliases;
+        }
+        "csharp" | "cpp" => {
+            // `using Alias = Some.Namespace;`
+            if let Some((alias, target)) = statement
+                .strip_prefix("using ")
+                .and_then(|rest| rest.split_once('='))
+            {
+                let alias = alias.trim();
+                if is_identifier(alias) {
+                    aliases.push((alias, last_segment(target.trim())));
+                }
+            }
+            return aliases;
+        }
+        "typescript" | "javascript" => {
+            // `import * as ns from "m"`, `import Default, { a } from "m"`
+            if let Some((head, path)) = statement
+                .strip_prefix("import ")
+                .and_then(|rest| rest.rsplit_once(" from "))
+            {
+                let head = head.trim();
+                if let Some(module) = import_path_module(path.trim()) {
+                    if let Some(namespace) = head.strip_prefix("* as ") {
+                        aliases.push((namespace.trim(), module));
+                    } else {
+                        let default = head.split([',', '{']).next().unwrap_or("").trim();
+                        if is_identifier(default) && default != "type" {
+                            aliases.push((default, module));
+                        }
+                    }
+                }
+            }
+        }
+        _ => {}
+    }
+
+    // `original as alias`: Python, Rust, and named imports in TypeScript
+    for (at, _) in statement.match_indices(" as ") {
+        let before = statement[..at].trim_end();
+        let original = before
+            .rsplit(|c: char| c.is_whitespace() || matches!(c, ',' | '{' | '('))
+            .next()
+            .unwrap_or(before);
+        let after = statement[at + 4..].trim_start();
+        let alias_end = after
+            .find(|c: char| !(c.is_alphanumeric() || c == '_' || c == '$'))
+            .unwrap_or(after.len());
+        let alias = &after[..alias_end];
+        let original = last_segment(original);
+        if is_identifier(alias) && is_identifier(original) {
+            aliases.push((alias, original));
+        }
+    }
+    aliases
+}
+
+/// Functions owned by a class or interface, keyed by function node
+pub(crate) fn owners(graph: &DependencyGraph) -> FastMap<NodeIndex, NodeIndex> {
+    let mut owners = FastMap::default();
+    for edge in graph.raw_edges() {
+        if edge.weight.edge_type != EdgeType::Contains {
+            continue;
+        }
+        let (owner, member) = (edge.source(), edge.target());
+        if matches!(
+            graph[owner].node_type,
+            NodeType::Class | NodeType::Interface
+        ) && graph[member].node_type == NodeType::Function
+        {
+            owners.entry(member).or_insert(owner);
+        }
+    }
+    owners
+}
+
+/// Qualified-name lookup tables over one graph; entries are graph indexes
+#[derive(Debug, Clone)]
+pub(crate) struct SymbolTable<E> {
+    /// `(module hash, name hash)` to the module's free functions
+    module_symbols: FastMap<(u64, u64), Candidates<E>>,
+    /// `(type hash, name hash)` to the type's member functions
+    type_members: FastMap<(u64, u64), Candidates<E>>,
+    /// `(file ordinal, alias hash)` to the hash of the aliased module
+    aliases: FastMap<(u32, u64), u64>,
+}
+
+impl<E> Default for SymbolTable<E> {
+    fn default() -> Self {
+        Self {
+            module_symbols: FastMap::default(),
+            type_members: FastMap::default(),
+            aliases: FastMap::default(),
+        }
+    }
+}
+
+impl<E: Copy> SymbolTable<E> {
+    /// `scopes` holds the scope of every graph node, in graph order
+    pub fn build(
+        graph: &DependencyGraph,
+        scopes: &[Scope],
+        owners: &FastMap<NodeIndex, NodeIndex>,
+        entry: impl Fn(NodeIndex) -> E,
+    ) -> Self {
+        let nodes = graph.raw_nodes();
+        let mut aliases = FastMap::default();
+        let mut declared: FastMap<u32, Vec<u64>> = FastMap::default();
+        for (raw, scope) in nodes.iter().zip(scopes) {
+            let node = &raw.weight;
+            if node.node_type != NodeType::Module {
+                continue;
+            }
+            match id_kind(node.id.as_str()) {
+                Some("package" | "namespace") => declared
+                    .entry(scope.file)
+                    .or_default()
+                    .push(hash_name(last_segment(&node.name))),
+                Some("import" | "using") => {
+                    for (alias, module) in import_aliases(node.language.as_str(), &node.name) {
+                        aliases
+                            .entry((scope.file, hash_name(alias)))
+                            .or_insert_with(|| hash_name(module));
+                    }
+                }
+                _ => {}
+            }
+        }
+
+        let mut modules: FastMap<u32, Vec<u64>> = FastMap::default();
+        let mut module_groups: FastMap<(u64, u64), Vec<(Scope, E)>> = FastMap::default();
+        let mut member_groups: FastMap<(u64, u64), Vec<(Scope, E)>> = FastMap::default();
+        for (index, (raw, scope)) in nodes.iter().zip(scopes).enumerate() {
+            let node = &raw.weight;
+            if node.node_type != NodeType::Function {
+                continue;
+            }
+            let index = NodeIndex::new(index);
+            let name = hash_name(&node.name);
+            if let Some(owner) = owners.get(&index) {
+                member_groups
+                    .entry((hash_name(&graph[*owner].name), name))
+                    .or_default()
+                    .push((*scope, entry(index)));
+                continue;
+            }
+            let file_modules = modules.entry(scope.file).or_insert_with(|| {
+                let mut names: Vec<u64> = path_module_name(&node.file_path)
+                    .map(hash_name)
+                    .into_iter()
+                    .collect();
+                names.extend(declared.get(&scope.file).into_iter().flatten());
+                names.sort_unstable();
+                names.dedup();
+                names
+            });
+            for module in file_modules.iter() {
+                module_groups
+                    .entry((*module, name))
+                    .or_default()
+                    .push((*scope, entry(index)));
+            }
+        }
+
+        let finish = |groups: FastMap<(u64, u64), Vec<(Scope, E)>>| {
+            groups
+                .into_iter()
+                .map(|(key, entries)| (key, Candidates::new(entries)))
+                .collect()
+        };
+        Self {
+            module_symbols: finish(module_groups),
+            type_members: finish(member_groups),
+            aliases,
+        }
+    }
+
+    /// Whether `caller`'s file imports a module under `qualifier`'s last segment
+    pub fn has_alias(&self, caller: Scope, qualifier: &str) -> bool {
+        self.aliases
+            .contains_key(&(caller.file, hash_name(last_segment(qualifier))))
+    }
+
+    /// Definitions `qualifier.name` or `qualifier::name` can refer to from `caller`
+    ///
+    /// The qualifier's last segment is tried as a type, then, after applying
+    /// the caller's import aliases, as a module.
+    pub fn lookup(&self, qualifier: &str, name: &str, caller: Option<Scope>) -> &[E] {
+        let qualifier = hash_name(last_segment(qualifier));
+        let name = hash_name(name);
+        if let Some(members) = self.type_members.get(&(qualifier, name)) {
+            return members.preferred(caller);
+        }
+        let module = caller
+            .and_then(|caller| self.aliases.get(&(caller.file, qualifier)))
+            .copied()
+            .unwrap_or(qualifier);
+        self.module_symbols
+            .get(&(module, name))
+            .map_or(&[], |functions| functions.preferred(caller))
+    }
+}
@@ -0,0 +1,112 @@
+//! Filesystem change notifications for watch mode.
+//!
+//! Wraps the platform watcher (inotify, FSEvents, ReadDirectoryChangesW) and
+//! hands out coalesced batches, so an editor save or a `git checkout` that
+//! touches many files triggers one update instead of one per event.
+
+use anyhow::{Context, Result};
+use notify::{RecommendedWatcher, RecursiveMode, Watcher};
+use std::collections::BTreeSet;
+use std::path::{Path, PathBuf};
+use std::sync::mpsc::{self, Receiver, RecvTimeoutError, Sender};
+use std::time::{Duration, Instant};
+
+/// Quiet period that ends a burst of events
+pub const DEFAULT_DEBOUNCE: Duration = Duration::from_millis(100);
+
+/// Upper bound on how long one burst may keep extending itself
+const MAX_BATCH_DELAY: Duration = Duration::from_secs(2);
+
+/// What the platform watcher and the Ctrl-C listener send to [`ChangeWatcher`]
+enum WatchMessage {
+    Event(notify::Result<notify::Event>),
+    Stop,
+}
+
+/// Recursive watch on a directory tree.
+pub struct ChangeWatcher {
+    // Dropping the watcher ends the subscription
+    _watcher: RecommendedWatcher,
+    events: Receiver<WatchMessage>,
+    sender: Sender<WatchMessage>,
+}
+
+impl ChangeWatcher {
+    pub fn new(root: &Path) -> Result<Self> {
+        let (sender, events) = mpsc::channel();
+        let notify_sender = sender.clone();
+        let mut watcher = notify::recommended_watcher(move |event| {
+            let _ = notify_sender.send(WatchMessage::Event(event));
+        })
+        .context("failed to create file watcher")?;
+        watcher
+            .watch(root, RecursiveMode::Recursive)
+            .with_context(|| format!("failed to watch {}", root.display()))?;
+        Ok(Self {
+            _watcher: watcher,
+            events,
+            sender,
+        })
+    }
+
+    /// Makes Ctrl-C end [`Self::next_batch`] with `None` instead of killing
+    /// the process, so the caller can finish up before exiting.
+    pub fn stop_on_ctrl_c(&self) {
+        let sender = self.sender.clone();
+        std::thread::spawn(move || {
+            let ctrl_c = tokio::runtime::Builder::new_current_thread()
+                .enable_all()
+                .build()
+                .and_then(|runtime| runtime.block_on(tokio::signal::ctrl_c()));
+            match ctrl_c {
+                Ok(()) => {
+                    let _ = sender.send(WatchMessage::Stop);
+                }
+                Err(err) => eprintln!("Warning: Failed to listen for Ctrl-C: {err}"),
+            }
+        });
+    }
+
+    /// Blocks until files change, then returns every path touched until the
+    /// tree has been quiet for `debounce`.
+    ///
+    /// With an `idle` timeout, returns an empty batch when nothing changes for
+    /// that long. Returns `None` once the watcher has shut down or was stopped;
+    /// a batch still being collected when stopped is dropped.
+    pub fn next_batch(&self, debounce: Duration, idle: Option<Duration>) -> Option<Vec<PathBuf>> {
+        let mut paths = BTreeSet::new();
+        let first = match idle {
+            Some(idle) => match self.events.recv_timeout(idle) {
+                Ok(message) => message,
+                Err(RecvTimeoutError::Timeout) => return Some(Vec::new()),
+                Err(RecvTimeoutError::Disconnected) => return None,
+            },
+            None => self.events.recv().ok()?,
+        };
+        self.collect(first, &mut paths)?;
+
+        let started = Instant::now();
+        while started.elapsed() < MAX_BATCH_DELAY {
+            match self.events.recv_timeout(debounce) {
+                Ok(message) => self.collect(message, &mut paths)?,
+                Err(RecvTimeoutError::Timeout) => break,
+                Err(RecvTimeoutError::Disconnected) => break,
+            }
+        }
+        Some(paths.into_iter().collect())
+    }
+
+    /// Adds the paths an event touched; `None` on a stop request
+    fn collect(&self, message: WatchMessage, paths: &mut BTreeSet<PathBuf>) -> Option<()> {
+        let event = match message {
+            WatchMessage::Event(event) => event,
+            WatchMessage::Stop => return None,
+        };
+        match event {
+            Ok(event) if !event.kind.is_access() => paths.extend(event.paths),
+            Ok(_) => {}
+            Err(err) => eprintln!("Warning: File watcher error: {err}"),
+        }
+        Some(())
+    }
+}
@@ -0,0 +1,524 @@
+//! Binary graph snapshot.
+//!
+//! A versioned, section-based little-endian file that consumers can mmap and
+//! query in place instead of re-parsing JSON:
+//!
+//! ```text
+//! header   magic "EMBGRAPH", version: u32, section count: u32
+//! table    per section: kind: u32, reserved: u32, offset: u64, length: u64
+//! sections each 8-byte aligned
+//! ```
+//!
+//! Strings (names, ids, paths, signatures, ...) live once in a string table:
+//! `STRING_OFFSETS` holds `count + 1` u32 byte offsets into `STRING_DATA`.
+//! Nodes are stored as columns indexed by node position, with [`NO_STRING`]
+//! for absent optional strings. Adjacency is CSR per edge type: for edge type
+//! `t`, `EDGE_OFFSETS + t` holds `node_count + 1` u32 offsets into the parallel
+//! `EDGE_TARGETS + t`, `EDGE_CONTEXTS + t` and `EDGE_RANKS + t` arrays. The rank
+//! is the edge's position in the original graph, so a reload rebuilds it with
+//! the same edge order.
+
+use anyhow::{bail, Context, Result};
+use petgraph::graph::NodeIndex;
+use petgraph::visit::EdgeRef;
+use std::collections::HashMap;
+use std::io::Write;
+use std::ops::Range;
+use std::path::Path;
+
+use super::write_file;
+use crate::core::{
+    DependencyGraph, Edge, EdgeType, FilePath, Language, Node, NodeId, NodeType, Visibility,
+};
+use crate::parsers::source::SourceBuffer;
+
+pub const MAGIC: [u8; 8] = *b"EMBGRAPH";
+/// Bumped on any incompatible layout change
+pub const FORMAT_VERSION: u32 = 1;
+/// String id of an absent optional string
+pub const NO_STRING: u32 = u32::MAX;
+
+pub const STRING_OFFSETS: u32 = 0x01;
+pub const STRING_DATA: u32 = 0x02;
+/// String ids of file paths, indexed by file id
+pub const FILES: u32 = 0x03;
+/// u8 node type codes, in [`NODE_TYPES`] order
+pub const NODE_TYPE: u32 = 0x10;
+/// u32 file ids
+pub const NODE_FILE: u32 = 0x11;
+/// u32 line numbers
+pub const NODE_LINE: u32 = 0x12;
+/// u32 string ids of the remaining node fields
+pub const NODE_NAME: u32 = 0x13;
+pub const NODE_ID: u32 = 0x14;
+pub const NODE_LANGUAGE: u32 = 0x15;
+pub const NODE_SIGNATURE: u32 = 0x16;
+pub const NODE_VISIBILITY: u32 = 0x17;
+pub const NODE_DOCSTRING: u32 = 0x18;
+/// Adjacency sections; add the edge type code from [`EDGE_TYPES`]
+pub const EDGE_OFFSETS: u32 = 0x100;
+pub const EDGE_TARGETS: u32 = 0x200;
+pub const EDGE_CONTEXTS: u32 = 0x300;
+pub const EDGE_RANKS: u32 = 0x400;
+
+/// Node type codes are positions in this list
+pub const NODE_TYPES: [NodeType; 6] = [
+    NodeType::Module,
+    NodeType::Class,
+    NodeType::Function,
+    NodeType::Variable,
+    NodeType::Interface,
+    NodeType::Enum,
+];
+
+/// Edge type codes are positions in this list
+pub const EDGE_TYPES: [EdgeType; 6] = [
+    EdgeType::Import,
+    EdgeType::Call,
+    EdgeType::Inheritance,
+    EdgeType::Implements,
+    EdgeType::Uses,
+    EdgeType::Contains,
+];
+
+const HEADER_LEN: usize = 16;
+const TABLE_ENTRY_LEN: usize = 24;
+
+/// Writes [`GraphSnapshot`] files.
+pub struct BinaryFormatter;
+
+impl BinaryFormatter {
+    pub fn new() -> Self {
+        Self
+    }
+
+    pub fn format_to_file(&self, graph: &DependencyGraph, output_path: &Path) -> Result<()> {
+        write_file(output_path, |out| self.write_to(graph, out))?;
+        Ok(())
+    }
+
+    pub fn write_to<W: Write>(&self, graph: &DependencyGraph, out: &mut W) -> Result<()> {
+        let node_count = graph.node_count();
+        let mut strings = StringTable::default();
+        let mut files: Vec<u32> = Vec::new();
+        let mut file_ids: HashMap<FilePath, u32> = HashMap::new();
+
+        let mut node_type = Vec::with_capacity(node_count);
+        let mut node_file = Vec::with_capacity(node_count);
+        let mut node_line = Vec::with_capacity(node_count);
+        let mut node_name = Vec::with_capacity(node_count);
+        let mut node_id = Vec::with_capacity(node_count);
+        let mut node_language = Vec::with_capacity(node_count);
+        let mut node_signature = Vec::with_capacity(node_count);
+        let mut node_visibility = Vec::with_capacity(node_count);
+        let mut node_docstring = Vec::with_capacity(node_count);
+        for node in graph.node_weights() {
+            let file_id = *file_ids.entry(node.file_path).or_insert_with(|| {
+                files.push(strings.intern(&node.file_path.to_string_lossy()));
+                files.len() as u32 - 1
+            });
+            node_type.push(type_code(node.node_type));
+            node_file.push(file_id);
+            node_line.push(node.line_number as u32);
+            node_name.push(strings.intern(&node.name));
+            node_id.push(strings.intern(node.id.as_str()));
+            node_language.push(strings.intern(node.language.as_str()));
+            node_signature.push(strings.intern_optional(node.signature.as_deref()));
+            node_visibility.push(strings.intern_optional(node.visibility.as_deref()));
+            node_docstring.push(strings.intern_optional(node.docstring.as_deref()));
+        }
+
+        let mut sections = vec![
+            (FILES, Column::U32(files)),
+            (NODE_TYPE, Column::Bytes(node_type)),
+            (NODE_FILE, Column::U32(node_file)),
+            (NODE_LINE, Column::U32(node_line)),
+            (NODE_NAME, Column::U32(node_name)),
+            (NODE_ID, Column::U32(node_id)),
+            (NODE_LANGUAGE, Column::U32(node_language)),
+            (NODE_SIGNATURE, Column::U32(node_signature)),
+            (NODE_VISIBILITY, Column::U32(node_visibility)),
+            (NODE_DOCSTRING, Column::U32(node_docstring)),
+        ];
+
+        for (code, &edge_type) in EDGE_TYPES.iter().enumerate() {
+            let code = code as u32;
+            let mut offsets = vec![0u32; node_count + 1];
+            for edge_ref in graph.edge_references() {
+                if edge_ref.weight().edge_type == edge_type {
+                    offsets[edge_ref.source().index() + 1] += 1;
+                }
+            }
+            for index in 1..offsets.len() {
+                offsets[index] += offsets[index - 1];
+            }
+
+            let edge_count = offsets[node_count] as usize;
+            let mut targets = vec![0u32; edge_count];
+            let mut contexts = vec![NO_STRING; edge_count];
+            let mut ranks = vec![0u32; edge_count];
+            let mut next = offsets.clone();
+            for edge_ref in graph.edge_references() {
+                let edge = edge_ref.weight();
+                if edge.edge_type != edge_type {
+                    continue;
+                }
+                let slot = &mut next[edge_ref.source().index()];
+                let position = *slot as usize;
+                *slot += 1;
+                targets[position] = edge_ref.target().index() as u32;
+                contexts[position] = strings.intern_optional(edge.context.as_deref());
+                ranks[position] = edge_ref.id().index() as u32;
+            }
+
+            sections.push((EDGE_OFFSETS + code, Column::U32(offsets)));
+            sections.push((EDGE_TARGETS + code, Column::U32(targets)));
+            sections.push((EDGE_CONTEXTS + code, Column::U32(contexts)));
+            sections.push((EDGE_RANKS + code, Column::U32(ranks)));
+        }
+
+        let (string_offsets, string_data) = strings.finish()?;
+        sections.insert(0, (STRING_DATA, Column::Bytes(string_data)));
+        sections.insert(0, (STRING_OFFSETS, Column::U32(string_offsets)));
+
+        // Header and section table, then each section at its aligned offset
+        out.write_all(&MAGIC)?;
+        out.write_all(&FORMAT_VERSION.to_le_bytes())?;
+        out.write_all(&(sections.len() as u32).to_le_bytes())?;
+        let mut offset = align(HEADER_LEN + sections.len() * TABLE_ENTRY_LEN);
+        for (kind, column) in &sections {
+            out.write_all(&kind.to_le_bytes())?;
+            out.write_all(&0u32.to_le_bytes())?;
+            out.write_all(&(offset as u64).to_le_bytes())?;
+            out.write_all(&(column.byte_len() as u64).to_le_bytes())?;
+            offset = align(offset + column.byte_len());
+        }
+
+        let mut written = HEADER_LEN + sections.len() * TABLE_ENTRY_LEN;
+        for (_, column) in &sections {
+            out.write_all(&[0u8; 8][..align(written) - written])?;
+            written = align(written);
+            column.write_to(out)?;
+            written += column.byte_len();
+        }
+        Ok(())
+    }
+}
+
+impl Default for BinaryFormatter {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+#[derive(Default)]
+struct StringTable {
+    ids: HashMap<String, u32>,
+    offsets: Vec<u32>,
+    data: Vec<u8>,
+}
+
+impl StringTable {
+    fn intern(&mut self, text: &str) -> u32 {
+        if let Some(&id) = self.ids.get(text) {
+            return id;
+        }
+        let id = self.offsets.len() as u32;
+        self.offsets.push(self.data.len() as u32);
+        self.data.extend_from_slice(text.as_bytes());
+        self.ids.insert(text.to_string(), id);
+        id
+    }
+
+    fn intern_optional(&mut self, text: Option<&str>) -> u32 {
+        text.map_or(NO_STRING, |text| self.intern(text))
+    }
+
+    fn finish(mut self) -> Result<(Vec<u32>, Vec<u8>)> {
+        if self.data.len() > u32::MAX as usize {
+            bail!("String table exceeds 4 GiB");
+        }
+        self.offsets.push(self.data.len() as u32);
+        Ok((self.offsets, self.data))
+    }
+}
+
+enum Column {
+    U32(Vec<u32>),
+    Bytes(Vec<u8>),
+}
+
+impl Column {
+    fn byte_len(&self) -> usize {
+        match self {
+            Column::U32(values) => values.len() * 4,
+            Column::Bytes(bytes) => bytes.len(),
+        }
+    }
+
+    fn write_to<W: Write>(&self, out: &mut W) -> std::io::Result<()> {
+        match self {
+            Column::U32(values) => values
+                .iter()
+                .try_for_each(|value| out.write_all(&value.to_le_bytes())),
+            Column::Bytes(bytes) => out.write_all(bytes),
+        }
+    }
+}
+
+fn align(offset: usize) -> usize {
+    (offset + 7) & !7
+}
+
+fn type_code(node_type: NodeType) -> u8 {
+    NODE_TYPES
+        .iter()
+        .position(|&candidate| candidate == node_type)
+        .unwrap_or_default() as u8
+}
+
+/// Read-only view of a snapshot written by [`BinaryFormatter`].
+///
+/// Large files are memory-mapped; every accessor reads the columns in place.
+pub struct GraphSnapshot {
+    data: SourceBuffer,
+    sections: HashMap<u32, Range<usize>>,
+    node_count: usize,
+}
+
+impl GraphSnapshot {
+    pub fn open(path: &Path) -> Result<Self> {
+        let data = SourceBuffer::load(path)
+            .with_context(|| format!("failed to read snapshot {}", path.display()))?;
+        Self::from_buffer(data).with_context(|| format!("invalid snapshot {}", path.display()))
+    }
+
+    #[allow(dead_code)]
+    pub fn from_bytes(bytes: Vec<u8>) -> Result<Self> {
+        Self::from_buffer(SourceBuffer::Heap(bytes))
+    }
+
+    fn from_buffer(data: SourceBuffer) -> Result<Self> {
+        let bytes = data.as_bytes();
+        if bytes.len() < HEADER_LEN || bytes[..8] != MAGIC {
+            bail!("not an embargo graph snapshot");
+        }
+        let version = read_u32(bytes, 8);
+        if version != FORMAT_VERSION {
+            bail!("unsupported snapshot version {version} (expected {FORMAT_VERSION})");
+        }
+
+        let section_count = read_u32(bytes, 12) as usize;
+        let table_end = HEADER_LEN + section_count * TABLE_ENTRY_LEN;
+        if bytes.len() < table_end {
+            bail!("truncated section table");
+        }
+        let mut sections = HashMap::with_capacity(section_count);
+        for entry in 0..section_count {
+            let at = HEADER_LEN + entry * TABLE_ENTRY_LEN;
+            let kind = read_u32(bytes, at);
+            let offset = read_u64(bytes, at + 8) as usize;
+            let len = read_u64(bytes, at + 16) as usize;
+            match offset.checked_add(len) {
+                Some(end) if end <= bytes.len() => {
+                    sections.insert(kind, offset..end);
+                }
+                _ => bail!("section {kind:#x} lies outside the file"),
+            }
+        }
+
+        let node_count = sections.get(&NODE_TYPE).map_or(0, |range| range.len());
+        let snapshot = Self {
+            data,
+            sections,
+            node_count,
+        };
+        snapshot.check_layout()?;
+        Ok(snapshot)
+    }
+
+    /// Checks that every column has the length the node and edge counts imply
+    fn check_layout(&self) -> Result<()> {
+        let node_count = self.node_count;
+        let expect = |kind: u32, len: usize| -> Result<()> {
+            match self.sections.get(&kind) {
+                Some(range) if range.len() == len => Ok(()),
+                Some(_) => bail!("section {kind:#x} has the wrong length"),
+                None => bail!("missing section {kind:#x}"),
+            }
+        };
+
+        let strings = self.section(STRING_OFFSETS).len() / 4;
+        if strings == 0
+            || self.u32_at(STRING_OFFSETS, strings - 1) as usize != self.section(STRING_DATA).len()
+        {
+            bail!("string table does not cover its data");
+        }
+        for kind in [
+            NODE_FILE,
+            NODE_LINE,
+            NODE_NAME,
+            NODE_ID,
+            NODE_LANGUAGE,
+            NODE_SIGNATURE,
+            NODE_VISIBILITY,
+            NODE_DOCSTRING,
+        ] {
+            expect(kind, node_count * 4)?;
+        }
+        let files = self.section(FILES).len();
+        expect(FILES, files - files % 4)?;
+        for code in 0..EDGE_TYPES.len() as u32 {
+            expect(EDGE_OFFSETS + code, (node_count + 1) * 4)?;
+            let edges = self.u32_at(EDGE_OFFSETS + code, node_count) as usize;
+            expect(EDGE_TARGETS + code, edges * 4)?;
+            expect(EDGE_CONTEXTS + code, edges * 4)?;
+            expect(EDGE_RANKS + code, edges * 4)?;
+        }
+        Ok(())
+    }
+
+    #[allow(dead_code)]
+    pub fn node_count(&self) -> usize {
+        self.node_count
+    }
+
+    pub fn edge_count(&self) -> usize {
+        (0..EDGE_TYPES.len() as u32)
+            .map(|code| self.u32_at(EDGE_OFFSETS + code, self.node_count) as usize)
+            .sum()
+    }
+
+    pub fn node_type(&self, node: usize) -> Option<NodeType> {
+        let code = *self.section(NODE_TYPE).get(node)?;
+        NODE_TYPES.get(code as usize).copied()
+    }
+
+    pub fn node_name(&self, node: usize) -> &str {
+        self.string(self.u32_at(NODE_NAME, node)).unwrap_or("")
+    }
+
+    pub fn node_id(&self, node: usize) -> &str {
+        self.string(self.u32_at(NODE_ID, node)).unwrap_or("")
+    }
+
+    pub fn node_file(&self, node: usize) -> &str {
+        let file = self.u32_at(NODE_FILE, node) as usize;
+        self.string(self.u32_at(FILES, file)).unwrap_or("")
+    }
+
+    pub fn node_line(&self, node: usize) -> usize {
+        self.u32_at(NODE_LINE, node) as usize
+    }
+
+    #[allow(dead_code)]
+    /// Targets of `node`'s outgoing edges of `edge_type`
+    pub fn targets(&self, node: usize, edge_type: EdgeType) -> impl Iterator<Item = usize> + '_ {
+        let code = edge_code(edge_type);
+        self.edge_slots(node, code)
+            .map(move |slot| self.u32_at(EDGE_TARGETS + code, slot) as usize)
+    }
+
+    /// Range of `node`'s entries in the CSR arrays of edge type `code`
+    fn edge_slots(&self, node: usize, code: u32) -> Range<usize> {
+        if node >= self.node_count {
+            return 0..0;
+        }
+        let start = self.u32_at(EDGE_OFFSETS + code, node) as usize;
+        let end = self.u32_at(EDGE_OFFSETS + code, node + 1) as usize;
+        start..end.max(start)
+    }
+
+    /// Rebuilds the full graph, with nodes and edges in their original order
+    pub fn to_graph(&self) -> Result<DependencyGraph> {
+        let mut graph = DependencyGraph::with_capacity(self.node_count, self.edge_count());
+        for node in 0..self.node_count {
+            let node_type = self
+                .node_type(node)
+                .with_context(|| format!("node {node} has an unknown type"))?;
+            let mut weight = Node::new(
+                NodeId::intern(self.node_id(node)),
+                self.node_name(node).to_string(),
+                node_type,
+                self.node_file(node),
+                self.node_line(node),
+                Language::from_name(self.optional(NODE_LANGUAGE, node).unwrap_or("")),
+            );
+            weight.signature = self.optional(NODE_SIGNATURE, node).map(str::to_string);
+            weight.visibility = self.optional(NODE_VISIBILITY, node).map(Visibility::from);
+            weight.docstring = self.optional(NODE_DOCSTRING, node).map(str::to_string);
+            graph.add_node(weight);
+        }
+
+        let mut edges: Vec<(u32, usize, usize, EdgeType, u32)> =
+            Vec::with_capacity(self.edge_count());
+        for (code, &edge_type) in EDGE_TYPES.iter().enumerate() {
+            let code = code as u32;
+            for source in 0..self.node_count {
+                for slot in self.edge_slots(source, code) {
+                    let target = self.u32_at(EDGE_TARGETS + code, slot) as usize;
+                    if target >= self.node_count {
+                        bail!("edge target {target} out of range");
+                    }
+                    let context = self.u32_at(EDGE_CONTEXTS + code, slot);
+                    let rank = self.u32_at(EDGE_RANKS + code, slot);
+                    edges.push((rank, source, target, edge_type, context));
+                }
+            }
+        }
+        edges.sort_unstable_by_key(|&(rank, ..)| rank);
+        for (_, source, target, edge_type, context) in edges {
+            let (source, target) = (NodeIndex::new(source), NodeIndex::new(target));
+            let mut edge = Edge::new(edge_type, graph[source].id, graph[target].id);
+            edge.context = self.string(context).map(str::to_string);
+            graph.add_edge(source, target, edge);
+        }
+        Ok(graph)
+    }
+
+    fn section(&self, kind: u32) -> &[u8] {
+        match self.sections.get(&kind) {
+            Some(range) => &self.data.as_bytes()[range.clone()],
+            None => &[],
+        }
+    }
+
+    /// Entry `index` of a u32 column; 0 past its end
+    fn u32_at(&self, kind: u32, index: usize) -> u32 {
+        let section = self.section(kind);
+        match section.get(index * 4..index * 4 + 4) {
+            Some(bytes) => u32::from_le_bytes(bytes.try_into().unwrap()),
+            None => 0,
+        }
+    }
+
+    fn optional(&self, kind: u32, node: usize) -> Option<&str> {
+        self.string(self.u32_at(kind, node))
+    }
+
+    fn string(&self, id: u32) -> Option<&str> {
+        if id == NO_STRING {
+            return None;
+        }
+        let start = self.u32_at(STRING_OFFSETS, id as usize) as usize;
+        let end = self.u32_at(STRING_OFFSETS, id as usize + 1) as usize;
+        let bytes = self.section(STRING_DATA).get(start..end)?;
+        std::str::from_utf8(bytes).ok()
+    }
+}
+
+#[allow(dead_code)]
+fn edge_code(edge_type: EdgeType) -> u32 {
+    EDGE_TYPES
+        .iter()
+        .position(|&candidate| candidate == edge_type)
+        .unwrap_or_default() as u32
+}
+
+fn read_u32(bytes: &[u8], at: usize) -> u32 {
+    u32::from_le_bytes(bytes[at..at + 4].try_into().unwrap())
+}
+
+fn read_u64(bytes: &[u8], at: usize) -> u64 {
+    u64::from_le_bytes(bytes[at..at + 8].try_into().unwrap())
+}
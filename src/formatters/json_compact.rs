@@ -1,12 +1,14 @@
 use anyhow::Result;
-use petgraph::graph::NodeIndex;
 use petgraph::visit::EdgeRef;
-use serde_json::json;
+use serde::ser::{SerializeMap, Serializer};
+use serde::Serialize;
+use std::borrow::Cow;
 use std::collections::HashMap;
-use std::fs;
+use std::io::Write;
 use std::path::Path;
 
-use crate::core::{DependencyGraph, EdgeType, NodeType};
+use super::write_file;
+use crate::core::{DependencyGraph, EdgeType, FilePath, NodeId, NodeType};
 
 /// JSON formatter optimized for LLM consumption with minimal tokens
 pub struct JsonCompactFormatter {
@@ -20,113 +22,30 @@ impl JsonCompactFormatter {
     }
 
     pub fn format_to_file(&self, graph: &DependencyGraph, output_path: &Path) -> Result<()> {
-        let json_content = self.format_graph(graph)?;
-        fs::write(output_path, json_content)?;
+        write_file(output_path, |out| self.write_to(graph, out))?;
         Ok(())
     }
 
-    fn format_graph(&self, graph: &DependencyGraph) -> Result<String> {
-        let node_indices: Vec<NodeIndex> = graph.node_indices().collect();
-
-        // Build compressed node mappings
-        let mut nodes = Vec::new();
-        let mut node_id_map = HashMap::new();
-        let mut file_map = HashMap::new();
-        let mut file_id = 0u16;
-
-        // First pass: build file mapping
-        for &idx in &node_indices {
-            if let Some(node) = graph.node_weight(idx) {
-                let path_str = node.file_path.to_string_lossy();
-                if !file_map.contains_key(path_str.as_ref()) {
-                    file_map.insert(path_str.to_string(), file_id);
-                    file_id += 1;
-                }
-            }
-        }
-
-        // Second pass: build nodes
-        for (node_idx, &idx) in node_indices.iter().enumerate() {
-            if let Some(node) = graph.node_weight(idx) {
-                node_id_map.insert(idx, node_idx);
-
-                let file_id = file_map[&node.file_path.to_string_lossy().to_string()];
-
-                let node_json = if self.minimal {
-                    json!({
-                        "n": node.name,
-                        "t": self.type_code(node.node_type),
-                        "f": file_id,
-                        "l": node.line_number
-                    })
-                } else {
-                    let mut node_obj = json!({
-                        "id": node.id,
-                        "name": node.name,
-                        "type": self.type_code(node.node_type),
-                        "file": file_id,
-                        "line": node.line_number,
-                        "lang": node.language
-                    });
-
-                    if let Some(ref sig) = node.signature {
-                        node_obj["sig"] = json!(sig);
-                    }
-                    if let Some(ref vis) = node.visibility {
-                        node_obj["vis"] = json!(vis);
-                    }
-
-                    node_obj
-                };
-
-                nodes.push(node_json);
-            }
+    /// Serializes the graph into `out` straight from its node and edge iterators
+    pub fn write_to<W: Write>(&self, graph: &DependencyGraph, out: &mut W) -> Result<()> {
+        // Files are numbered in node order, as the first node from each is met
+        let mut files: Vec<Cow<str>> = Vec::new();
+        let mut file_ids: HashMap<FilePath, u32> = HashMap::new();
+        for node in graph.node_weights() {
+            file_ids.entry(node.file_path).or_insert_with(|| {
+                files.push(node.file_path.to_string_lossy());
+                files.len() as u32 - 1
+            });
         }
 
-        // Build edges efficiently
-        let mut edges = Vec::new();
-        for edge_ref in graph.edge_references() {
-            let source_idx = edge_ref.source();
-            let target_idx = edge_ref.target();
-
-            if let (Some(&src_id), Some(&tgt_id)) =
-                (node_id_map.get(&source_idx), node_id_map.get(&target_idx))
-            {
-                let edge_json = if self.minimal {
-                    json!([src_id, tgt_id, self.edge_code(edge_ref.weight().edge_type)])
-                } else {
-                    json!({
-                        "src": src_id,
-                        "tgt": tgt_id,
-                        "type": self.edge_code(edge_ref.weight().edge_type),
-                        "ctx": edge_ref.weight().context
-                    })
-                };
-                edges.push(edge_json);
-            }
-        }
-
-        // Build file mapping for output
-        let files: Vec<String> = {
-            let mut file_vec = vec![String::new(); file_map.len()];
-            for (path, id) in file_map {
-                file_vec[id as usize] = path;
-            }
-            file_vec
+        let document = Document {
+            formatter: self,
+            graph,
+            files: &files,
+            file_ids: &file_ids,
         };
-
-        let output = json!({
-            "meta": {
-                "nodes": graph.node_count(),
-                "edges": graph.edge_count(),
-                "format": if self.minimal { "compact" } else { "full" }
-            },
-            "files": files,
-            "nodes": nodes,
-            "edges": edges
-        });
-
-        Ok(serde_json::to_string(&output)?)
+        serde_json::to_writer(out, &document)?;
+        Ok(())
     }
 
     fn type_code(&self, node_type: NodeType) -> u8 {
@@ -157,3 +76,136 @@ impl Default for JsonCompactFormatter {
         Self::new()
     }
 }
+
+/// The whole document; entries are emitted in sorted key order, matching the
+/// layout of the `serde_json::Value` tree this formatter used to build.
+struct Document<'a> {
+    formatter: &'a JsonCompactFormatter,
+    graph: &'a DependencyGraph,
+    files: &'a [Cow<'a, str>],
+    file_ids: &'a HashMap<FilePath, u32>,
+}
+
+#[derive(Serialize)]
+struct Meta {
+    edges: usize,
+    format: &'static str,
+    nodes: usize,
+}
+
+struct NodeList<'a>(&'a Document<'a>);
+
+struct EdgeList<'a>(&'a Document<'a>);
+
+#[derive(Serialize)]
+#[serde(untagged)]
+enum NodeRecord<'a> {
+    Compact {
+        f: u32,
+        l: usize,
+        n: &'a str,
+        t: u8,
+    },
+    Full {
+        file: u32,
+        id: NodeId,
+        lang: &'a str,
+        line: usize,
+        name: &'a str,
+        #[serde(skip_serializing_if = "Option::is_none")]
+        sig: Option<&'a str>,
+        #[serde(rename = "type")]
+        node_type: u8,
+        #[serde(skip_serializing_if = "Option::is_none")]
+        vis: Option<&'a str>,
+    },
+}
+
+#[derive(Serialize)]
+#[serde(untagged)]
+enum EdgeRecord<'a> {
+    Compact(usize, usize, u8),
+    Full {
+        ctx: Option<&'a str>,
+        src: usize,
+        tgt: usize,
+        #[serde(rename = "type")]
+        edge_type: u8,
+    },
+}
+
+impl Serialize for Document<'_> {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        let minimal = self.formatter.minimal;
+        let mut map = serializer.serialize_map(Some(4))?;
+        map.serialize_entry("edges", &EdgeList(self))?;
+        map.serialize_entry("files", self.files)?;
+        map.serialize_entry(
+            "meta",
+            &Meta {
+                edges: self.graph.edge_count(),
+                format: if minimal { "compact" } else { "full" },
+                nodes: self.graph.node_count(),
+            },
+        )?;
+        map.serialize_entry("nodes", &NodeList(self))?;
+        map.end()
+    }
+}
+
+impl Serialize for NodeList<'_> {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        let Document {
+            formatter,
+            graph,
+            file_ids,
+            ..
+        } = self.0;
+        serializer.collect_seq(graph.node_weights().map(|node| {
+            let file = file_ids[&node.file_path];
+            if formatter.minimal {
+                NodeRecord::Compact {
+                    f: file,
+                    l: node.line_number,
+                    n: &node.name,
+                    t: formatter.type_code(node.node_type),
+                }
+            } else {
+                NodeRecord::Full {
+                    file,
+                    id: node.id,
+                    lang: node.language.as_str(),
+                    line: node.line_number,
+                    name: &node.name,
+                    sig: node.signature.as_deref(),
+                    node_type: formatter.type_code(node.node_type),
+                    vis: node.visibility.as_deref(),
+                }
+            }
+        }))
+    }
+}
+
+impl Serialize for EdgeList<'_> {
+    fn serialize<S: Serializer>(&self, serializer: S) -> Result<S::Ok, S::Error> {
+        let Document {
+            formatter, graph, ..
+        } = self.0;
+        // Node positions in the output are their graph indices
+        serializer.collect_seq(graph.edge_references().map(|edge_ref| {
+            let src = edge_ref.source().index();
+            let tgt = edge_ref.target().index();
+            let edge = edge_ref.weight();
+            if formatter.minimal {
+                EdgeRecord::Compact(src, tgt, formatter.edge_code(edge.edge_type))
+            } else {
+                EdgeRecord::Full {
+                    ctx: edge.context.as_deref(),
+                    src,
+                    tgt,
+                    edge_type: formatter.edge_code(edge.edge_type),
+                }
+            }
+        }))
+    }
+}
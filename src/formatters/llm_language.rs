@@ -3,7 +3,9 @@ use petgraph::graph::NodeIndex;
 use petgraph::visit::EdgeRef;
 
 /// Language-specific hooks to tune the LLM-optimized formatter
-pub trait LlmLanguageAdapter {
+///
+/// Sections are rendered on the rayon pool, so adapters must be shareable.
+pub trait LlmLanguageAdapter: Send + Sync {
     /// Adapter name (e.g., "default", "python")
     #[allow(dead_code)]
     fn name(&self) -> &'static str {
@@ -14,16 +14,25 @@
 //! - `function()[ENTRY]` - Public API entry point
 //! - `function()[HOT]` - Performance-critical function
 //! - `function()->{calls}` - Immediate function calls
+//!
+//! ## Token Budget
+//!
+//! With [`LLMOptimizedFormatter::with_max_tokens`] only the highest-ranked
+//! files that fit the budget are rendered, followed by an **OMITTED** count of
+//! the rest.
 
 use anyhow::Result;
 use petgraph::graph::NodeIndex;
 use petgraph::visit::EdgeRef;
-use std::collections::{BTreeMap, HashMap};
-use std::fs;
+use rayon::prelude::*;
+use std::collections::{BTreeMap, HashMap, HashSet};
+use std::io::{self, Write};
 use std::path::Path;
 
 use super::llm_language::{DefaultLanguageAdapter, LlmLanguageAdapter};
-use crate::core::{DependencyGraph, Edge, Node, NodeType};
+use super::token_budget::{estimate_tokens, TokenBudget};
+use super::write_file;
+use crate::core::{DependencyGraph, EdgeType, GraphIndex, Node, NodeType, Visibility};
 
 /// Output verbosity level for LLM-optimized format.
 #[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
@@ -53,6 +62,8 @@ pub struct LLMOptimizedFormatter {
     language_adapter: Box<dyn LlmLanguageAdapter>,
     /// Output verbosity level
     verbosity: OutputVerbosity,
+    /// Upper bound on the estimated tokens of the document
+    max_tokens: Option<usize>,
 }
 
 impl LLMOptimizedFormatter {
@@ -66,6 +77,7 @@ impl LLMOptimizedFormatter {
             use_advanced_dag: true,
             language_adapter: Box::new(DefaultLanguageAdapter::new()),
             verbosity: OutputVerbosity::default(),
+            max_tokens: None,
         }
     }
 
@@ -75,6 +87,12 @@ impl LLMOptimizedFormatter {
         self
     }
 
+    /// Bounds the document to about `max_tokens` tokens; `None` renders the whole graph.
+    pub fn with_max_tokens(mut self, max_tokens: Option<usize>) -> Self {
+        self.max_tokens = max_tokens;
+        self
+    }
+
     #[allow(dead_code)]
     pub fn with_metadata(mut self, include: bool) -> Self {
         self.include_metadata = include;
@@ -116,12 +134,21 @@ impl LLMOptimizedFormatter {
     }
 
     pub fn format_to_file(&self, graph: &DependencyGraph, output_path: &Path) -> Result<()> {
-        let formatted_content = self.format_graph(graph)?;
-        fs::write(output_path, formatted_content)?;
+        write_file(output_path, |out| self.write_to(graph, out))?;
         Ok(())
     }
 
-    fn format_graph(&self, graph: &DependencyGraph) -> Result<String> {
+    /// Streams the document into `out`.
+    ///
+    /// Clusters, file groups and type sections are independent: they are
+    /// rendered in parallel into their own buffers and written in document
+    /// order, a batch at a time, so the output is identical to a sequential
+    /// render and memory tracks one batch rather than the whole document.
+    pub fn write_to<W: Write>(&self, graph: &DependencyGraph, out: &mut W) -> Result<()> {
+        let out: &mut dyn Write = out;
+        if let Some(max_tokens) = self.max_tokens {
+            return self.write_budgeted(graph, out, max_tokens);
+        }
         let mut output = String::with_capacity(8192);
 
         // Interpretation key only for Standard and Verbose modes
@@ -136,8 +163,10 @@ impl LLMOptimizedFormatter {
             graph.node_count(),
             graph.edge_count()
         ));
+        flush_section(out, &mut output)?;
 
         // Build node collections efficiently
+        let index = GraphIndex::new(graph);
         let node_indices: Vec<NodeIndex> = graph.node_indices().collect();
         let mut by_type: HashMap<NodeType, Vec<(NodeIndex, &Node)>> = HashMap::new();
 
@@ -148,7 +177,7 @@ impl LLMOptimizedFormatter {
         }
 
         // Generate advanced data structures for optimization
-        let directory_tree = self.build_directory_tree(&by_type);
+        let directory_tree = self.build_directory_tree(&index);
         let semantic_clusters = if self.use_semantic_clustering {
             self.build_semantic_clusters(&by_type)
         } else {
@@ -157,11 +186,24 @@ impl LLMOptimizedFormatter {
         let file_map = self.build_enhanced_file_map(&directory_tree);
 
         if self.use_semantic_clustering && !semantic_clusters.is_empty() {
-            self.format_with_clusters(&mut output, &semantic_clusters, &directory_tree, graph)?;
+            self.format_with_clusters(
+                &mut output,
+                out,
+                &semantic_clusters,
+                &directory_tree,
+                &index,
+            )?;
         } else if self.use_hierarchical {
-            self.format_hierarchical(&mut output, &by_type, &file_map, graph)?;
+            self.format_hierarchical(
+                &mut output,
+                out,
+                &by_type,
+                &directory_tree,
+                &file_map,
+                &index,
+            )?;
         } else {
-            self.format_flat(&mut output, &by_type, &file_map, graph)?;
+            self.format_flat(&mut output, out, &by_type, &file_map, &index)?;
         }
 
         // Dependency patterns only for Verbose mode
@@ -170,22 +212,24 @@ impl LLMOptimizedFormatter {
                 output.push('\n');
                 self.format_advanced_dependencies(&mut output, graph, &semantic_clusters);
             } else {
-                self.format_dependency_summary(&mut output, graph);
+                self.format_dependency_summary(&mut output, &index);
             }
         }
+        flush_section(out, &mut output)?;
 
-        Ok(output)
+        Ok(())
     }
 
     fn format_hierarchical(
         &self,
         output: &mut String,
+        out: &mut dyn Write,
         by_type: &HashMap<NodeType, Vec<(NodeIndex, &Node)>>,
+        directory_tree: &DirectoryTree,
         file_map: &HashMap<String, String>,
-        graph: &DependencyGraph,
+        index: &GraphIndex,
     ) -> Result<()> {
         // Directory tree header
-        let directory_tree = self.build_directory_tree(by_type);
         output.push_str("## DIRECTORY_TREE\n");
         output.push_str(&format!("ROOT: {}\n", directory_tree.common_prefix));
         output.push_str(&directory_tree.format_tree());
@@ -200,6 +244,7 @@ impl LLMOptimizedFormatter {
             }
             output.push('\n');
         }
+        flush_section(out, output)?;
 
         // Process types in dependency order: modules -> classes -> interfaces -> functions -> variables
         let type_order = [
@@ -213,7 +258,7 @@ impl LLMOptimizedFormatter {
 
         for node_type in type_order {
             if let Some(nodes) = by_type.get(&node_type) {
-                self.format_type_section(output, node_type, nodes, file_map, graph);
+                self.format_type_section(output, out, node_type, nodes, file_map, index)?;
             }
         }
 
@@ -223,19 +268,21 @@ impl LLMOptimizedFormatter {
     fn format_type_section(
         &self,
         output: &mut String,
+        out: &mut dyn Write,
         node_type: NodeType,
         nodes: &[(NodeIndex, &Node)],
         file_map: &HashMap<String, String>,
-        graph: &DependencyGraph,
-    ) {
+        index: &GraphIndex,
+    ) -> io::Result<()> {
         if nodes.is_empty() {
-            return;
+            return Ok(());
         }
 
         // Compact section header
         output.push_str(&format!("## {}\n", self.type_symbol(node_type)));
 
         if self.use_hierarchical {
+            flush_section(out, output)?;
             // Group by file for better structure
             let mut by_file: HashMap<String, Vec<(NodeIndex, &Node)>> = HashMap::new();
             for &(idx, node) in nodes {
@@ -251,29 +298,31 @@ impl LLMOptimizedFormatter {
             }
 
             // deterministic order by file key
-            let mut __keys: Vec<String> = by_file.keys().cloned().collect();
-            __keys.sort();
-            for file_key in __keys {
-                output.push_str(&format!("### {}\n", file_key));
-                let mut file_nodes = by_file.get(&file_key).cloned().unwrap_or_default();
+            let mut file_keys: Vec<&String> = by_file.keys().collect();
+            file_keys.sort();
+            write_sections(out, &file_keys, |file_key| {
+                let mut section = format!("### {}\n", file_key);
+                let mut file_nodes = by_file[*file_key].clone();
                 // sort by line then name
-                file_nodes.sort_by(|(ia, na), (ib, nb)| {
-                    let la = graph.node_weight(*ia).map(|n| n.line_number).unwrap_or(0);
-                    let lb = graph.node_weight(*ib).map(|n| n.line_number).unwrap_or(0);
-                    la.cmp(&lb).then_with(|| na.name.cmp(&nb.name))
+                file_nodes.sort_by(|(_, na), (_, nb)| {
+                    na.line_number
+                        .cmp(&nb.line_number)
+                        .then_with(|| na.name.cmp(&nb.name))
                 });
                 for (idx, node) in file_nodes {
-                    self.format_node_compact(output, node, idx, graph);
+                    self.format_node_compact(&mut section, node, idx, index);
                 }
-                output.push('\n');
-            }
+                section.push('\n');
+                section
+            })?;
         } else {
             // Flat format
             for &(idx, node) in nodes {
-                self.format_node_compact(output, node, idx, graph);
+                self.format_node_compact(output, node, idx, index);
             }
             output.push('\n');
         }
+        flush_section(out, output)
     }
 
     fn format_node_compact(
@@ -281,7 +330,7 @@ impl LLMOptimizedFormatter {
         output: &mut String,
         node: &Node,
         idx: NodeIndex,
-        graph: &DependencyGraph,
+        index: &GraphIndex,
     ) {
         // Ultra-compact format: signature [relationships]
         if self.include_metadata {
@@ -301,11 +350,11 @@ impl LLMOptimizedFormatter {
         }
 
         // Compact relationships
-        let outgoing = self.get_outgoing_edges(idx, graph);
-        if !outgoing.is_empty() {
+        let outgoing = index.out_degree(idx);
+        if outgoing > 0 {
             output.push_str(" →");
             let mut first = true;
-            for (_edge, target) in outgoing.iter().take(5) {
+            for (_edge, target) in index.outgoing(idx).take(5) {
                 // Limit to reduce tokens
                 if !first {
                     output.push(',');
@@ -313,8 +362,8 @@ impl LLMOptimizedFormatter {
                 output.push_str(&format!("{}", target.name));
                 first = false;
             }
-            if outgoing.len() > 5 {
-                output.push_str(&format!("+{}", outgoing.len() - 5));
+            if outgoing > 5 {
+                output.push_str(&format!("+{}", outgoing - 5));
             }
         }
 
@@ -324,9 +373,10 @@ impl LLMOptimizedFormatter {
     fn format_flat(
         &self,
         output: &mut String,
+        out: &mut dyn Write,
         by_type: &HashMap<NodeType, Vec<(NodeIndex, &Node)>>,
         file_map: &HashMap<String, String>,
-        graph: &DependencyGraph,
+        index: &GraphIndex,
     ) -> Result<()> {
         // Simple flat list optimized for LLM scanning with deterministic type order
         let type_order = [
@@ -338,15 +388,14 @@ impl LLMOptimizedFormatter {
             NodeType::Enum,
         ];
 
-        for node_type in type_order {
-            let Some(nodes) = by_type.get(&node_type) else {
-                continue;
-            };
-            if nodes.is_empty() {
-                continue;
-            }
-
-            output.push_str(&format!("## {}\n", self.type_symbol(node_type)));
+        let sections: Vec<(NodeType, &Vec<(NodeIndex, &Node)>)> = type_order
+            .iter()
+            .filter_map(|node_type| Some((*node_type, by_type.get(node_type)?)))
+            .filter(|(_, nodes)| !nodes.is_empty())
+            .collect();
+        flush_section(out, output)?;
+        write_sections(out, &sections, |&(node_type, nodes)| {
+            let mut section = format!("## {}\n", self.type_symbol(node_type));
 
             for &(idx, node) in nodes.iter() {
                 let file_ref = if self.compress_ids {
@@ -358,41 +407,38 @@ impl LLMOptimizedFormatter {
                     node.file_path.to_string_lossy().to_string()
                 };
 
-                output.push_str(&format!("{}:{} ", file_ref, node.line_number));
-                output.push_str(&node.name);
+                section.push_str(&format!("{}:{} ", file_ref, node.line_number));
+                section.push_str(&node.name);
 
                 // Compact relationships
-                let outgoing = self.get_outgoing_edges(idx, graph);
-                if !outgoing.is_empty() {
-                    output.push_str(" →");
-                    for (i, (_, target)) in outgoing.iter().take(3).enumerate() {
+                if index.out_degree(idx) > 0 {
+                    section.push_str(" →");
+                    for (i, (_, target)) in index.outgoing(idx).take(3).enumerate() {
                         if i > 0 {
-                            output.push(',');
+                            section.push(',');
                         }
-                        output.push_str(&target.name);
+                        section.push_str(&target.name);
                     }
                 }
-                output.push('\n');
+                section.push('\n');
             }
-            output.push('\n');
-        }
+            section.push('\n');
+            section
+        })?;
 
         Ok(())
     }
 
-    fn format_dependency_summary(&self, output: &mut String, graph: &DependencyGraph) {
+    fn format_dependency_summary(&self, output: &mut String, index: &GraphIndex) {
         output.push_str("## DEPS\n");
 
-        let mut edge_counts: HashMap<String, usize> = HashMap::new();
-        for edge_ref in graph.edge_references() {
-            let edge_type = format!("{:?}", edge_ref.weight().edge_type);
-            *edge_counts.entry(edge_type).or_insert(0) += 1;
-        }
-
-        let mut keys: Vec<_> = edge_counts.keys().cloned().collect();
-        keys.sort();
-        for edge_type in keys {
-            let count = edge_counts[&edge_type];
+        let mut edge_counts: Vec<(String, usize)> = EdgeType::ALL
+            .iter()
+            .map(|&edge_type| (format!("{:?}", edge_type), index.edge_count_of(edge_type)))
+            .filter(|&(_, count)| count > 0)
+            .collect();
+        edge_counts.sort();
+        for (edge_type, count) in edge_counts {
             output.push_str(&format!("{}: {}\n", edge_type, count));
         }
     }
@@ -408,34 +454,12 @@ impl LLMOptimizedFormatter {
         }
     }
 
-    fn get_outgoing_edges<'a>(
-        &self,
-        node_idx: NodeIndex,
-        graph: &'a DependencyGraph,
-    ) -> Vec<(&'a Edge, &'a Node)> {
-        let mut edges = Vec::new();
-        for edge_ref in graph.edges(node_idx) {
-            let target_idx = edge_ref.target();
-            let edge_weight = edge_ref.weight();
-            if let Some(target_node) = graph.node_weight(target_idx) {
-                edges.push((edge_weight, target_node));
-            }
-        }
-        edges
-    }
-
     /// Extract common path prefixes and build directory tree structure
-    fn build_directory_tree(
-        &self,
-        by_type: &HashMap<NodeType, Vec<(NodeIndex, &Node)>>,
-    ) -> DirectoryTree {
-        let mut all_paths = Vec::new();
-
-        for nodes in by_type.values() {
-            for (_, node) in nodes {
-                all_paths.push(node.file_path.to_string_lossy().to_string());
-            }
-        }
+    fn build_directory_tree(&self, index: &GraphIndex) -> DirectoryTree {
+        let mut all_paths: Vec<String> = index
+            .files()
+            .map(|(path, _)| path.to_string_lossy().to_string())
+            .collect();
 
         all_paths.sort();
         all_paths.dedup();
@@ -521,9 +545,10 @@ impl LLMOptimizedFormatter {
     fn format_with_clusters(
         &self,
         output: &mut String,
+        out: &mut dyn Write,
         clusters: &HashMap<String, Vec<(NodeIndex, &Node)>>,
         directory_tree: &DirectoryTree,
-        graph: &DependencyGraph,
+        index: &GraphIndex,
     ) -> Result<()> {
         // Directory tree header
         output.push_str("## DIRECTORY_TREE\n");
@@ -532,38 +557,40 @@ impl LLMOptimizedFormatter {
 
         // Semantic clusters with call hierarchies
         output.push_str("## ARCHITECTURAL_CLUSTERS\n\n");
+        flush_section(out, output)?;
 
-        let mut cluster_names: Vec<_> = clusters.keys().cloned().collect();
-        cluster_names.sort();
-        for cluster_name in cluster_names {
-            let nodes = match clusters.get(&cluster_name) {
-                Some(v) => v,
-                None => continue,
-            };
-            if nodes.is_empty() {
-                continue;
-            }
+        let mut cluster_list: Vec<(&String, &Vec<(NodeIndex, &Node)>)> = clusters
+            .iter()
+            .filter(|(_, nodes)| !nodes.is_empty())
+            .collect();
+        cluster_list.sort_by(|a, b| a.0.cmp(b.0));
+        write_sections(out, &cluster_list, |&(cluster_name, nodes)| {
+            self.format_cluster(cluster_name, nodes, index)
+        })?;
 
-            // Calculate cluster metrics
-            let max_depth = self.calculate_max_call_depth(nodes, graph);
-            output.push_str(&format!("### {}\n", cluster_name));
-            output.push_str(&format!(
-                "NODES:{} CALL_DEPTH:{}\n\n",
-                nodes.len(),
-                max_depth
-            ));
+        Ok(())
+    }
 
-            // Group by file and build call hierarchies
-            let mut by_file: BTreeMap<String, Vec<(NodeIndex, &Node)>> = BTreeMap::new();
-            for &(idx, node) in nodes {
-                let file_key = self
-                    .language_adapter
-                    .extract_filename(&node.file_path.to_string_lossy());
-                by_file.entry(file_key).or_default().push((idx, node));
-            }
+    /// Renders one cluster: its metrics header and a line of entities per file
+    fn format_cluster(
+        &self,
+        cluster_name: &str,
+        nodes: &[(NodeIndex, &Node)],
+        index: &GraphIndex,
+    ) -> String {
+        // Group by file and build call hierarchies
+        let mut by_file: BTreeMap<String, Vec<(NodeIndex, &Node)>> = BTreeMap::new();
+        for &(idx, node) in nodes {
+            let file_key = self
+                .language_adapter
+                .extract_filename(&node.file_path.to_string_lossy());
+            by_file.entry(file_key).or_default().push((idx, node));
+        }
+        let files: Vec<(String, Vec<(NodeIndex, &Node)>)> = by_file.into_iter().collect();
 
-            for (file, mut file_nodes) in by_file {
-                output.push_str(&format!("{}→[", file));
+        let file_sections: Vec<String> = files
+            .into_par_iter()
+            .map(|(file, mut file_nodes)| {
                 // Sort within file for deterministic order
                 file_nodes.sort_by(|a, b| {
                     let (_, na) = a;
@@ -572,21 +599,214 @@ impl LLMOptimizedFormatter {
                         .cmp(&nb.line_number)
                         .then_with(|| na.name.cmp(&nb.name))
                 });
-                let behavioral_entities = self.build_behavioral_entities(&file_nodes, graph);
+                let behavioral_entities = self.build_behavioral_entities(&file_nodes, index);
                 let entity_strings: Vec<String> = behavioral_entities
                     .iter()
                     .map(|entity| self.format_behavioral_entity(entity))
                     .collect();
+                format!("{}→[{}] ", file, entity_strings.join(","))
+            })
+            .collect();
+
+        let max_depth = self.calculate_max_call_depth(nodes, index);
+        let mut section = format!("### {}\n", cluster_name);
+        section.push_str(&format!(
+            "NODES:{} CALL_DEPTH:{}\n\n",
+            nodes.len(),
+            max_depth
+        ));
+        for file_section in file_sections {
+            section.push_str(&file_section);
+        }
+        section.push('\n');
+        section
+    }
+
+    /// Renders the highest-ranked file groups that fit in `max_tokens`.
+    ///
+    /// Groups are rendered in rank order, a parallel batch at a time, and kept
+    /// while they fit; rendering stops once a run of groups has not, so the
+    /// work tracks the size of the output rather than of the graph.
+    fn write_budgeted(
+        &self,
+        graph: &DependencyGraph,
+        out: &mut dyn Write,
+        max_tokens: usize,
+    ) -> Result<()> {
+        let mut output = String::with_capacity(8192);
+        if self.verbosity != OutputVerbosity::Compact {
+            self.add_interpretation_key(&mut output);
+            // Fixed overhead: dropped when it would crowd out the graph itself
+            if estimate_tokens(&output) > max_tokens / KEY_BUDGET_SHARE {
+                output.clear();
+            }
+        }
+
+        let index = GraphIndex::new(graph);
+        let paths: Vec<String> = index
+            .files()
+            .map(|(path, _)| path.to_string_lossy().to_string())
+            .collect();
+        let root = DirectoryTree::find_common_prefix(&paths);
+        drop(paths);
+
+        output.push_str("# CODE_GRAPH\n");
+        output.push_str(&format!(
+            "NODES:{} EDGES:{} TOKEN_BUDGET:{}\n\n",
+            graph.node_count(),
+            graph.edge_count(),
+            max_tokens
+        ));
+        output.push_str(&format!("ROOT: {}\n\n", root));
+        output.push_str("## ARCHITECTURAL_CLUSTERS\n\n");
+        let mut budget = TokenBudget::new(max_tokens.saturating_sub(OMITTED_FOOTER_TOKENS));
+        budget.spend(estimate_tokens(&output));
+        flush_section(out, &mut output)?;
+
+        let groups = self.rank_file_groups(&index);
+        let mut cluster_totals: HashMap<&str, usize> = HashMap::new();
+        for group in &groups {
+            *cluster_totals.entry(&group.cluster).or_default() += group.nodes.len();
+        }
+
+        // Indices into `groups` with their rendered lines, in rank order
+        let mut selected: Vec<(usize, String)> = Vec::new();
+        let mut clusters_shown: HashSet<&str> = HashSet::new();
+        let mut misses = 0;
+        let batch = (rayon::current_num_threads() * SECTIONS_PER_THREAD).max(1);
+        'ranked: for (chunk_idx, chunk) in groups.chunks(batch).enumerate() {
+            let lines: Vec<String> = chunk
+                .par_iter()
+                .map(|group| self.format_file_group(group, &root, &index))
+                .collect();
+            for (offset, line) in lines.into_iter().enumerate() {
+                let group_idx = chunk_idx * batch + offset;
+                let cluster = groups[group_idx].cluster.as_str();
+                let mut cost = estimate_tokens(&line);
+                if !clusters_shown.contains(cluster) {
+                    cost += CLUSTER_HEADER_TOKENS + estimate_tokens(cluster);
+                }
+                if budget.try_spend(cost) {
+                    clusters_shown.insert(cluster);
+                    selected.push((group_idx, line));
+                    misses = 0;
+                    continue;
+                }
+                misses += 1;
+                if misses >= MAX_BUDGET_MISSES || budget.remaining() < MIN_GROUP_TOKENS {
+                    break 'ranked;
+                }
+            }
+        }
 
-                output.push_str(&entity_strings.join(","));
-                output.push_str("] ");
+        // Document order: clusters by name, files by path within each
+        selected.sort_by(|(a, _), (b, _)| {
+            let (a, b) = (&groups[*a], &groups[*b]);
+            a.cluster.cmp(&b.cluster).then_with(|| a.path.cmp(b.path))
+        });
+        let mut shown_nodes = 0;
+        let mut shown_files: HashSet<&Path> = HashSet::new();
+        for cluster_run in
+            selected.chunk_by(|(a, _), (b, _)| groups[*a].cluster == groups[*b].cluster)
+        {
+            let cluster = groups[cluster_run[0].0].cluster.as_str();
+            let nodes: Vec<(NodeIndex, &Node)> = cluster_run
+                .iter()
+                .flat_map(|(group_idx, _)| groups[*group_idx].nodes.iter().copied())
+                .collect();
+            output.push_str(&format!("### {}\n", cluster));
+            output.push_str(&format!(
+                "NODES:{}/{} CALL_DEPTH:{}\n\n",
+                nodes.len(),
+                cluster_totals[cluster],
+                self.calculate_max_call_depth(&nodes, &index)
+            ));
+            for (group_idx, line) in cluster_run {
+                output.push_str(line);
+                shown_files.insert(groups[*group_idx].path);
             }
             output.push('\n');
+            shown_nodes += nodes.len();
+            flush_section(out, &mut output)?;
         }
 
+        let rendered_nodes: usize = groups.iter().map(|group| group.nodes.len()).sum();
+        let omitted_nodes = rendered_nodes - shown_nodes;
+        if omitted_nodes > 0 {
+            let rendered_files: HashSet<&Path> = groups.iter().map(|group| group.path).collect();
+            output.push_str("## OMITTED\n");
+            output.push_str(&format!(
+                "FILES:{} NODES:{} (lowest-ranked, over the token budget)\n",
+                rendered_files.len() - shown_files.len(),
+                omitted_nodes
+            ));
+            flush_section(out, &mut output)?;
+        }
         Ok(())
     }
 
+    /// Splits each file's functions by cluster and ranks the groups, most
+    /// connected first.
+    ///
+    /// Only functions are rendered as entities, so other nodes join no group
+    /// and count as neither shown nor omitted. A node scores its degree with
+    /// incoming edges counted twice, since a function many others call
+    /// explains more of the code than one that calls many; a group scores the
+    /// sum of its nodes.
+    fn rank_file_groups<'g>(&self, index: &GraphIndex<'g>) -> Vec<FileGroup<'g>> {
+        let mut groups = Vec::new();
+        for (path, file_nodes) in index.files() {
+            let mut by_cluster: BTreeMap<String, FileGroup<'g>> = BTreeMap::new();
+            for &idx in file_nodes {
+                let node = index.node(idx);
+                if node.node_type != NodeType::Function {
+                    continue;
+                }
+                let cluster = if self.use_semantic_clustering {
+                    self.language_adapter.classify_node_cluster(node)
+                } else {
+                    UNCLUSTERED.to_string()
+                };
+                let group = by_cluster
+                    .entry(cluster)
+                    .or_insert_with_key(|cluster| FileGroup {
+                        cluster: cluster.clone(),
+                        path,
+                        nodes: Vec::new(),
+                        score: 0,
+                    });
+                group.nodes.push((idx, node));
+                group.score += 2 * index.in_degree(idx) + index.out_degree(idx) + 1;
+            }
+            groups.extend(by_cluster.into_values());
+        }
+        groups.sort_by(|a, b| {
+            b.score
+                .cmp(&a.score)
+                .then_with(|| a.path.cmp(b.path))
+                .then_with(|| a.cluster.cmp(&b.cluster))
+        });
+        groups
+    }
+
+    /// One `file→[entities]` line, keyed by the path below `root`
+    fn format_file_group(&self, group: &FileGroup, root: &str, index: &GraphIndex) -> String {
+        let mut file_nodes = group.nodes.clone();
+        file_nodes.sort_by(|(_, a), (_, b)| {
+            a.line_number
+                .cmp(&b.line_number)
+                .then_with(|| a.name.cmp(&b.name))
+        });
+        let entities = self.build_behavioral_entities(&file_nodes, index);
+        let entity_strings: Vec<String> = entities
+            .iter()
+            .map(|entity| self.format_behavioral_entity(entity))
+            .collect();
+        let path = group.path.to_string_lossy();
+        let key = path.strip_prefix(root).unwrap_or(&path);
+        format!("{}→[{}]\n", key, entity_strings.join(","))
+    }
+
     /// Format advanced dependency patterns
     fn format_advanced_dependencies(
         &self,
@@ -701,37 +921,30 @@ impl LLMOptimizedFormatter {
     }
 
     /// Calculate maximum call depth in a cluster
-    fn calculate_max_call_depth(
-        &self,
-        nodes: &[(NodeIndex, &Node)],
-        graph: &DependencyGraph,
-    ) -> usize {
-        let mut max_depth = 0;
-
-        for &(node_idx, _) in nodes {
-            let depth = self.calculate_node_call_depth(
-                node_idx,
-                graph,
-                &mut std::collections::HashSet::new(),
-            );
-            max_depth = max_depth.max(depth);
-        }
-
-        max_depth
+    fn calculate_max_call_depth(&self, nodes: &[(NodeIndex, &Node)], index: &GraphIndex) -> usize {
+        nodes
+            .iter()
+            .map(|&(node_idx, _)| index.call_depth(node_idx))
+            .max()
+            .unwrap_or(0)
     }
 
     /// Build behavioral entities (compact format with nested calls)
     fn build_behavioral_entities(
         &self,
         file_nodes: &[(NodeIndex, &Node)],
-        graph: &DependencyGraph,
+        index: &GraphIndex,
     ) -> Vec<BehavioralEntity> {
         let mut entities = Vec::new();
+        let file_node_indices: HashSet<NodeIndex> =
+            file_nodes.iter().map(|(idx, _)| *idx).collect();
 
         for &(node_idx, node) in file_nodes {
             if matches!(node.node_type, crate::core::NodeType::Function) {
-                let nested_calls = self.extract_immediate_calls(node_idx, graph, file_nodes);
-                let annotations = self.get_compact_annotations(node, graph, file_nodes);
+                let nested_calls =
+                    self.extract_immediate_calls(node_idx, index, &file_node_indices);
+                let annotations =
+                    self.get_compact_annotations(node_idx, node, index, &file_node_indices);
 
                 entities.push(BehavioralEntity {
                     name: node.name.clone(),
@@ -761,57 +974,33 @@ impl LLMOptimizedFormatter {
     fn extract_immediate_calls(
         &self,
         node_idx: NodeIndex,
-        graph: &DependencyGraph,
-        file_nodes: &[(NodeIndex, &Node)],
+        index: &GraphIndex,
+        file_node_indices: &HashSet<NodeIndex>,
     ) -> Vec<String> {
+        let graph = index.graph();
         let mut calls = Vec::new();
-        let file_node_indices: std::collections::HashSet<NodeIndex> =
-            file_nodes.iter().map(|(idx, _)| *idx).collect();
 
-        for edge_ref in graph.edges(node_idx) {
-            if matches!(edge_ref.weight().edge_type, crate::core::EdgeType::Call) {
-                let target_idx = edge_ref.target();
-                if let Some(target_node) = graph.node_weight(target_idx) {
-                    if file_node_indices.contains(&target_idx) {
-                        // Internal call - allow language adapter to override display
-                        if let Some(display) = self.language_adapter.format_call_display(
-                            target_idx,
-                            target_node,
-                            graph,
-                        ) {
-                            calls.push(display);
-                        } else {
-                            calls.push(target_node.name.clone());
-                        }
-                    } else {
-                        // External call - show with simplified module context
-                        let module_name = self
-                            .language_adapter
-                            .extract_module_from_path(&target_node.file_path.to_string_lossy());
-                        if module_name == "unknown" || module_name.is_empty() {
-                            if let Some(display) = self.language_adapter.format_call_display(
-                                target_idx,
-                                target_node,
-                                graph,
-                            ) {
-                                calls.push(display);
-                            } else {
-                                calls.push(target_node.name.clone());
-                            }
-                        } else {
-                            // Let adapter override the callee name if applicable
-                            let name = if let Some(display) = self
-                                .language_adapter
-                                .format_call_display(target_idx, target_node, graph)
-                            {
-                                display
-                            } else {
-                                target_node.name.clone()
-                            };
-                            calls.push(format!("{}::{}", module_name, name));
-                        }
-                    }
-                }
+        for &target_idx in index.targets_of(node_idx, EdgeType::Call) {
+            let target_node = index.node(target_idx);
+            // Let the language adapter override the callee name if applicable
+            let name = self
+                .language_adapter
+                .format_call_display(target_idx, target_node, graph)
+                .unwrap_or_else(|| target_node.name.clone());
+            if file_node_indices.contains(&target_idx) {
+                // Internal call
+                calls.push(name);
+                continue;
+            }
+
+            // External call - show with simplified module context
+            let module_name = self
+                .language_adapter
+                .extract_module_from_path(&target_node.file_path.to_string_lossy());
+            if module_name == "unknown" || module_name.is_empty() {
+                calls.push(name);
+            } else {
+                calls.push(format!("{}::{}", module_name, name));
             }
         }
 
@@ -845,63 +1034,38 @@ impl LLMOptimizedFormatter {
     /// Get compact annotations for a function
     fn get_compact_annotations(
         &self,
+        node_idx: NodeIndex,
         node: &Node,
-        graph: &DependencyGraph,
-        file_nodes: &[(NodeIndex, &Node)],
+        index: &GraphIndex,
+        file_node_indices: &HashSet<NodeIndex>,
     ) -> Vec<String> {
         let mut annotations = Vec::new();
 
-        // Find the NodeIndex for this node
-        let mut current_node_idx = None;
-        for &(idx, file_node) in file_nodes {
-            if file_node.name == node.name && file_node.line_number == node.line_number {
-                current_node_idx = Some(idx);
-                break;
+        // Check if this function is called by other functions in the same file
+        let is_called_internally = index
+            .sources_of(node_idx, EdgeType::Call)
+            .iter()
+            .any(|caller| *caller != node_idx && file_node_indices.contains(caller));
+
+        // More precise entry point detection
+        if !is_called_internally {
+            // True entry points: main, new, parse_file, or public methods
+            if node.name == "main"
+                || node.name == "new"
+                || node.name == "parse_file"
+                || node.name.starts_with("format_")
+                || node.visibility == Some(Visibility::Public)
+            {
+                annotations.push("ENTRY".to_string());
             }
         }
 
-        if let Some(node_idx) = current_node_idx {
-            // Check if this function is called by other functions in the same file
-            let mut is_called_internally = false;
-
-            for &(caller_idx, _) in file_nodes {
-                if caller_idx == node_idx {
-                    continue;
-                }
-
-                for edge_ref in graph.edges(caller_idx) {
-                    if matches!(edge_ref.weight().edge_type, crate::core::EdgeType::Call) {
-                        if edge_ref.target() == node_idx {
-                            is_called_internally = true;
-                            break;
-                        }
-                    }
-                }
-                if is_called_internally {
-                    break;
-                }
-            }
-
-            // More precise entry point detection
-            if !is_called_internally {
-                // True entry points: main, new, parse_file, or public methods
-                if node.name == "main"
-                    || node.name == "new"
-                    || node.name == "parse_file"
-                    || node.name.starts_with("format_")
-                    || node.visibility.as_ref().map_or(false, |v| v == "public")
-                {
-                    annotations.push("ENTRY".to_string());
-                }
-            }
-
-            // Add performance hints
-            if node.name.contains("resolve")
-                || node.name.contains("compute")
-                || node.name.contains("build")
-            {
-                annotations.push("HOT".to_string());
-            }
+        // Add performance hints
+        if node.name.contains("resolve")
+            || node.name.contains("compute")
+            || node.name.contains("build")
+        {
+            annotations.push("HOT".to_string());
         }
 
         // Merge language-specific annotations
@@ -994,37 +1158,12 @@ impl LLMOptimizedFormatter {
         self.language_adapter.extract_module_from_path(path)
     }
 
-    /// Calculate call depth for a single node (with cycle detection)
-    fn calculate_node_call_depth(
-        &self,
-        node_idx: NodeIndex,
-        graph: &DependencyGraph,
-        visited: &mut std::collections::HashSet<NodeIndex>,
-    ) -> usize {
-        if visited.contains(&node_idx) {
-            return 0; // Prevent infinite recursion
-        }
-
-        visited.insert(node_idx);
-
-        let mut max_child_depth = 0;
-        for edge_ref in graph.edges(node_idx) {
-            if matches!(edge_ref.weight().edge_type, crate::core::EdgeType::Call) {
-                let child_depth = self.calculate_node_call_depth(edge_ref.target(), graph, visited);
-                max_child_depth = max_child_depth.max(child_depth);
-            }
-        }
-
-        visited.remove(&node_idx);
-        1 + max_child_depth
-    }
-
     /// Build call trees for functions in a file
     #[allow(dead_code)]
     fn build_call_trees(
         &self,
         file_nodes: &[(NodeIndex, &Node)],
-        graph: &DependencyGraph,
+        index: &GraphIndex,
     ) -> Vec<CallTreeNode> {
         let mut trees = Vec::new();
         let mut processed = std::collections::HashSet::new();
@@ -1040,12 +1179,9 @@ impl LLMOptimizedFormatter {
 
         // Remove functions that are called by other functions in same file
         for &(caller_idx, _) in file_nodes {
-            for edge_ref in graph.edges(caller_idx) {
-                if matches!(edge_ref.weight().edge_type, crate::core::EdgeType::Call) {
-                    let target_idx = edge_ref.target();
-                    if file_function_indices.contains(&target_idx) {
-                        entry_points.remove(&target_idx);
-                    }
+            for target_idx in index.targets_of(caller_idx, EdgeType::Call) {
+                if file_function_indices.contains(target_idx) {
+                    entry_points.remove(target_idx);
                 }
             }
         }
@@ -1053,11 +1189,10 @@ impl LLMOptimizedFormatter {
         // Build trees starting from entry points
         for &entry_idx in &entry_points {
             if !processed.contains(&entry_idx) {
-                if let Some(node) = graph.node_weight(entry_idx) {
-                    let tree =
-                        self.build_call_tree_recursive(entry_idx, node, graph, &mut processed, 0);
-                    trees.push(tree);
-                }
+                let node = index.node(entry_idx);
+                let tree =
+                    self.build_call_tree_recursive(entry_idx, node, index, &mut processed, 0);
+                trees.push(tree);
             }
         }
 
@@ -1066,7 +1201,7 @@ impl LLMOptimizedFormatter {
             if matches!(node.node_type, crate::core::NodeType::Function)
                 && !processed.contains(&func_idx)
             {
-                let tree = self.build_call_tree_recursive(func_idx, node, graph, &mut processed, 0);
+                let tree = self.build_call_tree_recursive(func_idx, node, index, &mut processed, 0);
                 trees.push(tree);
             }
         }
@@ -1080,7 +1215,7 @@ impl LLMOptimizedFormatter {
         &self,
         node_idx: NodeIndex,
         node: &Node,
-        graph: &DependencyGraph,
+        index: &GraphIndex,
         processed: &mut std::collections::HashSet<NodeIndex>,
         depth: usize,
     ) -> CallTreeNode {
@@ -1090,28 +1225,24 @@ impl LLMOptimizedFormatter {
 
         if depth < 4 {
             // Limit depth to prevent explosion
-            for edge_ref in graph.edges(node_idx) {
-                if matches!(edge_ref.weight().edge_type, crate::core::EdgeType::Call) {
-                    let target_idx = edge_ref.target();
-                    if let Some(target_node) = graph.node_weight(target_idx) {
-                        if !processed.contains(&target_idx) {
-                            let child_tree = self.build_call_tree_recursive(
-                                target_idx,
-                                target_node,
-                                graph,
-                                processed,
-                                depth + 1,
-                            );
-                            children.push(child_tree);
-                        } else {
-                            // Reference to already processed node (potential cycle)
-                            children.push(CallTreeNode {
-                                name: format!("{}[REF]", target_node.name),
-                                annotations: vec!["CYCLE".to_string()],
-                                children: Vec::new(),
-                            });
-                        }
-                    }
+            for &target_idx in index.targets_of(node_idx, EdgeType::Call) {
+                let target_node = index.node(target_idx);
+                if !processed.contains(&target_idx) {
+                    let child_tree = self.build_call_tree_recursive(
+                        target_idx,
+                        target_node,
+                        index,
+                        processed,
+                        depth + 1,
+                    );
+                    children.push(child_tree);
+                } else {
+                    // Reference to already processed node (potential cycle)
+                    children.push(CallTreeNode {
+                        name: format!("{}[REF]", target_node.name),
+                        annotations: vec!["CYCLE".to_string()],
+                        children: Vec::new(),
+                    });
                 }
             }
         }
@@ -1134,7 +1265,7 @@ impl LLMOptimizedFormatter {
         let mut annotations = Vec::new();
 
         // Entry point detection
-        if node.visibility.as_ref().map_or(false, |v| v == "public") {
+        if node.visibility == Some(Visibility::Public) {
             annotations.push("ENTRY".to_string());
         }
 
@@ -1209,6 +1340,14 @@ struct CallTreeNode {
     children: Vec<CallTreeNode>,
 }
 
+/// Nodes of one cluster within one file, the unit a token budget selects
+struct FileGroup<'g> {
+    cluster: String,
+    path: &'g Path,
+    nodes: Vec<(NodeIndex, &'g Node)>,
+    score: usize,
+}
+
 /// Represents a behavioral entity with compact nested calls
 #[derive(Debug, Clone)]
 struct BehavioralEntity {
@@ -1429,3 +1568,44 @@ impl Default for LLMOptimizedFormatter {
         Self::new()
     }
 }
+
+/// Sections rendered per thread in each parallel batch
+const SECTIONS_PER_THREAD: usize = 4;
+
+/// The interpretation key is kept only while it takes at most 1/N of a token budget
+const KEY_BUDGET_SHARE: usize = 4;
+/// Held back from a token budget for the OMITTED footer
+const OMITTED_FOOTER_TOKENS: usize = 24;
+/// Charged for a cluster's header on top of its name
+const CLUSTER_HEADER_TOKENS: usize = 12;
+/// Consecutive file groups over the remaining budget before selection stops
+const MAX_BUDGET_MISSES: usize = 64;
+/// Remaining budget below which no file group is worth rendering
+const MIN_GROUP_TOKENS: usize = 8;
+/// Cluster of every node when semantic clustering is off
+const UNCLUSTERED: &str = "CODE";
+
+/// Renders `items` on the rayon pool and writes the sections in input order.
+///
+/// Only one batch of rendered sections is held in memory at a time.
+fn write_sections<T, F>(out: &mut dyn Write, items: &[T], render: F) -> io::Result<()>
+where
+    T: Sync,
+    F: Fn(&T) -> String + Sync,
+{
+    let batch = (rayon::current_num_threads() * SECTIONS_PER_THREAD).max(1);
+    for chunk in items.chunks(batch) {
+        let sections: Vec<String> = chunk.par_iter().map(&render).collect();
+        for section in sections {
+            out.write_all(section.as_bytes())?;
+        }
+    }
+    Ok(())
+}
+
+/// Moves a rendered section from the scratch buffer to the output
+fn flush_section(out: &mut dyn Write, section: &mut String) -> io::Result<()> {
+    out.write_all(section.as_bytes())?;
+    section.clear();
+    Ok(())
+}
@@ -1,20 +1,174 @@
 use anyhow::Result;
 use petgraph::graph::NodeIndex;
-use petgraph::visit::EdgeRef;
 use std::collections::HashMap;
-use std::fs;
-use std::path::Path;
+use std::fs::{self, File, OpenOptions};
+use std::io::{self, BufRead, BufReader, BufWriter, Read, Write};
+use std::path::{Path, PathBuf};
 
-use crate::core::{DependencyGraph, Edge, EdgeType, Node, NodeType};
+use crate::core::{DependencyGraph, EdgeType, GraphIndex, Node, NodeType};
 
+mod binary;
 mod json_compact;
 mod llm_language;
 mod llm_optimized;
+pub mod token_budget;
 
+pub use binary::{BinaryFormatter, GraphSnapshot};
 pub use json_compact::JsonCompactFormatter;
 pub use llm_language::{LlmLanguageAdapter, PythonLanguageAdapter};
 pub use llm_optimized::{LLMOptimizedFormatter, OutputVerbosity};
 
+/// Streams `render` into `path` through a `BufWriter`; returns whether the file changed.
+///
+/// The new contents go to a sibling temp file that replaces `path` once the
+/// render has succeeded, so a failing render leaves the old file as it was.
+pub fn write_file<F>(path: &Path, render: F) -> Result<bool>
+where
+    F: FnOnce(&mut BufWriter<ChangedFileWriter>) -> Result<()>,
+{
+    let mut out = BufWriter::new(ChangedFileWriter::open(path)?);
+    render(&mut out)?;
+    let writer = out.into_inner().map_err(|err| err.into_error())?;
+    Ok(writer.finish()?)
+}
+
+/// File sink that leaves an existing file alone for as long as the output matches it.
+///
+/// Incoming bytes are compared with the current contents. At the first
+/// difference the matching prefix is copied into a sibling temp file and the
+/// rest of the output follows it there; [`finish`](Self::finish) renames it over
+/// the file, and dropping the writer unfinished deletes it. A no-op
+/// regeneration therefore neither rewrites the file nor bumps its mtime, which
+/// matters to editors and watch mode consumers that reload on change.
+pub struct ChangedFileWriter {
+    path: PathBuf,
+    temp_path: PathBuf,
+    /// Current contents, while everything written so far matches them
+    existing: Option<BufReader<File>>,
+    /// The temp file, from the first difference on
+    target: Option<File>,
+    position: u64,
+}
+
+impl ChangedFileWriter {
+    fn open(path: &Path) -> io::Result<Self> {
+        let file_name = path.file_name().unwrap_or_default().to_string_lossy();
+        let temp_path = path.with_file_name(format!(".{file_name}.tmp"));
+        let (existing, target) = match File::open(path) {
+            Ok(file) => (Some(BufReader::new(file)), None),
+            Err(_) => (None, Some(File::create(&temp_path)?)),
+        };
+        Ok(Self {
+            path: path.to_path_buf(),
+            temp_path,
+            existing,
+            target,
+            position: 0,
+        })
+    }
+
+    /// Moves the new contents into place, or drops whatever the old file held
+    /// past them when they are a prefix of it
+    fn finish(mut self) -> io::Result<bool> {
+        if let Some(target) = self.target.take() {
+            if let Ok(metadata) = fs::metadata(&self.path) {
+                let _ = fs::set_permissions(&self.temp_path, metadata.permissions());
+            }
+            drop(target);
+            if let Err(err) = fs::rename(&self.temp_path, &self.path) {
+                let _ = fs::remove_file(&self.temp_path);
+                return Err(err);
+            }
+            return Ok(true);
+        }
+        let has_tail = match &mut self.existing {
+            Some(existing) => !existing.fill_buf()?.is_empty(),
+            None => false,
+        };
+        if has_tail {
+            OpenOptions::new()
+                .write(true)
+                .open(&self.path)?
+                .set_len(self.position)?;
+        }
+        Ok(has_tail)
+    }
+
+    /// Consumes the longest prefix of `buf` that matches the existing file
+    fn matching_prefix(existing: &mut BufReader<File>, buf: &[u8]) -> io::Result<usize> {
+        let mut matched = 0;
+        while matched < buf.len() {
+            let chunk = existing.fill_buf()?;
+            if chunk.is_empty() {
+                break;
+            }
+            let len = chunk.len().min(buf.len() - matched);
+            let same = chunk[..len]
+                .iter()
+                .zip(&buf[matched..matched + len])
+                .take_while(|(old, new)| old == new)
+                .count();
+            existing.consume(same);
+            matched += same;
+            if same < len {
+                break;
+            }
+        }
+        Ok(matched)
+    }
+}
+
+impl Drop for ChangedFileWriter {
+    fn drop(&mut self) {
+        // Not finished: the render failed, keep the old file
+        if self.target.take().is_some() {
+            let _ = fs::remove_file(&self.temp_path);
+        }
+    }
+}
+
+impl Write for ChangedFileWriter {
+    fn write(&mut self, buf: &[u8]) -> io::Result<usize> {
+        if self.target.is_none() {
+            let matched = match &mut self.existing {
+                Some(existing) => Self::matching_prefix(existing, buf)?,
+                None => 0,
+            };
+            self.position += matched as u64;
+            if matched == buf.len() {
+                return Ok(matched);
+            }
+
+            // First difference: the temp file takes the matching prefix and the rest
+            self.existing = None;
+            let mut target = File::create(&self.temp_path)?;
+            io::copy(
+                &mut File::open(&self.path)?.take(self.position),
+                &mut target,
+            )?;
+            self.target = Some(target);
+            if matched > 0 {
+                return Ok(matched);
+            }
+        }
+
+        let target = self
+            .target
+            .as_mut()
+            .expect("target is open past the first difference");
+        let written = target.write(buf)?;
+        self.position += written as u64;
+        Ok(written)
+    }
+
+    fn flush(&mut self) -> io::Result<()> {
+        match &mut self.target {
+            Some(target) => target.flush(),
+            None => Ok(()),
+        }
+    }
+}
+
 pub struct EmbargoFormatter;
 
 impl EmbargoFormatter {
@@ -23,21 +177,20 @@ impl EmbargoFormatter {
     }
 
     pub fn format_to_file(&self, graph: &DependencyGraph, output_path: &Path) -> Result<()> {
-        let formatted_content = self.format_graph(graph)?;
-        fs::write(output_path, formatted_content)?;
+        write_file(output_path, |out| self.write_to(graph, out))?;
         Ok(())
     }
 
-    fn format_graph(&self, graph: &DependencyGraph) -> Result<String> {
-        let mut output = String::new();
-
-        output.push_str("# EMBARGO - Codebase Dependency Analysis\n\n");
-        output.push_str("Generated by embargo - An ultrafast codebase dependency extractor\n\n");
-        output.push_str("## Overview\n\n");
-        output.push_str(&format!("- **Total Nodes**: {}\n", graph.node_count()));
-        output.push_str(&format!("- **Total Edges**: {}\n", graph.edge_count()));
-        output.push_str("\n---\n\n");
+    /// Streams the document into `out` node by node
+    pub fn write_to<W: Write>(&self, graph: &DependencyGraph, out: &mut W) -> Result<()> {
+        out.write_all(b"# EMBARGO - Codebase Dependency Analysis\n\n")?;
+        out.write_all(b"Generated by embargo - An ultrafast codebase dependency extractor\n\n")?;
+        out.write_all(b"## Overview\n\n")?;
+        writeln!(out, "- **Total Nodes**: {}", graph.node_count())?;
+        writeln!(out, "- **Total Edges**: {}", graph.edge_count())?;
+        out.write_all(b"\n---\n\n")?;
 
+        let index = GraphIndex::new(graph);
         let node_indices: Vec<NodeIndex> = graph.node_indices().collect();
 
         let mut modules = Vec::new();
@@ -60,47 +213,47 @@ impl EmbargoFormatter {
         }
 
         if !modules.is_empty() {
-            output.push_str("## Modules & Imports\n\n");
+            out.write_all(b"## Modules & Imports\n\n")?;
             for (idx, module) in modules {
-                output.push_str(&self.format_module_node(module, idx, graph));
+                self.format_module_node(out, module, idx, &index)?;
             }
-            output.push_str("\n---\n\n");
+            out.write_all(b"\n---\n\n")?;
         }
 
         if !classes.is_empty() {
-            output.push_str("## Classes\n\n");
+            out.write_all(b"## Classes\n\n")?;
             for (idx, class) in classes {
-                output.push_str(&self.format_class_node(class, idx, graph));
+                self.format_class_node(out, class, idx, &index)?;
             }
-            output.push_str("\n---\n\n");
+            out.write_all(b"\n---\n\n")?;
         }
 
         if !interfaces.is_empty() {
-            output.push_str("## Interfaces\n\n");
+            out.write_all(b"## Interfaces\n\n")?;
             for (idx, interface) in interfaces {
-                output.push_str(&self.format_interface_node(interface, idx, graph));
+                self.format_interface_node(out, interface, idx, &index)?;
             }
-            output.push_str("\n---\n\n");
+            out.write_all(b"\n---\n\n")?;
         }
 
         if !functions.is_empty() {
-            output.push_str("## Functions\n\n");
+            out.write_all(b"## Functions\n\n")?;
             for (idx, function) in functions {
-                output.push_str(&self.format_function_node(function, idx, graph));
+                self.format_function_node(out, function, idx, &index)?;
             }
-            output.push_str("\n---\n\n");
+            out.write_all(b"\n---\n\n")?;
         }
 
         if !variables.is_empty() {
-            output.push_str("## Variables\n\n");
+            out.write_all(b"## Variables\n\n")?;
             for (idx, variable) in variables {
-                output.push_str(&self.format_variable_node(variable, idx, graph));
+                self.format_variable_node(out, variable, idx, &index)?;
             }
-            output.push_str("\n---\n\n");
+            out.write_all(b"\n---\n\n")?;
         }
 
-        output.push_str("## Dependency Graph Summary\n\n");
-        output.push_str("### Edge Types\n\n");
+        out.write_all(b"## Dependency Graph Summary\n\n")?;
+        out.write_all(b"### Edge Types\n\n")?;
 
         let mut edge_counts = HashMap::new();
         for edge_ref in graph.edge_references() {
@@ -109,207 +262,168 @@ impl EmbargoFormatter {
         }
 
         for (edge_type, count) in edge_counts {
-            output.push_str(&format!("- **{}**: {} connections\n", edge_type, count));
+            writeln!(out, "- **{}**: {} connections", edge_type, count)?;
         }
 
-        output.push_str("\n### Dependency Analysis\n\n");
-        output.push_str(
-            "This dependency graph represents the relationships between code elements:\n\n",
-        );
-        output.push_str("- **Import**: Module import relationships\n");
-        output.push_str("- **Call**: Function call relationships\n");
-        output.push_str("- **Inheritance**: Class inheritance relationships\n");
-        output.push_str("- **Implements**: Interface implementation relationships\n");
-        output.push_str("- **Uses**: General usage relationships\n");
-        output.push_str("- **Contains**: Containment relationships (class contains method)\n\n");
-
-        output.push_str("---\n\n");
-        output.push_str("*Generated by embargo - Optimize for LLM consumption and agentic software development*\n");
-
-        Ok(output)
+        out.write_all(b"\n### Dependency Analysis\n\n")?;
+        out.write_all(
+            b"This dependency graph represents the relationships between code elements:\n\n",
+        )?;
+        out.write_all(b"- **Import**: Module import relationships\n")?;
+        out.write_all(b"- **Call**: Function call relationships\n")?;
+        out.write_all(b"- **Inheritance**: Class inheritance relationships\n")?;
+        out.write_all(b"- **Implements**: Interface implementation relationships\n")?;
+        out.write_all(b"- **Uses**: General usage relationships\n")?;
+        out.write_all(b"- **Contains**: Containment relationships (class contains method)\n\n")?;
+
+        out.write_all(b"---\n\n")?;
+        out.write_all(b"*Generated by embargo - Optimize for LLM consumption and agentic software development*\n")?;
+
+        Ok(())
     }
 
-    fn format_module_node(&self, node: &Node, idx: NodeIndex, graph: &DependencyGraph) -> String {
-        let mut output = String::new();
-        output.push_str(&format!("### {}\n\n", node.name));
-        output.push_str(&format!("- **ID**: `{}`\n", node.id));
-        output.push_str(&format!("- **File**: `{}`\n", node.file_path.display()));
-        output.push_str(&format!("- **Line**: {}\n", node.line_number));
-        output.push_str(&format!("- **Language**: {}\n", node.language));
-
-        let dependencies = self.get_outgoing_edges(idx, graph);
-        if !dependencies.is_empty() {
-            output.push_str("\n**Dependencies**:\n");
-            for (edge, target) in dependencies {
-                output.push_str(&format!("- {:?}: `{}`\n", edge.edge_type, target.name));
+    fn format_module_node<W: Write>(
+        &self,
+        out: &mut W,
+        node: &Node,
+        idx: NodeIndex,
+        index: &GraphIndex,
+    ) -> io::Result<()> {
+        writeln!(out, "### {}\n", node.name)?;
+        writeln!(out, "- **ID**: `{}`", node.id)?;
+        writeln!(out, "- **File**: `{}`", node.file_path.display())?;
+        writeln!(out, "- **Line**: {}", node.line_number)?;
+        writeln!(out, "- **Language**: {}", node.language)?;
+
+        if index.out_degree(idx) > 0 {
+            out.write_all(b"\n**Dependencies**:\n")?;
+            for (edge, target) in index.outgoing(idx) {
+                writeln!(out, "- {:?}: `{}`", edge.edge_type, target.name)?;
             }
         }
 
-        output.push_str("\n");
-        output
+        writeln!(out)?;
+        Ok(())
     }
 
-    fn format_class_node(&self, node: &Node, idx: NodeIndex, graph: &DependencyGraph) -> String {
-        let mut output = String::new();
-        output.push_str(&format!("### {}\n\n", node.name));
-        output.push_str(&format!("- **ID**: `{}`\n", node.id));
-        output.push_str(&format!("- **File**: `{}`\n", node.file_path.display()));
-        output.push_str(&format!("- **Line**: {}\n", node.line_number));
-        output.push_str(&format!("- **Language**: {}\n", node.language));
+    fn format_class_node<W: Write>(
+        &self,
+        out: &mut W,
+        node: &Node,
+        idx: NodeIndex,
+        index: &GraphIndex,
+    ) -> io::Result<()> {
+        writeln!(out, "### {}\n", node.name)?;
+        writeln!(out, "- **ID**: `{}`", node.id)?;
+        writeln!(out, "- **File**: `{}`", node.file_path.display())?;
+        writeln!(out, "- **Line**: {}", node.line_number)?;
+        writeln!(out, "- **Language**: {}", node.language)?;
 
         if let Some(ref visibility) = node.visibility {
-            output.push_str(&format!("- **Visibility**: {}\n", visibility));
+            writeln!(out, "- **Visibility**: {}", visibility)?;
         }
 
         if let Some(ref docstring) = node.docstring {
-            output.push_str(&format!(
-                "- **Documentation**:\n  ```\n  {}\n  ```\n",
-                docstring
-            ));
+            writeln!(out, "- **Documentation**:\n  ```\n  {}\n  ```", docstring)?;
         }
 
-        let outgoing = self.get_outgoing_edges(idx, graph);
-        let incoming = self.get_incoming_edges(idx, graph);
-
-        if !outgoing.is_empty() {
-            output.push_str("\n**Extends/Implements**:\n");
-            for (edge, target) in outgoing {
-                output.push_str(&format!("- {:?}: `{}`\n", edge.edge_type, target.name));
+        if index.out_degree(idx) > 0 {
+            out.write_all(b"\n**Extends/Implements**:\n")?;
+            for (edge, target) in index.outgoing(idx) {
+                writeln!(out, "- {:?}: `{}`", edge.edge_type, target.name)?;
             }
         }
 
-        if !incoming.is_empty() {
-            output.push_str("\n**Contains**:\n");
-            for (edge, source) in incoming {
-                if matches!(edge.edge_type, EdgeType::Contains) {
-                    output.push_str(&format!(
-                        "- {}: `{}`\n",
-                        source.node_type.format(),
-                        source.name
-                    ));
-                }
+        if index.in_degree(idx) > 0 {
+            out.write_all(b"\n**Contains**:\n")?;
+            for (_, source) in index.incoming_of(idx, EdgeType::Contains) {
+                writeln!(out, "- {}: `{}`", source.node_type.format(), source.name)?;
             }
         }
 
-        output.push_str("\n");
-        output
+        writeln!(out)?;
+        Ok(())
     }
 
-    fn format_interface_node(
+    fn format_interface_node<W: Write>(
         &self,
+        out: &mut W,
         node: &Node,
         idx: NodeIndex,
-        graph: &DependencyGraph,
-    ) -> String {
-        let mut output = String::new();
-        output.push_str(&format!("### {}\n\n", node.name));
-        output.push_str(&format!("- **ID**: `{}`\n", node.id));
-        output.push_str(&format!("- **File**: `{}`\n", node.file_path.display()));
-        output.push_str(&format!("- **Line**: {}\n", node.line_number));
-        output.push_str(&format!("- **Language**: {}\n", node.language));
-
-        let incoming = self.get_incoming_edges(idx, graph);
-        if !incoming.is_empty() {
-            output.push_str("\n**Implemented by**:\n");
-            for (edge, source) in incoming {
-                if matches!(edge.edge_type, EdgeType::Implements) {
-                    output.push_str(&format!("- `{}`\n", source.name));
-                }
+        index: &GraphIndex,
+    ) -> io::Result<()> {
+        writeln!(out, "### {}\n", node.name)?;
+        writeln!(out, "- **ID**: `{}`", node.id)?;
+        writeln!(out, "- **File**: `{}`", node.file_path.display())?;
+        writeln!(out, "- **Line**: {}", node.line_number)?;
+        writeln!(out, "- **Language**: {}", node.language)?;
+
+        if index.in_degree(idx) > 0 {
+            out.write_all(b"\n**Implemented by**:\n")?;
+            for (_, source) in index.incoming_of(idx, EdgeType::Implements) {
+                writeln!(out, "- `{}`", source.name)?;
             }
         }
 
-        output.push_str("\n");
-        output
+        writeln!(out)?;
+        Ok(())
     }
 
-    fn format_function_node(&self, node: &Node, idx: NodeIndex, graph: &DependencyGraph) -> String {
-        let mut output = String::new();
-        output.push_str(&format!("### {}\n\n", node.name));
-        output.push_str(&format!("- **ID**: `{}`\n", node.id));
-        output.push_str(&format!("- **File**: `{}`\n", node.file_path.display()));
-        output.push_str(&format!("- **Line**: {}\n", node.line_number));
-        output.push_str(&format!("- **Language**: {}\n", node.language));
+    fn format_function_node<W: Write>(
+        &self,
+        out: &mut W,
+        node: &Node,
+        idx: NodeIndex,
+        index: &GraphIndex,
+    ) -> io::Result<()> {
+        writeln!(out, "### {}\n", node.name)?;
+        writeln!(out, "- **ID**: `{}`", node.id)?;
+        writeln!(out, "- **File**: `{}`", node.file_path.display())?;
+        writeln!(out, "- **Line**: {}", node.line_number)?;
+        writeln!(out, "- **Language**: {}", node.language)?;
 
         if let Some(ref signature) = node.signature {
-            output.push_str(&format!("- **Signature**: `{}`\n", signature));
+            writeln!(out, "- **Signature**: `{}`", signature)?;
         }
 
         if let Some(ref visibility) = node.visibility {
-            output.push_str(&format!("- **Visibility**: {}\n", visibility));
+            writeln!(out, "- **Visibility**: {}", visibility)?;
         }
 
         if let Some(ref docstring) = node.docstring {
-            output.push_str(&format!(
-                "- **Documentation**:\n  ```\n  {}\n  ```\n",
-                docstring
-            ));
+            writeln!(out, "- **Documentation**:\n  ```\n  {}\n  ```", docstring)?;
         }
 
-        let outgoing = self.get_outgoing_edges(idx, graph);
-        if !outgoing.is_empty() {
-            output.push_str("\n**Calls**:\n");
-            for (edge, target) in outgoing {
-                if matches!(edge.edge_type, EdgeType::Call) {
-                    output.push_str(&format!("- `{}`\n", target.name));
-                }
+        if index.out_degree(idx) > 0 {
+            out.write_all(b"\n**Calls**:\n")?;
+            for (_, target) in index.outgoing_of(idx, EdgeType::Call) {
+                writeln!(out, "- `{}`", target.name)?;
             }
         }
 
-        output.push_str("\n");
-        output
+        writeln!(out)?;
+        Ok(())
     }
 
-    fn format_variable_node(
+    fn format_variable_node<W: Write>(
         &self,
+        out: &mut W,
         node: &Node,
         _idx: NodeIndex,
-        _graph: &DependencyGraph,
-    ) -> String {
-        let mut output = String::new();
-        output.push_str(&format!("### {}\n\n", node.name));
-        output.push_str(&format!("- **ID**: `{}`\n", node.id));
-        output.push_str(&format!("- **File**: `{}`\n", node.file_path.display()));
-        output.push_str(&format!("- **Line**: {}\n", node.line_number));
-        output.push_str(&format!("- **Language**: {}\n", node.language));
+        _index: &GraphIndex,
+    ) -> io::Result<()> {
+        writeln!(out, "### {}\n", node.name)?;
+        writeln!(out, "- **ID**: `{}`", node.id)?;
+        writeln!(out, "- **File**: `{}`", node.file_path.display())?;
+        writeln!(out, "- **Line**: {}", node.line_number)?;
+        writeln!(out, "- **Language**: {}", node.language)?;
 
         if let Some(ref visibility) = node.visibility {
-            output.push_str(&format!("- **Visibility**: {}\n", visibility));
-        }
-
-        output.push_str("\n");
-        output
-    }
-
-    fn get_outgoing_edges<'a>(
-        &self,
-        node_idx: NodeIndex,
-        graph: &'a DependencyGraph,
-    ) -> Vec<(&'a Edge, &'a Node)> {
-        let mut edges = Vec::new();
-        for edge_ref in graph.edges(node_idx) {
-            let target_idx = edge_ref.target();
-            let edge_weight = edge_ref.weight();
-            if let Some(target_node) = graph.node_weight(target_idx) {
-                edges.push((edge_weight, target_node));
-            }
+            writeln!(out, "- **Visibility**: {}", visibility)?;
         }
-        edges
-    }
 
-    fn get_incoming_edges<'a>(
-        &self,
-        node_idx: NodeIndex,
-        graph: &'a DependencyGraph,
-    ) -> Vec<(&'a Edge, &'a Node)> {
-        let mut edges = Vec::new();
-        for edge_ref in graph.edges_directed(node_idx, petgraph::Direction::Incoming) {
-            let source_idx = edge_ref.source();
-            let edge_weight = edge_ref.weight();
-            if let Some(source_node) = graph.node_weight(source_idx) {
-                edges.push((edge_weight, source_node));
-            }
-        }
-        edges
+        writeln!(out)?;
+        Ok(())
     }
 }
 
@@ -0,0 +1,37 @@
+//! Token accounting for size-bounded output.
+
+/// Rough token count of `text`: about four bytes per token for code and identifiers
+pub fn estimate_tokens(text: &str) -> usize {
+    text.len().div_ceil(4)
+}
+
+/// Tokens left of a fixed output budget
+#[derive(Debug, Clone, Copy)]
+pub struct TokenBudget {
+    limit: usize,
+    used: usize,
+}
+
+impl TokenBudget {
+    pub fn new(limit: usize) -> Self {
+        Self { limit, used: 0 }
+    }
+
+    /// Charges `tokens` unconditionally, for output that is always written
+    pub fn spend(&mut self, tokens: usize) {
+        self.used += tokens;
+    }
+
+    /// Charges `tokens` only if they fit in what is left
+    pub fn try_spend(&mut self, tokens: usize) -> bool {
+        if tokens > self.remaining() {
+            return false;
+        }
+        self.used += tokens;
+        true
+    }
+
+    pub fn remaining(&self) -> usize {
+        self.limit.saturating_sub(self.used)
+    }
+}
@@ -10,6 +10,7 @@
 //! - **LLM-Optimized**: Compact format with semantic clustering and behavioral notation
 //! - **Markdown**: Traditional readable format with full details
 //! - **JSON-Compact**: Minimal token format for programmatic consumption
+//! - **Binary**: Memory-mappable graph snapshot, reloadable with `GraphSnapshot`
 //!
 //! ## Supported Languages
 //!
@@ -1,13 +1,17 @@
-use anyhow::Result;
+use anyhow::{Context, Result};
 use clap::{Parser, ValueEnum};
-use std::path::PathBuf;
-use std::time::Instant;
+use std::io::{BufWriter, Write};
+use std::path::{Path, PathBuf};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
 
 mod core;
 mod formatters;
 mod parsers;
 
-use crate::core::CodebaseAnalyzer;
+use crate::core::{CodebaseAnalyzer, DependencyGraph, Profiler};
+use crate::parsers::cache::CacheValidation;
+use crate::parsers::limits::ParseLimits;
 
 #[derive(Debug, Clone, Parser)]
 #[command(
@@ -18,10 +22,15 @@ use crate::core::CodebaseAnalyzer;
 )]
 struct Cli {
     /// Input directory to analyze
-    #[arg(short, long, value_name = "PATH")]
-    input: PathBuf,
+    #[arg(
+        short,
+        long,
+        value_name = "PATH",
+        required_unless_present_any = ["from_snapshot", "merge"]
+    )]
+    input: Option<PathBuf>,
 
-    /// Output file path
+    /// Output file path, or - for stdout
     #[arg(short, long, value_name = "FILE", default_value = "EMBARGO.md")]
     output: PathBuf,
 
@@ -35,13 +44,128 @@ struct Cli {
     )]
     languages: Vec<String>,
 
-    /// Output format: markdown, llm-optimized, json-compact
+    /// Output format: markdown, llm-optimized, json-compact, binary
     #[arg(short, long, value_name = "FORMAT", value_enum, default_value_t = OutputFormat::LlmOptimized)]
     format: OutputFormat,
 
     /// Output verbosity for llm-optimized format: compact, standard, verbose
     #[arg(long, value_name = "LEVEL", value_enum, default_value_t = Verbosity::Standard)]
     verbosity: Verbosity,
+
+    /// Bound llm-optimized output to about N tokens, keeping the most connected files
+    #[arg(long, value_name = "N")]
+    max_tokens: Option<usize>,
+
+    /// Render only the neighborhood of these files or symbols (path, name or Type::name)
+    #[arg(long, value_name = "PATH|SYMBOL", value_delimiter = ',')]
+    focus: Vec<String>,
+
+    /// Call and import edges walked out from the --focus targets
+    #[arg(long, value_name = "K", default_value_t = 2)]
+    depth: usize,
+
+    /// Maximum number of worker threads (defaults to all cores)
+    #[arg(short, long, value_name = "N")]
+    jobs: Option<usize>,
+
+    /// Directory holding the parse cache pack (defaults to $TMP/embargo_cache)
+    #[arg(long, value_name = "DIR")]
+    cache_dir: Option<PathBuf>,
+
+    /// How cached parses are validated: mtime, content-hash
+    #[arg(long, value_name = "MODE", value_enum, default_value_t = CacheMode::Mtime)]
+    cache_validation: CacheMode,
+
+    /// Memory budget of the in-process parse cache, in MiB
+    #[arg(long, value_name = "MIB", default_value_t = 256)]
+    cache_memory_mb: usize,
+
+    /// Maximum number of files held in the in-process parse cache
+    #[arg(long, value_name = "N")]
+    cache_max_entries: Option<usize>,
+
+    /// Files larger than this are outlined (declarations only, no call sites), in KiB
+    #[arg(long, value_name = "KIB", default_value_t = 2048)]
+    max_file_kb: u64,
+
+    /// Files with more lines than this are outlined
+    #[arg(long, value_name = "N", default_value_t = 50_000)]
+    max_file_lines: usize,
+
+    /// Give up on outlining a file after this many milliseconds (0 = no timeout)
+    #[arg(long, value_name = "MS", default_value_t = 2000)]
+    outline_timeout_ms: u64,
+
+    /// Parse minified and generated files in full unless they exceed the size limits
+    #[arg(long)]
+    parse_generated: bool,
+
+    /// Parse every file in full, however large
+    #[arg(long, conflicts_with_all = ["max_file_kb", "max_file_lines", "parse_generated"])]
+    no_parse_limits: bool,
+
+    /// Only create call edges for exact name matches (no typo-tolerant fallback)
+    #[arg(long)]
+    no_fuzzy: bool,
+
+    /// Don't link HTTP client calls to the routes other files and languages serve
+    #[arg(long)]
+    no_cross_language: bool,
+
+    /// Reuse the previous run's graph and only redo work for changed files
+    #[arg(long)]
+    incremental: bool,
+
+    /// File listing changed, added or deleted paths, one per line ("-" for stdin); implies --incremental
+    #[arg(long, value_name = "FILE")]
+    changed_files: Option<PathBuf>,
+
+    /// Take the changed paths from `git diff` against REV plus untracked files; implies --incremental
+    #[arg(long, value_name = "REV", conflicts_with = "changed_files")]
+    git_diff: Option<String>,
+
+    /// Stay resident and regenerate the output whenever source files change
+    #[arg(long)]
+    watch: bool,
+
+    /// Load the graph from a binary snapshot instead of analyzing sources
+    #[arg(
+        long,
+        value_name = "FILE",
+        conflicts_with_all = ["input", "incremental", "changed_files", "git_diff", "watch"]
+    )]
+    from_snapshot: Option<PathBuf>,
+
+    /// Analyze the input as one shard of a larger tree and write its partial graph to FILE
+    #[arg(
+        long,
+        value_name = "FILE",
+        conflicts_with_all = ["incremental", "changed_files", "git_diff", "watch", "from_snapshot"]
+    )]
+    shard: Option<PathBuf>,
+
+    /// Merge shards written by --shard, resolve calls across them and write the usual output
+    #[arg(
+        long,
+        value_name = "SHARD",
+        num_args = 1..,
+        conflicts_with_all = [
+            "input", "shard", "incremental", "changed_files", "git_diff", "watch", "from_snapshot"
+        ]
+    )]
+    merge: Vec<PathBuf>,
+
+    /// Report per-phase timings and counters when the run ends: json
+    #[arg(long, value_name = "FORMAT", value_enum, conflicts_with = "watch")]
+    stats: Option<StatsFormat>,
+
+    /// Write the --stats report to FILE instead of stderr
+    #[arg(long, value_name = "FILE", requires = "stats")]
+    stats_output: Option<PathBuf>,
+
+    /// Write a Chrome trace of every phase to FILE (open in chrome://tracing or Perfetto)
+    #[arg(long, value_name = "FILE", conflicts_with = "watch")]
+    trace: Option<PathBuf>,
 }
 
 #[derive(Debug, Copy, Clone, Eq, PartialEq, ValueEnum)]
@@ -50,6 +174,7 @@ enum OutputFormat {
     Markdown,
     LlmOptimized,
     JsonCompact,
+    Binary,
 }
 
 /// Output verbosity level for llm-optimized format.
@@ -65,12 +190,42 @@ enum Verbosity {
     Verbose,
 }
 
+/// How the graph is rendered.
+#[derive(Debug, Clone)]
+struct OutputOptions {
+    format: OutputFormat,
+    verbosity: Verbosity,
+    max_tokens: Option<usize>,
+    /// Targets whose neighborhood is rendered instead of the whole graph
+    focus: Vec<String>,
+    depth: usize,
+}
+
+/// Parse cache validation strategy.
+#[derive(Debug, Copy, Clone, Eq, PartialEq, ValueEnum, Default)]
+#[value(rename_all = "kebab-case")]
+enum CacheMode {
+    /// Modification time and size (default)
+    #[default]
+    Mtime,
+    /// Hash file contents when the mtime changed, surviving checkouts and touches
+    ContentHash,
+}
+
+/// Report format of `--stats`.
+#[derive(Debug, Copy, Clone, Eq, PartialEq, ValueEnum)]
+#[value(rename_all = "kebab-case")]
+enum StatsFormat {
+    Json,
+}
+
 impl OutputFormat {
     fn as_str(self) -> &'static str {
         match self {
             OutputFormat::Markdown => "markdown",
             OutputFormat::LlmOptimized => "llm-optimized",
             OutputFormat::JsonCompact => "json-compact",
+            OutputFormat::Binary => "binary",
         }
     }
 }
@@ -87,9 +242,46 @@ fn run(cli: Cli) -> Result<()> {
         languages,
         format,
         verbosity,
+        max_tokens,
+        focus,
+        depth,
+        jobs,
+        cache_dir,
+        cache_validation,
+        cache_memory_mb,
+        cache_max_entries,
+        max_file_kb,
+        max_file_lines,
+        outline_timeout_ms,
+        parse_generated,
+        no_parse_limits,
+        no_fuzzy,
+        no_cross_language,
+        incremental,
+        changed_files,
+        git_diff,
+        watch,
+        from_snapshot,
+        shard,
+        merge,
+        stats,
+        stats_output,
+        trace,
     } = cli;
 
+    if max_tokens.is_some() && format != OutputFormat::LlmOptimized {
+        eprintln!("Warning: --max-tokens only applies to the llm-optimized format");
+    }
+    let options = OutputOptions {
+        format,
+        verbosity,
+        max_tokens,
+        focus,
+        depth,
+    };
+
     let start_time = Instant::now();
+    let profiler = (stats.is_some() || trace.is_some()).then(|| Arc::new(Profiler::new()));
 
     let normalized_languages: Vec<String> = languages
         .into_iter()
@@ -98,71 +290,360 @@ fn run(cli: Cli) -> Result<()> {
         .collect();
     let language_refs: Vec<&str> = normalized_languages.iter().map(String::as_str).collect();
 
-    println!("EMBARGO - Ultrafast Codebase Analysis");
-    println!("Input: {} (targeting <1s)", input.display());
-    println!("Output: {}", output.display());
-    println!("Format: {}", format.as_str());
-    println!("Languages: {:?}", normalized_languages);
+    if let Some(snapshot) = from_snapshot {
+        eprintln!("EMBARGO - Snapshot Conversion");
+        eprintln!("Snapshot: {}", snapshot.display());
+        eprintln!("Output: {}", output.display());
+        eprintln!("Format: {}", format.as_str());
+        let graph = {
+            let _span = profiler.as_deref().map(|p| p.span("snapshot_load"));
+            crate::formatters::GraphSnapshot::open(&snapshot)?.to_graph()?
+        };
+        let generated_output = {
+            let _span = profiler
+                .as_deref()
+                .map(|p| p.span_with("format", format.as_str()));
+            write_output(&graph, &options, &language_refs, &output)?
+        };
+        eprintln!(
+            "Converted {} nodes and {} edges into {} in {:.2}s",
+            graph.node_count(),
+            graph.edge_count(),
+            generated_output.display(),
+            start_time.elapsed().as_secs_f64()
+        );
+        if let Some(profiler) = &profiler {
+            write_profile(profiler, stats, stats_output.as_deref(), trace.as_deref())?;
+        }
+        return Ok(());
+    }
+    let input = input.unwrap_or_default();
+
+    eprintln!("EMBARGO - Ultrafast Codebase Analysis");
+    if merge.is_empty() {
+        eprintln!("Input: {} (targeting <1s)", input.display());
+    } else {
+        eprintln!("Shards: {}", merge.len());
+    }
+    eprintln!("Output: {}", output.display());
+    eprintln!("Format: {}", format.as_str());
+    eprintln!("Languages: {:?}", normalized_languages);
 
     let analysis_start = Instant::now();
 
-    let mut analyzer = CodebaseAnalyzer::new();
-    let dependency_graph = analyzer.analyze(&input, &language_refs)?;
+    let cache_validation = match cache_validation {
+        CacheMode::Mtime => CacheValidation::Metadata,
+        CacheMode::ContentHash => CacheValidation::ContentHash,
+    };
+    let parse_limits = if no_parse_limits {
+        ParseLimits::unlimited()
+    } else {
+        ParseLimits {
+            max_bytes: max_file_kb.saturating_mul(1024),
+            max_lines: max_file_lines,
+            detect_generated: !parse_generated,
+            outline_timeout: Duration::from_millis(outline_timeout_ms),
+        }
+    };
+    let mut analyzer = CodebaseAnalyzer::new()
+        .with_jobs(jobs)
+        .with_cache_options(cache_dir, cache_validation)
+        .with_cache_limits(
+            cache_memory_mb.saturating_mul(1024 * 1024),
+            cache_max_entries,
+        )
+        .with_parse_limits(parse_limits)
+        .with_fuzzy_matching(!no_fuzzy)
+        .with_cross_language(!no_cross_language);
+    if let Some(profiler) = &profiler {
+        analyzer = analyzer.with_profiler(Arc::clone(profiler));
+    }
+    let changed_paths = match (&changed_files, &git_diff) {
+        (Some(list), _) => Some(read_path_list(list)?),
+        (None, Some(rev)) => Some(crate::core::incremental::git_changed_paths(&input, rev)?),
+        (None, None) => None,
+    };
+    if watch {
+        return watch_and_regenerate(
+            &analyzer,
+            &input,
+            &language_refs,
+            changed_paths.as_deref(),
+            &output,
+            &options,
+        );
+    }
+    if let Some(shard_path) = shard {
+        let graph_shard = analyzer.analyze_shard(&input, &language_refs)?;
+        {
+            let _span = profiler.as_deref().map(|p| p.span("shard_write"));
+            graph_shard.save(&shard_path)?;
+        }
+        eprintln!(
+            "Shard written to {} in {:.2}s",
+            shard_path.display(),
+            start_time.elapsed().as_secs_f64()
+        );
+        if let Some(profiler) = &profiler {
+            write_profile(profiler, stats, stats_output.as_deref(), trace.as_deref())?;
+        }
+        return Ok(());
+    }
+    let dependency_graph = if !merge.is_empty() {
+        analyzer.merge_shards(&merge)?
+    } else if incremental || changed_paths.is_some() {
+        analyzer.analyze_incremental(&input, &language_refs, changed_paths.as_deref())?
+    } else {
+        analyzer.analyze(&input, &language_refs)?
+    };
 
     let analysis_time = analysis_start.elapsed();
-    println!(
-        "Analysis completed in {:.2}s",
-        analysis_time.as_secs_f64()
+    eprintln!("Analysis completed in {:.2}s", analysis_time.as_secs_f64());
+
+    let generated_output = {
+        let _span = profiler
+            .as_deref()
+            .map(|p| p.span_with("format", format.as_str()));
+        write_output(&dependency_graph, &options, &language_refs, &output)?
+    };
+
+    let total_time = start_time.elapsed();
+    eprintln!(
+        "Analysis complete. Generated {}",
+        generated_output.display()
     );
+    eprintln!("Total execution time: {:.2}s", total_time.as_secs_f64());
+
+    if total_time.as_secs_f64() < 1.0 {
+        eprintln!("Sub-1 second execution achieved.");
+    } else {
+        eprintln!(
+            "Execution time: {:.2}s (optimizations in progress)",
+            total_time.as_secs_f64()
+        );
+    }
+
+    if let Some(profiler) = &profiler {
+        write_profile(profiler, stats, stats_output.as_deref(), trace.as_deref())?;
+    }
+
+    Ok(())
+}
+
+/// Writes the `--stats` report and the `--trace` file requested on the command line
+fn write_profile(
+    profiler: &Profiler,
+    stats: Option<StatsFormat>,
+    stats_output: Option<&Path>,
+    trace: Option<&Path>,
+) -> Result<()> {
+    if let Some(StatsFormat::Json) = stats {
+        match stats_output {
+            Some(path) => {
+                let file = std::fs::File::create(path)
+                    .with_context(|| format!("failed to create {}", path.display()))?;
+                let mut out = BufWriter::new(file);
+                profiler.write_stats_json(&mut out)?;
+                out.flush()?;
+            }
+            None => profiler.write_stats_json(&mut std::io::stderr().lock())?,
+        }
+    }
+    if let Some(path) = trace {
+        let file = std::fs::File::create(path)
+            .with_context(|| format!("failed to create {}", path.display()))?;
+        let mut out = BufWriter::new(file);
+        profiler.write_chrome_trace(&mut out)?;
+        out.flush()?;
+        eprintln!("Trace: {}", path.display());
+    }
+    Ok(())
+}
+
+/// Reads one path per line from `list`, or from stdin when it is `-`
+fn read_path_list(list: &Path) -> Result<Vec<PathBuf>> {
+    let contents = if list == Path::new("-") {
+        let mut buffer = String::new();
+        std::io::Read::read_to_string(&mut std::io::stdin(), &mut buffer)?;
+        buffer
+    } else {
+        std::fs::read_to_string(list)
+            .with_context(|| format!("failed to read {}", list.display()))?
+    };
+    Ok(contents
+        .lines()
+        .map(str::trim)
+        .filter(|line| !line.is_empty())
+        .map(PathBuf::from)
+        .collect())
+}
+
+/// `--output` value that streams to stdout instead of a file
+const STDOUT_OUTPUT: &str = "-";
 
-    let mut generated_output = output.clone();
+/// Renders `graph` in `format` and returns the file written
+fn write_output(
+    graph: &DependencyGraph,
+    options: &OutputOptions,
+    language_refs: &[&str],
+    output: &Path,
+) -> Result<PathBuf> {
+    use crate::formatters::{BinaryFormatter, EmbargoFormatter, JsonCompactFormatter};
 
-    match format {
+    let focused;
+    let graph = if options.focus.is_empty() {
+        graph
+    } else {
+        let summary;
+        (focused, summary) = crate::core::focus::focus(graph, &options.focus, options.depth)?;
+        for target in &summary.unmatched {
+            eprintln!("Warning: --focus {target} matched no file or symbol");
+        }
+        eprintln!(
+            "Focused on {} of {} nodes ({} named, depth {})",
+            summary.nodes,
+            graph.node_count(),
+            summary.seeds,
+            options.depth
+        );
+        &focused
+    };
+
+    if output == Path::new(STDOUT_OUTPUT) {
+        let stdout = std::io::stdout();
+        let mut out = BufWriter::new(stdout.lock());
+        match options.format {
+            OutputFormat::Markdown => EmbargoFormatter::new().write_to(graph, &mut out)?,
+            OutputFormat::LlmOptimized => {
+                llm_formatter(options, language_refs).write_to(graph, &mut out)?
+            }
+            OutputFormat::JsonCompact => JsonCompactFormatter::new().write_to(graph, &mut out)?,
+            OutputFormat::Binary => BinaryFormatter::new().write_to(graph, &mut out)?,
+        }
+        out.flush()?;
+        return Ok(output.to_path_buf());
+    }
+
+    let mut generated_output = output.to_path_buf();
+    match options.format {
         OutputFormat::Markdown => {
-            use crate::formatters::EmbargoFormatter;
-            EmbargoFormatter::new().format_to_file(&dependency_graph, &output)?;
+            EmbargoFormatter::new().format_to_file(graph, output)?;
         }
         OutputFormat::LlmOptimized => {
-            use crate::formatters::{LLMOptimizedFormatter, OutputVerbosity};
-            let output_verbosity = match verbosity {
-                Verbosity::Compact => OutputVerbosity::Compact,
-                Verbosity::Standard => OutputVerbosity::Standard,
-                Verbosity::Verbose => OutputVerbosity::Verbose,
-            };
-            let formatter = if language_refs.iter().any(|lang| *lang == "python") {
-                LLMOptimizedFormatter::for_python()
-            } else {
-                LLMOptimizedFormatter::new()
-            }
-            .with_verbosity(output_verbosity)
-            .with_hierarchical(true)
-            .with_compressed_ids(true);
-            formatter.format_to_file(&dependency_graph, &output)?;
+            llm_formatter(options, language_refs).format_to_file(graph, output)?;
         }
         OutputFormat::JsonCompact => {
-            use crate::formatters::JsonCompactFormatter;
             let formatter = JsonCompactFormatter::new();
             generated_output = output.with_extension("json");
-            formatter.format_to_file(&dependency_graph, &generated_output)?;
-            println!("JSON output: {}", generated_output.display());
+            formatter.format_to_file(graph, &generated_output)?;
+            eprintln!("JSON output: {}", generated_output.display());
+        }
+        OutputFormat::Binary => {
+            generated_output = output.with_extension("bin");
+            BinaryFormatter::new().format_to_file(graph, &generated_output)?;
+            eprintln!("Binary snapshot: {}", generated_output.display());
         }
     }
 
-    let total_time = start_time.elapsed();
-    println!(
-        "Analysis complete. Generated {}",
-        generated_output.display()
-    );
-    println!("Total execution time: {:.2}s", total_time.as_secs_f64());
+    Ok(generated_output)
+}
 
-    if total_time.as_secs_f64() < 1.0 {
-        println!("Sub-1 second execution achieved.");
+fn llm_formatter(
+    options: &OutputOptions,
+    language_refs: &[&str],
+) -> crate::formatters::LLMOptimizedFormatter {
+    use crate::formatters::{LLMOptimizedFormatter, OutputVerbosity};
+    let output_verbosity = match options.verbosity {
+        Verbosity::Compact => OutputVerbosity::Compact,
+        Verbosity::Standard => OutputVerbosity::Standard,
+        Verbosity::Verbose => OutputVerbosity::Verbose,
+    };
+    let formatter = if language_refs.iter().any(|lang| *lang == "python") {
+        LLMOptimizedFormatter::for_python()
     } else {
-        println!(
-            "Execution time: {:.2}s (optimizations in progress)",
-            total_time.as_secs_f64()
+        LLMOptimizedFormatter::new()
+    };
+    formatter
+        .with_verbosity(output_verbosity)
+        .with_max_tokens(options.max_tokens)
+        .with_hierarchical(true)
+        .with_compressed_ids(true)
+}
+
+/// How often a watch session with unsaved updates writes the analysis state
+const STATE_SAVE_INTERVAL: Duration = Duration::from_secs(30);
+
+/// Keeps the analyzer, parse cache and graph resident and rewrites the output
+/// after each coalesced burst of file changes.
+///
+/// A failed update or output write is reported and the watch goes on. The
+/// state is saved at most every [`STATE_SAVE_INTERVAL`] and when the watch
+/// ends; a session killed in between loses only those updates, and the next
+/// run re-parses the affected files from the parse cache.
+fn watch_and_regenerate(
+    analyzer: &CodebaseAnalyzer,
+    input: &Path,
+    language_refs: &[&str],
+    changed: Option<&[PathBuf]>,
+    output: &Path,
+    options: &OutputOptions,
+) -> Result<()> {
+    use crate::core::watcher::{ChangeWatcher, DEFAULT_DEBOUNCE};
+
+    // Subscribe before the initial pass so edits made during it are not missed
+    let watcher = ChangeWatcher::new(input)?;
+    // Ctrl-C ends the loop below, so unsaved state is written before exiting
+    watcher.stop_on_ctrl_c();
+
+    let mut state = analyzer.open_state(input, language_refs);
+    let (graph, _) = analyzer.update_state(&mut state, input, language_refs, changed)?;
+    let generated_output = write_output(&graph, options, language_refs, output)?;
+    analyzer.save_state(&state, input, language_refs);
+    eprintln!("Watching {} for changes (Ctrl-C to stop)", input.display());
+
+    let generated = std::fs::canonicalize(&generated_output).unwrap_or(generated_output);
+    let mut unsaved_since: Option<Instant> = None;
+    while let Some(batch) = watcher.next_batch(DEFAULT_DEBOUNCE, Some(STATE_SAVE_INTERVAL)) {
+        if unsaved_since.is_some_and(|since| since.elapsed() >= STATE_SAVE_INTERVAL) {
+            analyzer.save_state(&state, input, language_refs);
+            unsaved_since = None;
+        }
+        // Our own output lands inside the watched tree as well
+        let batch: Vec<PathBuf> = batch
+            .into_iter()
+            .filter(|path| std::fs::canonicalize(path).map_or(true, |path| path != generated))
+            .collect();
+        if batch.is_empty() {
+            continue;
+        }
+
+        let update_start = Instant::now();
+        let (graph, summary) =
+            match analyzer.update_state(&mut state, input, language_refs, Some(&batch)) {
+                Ok(update) => update,
+                Err(err) => {
+                    eprintln!("Warning: Incremental update failed: {err}");
+                    continue;
+                }
+            };
+        if summary.files_changed == 0 {
+            continue;
+        }
+        unsaved_since.get_or_insert(update_start);
+
+        if let Err(err) = write_output(&graph, options, language_refs, output) {
+            eprintln!("Warning: Failed to write {}: {err}", output.display());
+            continue;
+        }
+        eprintln!(
+            "Updated {} files in {:.0}ms",
+            summary.files_changed,
+            update_start.elapsed().as_secs_f64() * 1000.0
         );
     }
 
+    if unsaved_since.is_some() {
+        analyzer.save_state(&state, input, language_refs);
+    }
     Ok(())
 }
@@ -1,39 +1,287 @@
-use anyhow::Result;
+use anyhow::{anyhow, Result};
 use dashmap::DashMap;
 use serde::{Deserialize, Serialize};
-use std::collections::hash_map::DefaultHasher;
-use std::fs;
-use std::hash::{Hash, Hasher};
+use std::borrow::Cow;
+use std::collections::{HashMap, VecDeque};
+use std::fs::{self, File, OpenOptions};
+use std::io::{BufWriter, Write};
+use std::mem::size_of;
 use std::path::{Path, PathBuf};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::Mutex;
 use std::time::UNIX_EPOCH;
+use xxhash_rust::xxh3::xxh3_64;
 
+use super::limits::{LimitReason, ParseLimits};
+use super::source::SourceBuffer;
 use super::ParseResult;
-use crate::core::{CallSite, Edge, Node};
+use crate::core::{
+    CallSite, Edge, FilePath, Language, Node, NodeExport, NodeId, NodeType, Visibility,
+};
 
-const DEFAULT_MAX_MEMORY_ENTRIES: usize = 1000;
+/// Default byte budget of the in-memory tier
+pub const DEFAULT_MAX_MEMORY_BYTES: usize = 256 * 1024 * 1024;
+const INITIAL_MEMORY_CAPACITY: usize = 1000;
+
+/// Name of the packed store inside the cache directory
+pub const PACK_FILE_NAME: &str = "parse_cache.pack";
+const PACK_MAGIC: &[u8; 8] = b"EMBPACK\0";
+const PACK_VERSION: u32 = 6;
+const PACK_HEADER_LEN: usize = PACK_MAGIC.len() + 4;
+/// Fixed part of a record: path length, timestamp, size, content hash, limits, payload length
+const RECORD_FIXED_LEN: usize = 4 + 8 + 8 + 8 + 8 + 4;
+/// Packs smaller than this are never compacted automatically
+const COMPACTION_MIN_BYTES: usize = 1 << 20;
+
+/// How a cached entry is checked against the file on disk
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Default)]
+pub enum CacheValidation {
+    /// Modification time and size; cheap, but any mtime change invalidates
+    #[default]
+    Metadata,
+    /// xxh3 hash of the file contents, consulted only when the mtime differs
+    ContentHash,
+}
 
 /// Fast cache for parsed results using file modification timestamps
-#[derive(Debug, Clone, Serialize, Deserialize)]
+#[derive(Debug, Clone)]
 pub struct ParsedFileEntry {
     pub nodes: Vec<Node>,
     pub edges: Vec<Edge>,
     pub call_sites: Option<Vec<CallSite>>,
+    pub exports: Vec<NodeExport>,
+    pub limited: Option<LimitReason>,
+    /// Modification time in nanoseconds since the epoch
     pub timestamp: u64,
     pub file_size: u64,
+    /// xxh3 of the contents, or 0 when stored in metadata mode
+    pub content_hash: u64,
+    /// [`ParseLimits::fingerprint`] of the limits the file was parsed under
+    pub limits: u64,
+}
+
+impl ParsedFileEntry {
+    fn stamp(&self) -> StoredStamp {
+        StoredStamp {
+            timestamp: self.timestamp,
+            file_size: self.file_size,
+            content_hash: self.content_hash,
+            limits: self.limits,
+        }
+    }
+
+    fn to_result(&self) -> ParseResult {
+        ParseResult {
+            nodes: self.nodes.clone(),
+            edges: self.edges.clone(),
+            call_sites: self.call_sites.clone(),
+            exports: self.exports.clone(),
+            limited: self.limited,
+        }
+    }
+
+    fn into_result(self) -> ParseResult {
+        ParseResult {
+            nodes: self.nodes,
+            edges: self.edges,
+            call_sites: self.call_sites,
+            exports: self.exports,
+            limited: self.limited,
+        }
+    }
+
+    /// Approximate heap footprint in bytes: struct sizes plus string contents.
+    ///
+    /// Interned ids and paths are shared process-wide and not charged to the entry.
+    /// Ignores allocator overhead and spare `Vec` capacity; good enough to keep
+    /// the memory tier near its budget.
+    pub fn approx_size(&self) -> usize {
+        fn opt_len(value: &Option<String>) -> usize {
+            value.as_ref().map_or(0, String::len)
+        }
+
+        let nodes: usize = self
+            .nodes
+            .iter()
+            .map(|node| {
+                let visibility = match &node.visibility {
+                    Some(Visibility::Other(modifier)) => modifier.len(),
+                    _ => 0,
+                };
+                size_of::<Node>()
+                    + node.name.len()
+                    + opt_len(&node.signature)
+                    + opt_len(&node.docstring)
+                    + visibility
+            })
+            .sum();
+        let edges: usize = self
+            .edges
+            .iter()
+            .map(|edge| size_of::<Edge>() + opt_len(&edge.context))
+            .sum();
+        let call_sites: usize = self
+            .call_sites
+            .iter()
+            .flatten()
+            .map(|site| size_of::<CallSite>() + site.called_name.len() + opt_len(&site.context))
+            .sum();
+
+        let exports: usize = self
+            .exports
+            .iter()
+            .map(|export| size_of::<NodeExport>() + export.protocol.len() + export.signature.len())
+            .sum();
+
+        size_of::<Self>() + nodes + edges + call_sites + exports
+    }
+}
+
+/// Pack payload of one entry.
+///
+/// Each path is stored once in `files` and nodes refer to it by index, and
+/// strings decode borrowed from the pack buffer. A load allocates only the
+/// strings the entry keeps and interns each of its paths once.
+#[derive(Serialize, Deserialize)]
+struct PackedEntry<'a> {
+    #[serde(borrow)]
+    files: Vec<&'a str>,
+    #[serde(borrow)]
+    nodes: Vec<PackedNode<'a>>,
+    edges: Cow<'a, [Edge]>,
+    call_sites: Option<Cow<'a, [CallSite]>>,
+    exports: Cow<'a, [NodeExport]>,
+    limited: Option<LimitReason>,
+    timestamp: u64,
+    file_size: u64,
+    content_hash: u64,
+    limits: u64,
+}
+
+#[derive(Serialize, Deserialize)]
+struct PackedNode<'a> {
+    id: NodeId,
+    name: &'a str,
+    node_type: NodeType,
+    /// Index into the entry's `files`
+    file: u32,
+    line_number: usize,
+    language: Language,
+    #[serde(borrow)]
+    signature: Option<&'a str>,
+    #[serde(borrow)]
+    docstring: Option<&'a str>,
+    visibility: Option<Visibility>,
+}
+
+impl<'a> PackedEntry<'a> {
+    /// Fails for a node whose path is not valid UTF-8
+    fn new(entry: &'a ParsedFileEntry) -> Result<Self> {
+        let mut files = Vec::new();
+        let mut file_indices: HashMap<FilePath, u32> = HashMap::new();
+        let mut nodes = Vec::with_capacity(entry.nodes.len());
+        for node in &entry.nodes {
+            let file = match file_indices.get(&node.file_path) {
+                Some(&file) => file,
+                None => {
+                    let path = node
+                        .file_path
+                        .to_str()
+                        .ok_or_else(|| anyhow!("non UTF-8 path {}", node.file_path.display()))?;
+                    files.push(path);
+                    file_indices.insert(node.file_path, files.len() as u32 - 1);
+                    files.len() as u32 - 1
+                }
+            };
+            nodes.push(PackedNode {
+                id: node.id,
+                name: &node.name,
+                node_type: node.node_type,
+                file,
+                line_number: node.line_number,
+                language: node.language,
+                signature: node.signature.as_deref(),
+                docstring: node.docstring.as_deref(),
+                visibility: node.visibility.clone(),
+            });
+        }
+        Ok(Self {
+            files,
+            nodes,
+            edges: Cow::Borrowed(&entry.edges),
+            call_sites: entry.call_sites.as_deref().map(Cow::Borrowed),
+            exports: Cow::Borrowed(&entry.exports),
+            limited: entry.limited,
+            timestamp: entry.timestamp,
+            file_size: entry.file_size,
+            content_hash: entry.content_hash,
+            limits: entry.limits,
+        })
+    }
+
+    /// `None` for a node pointing past the file table
+    fn into_entry(self) -> Option<ParsedFileEntry> {
+        let files: Vec<FilePath> = self.files.into_iter().map(FilePath::from).collect();
+        let nodes = self
+            .nodes
+            .into_iter()
+            .map(|node| {
+                Some(Node {
+                    id: node.id,
+                    name: node.name.to_string(),
+                    node_type: node.node_type,
+                    file_path: *files.get(node.file as usize)?,
+                    line_number: node.line_number,
+                    language: node.language,
+                    signature: node.signature.map(str::to_string),
+                    docstring: node.docstring.map(str::to_string),
+                    visibility: node.visibility,
+                })
+            })
+            .collect::<Option<Vec<Node>>>()?;
+        Some(ParsedFileEntry {
+            nodes,
+            edges: self.edges.into_owned(),
+            call_sites: self.call_sites.map(Cow::into_owned),
+            exports: self.exports.into_owned(),
+            limited: self.limited,
+            timestamp: self.timestamp,
+            file_size: self.file_size,
+            content_hash: self.content_hash,
+            limits: self.limits,
+        })
+    }
+}
+
+/// Outcome of [`ParseCache::lookup_or_parse`]
+pub enum CacheLookup {
+    /// Served from the memory tier or the pack
+    Hit(ParseResult),
+    /// Freshly parsed and stored
+    Parsed(ParseResult),
 }
 
 /// High-performance thread-safe cache with memory and (best-effort) disk storage
 pub struct ParseCache {
-    memory_cache: DashMap<PathBuf, ParsedFileEntry>,
-    cache_dir: Option<PathBuf>,
-    max_memory_entries: usize,
+    memory: MemoryTier,
+    pack: Option<PackStore>,
+    validation: CacheValidation,
+    /// Fingerprint of the parse limits new entries are stored and served under
+    limits: u64,
 }
 
 impl ParseCache {
+    /// Opens the cache, loading the pack file from `cache_dir` (or `$TMP/embargo_cache`).
+    ///
+    /// Entries are keyed by the path as scanned, so two checkouts of the same repo
+    /// analyzed with the same relative input path can share one cache directory.
     pub fn new(cache_dir: Option<PathBuf>) -> Result<Self> {
-        let resolved_dir = cache_dir.unwrap_or_else(|| std::env::temp_dir().join("embargo_cache"));
-        let cache_dir = match fs::create_dir_all(&resolved_dir) {
-            Ok(()) => Some(resolved_dir),
+        let resolved_dir = cache_dir.unwrap_or_else(default_cache_dir);
+        let pack = match fs::create_dir_all(&resolved_dir)
+            .map_err(anyhow::Error::from)
+            .and_then(|()| PackStore::open(&resolved_dir.join(PACK_FILE_NAME)))
+        {
+            Ok(pack) => Some(pack),
             Err(err) => {
                 eprintln!(
                     "Warning: Failed to initialize disk cache at {}: {err}",
@@ -44,173 +292,740 @@ impl ParseCache {
         };
 
         Ok(Self {
-            memory_cache: DashMap::with_capacity(DEFAULT_MAX_MEMORY_ENTRIES),
-            cache_dir,
-            max_memory_entries: DEFAULT_MAX_MEMORY_ENTRIES,
+            memory: MemoryTier::new(DEFAULT_MAX_MEMORY_BYTES, None),
+            pack,
+            validation: CacheValidation::default(),
+            limits: ParseLimits::default().fingerprint(),
         })
     }
 
     /// Build an in-memory-only cache without touching the filesystem
     pub fn in_memory_only() -> Self {
         Self {
-            memory_cache: DashMap::with_capacity(DEFAULT_MAX_MEMORY_ENTRIES),
-            cache_dir: None,
-            max_memory_entries: DEFAULT_MAX_MEMORY_ENTRIES,
+            memory: MemoryTier::new(DEFAULT_MAX_MEMORY_BYTES, None),
+            pack: None,
+            validation: CacheValidation::default(),
+            limits: ParseLimits::default().fingerprint(),
         }
     }
 
-    /// Check if file needs reparsing based on modification time and size
-    pub fn needs_update(&self, file_path: &Path) -> Result<bool> {
-        let metadata = fs::metadata(file_path)?;
-        let current_timestamp = metadata
-            .modified()?
-            .duration_since(UNIX_EPOCH)
-            .unwrap_or_default()
-            .as_secs();
-        let current_size = metadata.len();
+    /// Bounds the in-memory tier by approximate bytes and, optionally, entry count.
+    ///
+    /// Entries evicted from memory are still served from the pack when one is open.
+    pub fn with_memory_limits(mut self, max_bytes: usize, max_entries: Option<usize>) -> Self {
+        self.memory = MemoryTier::new(max_bytes, max_entries);
+        self
+    }
 
-        if let Some(entry) = self.memory_cache.get(file_path) {
-            return Ok(entry.timestamp != current_timestamp || entry.file_size != current_size);
+    /// Selects how entries are validated against the files on disk.
+    pub fn with_validation(mut self, validation: CacheValidation) -> Self {
+        self.validation = validation;
+        self
+    }
+
+    /// Only serves entries parsed under `limits`, so changing them re-parses
+    /// the files they outline differently.
+    pub fn with_parse_limits(mut self, limits: &ParseLimits) -> Self {
+        self.limits = limits.fingerprint();
+        self
+    }
+
+    /// Serves a file from the cache, or runs `parse` and caches its result.
+    ///
+    /// The file is stat'ed once; a memory hit clones the entry, a pack hit is
+    /// deserialized once and moved out, and a miss stores the fresh result with a
+    /// single copy for the memory tier. Outline parses that timed out are not
+    /// cached, since the next run may finish them. Caching failures are reported
+    /// as warnings; only `parse` errors are returned.
+    pub fn lookup_or_parse<F>(&self, file_path: &Path, parse: F) -> Result<CacheLookup>
+    where
+        F: FnOnce() -> Result<ParseResult>,
+    {
+        let stamp = match fs::metadata(file_path)
+            .map_err(anyhow::Error::from)
+            .and_then(|m| file_stamp(&m))
+        {
+            Ok(stamp) => stamp,
+            Err(_) => return parse().map(CacheLookup::Parsed),
+        };
+
+        let mut content_hash = None;
+        if let Some(result) = self.lookup(file_path, stamp, &mut content_hash) {
+            return Ok(CacheLookup::Hit(result));
         }
 
-        if let Some(cache_path) = self.cache_path(file_path) {
-            if cache_path.exists() {
-                if let Ok(entry) = self.load_from_disk(&cache_path) {
-                    return Ok(
-                        entry.timestamp != current_timestamp || entry.file_size != current_size
-                    );
-                }
+        let result = parse()?;
+        Ok(CacheLookup::Parsed(self.insert(
+            file_path,
+            stamp,
+            content_hash,
+            result,
+        )))
+    }
+
+    /// Clear all caches
+    #[allow(dead_code)]
+    pub fn clear(&self) -> Result<()> {
+        self.memory.clear();
+        if let Some(pack) = &self.pack {
+            pack.clear()?;
+        }
+        Ok(())
+    }
+
+    /// Rewrites the pack file keeping only the newest record for each path.
+    ///
+    /// Also runs automatically at startup once superseded records make up more
+    /// than half of a pack larger than 1 MiB.
+    #[allow(dead_code)]
+    pub fn compact(&mut self) -> Result<()> {
+        if let Some(pack) = &self.pack {
+            let path = pack.path.clone();
+            PackStore::compact_file(&path)?;
+            self.pack = Some(PackStore::open(&path)?);
+        }
+        Ok(())
+    }
+
+    /// Current size of both cache tiers
+    pub fn stats(&self) -> CacheStats {
+        CacheStats {
+            memory_entries: self.memory.len(),
+            memory_bytes: self.memory.bytes(),
+            disk_cache_size: self.get_disk_cache_size(),
+        }
+    }
+
+    /// Returns a valid cached result, cloned from memory or moved out of the pack.
+    ///
+    /// An entry validated by its content hash under another mtime takes the
+    /// file's current mtime in both tiers, so later runs match it by metadata
+    /// again instead of hashing the file every time.
+    fn lookup(
+        &self,
+        file_path: &Path,
+        stamp: FileStamp,
+        content_hash: &mut Option<u64>,
+    ) -> Option<ParseResult> {
+        if let Some(stored) = self.memory.stamp(file_path) {
+            if !self.is_current(file_path, stamp, stored, content_hash) {
+                return None;
+            }
+            if stored.timestamp != stamp.timestamp {
+                self.memory.restamp(file_path, stamp.timestamp);
+                self.restamp_pack(file_path, stored, stamp.timestamp);
             }
+            return self.memory.get(file_path);
         }
 
-        Ok(true)
+        let pack = self.pack.as_ref()?;
+        let slot = pack.slot(file_path)?;
+        if !self.is_current(file_path, stamp, slot.stamp, content_hash) {
+            return None;
+        }
+        let entry = pack.load(file_path, slot)?;
+        if slot.stamp.timestamp != stamp.timestamp {
+            self.restamp_pack(file_path, slot.stamp, stamp.timestamp);
+        }
+        Some(entry.into_result())
     }
 
-    /// Get cached parse result if valid
-    pub fn get(&self, file_path: &Path) -> Option<ParseResult> {
-        if let Some(entry) = self.memory_cache.get(file_path) {
-            return Some(ParseResult {
-                nodes: entry.nodes.clone(),
-                edges: entry.edges.clone(),
-                call_sites: entry.call_sites.clone(),
-            });
+    /// Moves the pack's record for `file_path` to `timestamp` if it is still
+    /// the one stamped `validated`
+    fn restamp_pack(&self, file_path: &Path, validated: StoredStamp, timestamp: u64) {
+        let Some(pack) = &self.pack else {
+            return;
+        };
+        let Some(slot) = pack.slot(file_path).filter(|slot| slot.stamp == validated) else {
+            return;
+        };
+        if let Err(err) = pack.restamp(file_path, slot, timestamp) {
+            eprintln!(
+                "Warning: Failed to refresh cache stamp of {}: {err}",
+                file_path.display()
+            );
         }
+    }
 
-        if let Some(cache_path) = self.cache_path(file_path) {
-            if let Ok(entry) = self.load_from_disk(&cache_path) {
-                let result = ParseResult {
-                    nodes: entry.nodes.clone(),
-                    edges: entry.edges.clone(),
-                    call_sites: entry.call_sites.clone(),
-                };
+    /// Stores a fresh result in both tiers and hands it back.
+    ///
+    /// The result is moved into the entry and only copied back out when the
+    /// memory tier keeps it.
+    fn insert(
+        &self,
+        file_path: &Path,
+        stamp: FileStamp,
+        content_hash: Option<u64>,
+        result: ParseResult,
+    ) -> ParseResult {
+        if result.limited == Some(LimitReason::Timeout) {
+            return result;
+        }
+        let content_hash = match (self.validation, content_hash) {
+            (CacheValidation::Metadata, _) => Ok(0),
+            (CacheValidation::ContentHash, Some(hash)) => Ok(hash),
+            (CacheValidation::ContentHash, None) => {
+                fs::read(file_path).map(|bytes| xxh3_64(&bytes))
+            }
+        };
+        let content_hash = match content_hash {
+            Ok(hash) => hash,
+            Err(err) => {
+                eprintln!("Warning: Failed to cache {}: {err}", file_path.display());
+                return result;
+            }
+        };
 
-                if self.memory_cache.len() < self.max_memory_entries {
-                    self.memory_cache.insert(file_path.to_path_buf(), entry);
-                }
+        let entry = ParsedFileEntry {
+            nodes: result.nodes,
+            edges: result.edges,
+            call_sites: result.call_sites,
+            exports: result.exports,
+            limited: result.limited,
+            timestamp: stamp.timestamp,
+            file_size: stamp.file_size,
+            content_hash,
+            limits: self.limits,
+        };
+
+        if let Some(pack) = &self.pack {
+            if let Err(err) = pack.append(file_path, &entry) {
+                eprintln!("Warning: Failed to cache {}: {err}", file_path.display());
+            }
+        }
+
+        self.memory.insert(file_path, entry)
+    }
 
-                return Some(result);
+    /// Compares stored validation fields against the file's current state.
+    ///
+    /// Entries parsed under other limits and a differing size always
+    /// invalidate. A differing mtime invalidates in
+    /// metadata mode; in content-hash mode the file is hashed (once, memoized in
+    /// `content_hash` for a following store) and compared instead.
+    fn is_current(
+        &self,
+        file_path: &Path,
+        current: FileStamp,
+        stored: StoredStamp,
+        content_hash: &mut Option<u64>,
+    ) -> bool {
+        if stored.limits != self.limits || stored.file_size != current.file_size {
+            return false;
+        }
+        if stored.timestamp == current.timestamp {
+            return true;
+        }
+        match self.validation {
+            CacheValidation::Metadata => false,
+            CacheValidation::ContentHash => {
+                if content_hash.is_none() {
+                    *content_hash = fs::read(file_path).ok().map(|bytes| xxh3_64(&bytes));
+                }
+                *content_hash == Some(stored.content_hash)
             }
         }
+    }
 
-        None
+    fn get_disk_cache_size(&self) -> usize {
+        self.pack.as_ref().map_or(0, |pack| pack.index.len())
     }
+}
 
-    /// Store parse result in cache
-    pub fn store(&self, file_path: &Path, result: &ParseResult) -> Result<()> {
-        let metadata = fs::metadata(file_path)?;
-        let timestamp = metadata
-            .modified()?
-            .duration_since(UNIX_EPOCH)
-            .unwrap_or_default()
-            .as_secs();
-        let file_size = metadata.len();
+/// Bounded in-memory tier with CLOCK (second-chance) eviction.
+///
+/// Hits only set a reference bit under the map's read lock; the ring and the
+/// byte count sit behind one mutex that is taken on insert and eviction.
+struct MemoryTier {
+    entries: DashMap<PathBuf, MemoryEntry>,
+    clock: Mutex<ClockState>,
+    max_bytes: usize,
+    max_entries: usize,
+}
 
-        let entry = ParsedFileEntry {
-            nodes: result.nodes.clone(),
-            edges: result.edges.clone(),
-            call_sites: result.call_sites.clone(),
-            timestamp,
-            file_size,
+struct MemoryEntry {
+    entry: ParsedFileEntry,
+    size: usize,
+    referenced: AtomicBool,
+}
+
+#[derive(Default)]
+struct ClockState {
+    /// Insertion-ordered keys; the front is the clock hand
+    ring: VecDeque<PathBuf>,
+    bytes: usize,
+}
+
+impl MemoryTier {
+    fn new(max_bytes: usize, max_entries: Option<usize>) -> Self {
+        let max_entries = max_entries.unwrap_or(usize::MAX);
+        Self {
+            entries: DashMap::with_capacity(INITIAL_MEMORY_CAPACITY.min(max_entries)),
+            clock: Mutex::new(ClockState::default()),
+            max_bytes,
+            max_entries,
+        }
+    }
+
+    fn stamp(&self, file_path: &Path) -> Option<StoredStamp> {
+        self.entries
+            .get(file_path)
+            .map(|cached| cached.entry.stamp())
+    }
+
+    fn get(&self, file_path: &Path) -> Option<ParseResult> {
+        let cached = self.entries.get(file_path)?;
+        cached.referenced.store(true, Ordering::Relaxed);
+        Some(cached.entry.to_result())
+    }
+
+    /// Keeps `entry` if it fits and returns its result, copied only when kept
+    fn insert(&self, file_path: &Path, entry: ParsedFileEntry) -> ParseResult {
+        let size = entry.approx_size();
+        let Ok(mut clock) = self.clock.lock() else {
+            return entry.into_result();
         };
 
-        if self.memory_cache.len() >= self.max_memory_entries {
-            if let Some(entry) = self.memory_cache.iter().next() {
-                let key = entry.key().clone();
-                drop(entry);
-                self.memory_cache.remove(&key);
+        if size > self.max_bytes || self.max_entries == 0 {
+            // Too large to ever fit; make sure no stale copy lingers
+            if let Some((_, old)) = self.entries.remove(file_path) {
+                clock.bytes -= old.size;
+                // A later insert pushes the key again; a second copy would
+                // bring the hand to the new entry early
+                if let Some(pos) = clock.ring.iter().position(|key| key == file_path) {
+                    clock.ring.remove(pos);
+                }
             }
+            return entry.into_result();
         }
-        self.memory_cache
-            .insert(file_path.to_path_buf(), entry.clone());
 
-        if let Some(cache_path) = self.cache_path(file_path) {
-            self.store_to_disk(&cache_path, &entry)?;
+        let result = entry.to_result();
+        let cached = MemoryEntry {
+            entry,
+            size,
+            referenced: AtomicBool::new(false),
+        };
+        match self.entries.insert(file_path.to_path_buf(), cached) {
+            Some(old) => clock.bytes -= old.size,
+            None => clock.ring.push_back(file_path.to_path_buf()),
         }
+        clock.bytes += size;
 
-        Ok(())
+        while clock.bytes > self.max_bytes || self.entries.len() > self.max_entries {
+            let Some(key) = clock.ring.pop_front() else {
+                break;
+            };
+            let second_chance = self
+                .entries
+                .get(&key)
+                .map(|cached| cached.referenced.swap(false, Ordering::Relaxed));
+            match second_chance {
+                Some(true) => clock.ring.push_back(key),
+                Some(false) => {
+                    if let Some((_, evicted)) = self.entries.remove(&key) {
+                        clock.bytes -= evicted.size;
+                    }
+                }
+                None => {}
+            }
+        }
+        result
     }
 
-    /// Clear all caches
-    #[allow(dead_code)]
-    pub fn clear(&self) -> Result<()> {
-        self.memory_cache.clear();
-        if let Some(cache_dir) = &self.cache_dir {
-            if cache_dir.exists() {
-                fs::remove_dir_all(cache_dir)?;
-                fs::create_dir_all(cache_dir)?;
+    /// Records a new mtime for an entry whose contents were found unchanged
+    fn restamp(&self, file_path: &Path, timestamp: u64) {
+        if let Some(mut cached) = self.entries.get_mut(file_path) {
+            cached.entry.timestamp = timestamp;
+        }
+    }
+
+    fn clear(&self) {
+        if let Ok(mut clock) = self.clock.lock() {
+            self.entries.clear();
+            *clock = ClockState::default();
+        }
+    }
+
+    fn len(&self) -> usize {
+        self.entries.len()
+    }
+
+    fn bytes(&self) -> usize {
+        self.clock.lock().map_or(0, |clock| clock.bytes)
+    }
+}
+
+/// Modification time (nanoseconds) and size of a file, from one stat
+#[derive(Debug, Clone, Copy)]
+struct FileStamp {
+    timestamp: u64,
+    file_size: u64,
+}
+
+/// Validation fields recorded alongside a cached entry
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct StoredStamp {
+    timestamp: u64,
+    file_size: u64,
+    content_hash: u64,
+    limits: u64,
+}
+
+fn file_stamp(metadata: &fs::Metadata) -> Result<FileStamp> {
+    let timestamp = metadata
+        .modified()?
+        .duration_since(UNIX_EPOCH)
+        .unwrap_or_default()
+        .as_nanos() as u64;
+    Ok(FileStamp {
+        timestamp,
+        file_size: metadata.len(),
+    })
+}
+
+/// Directory used when no cache directory is configured
+pub fn default_cache_dir() -> PathBuf {
+    std::env::temp_dir().join("embargo_cache")
+}
+
+/// Location and validation fields of one record in the pack file
+#[derive(Debug, Clone, Copy)]
+struct PackSlot {
+    record_start: usize,
+    payload_start: usize,
+    payload_end: usize,
+    stamp: StoredStamp,
+}
+
+/// Single append-only file holding every cached entry.
+///
+/// Layout: an 8-byte magic and a `u32` version, then records of
+/// `path_len: u32 | path | timestamp: u64 | file_size: u64 | content_hash: u64 |
+/// limits: u64 | payload_len: u32 | bincode(PackedEntry)`, all little-endian. A path may
+/// appear many times; the last record wins. Opening scans the file once to
+/// index it; only the index stays in memory, and each load reads one record
+/// back by offset, so entries evicted from the memory tier stay reachable
+/// without holding the pack in memory.
+///
+/// Processes sharing a cache directory serialize appends, truncation and
+/// compaction through an exclusive lock on a sibling `.pack.lock` file.
+/// Compaction replaces the pack by rename, so a process that opened it before
+/// keeps reading and appending to the old file; its later records are lost to
+/// other processes but never corrupt the new pack.
+struct PackStore {
+    path: PathBuf,
+    index: DashMap<PathBuf, PackSlot>,
+    file: File,
+    lock_file: File,
+    /// The file lock is held per handle, so threads of one process take turns here first
+    writer: Mutex<()>,
+}
+
+/// Holds the pack's advisory lock until dropped
+struct PackLock<'a>(&'a File);
+
+impl<'a> PackLock<'a> {
+    fn acquire(lock_file: &'a File) -> Result<Self> {
+        lock_file.lock()?;
+        Ok(Self(lock_file))
+    }
+}
+
+impl Drop for PackLock<'_> {
+    fn drop(&mut self) {
+        let _ = self.0.unlock();
+    }
+}
+
+impl PackStore {
+    fn open(path: &Path) -> Result<Self> {
+        let lock_file = open_lock_file(path)?;
+        let lock = PackLock::acquire(&lock_file)?;
+        let (mut index, valid_len, file_len) = Self::read_index(path);
+
+        if valid_len < PACK_HEADER_LEN {
+            // Missing, foreign or outdated pack: start a fresh one
+            let mut file = File::create(path)?;
+            file.write_all(PACK_MAGIC)?;
+            file.write_all(&PACK_VERSION.to_le_bytes())?;
+            index.clear();
+        } else {
+            if valid_len < file_len {
+                // Drop a partially written trailing record so appends stay aligned
+                OpenOptions::new()
+                    .write(true)
+                    .open(path)?
+                    .set_len(valid_len as u64)?;
+            }
+
+            let live_bytes: usize = index
+                .iter()
+                .map(|slot| slot.payload_end - slot.record_start)
+                .sum();
+            if valid_len >= COMPACTION_MIN_BYTES && live_bytes * 2 < valid_len {
+                Self::write_compacted(path)?;
+                (index, _, _) = Self::read_index(path);
             }
         }
-        Ok(())
+
+        let file = OpenOptions::new().read(true).append(true).open(path)?;
+        drop(lock);
+        Ok(Self {
+            path: path.to_path_buf(),
+            index,
+            file,
+            lock_file,
+            writer: Mutex::new(()),
+        })
     }
 
-    /// Get cache hit statistics
-    #[allow(dead_code)]
-    pub fn stats(&self) -> CacheStats {
-        CacheStats {
-            memory_entries: self.memory_cache.len(),
-            disk_cache_size: self.get_disk_cache_size(),
+    /// Scans the pack and indexes its records.
+    ///
+    /// Returns the newest slot per path, the length of the well-formed prefix
+    /// (0 if the header is missing or has another version) and the file length.
+    fn read_index(path: &Path) -> (DashMap<PathBuf, PackSlot>, usize, usize) {
+        match SourceBuffer::load(path) {
+            Ok(data) => {
+                let (index, valid_len) = Self::index_records(&data);
+                (index, valid_len, data.len())
+            }
+            Err(_) => (DashMap::new(), 0, 0),
         }
     }
 
-    fn cache_path(&self, file_path: &Path) -> Option<PathBuf> {
-        let cache_dir = self.cache_dir.as_ref()?;
+    fn index_records(data: &[u8]) -> (DashMap<PathBuf, PackSlot>, usize) {
+        let index = DashMap::new();
+        if data.len() < PACK_HEADER_LEN
+            || &data[..PACK_MAGIC.len()] != PACK_MAGIC
+            || read_u32(&data, PACK_MAGIC.len()) != Some(PACK_VERSION)
+        {
+            return (index, 0);
+        }
 
-        let mut hasher = DefaultHasher::new();
-        file_path.hash(&mut hasher);
-        let hash = hasher.finish();
+        let mut pos = PACK_HEADER_LEN;
+        while let Some((file_path, slot)) = Self::read_record(&data, pos) {
+            pos = slot.payload_end;
+            index.insert(file_path, slot);
+        }
+        (index, pos)
+    }
 
-        Some(cache_dir.join(format!("cache_{:x}.bincode", hash)))
+    fn read_record(data: &[u8], record_start: usize) -> Option<(PathBuf, PackSlot)> {
+        let path_len = read_u32(data, record_start)? as usize;
+        let path_start = record_start + 4;
+        let path_end = path_start.checked_add(path_len)?;
+        let file_path = std::str::from_utf8(data.get(path_start..path_end)?).ok()?;
+        let timestamp = read_u64(data, path_end)?;
+        let file_size = read_u64(data, path_end + 8)?;
+        let content_hash = read_u64(data, path_end + 16)?;
+        let limits = read_u64(data, path_end + 24)?;
+        let payload_len = read_u32(data, path_end + 32)? as usize;
+        let payload_start = path_end + 36;
+        let payload_end = payload_start.checked_add(payload_len)?;
+        if payload_end > data.len() {
+            return None;
+        }
+
+        Some((
+            PathBuf::from(file_path),
+            PackSlot {
+                record_start,
+                payload_start,
+                payload_end,
+                stamp: StoredStamp {
+                    timestamp,
+                    file_size,
+                    content_hash,
+                    limits,
+                },
+            },
+        ))
+    }
+
+    fn slot(&self, file_path: &Path) -> Option<PackSlot> {
+        self.index.get(file_path).map(|slot| *slot)
+    }
+
+    /// Reads the record at `slot` back from the file.
+    ///
+    /// `None` unless it is still the record for `file_path` that was indexed,
+    /// which another process clearing the pack would break.
+    fn load(&self, file_path: &Path, slot: PackSlot) -> Option<ParsedFileEntry> {
+        let mut record = vec![0; slot.payload_end - slot.record_start];
+        read_exact_at(&self.file, &mut record, slot.record_start as u64).ok()?;
+        let (stored_path, stored) = Self::read_record(&record, 0)?;
+        if stored_path != file_path || stored.payload_end != record.len() {
+            return None;
+        }
+        bincode::deserialize::<PackedEntry>(&record[stored.payload_start..])
+            .ok()?
+            .into_entry()
+    }
+
+    /// Encodes `entry` as a record and appends it.
+    fn append(&self, file_path: &Path, entry: &ParsedFileEntry) -> Result<()> {
+        let path_bytes = file_path
+            .to_str()
+            .ok_or_else(|| anyhow!("non UTF-8 path {}", file_path.display()))?
+            .as_bytes();
+        let payload = bincode::serialize(&PackedEntry::new(entry)?)?;
+
+        let mut record = Vec::with_capacity(RECORD_FIXED_LEN + path_bytes.len() + payload.len());
+        record.extend_from_slice(&(path_bytes.len() as u32).to_le_bytes());
+        record.extend_from_slice(path_bytes);
+        record.extend_from_slice(&entry.timestamp.to_le_bytes());
+        record.extend_from_slice(&entry.file_size.to_le_bytes());
+        record.extend_from_slice(&entry.content_hash.to_le_bytes());
+        record.extend_from_slice(&entry.limits.to_le_bytes());
+        record.extend_from_slice(&(payload.len() as u32).to_le_bytes());
+        record.extend_from_slice(&payload);
+        let payload_offset = record.len() - payload.len();
+        self.append_record(file_path, &record, payload_offset, entry.stamp())
     }
 
-    fn load_from_disk(&self, cache_path: &Path) -> Result<ParsedFileEntry> {
-        let data = fs::read(cache_path)?;
-        let entry: ParsedFileEntry = bincode::deserialize(&data)?;
-        Ok(entry)
+    /// Re-appends the record at `slot` with its mtime set to `timestamp`.
+    ///
+    /// The payload is copied as is; the superseded record goes at the next compaction.
+    fn restamp(&self, file_path: &Path, slot: PackSlot, timestamp: u64) -> Result<()> {
+        let mut record = vec![0; slot.payload_end - slot.record_start];
+        read_exact_at(&self.file, &mut record, slot.record_start as u64)?;
+        let payload_offset = match Self::read_record(&record, 0) {
+            Some((stored_path, stored)) if stored_path == file_path => stored.payload_start,
+            _ => return Err(anyhow!("pack record moved")),
+        };
+        // The timestamp is the first of the fixed fields after the path
+        let timestamp_at = payload_offset - (RECORD_FIXED_LEN - 4);
+        record[timestamp_at..timestamp_at + 8].copy_from_slice(&timestamp.to_le_bytes());
+        self.append_record(
+            file_path,
+            &record,
+            payload_offset,
+            StoredStamp {
+                timestamp,
+                ..slot.stamp
+            },
+        )
     }
 
-    fn store_to_disk(&self, cache_path: &Path, entry: &ParsedFileEntry) -> Result<()> {
-        let data = bincode::serialize(entry)?;
-        fs::write(cache_path, data)?;
+    /// Appends one encoded record with a single write so concurrent appenders
+    /// never interleave, and indexes it under `stamp`.
+    fn append_record(
+        &self,
+        file_path: &Path,
+        record: &[u8],
+        payload_offset: usize,
+        stamp: StoredStamp,
+    ) -> Result<()> {
+        let _writer = self
+            .writer
+            .lock()
+            .map_err(|_| anyhow!("parse cache pack poisoned"))?;
+        let lock = PackLock::acquire(&self.lock_file)?;
+        // Other processes may have appended since this one last did
+        let record_start = self.file.metadata()?.len() as usize;
+        (&self.file).write_all(record)?;
+        drop(lock);
+
+        self.index.insert(
+            file_path.to_path_buf(),
+            PackSlot {
+                record_start,
+                payload_start: record_start + payload_offset,
+                payload_end: record_start + record.len(),
+                stamp,
+            },
+        );
         Ok(())
     }
 
-    #[allow(dead_code)]
-    fn get_disk_cache_size(&self) -> usize {
-        if let Some(cache_dir) = &self.cache_dir {
-            if let Ok(entries) = fs::read_dir(cache_dir) {
-                entries.filter_map(|e| e.ok()).count()
-            } else {
-                0
+    fn clear(&self) -> Result<()> {
+        let _writer = self
+            .writer
+            .lock()
+            .map_err(|_| anyhow!("parse cache pack poisoned"))?;
+        let _lock = PackLock::acquire(&self.lock_file)?;
+        self.file.set_len(PACK_HEADER_LEN as u64)?;
+        self.index.clear();
+        Ok(())
+    }
+
+    /// Rewrites the pack at `path` with only the newest record per path.
+    fn compact_file(path: &Path) -> Result<()> {
+        let lock_file = open_lock_file(path)?;
+        let _lock = PackLock::acquire(&lock_file)?;
+        Self::write_compacted(path)
+    }
+
+    /// [`Self::compact_file`] for a caller already holding the pack lock
+    fn write_compacted(path: &Path) -> Result<()> {
+        let data = SourceBuffer::load(path)?;
+        let (index, valid_len) = Self::index_records(&data);
+        if valid_len < PACK_HEADER_LEN {
+            return Ok(());
+        }
+
+        let mut slots: Vec<PackSlot> = index.iter().map(|slot| *slot).collect();
+        slots.sort_unstable_by_key(|slot| slot.record_start);
+
+        let tmp_path = path.with_extension("pack.tmp");
+        let mut compacted = BufWriter::new(File::create(&tmp_path)?);
+        compacted.write_all(&data[..PACK_HEADER_LEN])?;
+        for slot in slots {
+            compacted.write_all(&data[slot.record_start..slot.payload_end])?;
+        }
+        compacted.into_inner().map_err(|err| err.into_error())?;
+        drop(data);
+        fs::rename(&tmp_path, path)?;
+        Ok(())
+    }
+}
+
+/// The pack's lock file, created on first use
+fn open_lock_file(pack_path: &Path) -> Result<File> {
+    Ok(OpenOptions::new()
+        .create(true)
+        .truncate(false)
+        .write(true)
+        .open(pack_path.with_extension("pack.lock"))?)
+}
+
+/// Fills `buf` from `offset` without moving a shared cursor, so loads run concurrently
+#[cfg(unix)]
+fn read_exact_at(file: &File, buf: &mut [u8], offset: u64) -> std::io::Result<()> {
+    std::os::unix::fs::FileExt::read_exact_at(file, buf, offset)
+}
+
+#[cfg(windows)]
+fn read_exact_at(file: &File, mut buf: &mut [u8], mut offset: u64) -> std::io::Result<()> {
+    use std::os::windows::fs::FileExt;
+    while !buf.is_empty() {
+        match file.seek_read(buf, offset) {
+            Ok(0) => return Err(std::io::ErrorKind::UnexpectedEof.into()),
+            Ok(read) => {
+                buf = &mut buf[read..];
+                offset += read as u64;
             }
-        } else {
-            0
+            Err(err) if err.kind() == std::io::ErrorKind::Interrupted => {}
+            Err(err) => return Err(err),
         }
     }
+    Ok(())
+}
+
+fn read_u32(data: &[u8], pos: usize) -> Option<u32> {
+    let bytes = data.get(pos..pos.checked_add(4)?)?;
+    Some(u32::from_le_bytes(bytes.try_into().ok()?))
+}
+
+fn read_u64(data: &[u8], pos: usize) -> Option<u64> {
+    let bytes = data.get(pos..pos.checked_add(8)?)?;
+    Some(u64::from_le_bytes(bytes.try_into().ok()?))
 }
 
 #[derive(Debug)]
-#[allow(dead_code)]
 pub struct CacheStats {
     pub memory_entries: usize,
+    /// Approximate bytes held by the memory tier
+    pub memory_bytes: usize,
     pub disk_cache_size: usize,
 }
@@ -1,49 +1,177 @@
 use anyhow::Result;
-use std::fs::File;
-use std::io::{BufReader, Read};
+use std::cell::RefCell;
+use std::collections::hash_map::Entry;
+use std::collections::HashMap;
 use std::path::Path;
+use std::time::Duration;
 use tree_sitter::{Language, Node as TSNode, Parser, Tree};
 
+use super::outline::{self, OutlineRole};
+use super::ParseResult;
+use crate::core::resolver::{CallKinds, CallSiteExtractor};
+use crate::core::NodeId;
+
+thread_local! {
+    /// One configured tree-sitter parser per language for each worker thread
+    static PARSER_POOL: RefCell<HashMap<&'static str, Parser>> = RefCell::new(HashMap::new());
+}
+
+/// Shareable handle to a pooled tree-sitter parser for one language.
+///
+/// The `tree_sitter::Parser` itself lives in a thread-local pool keyed by language
+/// name, so each worker thread configures it once and reuses it for every file.
 pub struct TreeSitterParser {
-    parser: Parser,
-    #[allow(dead_code)]
+    language_name: &'static str,
     language: Language,
+    call_kinds: CallKinds,
+    outline_kinds: KindTable<OutlineRole>,
 }
 
 impl TreeSitterParser {
-    pub fn new(language: Language) -> Result<Self> {
-        let mut parser = Parser::new();
-        parser.set_language(language)?;
-        Ok(Self { parser, language })
+    pub fn new(language_name: &'static str, language: Language) -> Result<Self> {
+        let parser = Self {
+            language_name,
+            language,
+            call_kinds: CallSiteExtractor::kinds(language),
+            outline_kinds: KindTable::new(language, outline::kinds(language_name)),
+        };
+        // Surface grammar/ABI mismatches at construction rather than on the first file
+        parser.with_parser(|_| ())?;
+        Ok(parser)
     }
 
-    pub fn parse_file(&mut self, file_path: &Path) -> Result<Tree> {
-        let source = self.read_file_optimized(file_path)?;
-        let tree = self
-            .parser
-            .parse(&source, None)
-            .ok_or_else(|| anyhow::anyhow!("Failed to parse file: {}", file_path.display()))?;
-        Ok(tree)
+    /// Call-site node kinds of this grammar, resolved to kind ids once
+    pub fn call_kinds(&self) -> &CallKinds {
+        &self.call_kinds
     }
 
-    pub fn get_source(&self, file_path: &Path) -> Result<String> {
-        self.read_file_optimized(file_path)
+    pub fn parse_source(&self, source: &[u8], file_path: &Path) -> Result<Tree> {
+        self.with_parser(|parser| {
+            let tree = parser.parse(source, None);
+            if tree.is_none() {
+                // A failed parse may leave partial state behind; start clean next time
+                parser.reset();
+            }
+            tree
+        })?
+        .ok_or_else(|| anyhow::anyhow!("Failed to parse file: {}", file_path.display()))
     }
 
-    /// Optimized file reading with buffering for better I/O performance
-    fn read_file_optimized(&self, file_path: &Path) -> Result<String> {
-        let file = File::open(file_path)?;
-        let metadata = file.metadata()?;
-        let file_size = metadata.len() as usize;
+    /// Outline of `source` (see [`outline`]), or `None` when the parse takes
+    /// longer than `timeout`
+    pub fn parse_outline(
+        &self,
+        source: &[u8],
+        file_path: &Path,
+        timeout: Duration,
+    ) -> Result<Option<ParseResult>> {
+        let tree = self.with_parser(|parser| {
+            parser.set_timeout_micros(timeout.as_micros().min(u64::MAX as u128) as u64);
+            let tree = parser.parse(source, None);
+            parser.set_timeout_micros(0);
+            if tree.is_none() {
+                // A timed-out parse is resumable; drop it so the next file starts fresh
+                parser.reset();
+            }
+            tree
+        })?;
+        Ok(tree.map(|tree| {
+            outline::extract(
+                &self.outline_kinds,
+                &tree,
+                source,
+                file_path,
+                self.language_name,
+            )
+        }))
+    }
 
-        // Use buffered reader with optimal buffer size
-        let mut reader =
-            BufReader::with_capacity(if file_size < 8192 { file_size } else { 8192 }, file);
+    /// Runs `f` with this thread's parser for the language, creating it on first use
+    fn with_parser<R>(&self, f: impl FnOnce(&mut Parser) -> R) -> Result<R> {
+        PARSER_POOL.with(|pool| {
+            let mut pool = pool.borrow_mut();
+            let parser = match pool.entry(self.language_name) {
+                Entry::Occupied(entry) => entry.into_mut(),
+                Entry::Vacant(entry) => {
+                    let mut parser = Parser::new();
+                    parser.set_language(self.language)?;
+                    entry.insert(parser)
+                }
+            };
+            Ok(f(parser))
+        })
+    }
+}
+
+/// Maps a grammar's numeric node kind ids to parser-defined roles.
+///
+/// Built once per language so traversals dispatch on `kind_id()` instead of
+/// comparing kind strings. Every named kind id carrying one of the given names
+/// is mapped, which covers grammars that expose a kind under several ids.
+pub struct KindTable<R> {
+    roles: Vec<Option<R>>,
+}
 
-        // Pre-allocate string with known capacity
-        let mut content = String::with_capacity(file_size);
-        reader.read_to_string(&mut content)?;
-        Ok(content)
+impl<R: Copy> KindTable<R> {
+    pub fn new(language: Language, kinds: &[(&str, R)]) -> Self {
+        let roles = (0..language.node_kind_count())
+            .map(|id| {
+                let id = id as u16;
+                if !language.node_kind_is_named(id) {
+                    return None;
+                }
+                let name = language.node_kind_for_id(id)?;
+                kinds
+                    .iter()
+                    .find(|(kind, _)| *kind == name)
+                    .map(|&(_, role)| role)
+            })
+            .collect();
+        Self { roles }
+    }
+
+    #[inline]
+    pub fn get(&self, node: &TSNode) -> Option<R> {
+        self.roles.get(node.kind_id() as usize).copied().flatten()
+    }
+}
+
+/// Per-node callbacks for [`walk_tree`].
+pub trait Visitor<'tree> {
+    /// Called before a node's children; returning `false` skips them
+    fn enter(&mut self, node: TSNode<'tree>) -> bool;
+
+    /// Called after a node's children (or right after `enter` for leaves)
+    fn leave(&mut self, _node: TSNode<'tree>) {}
+}
+
+/// Visits every node under `root` in document order with a single `TreeCursor`.
+///
+/// Iterative, so deeply nested sources cannot overflow the stack, and each node
+/// is reached exactly once however many extractions the visitor performs.
+pub fn walk_tree<'tree>(root: TSNode<'tree>, visitor: &mut impl Visitor<'tree>) {
+    let mut cursor = root.walk();
+    let mut depth = 0usize;
+    loop {
+        let node = cursor.node();
+        if visitor.enter(node) && cursor.goto_first_child() {
+            depth += 1;
+            continue;
+        }
+        visitor.leave(node);
+
+        // Climb until a sibling is left to visit, closing each parent on the way
+        loop {
+            if depth == 0 {
+                return;
+            }
+            if cursor.goto_next_sibling() {
+                break;
+            }
+            cursor.goto_parent();
+            depth -= 1;
+            visitor.leave(cursor.node());
+        }
     }
 }
 
@@ -51,8 +179,9 @@ pub fn extract_text<'a>(node: &TSNode, source: &'a [u8]) -> &'a str {
     std::str::from_utf8(&source[node.byte_range()]).unwrap_or("")
 }
 
-pub fn generate_node_id(file_path: &Path, node_type: &str, name: &str, line: usize) -> String {
-    format!(
+/// Formats and interns the `filepath:type:name:line` id of a node.
+pub fn generate_node_id(file_path: &Path, node_type: &str, name: &str, line: usize) -> NodeId {
+    NodeId::intern(&format!(
         "{}:{}:{}:{}",
         file_path
             .to_string_lossy()
@@ -61,14 +190,14 @@ pub fn generate_node_id(file_path: &Path, node_type: &str, name: &str, line: usi
         node_type,
         name,
         line
-    )
+    ))
 }
-
+    
 pub fn extract_docstring(node: &TSNode, source: &[u8]) -> Option<String> {
     // For Python, docstrings can be:
     // 1. Direct child of function_definition (for functions)
     // 2. Inside the "block" child (for classes and functions in some cases)
-    
+
     // First try direct children
     for child in node.children(&mut node.walk()) {
         if child.kind() == "expression_statement" {
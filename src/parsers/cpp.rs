@@ -1,38 +1,74 @@
 use anyhow::Result;
 use std::path::Path;
+use std::time::Duration;
 use tree_sitter::Node as TSNode;
 
-use super::common::{extract_text, find_child_by_kind, generate_node_id, TreeSitterParser};
+use super::common::{
+    extract_text, find_child_by_kind, generate_node_id, walk_tree, KindTable, TreeSitterParser,
+    Visitor,
+};
 use super::{LanguageParser, ParseResult};
-use crate::core::{CallSite, CallSiteExtractor, Edge, EdgeType, Node, NodeType};
+use crate::core::{CallSiteExtractor, Edge, EdgeType, Node, NodeId, NodeType};
+
+/// Declaration kinds the C++ visitor acts on
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum CppKind {
+    Include,
+    Using,
+    Namespace,
+    DeclarationList,
+    Class,
+    FieldDeclarationList,
+    Function,
+    Template,
+    Declaration,
+    FieldDeclaration,
+}
+
+/// What the children of the node being visited may declare
+#[derive(Debug, Clone, Copy)]
+enum Scope {
+    /// Translation unit or namespace body; includes and usings only count at file level
+    Declarations {
+        parent: Option<NodeId>,
+        file_level: bool,
+    },
+    /// A named namespace, whose declaration list holds its contents
+    Namespace(NodeId),
+    /// A named class or struct, whose field declaration list holds its members
+    Class(NodeId),
+    Members(NodeId),
+    Template(Option<NodeId>),
+    /// Bodies, expressions and anything else: only call sites are collected
+    Opaque,
+}
 
 pub struct CppParser {
-    #[allow(dead_code)]
     parser: TreeSitterParser,
+    kinds: KindTable<CppKind>,
 }
 
 impl CppParser {
     pub fn new() -> Result<Self> {
         let language = tree_sitter_cpp::language();
-        let parser = TreeSitterParser::new(language)?;
-        Ok(Self { parser })
-    }
-
-    fn extract_includes(
-        &self,
-        root: &TSNode,
-        source: &[u8],
-        file_path: &Path,
-        nodes: &mut Vec<Node>,
-        edges: &mut Vec<Edge>,
-    ) {
-        let mut cursor = root.walk();
-
-        for child in root.children(&mut cursor) {
-            if child.kind() == "preproc_include" {
-                self.process_include(&child, source, file_path, nodes, edges);
-            }
-        }
+        let parser = TreeSitterParser::new("cpp", language)?;
+        let kinds = KindTable::new(
+            language,
+            &[
+                ("preproc_include", CppKind::Include),
+                ("using_declaration", CppKind::Using),
+                ("namespace_definition", CppKind::Namespace),
+                ("declaration_list", CppKind::DeclarationList),
+                ("class_specifier", CppKind::Class),
+                ("struct_specifier", CppKind::Class),
+                ("field_declaration_list", CppKind::FieldDeclarationList),
+                ("function_definition", CppKind::Function),
+                ("template_declaration", CppKind::Template),
+                ("declaration", CppKind::Declaration),
+                ("field_declaration", CppKind::FieldDeclaration),
+            ],
+        );
+        Ok(Self { parser, kinds })
     }
 
     fn process_include(
@@ -48,7 +84,7 @@ impl CppParser {
 
         let module_id = generate_node_id(file_path, "include", include_text, line_number);
         let include_node_obj = Node::new(
-            module_id.clone(),
+            module_id,
             include_text.to_string(),
             NodeType::Module,
             file_path.to_path_buf(),
@@ -59,103 +95,29 @@ impl CppParser {
         nodes.push(include_node_obj);
     }
 
-    fn extract_namespaces(
-        &self,
-        root: &TSNode,
-        source: &[u8],
-        file_path: &Path,
-        nodes: &mut Vec<Node>,
-        edges: &mut Vec<Edge>,
-    ) {
-        let mut cursor = root.walk();
-
-        for child in root.children(&mut cursor) {
-            if child.kind() == "namespace_definition" {
-                self.process_namespace(&child, source, file_path, nodes, edges);
-            }
-        }
-    }
-
     fn process_namespace(
         &self,
         namespace_node: &TSNode,
         source: &[u8],
         file_path: &Path,
         nodes: &mut Vec<Node>,
-        edges: &mut Vec<Edge>,
-    ) {
-        if let Some(name_node) = find_child_by_kind(namespace_node, "identifier") {
-            let namespace_name = extract_text(&name_node, source);
-            let line_number = namespace_node.start_position().row + 1;
-            let namespace_id =
-                generate_node_id(file_path, "namespace", namespace_name, line_number);
-
-            let namespace_node_obj = Node::new(
-                namespace_id.clone(),
-                namespace_name.to_string(),
-                NodeType::Module,
-                file_path.to_path_buf(),
-                line_number,
-                "cpp".to_string(),
-            );
-
-            nodes.push(namespace_node_obj);
-
-            // Process contents of namespace
-            if let Some(declaration_list) = find_child_by_kind(namespace_node, "declaration_list") {
-                self.extract_from_declaration_list(
-                    &declaration_list,
-                    source,
-                    file_path,
-                    &namespace_id,
-                    nodes,
-                    edges,
-                );
-            }
-        }
-    }
-
-    fn extract_classes(
-        &self,
-        root: &TSNode,
-        source: &[u8],
-        file_path: &Path,
-        nodes: &mut Vec<Node>,
-        edges: &mut Vec<Edge>,
-    ) {
-        self.extract_from_declaration_list(root, source, file_path, "", nodes, edges);
-    }
-
-    fn extract_from_declaration_list(
-        &self,
-        parent_node: &TSNode,
-        source: &[u8],
-        file_path: &Path,
-        parent_id: &str,
-        nodes: &mut Vec<Node>,
-        edges: &mut Vec<Edge>,
-    ) {
-        let mut cursor = parent_node.walk();
+    ) -> Option<NodeId> {
+        let name_node = find_child_by_kind(namespace_node, "identifier")?;
+        let namespace_name = extract_text(&name_node, source);
+        let line_number = namespace_node.start_position().row + 1;
+        let namespace_id = generate_node_id(file_path, "namespace", namespace_name, line_number);
+
+        let namespace_node_obj = Node::new(
+            namespace_id,
+            namespace_name.to_string(),
+            NodeType::Module,
+            file_path.to_path_buf(),
+            line_number,
+            "cpp".to_string(),
+        );
 
-        for child in parent_node.children(&mut cursor) {
-            match child.kind() {
-                "class_specifier" | "struct_specifier" => {
-                    self.process_class_or_struct(
-                        &child, source, file_path, parent_id, nodes, edges,
-                    );
-                }
-                "function_definition" => {
-                    self.process_function(&child, source, file_path, parent_id, nodes, edges);
-                }
-                "template_declaration" => {
-                    self.process_template(&child, source, file_path, parent_id, nodes, edges);
-                }
-                "namespace_definition" => {
-                    self.process_namespace(&child, source, file_path, nodes, edges);
-                }
-                _ => {}
-            }
-        }
+        nodes.push(namespace_node_obj);
+        Some(namespace_id)
     }
 
     fn process_class_or_struct(
@@ -163,107 +125,50 @@ impl CppParser {
         class_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        parent_id: &str,
+        parent_id: Option<NodeId>,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
-    ) {
-        if let Some(name_node) = find_child_by_kind(class_node, "type_identifier") {
-            let class_name = extract_text(&name_node, source);
-            let line_number = class_node.start_position().row + 1;
-            let class_id = generate_node_id(file_path, "class", class_name, line_number);
-
-            let node_type = NodeType::Class;
-
-            let class_node_obj = Node::new(
-                class_id.clone(),
-                class_name.to_string(),
-                node_type,
-                file_path.to_path_buf(),
-                line_number,
-                "cpp".to_string(),
-            );
+    ) -> Option<NodeId> {
+        let name_node = find_child_by_kind(class_node, "type_identifier")?;
+        let class_name = extract_text(&name_node, source);
+        let line_number = class_node.start_position().row + 1;
+        let class_id = generate_node_id(file_path, "class", class_name, line_number);
+
+        let node_type = NodeType::Class;
+
+        let class_node_obj = Node::new(
+            class_id,
+            class_name.to_string(),
+            node_type,
+            file_path.to_path_buf(),
+            line_number,
+            "cpp".to_string(),
+        );
 
-            // Handle inheritance
-            if let Some(base_class_clause) = find_child_by_kind(class_node, "base_class_clause") {
-                for base_class in base_class_clause.children(&mut base_class_clause.walk()) {
-                    if base_class.kind() == "base_class" {
-                        if let Some(base_name_node) =
-                            find_child_by_kind(&base_class, "type_identifier")
-                        {
-                            let parent_class = extract_text(&base_name_node, source);
-                            let parent_id = format!("external:class:{}:0", parent_class);
-                            let inheritance_edge =
-                                Edge::new(EdgeType::Inheritance, class_id.clone(), parent_id);
-                            edges.push(inheritance_edge);
-                        }
+        // Handle inheritance
+        if let Some(base_class_clause) = find_child_by_kind(class_node, "base_class_clause") {
+            for base_class in base_class_clause.children(&mut base_class_clause.walk()) {
+                if base_class.kind() == "base_class" {
+                    if let Some(base_name_node) = find_child_by_kind(&base_class, "type_identifier")
+                    {
+                        let parent_class = extract_text(&base_name_node, source);
+                        let parent_id = format!("external:class:{}:0", parent_class);
+                        let inheritance_edge =
+                            Edge::new(EdgeType::Inheritance, class_id, parent_id);
+                        edges.push(inheritance_edge);
                     }
                 }
             }
-
-            // Add containment edge if this class is inside a namespace
-            if !parent_id.is_empty() {
-                let containment_edge =
-                    Edge::new(EdgeType::Contains, parent_id.to_string(), class_id.clone());
-                edges.push(containment_edge);
-            }
-
-            nodes.push(class_node_obj);
-
-            // Extract class members
-            if let Some(field_declaration_list) =
-                find_child_by_kind(class_node, "field_declaration_list")
-            {
-                self.extract_class_members(
-                    &field_declaration_list,
-                    source,
-                    file_path,
-                    &class_id,
-                    nodes,
-                    edges,
-                );
-            }
         }
-    }
 
-    fn extract_class_members(
-        &self,
-        field_list: &TSNode,
-        source: &[u8],
-        file_path: &Path,
-        class_id: &str,
-        nodes: &mut Vec<Node>,
-        edges: &mut Vec<Edge>,
-    ) {
-        let mut cursor = field_list.walk();
-
-        for child in field_list.children(&mut cursor) {
-            match child.kind() {
-                "function_definition" => {
-                    self.process_method(&child, source, file_path, class_id, nodes, edges);
-                }
-                "declaration" => {
-                    // Handle method declarations, constructors, destructors
-                    if let Some(declarator) = find_child_by_kind(&child, "function_declarator") {
-                        self.process_method_declaration(
-                            &child,
-                            &declarator,
-                            source,
-                            file_path,
-                            class_id,
-                            nodes,
-                            edges,
-                        );
-                    }
-                }
-                "field_declaration" => {
-                    self.process_field(&child, source, file_path, class_id, nodes, edges);
-                }
-                "template_declaration" => {
-                    self.process_template(&child, source, file_path, class_id, nodes, edges);
-                }
-                _ => {}
-            }
+        // Add containment edge if this class is inside a namespace
+        if let Some(parent_id) = parent_id {
+            let containment_edge = Edge::new(EdgeType::Contains, parent_id, class_id);
+            edges.push(containment_edge);
         }
+
+        nodes.push(class_node_obj);
+        Some(class_id)
     }
 
     fn process_method(
@@ -271,7 +176,7 @@ impl CppParser {
         method_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: &str,
+        class_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -282,7 +187,7 @@ impl CppParser {
                 let method_id = generate_node_id(file_path, "method", method_name, line_number);
 
                 let method_node_obj = Node::new(
-                    method_id.clone(),
+                    method_id,
                     method_name.to_string(),
                     NodeType::Function,
                     file_path.to_path_buf(),
@@ -293,12 +198,8 @@ impl CppParser {
                 nodes.push(method_node_obj);
 
                 // Add containment edge
-                let containment_edge =
-                    Edge::new(EdgeType::Contains, class_id.to_string(), method_id.clone());
+                let containment_edge = Edge::new(EdgeType::Contains, class_id, method_id);
                 edges.push(containment_edge);
-
-                // Note: Function calls are now extracted separately via extract_call_sites
-                // Legacy function call extraction would go here but is replaced by CallSiteExtractor
             }
         }
     }
@@ -309,7 +210,7 @@ impl CppParser {
         declarator: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: &str,
+        class_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -319,7 +220,7 @@ impl CppParser {
             let method_id = generate_node_id(file_path, "method", method_name, line_number);
 
             let method_node_obj = Node::new(
-                method_id.clone(),
+                method_id,
                 method_name.to_string(),
                 NodeType::Function,
                 file_path.to_path_buf(),
@@ -330,7 +231,7 @@ impl CppParser {
             nodes.push(method_node_obj);
 
             // Add containment edge
-            let containment_edge = Edge::new(EdgeType::Contains, class_id.to_string(), method_id);
+            let containment_edge = Edge::new(EdgeType::Contains, class_id, method_id);
             edges.push(containment_edge);
         }
     }
@@ -340,7 +241,7 @@ impl CppParser {
         field_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: &str,
+        class_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -351,7 +252,7 @@ impl CppParser {
                 let field_id = generate_node_id(file_path, "field", field_name, line_number);
 
                 let field_node_obj = Node::new(
-                    field_id.clone(),
+                    field_id,
                     field_name.to_string(),
                     NodeType::Variable,
                     file_path.to_path_buf(),
@@ -362,8 +263,7 @@ impl CppParser {
                 nodes.push(field_node_obj);
 
                 // Add containment edge
-                let containment_edge =
-                    Edge::new(EdgeType::Contains, class_id.to_string(), field_id);
+                let containment_edge = Edge::new(EdgeType::Contains, class_id, field_id);
                 edges.push(containment_edge);
             }
         }
@@ -374,7 +274,7 @@ impl CppParser {
         func_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        parent_id: &str,
+        parent_id: Option<NodeId>,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -385,7 +285,7 @@ impl CppParser {
                 let func_id = generate_node_id(file_path, "function", func_name, line_number);
 
                 let func_node_obj = Node::new(
-                    func_id.clone(),
+                    func_id,
                     func_name.to_string(),
                     NodeType::Function,
                     file_path.to_path_buf(),
@@ -396,194 +296,185 @@ impl CppParser {
                 nodes.push(func_node_obj);
 
                 // Add containment edge if inside namespace
-                if !parent_id.is_empty() {
-                    let containment_edge =
-                        Edge::new(EdgeType::Contains, parent_id.to_string(), func_id.clone());
+                if let Some(parent_id) = parent_id {
+                    let containment_edge = Edge::new(EdgeType::Contains, parent_id, func_id);
                     edges.push(containment_edge);
                 }
-
-                // Note: Function calls are now extracted separately via extract_call_sites
-                // Legacy function call extraction would go here but is replaced by CallSiteExtractor
             }
         }
     }
 
-    fn process_template(
+    fn process_using(
         &self,
-        template_node: &TSNode,
+        using_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        parent_id: &str,
         nodes: &mut Vec<Node>,
-        edges: &mut Vec<Edge>,
     ) {
-        // Process the template declaration content
-        for child in template_node.children(&mut template_node.walk()) {
-            match child.kind() {
-                "class_specifier" | "struct_specifier" => {
-                    self.process_class_or_struct(
-                        &child, source, file_path, parent_id, nodes, edges,
-                    );
-                }
-                "function_definition" => {
-                    self.process_function(&child, source, file_path, parent_id, nodes, edges);
-                }
-                _ => {}
-            }
-        }
-    }
+        let using_text = extract_text(using_node, source);
+        let line_number = using_node.start_position().row + 1;
 
-    // Legacy function call extraction methods (kept for compatibility but replaced by CallSiteExtractor)
-    #[allow(dead_code)]
-    fn extract_function_calls_legacy(
-        &self,
-        body_node: &TSNode,
-        source: &[u8],
-        file_path: &Path,
-        caller_id: &str,
-        edges: &mut Vec<Edge>,
-    ) {
-        self.traverse_for_calls_legacy(body_node, source, file_path, caller_id, edges);
+        let using_id = generate_node_id(file_path, "using", using_text, line_number);
+        let using_node = Node::new(
+            using_id,
+            using_text.to_string(),
+            NodeType::Module,
+            file_path.to_path_buf(),
+            line_number,
+            "cpp".to_string(),
+        );
+
+        nodes.push(using_node);
     }
+}
 
-    #[allow(dead_code)]
-    fn traverse_for_calls_legacy(
-        &self,
-        node: &TSNode,
-        source: &[u8],
-        _file_path: &Path,
-        caller_id: &str,
-        edges: &mut Vec<Edge>,
-    ) {
-        match node.kind() {
-            "call_expression" => {
-                self.process_function_call_legacy(node, source, caller_id, edges);
+/// Single-pass extraction of declarations and call sites.
+///
+/// Keeps one [`Scope`] per open node, so each declaration is handled exactly
+/// once by the handler its position calls for, while the embedded call-site
+/// extractor sees every node of the same traversal.
+struct CppVisitor<'p, 's> {
+    parser: &'p CppParser,
+    source: &'s [u8],
+    file_path: &'p Path,
+    nodes: Vec<Node>,
+    edges: Vec<Edge>,
+    calls: CallSiteExtractor<'p>,
+    /// Scope of the children of each node from the root down to the current one
+    scopes: Vec<Scope>,
+}
+
+impl CppVisitor<'_, '_> {
+    /// Handles `node` as found in `scope` and returns the scope of its children
+    fn declare(&mut self, node: &TSNode, scope: Scope) -> Scope {
+        let Some(kind) = self.parser.kinds.get(node) else {
+            return Scope::Opaque;
+        };
+        let (parser, source, file_path) = (self.parser, self.source, self.file_path);
+        let (nodes, edges) = (&mut self.nodes, &mut self.edges);
+
+        match (scope, kind) {
+            (
+                Scope::Declarations {
+                    file_level: true, ..
+                },
+                CppKind::Include,
+            ) => {
+                parser.process_include(node, source, file_path, nodes, edges);
+                Scope::Opaque
             }
-            _ => {
-                // Recursively traverse child nodes
-                let mut cursor = node.walk();
-                for child in node.children(&mut cursor) {
-                    self.traverse_for_calls_legacy(&child, source, _file_path, caller_id, edges);
-                }
+            (
+                Scope::Declarations {
+                    file_level: true, ..
+                },
+                CppKind::Using,
+            ) => {
+                parser.process_using(node, source, file_path, nodes);
+                Scope::Opaque
             }
-        }
-    }
-
-    #[allow(dead_code)]
-    fn process_function_call_legacy(
-        &self,
-        call_node: &TSNode,
-        source: &[u8],
-        caller_id: &str,
-        edges: &mut Vec<Edge>,
-    ) {
-        if let Some(function_node) = call_node.child(0) {
-            let function_name = match function_node.kind() {
-                "identifier" => extract_text(&function_node, source),
-                "field_expression" => {
-                    // Handle member function calls like obj.method()
-                    if let Some(field_node) = find_child_by_kind(&function_node, "field_identifier")
-                    {
-                        extract_text(&field_node, source)
-                    } else {
-                        extract_text(&function_node, source)
-                    }
-                }
-                "qualified_identifier" => {
-                    // Handle qualified calls like namespace::function()
-                    extract_text(&function_node, source)
+            (Scope::Declarations { .. }, CppKind::Namespace) => parser
+                .process_namespace(node, source, file_path, nodes)
+                .map_or(Scope::Opaque, Scope::Namespace),
+            (Scope::Namespace(namespace_id), CppKind::DeclarationList) => Scope::Declarations {
+                parent: Some(namespace_id),
+                file_level: false,
+            },
+            (Scope::Declarations { parent, .. } | Scope::Template(parent), CppKind::Class) => {
+                parser
+                    .process_class_or_struct(node, source, file_path, parent, nodes, edges)
+                    .map_or(Scope::Opaque, Scope::Class)
+            }
+            (Scope::Declarations { parent, .. } | Scope::Template(parent), CppKind::Function) => {
+                parser.process_function(node, source, file_path, parent, nodes, edges);
+                Scope::Opaque
+            }
+            (Scope::Declarations { parent, .. }, CppKind::Template) => Scope::Template(parent),
+            (Scope::Class(class_id), CppKind::FieldDeclarationList) => Scope::Members(class_id),
+            (Scope::Members(class_id), CppKind::Function) => {
+                parser.process_method(node, source, file_path, class_id, nodes, edges);
+                Scope::Opaque
+            }
+            (Scope::Members(class_id), CppKind::Declaration) => {
+                // Handle method declarations, constructors, destructors
+                if let Some(declarator) = find_child_by_kind(node, "function_declarator") {
+                    parser.process_method_declaration(
+                        node,
+                        &declarator,
+                        source,
+                        file_path,
+                        class_id,
+                        nodes,
+                        edges,
+                    );
                 }
-                _ => extract_text(&function_node, source),
-            };
-
-            if !function_name.is_empty() {
-                let callee_id = format!("external:function:{}:0", function_name);
-                let call_edge = Edge::new(EdgeType::Call, caller_id.to_string(), callee_id);
-                edges.push(call_edge);
+                Scope::Opaque
+            }
+            (Scope::Members(class_id), CppKind::FieldDeclaration) => {
+                parser.process_field(node, source, file_path, class_id, nodes, edges);
+                Scope::Opaque
             }
+            (Scope::Members(class_id), CppKind::Template) => Scope::Template(Some(class_id)),
+            _ => Scope::Opaque,
         }
     }
+}
 
-    /// Extract call sites using the new optimized CallSiteExtractor
-    fn extract_call_sites(
-        &self,
-        root_node: &TSNode,
-        source: &[u8],
-        file_path: &Path,
-    ) -> Vec<CallSite> {
-        let mut extractor = CallSiteExtractor::new();
-        extractor.extract_from_ast(root_node, source, file_path)
+impl<'tree> Visitor<'tree> for CppVisitor<'_, '_> {
+    fn enter(&mut self, node: TSNode<'tree>) -> bool {
+        let children = match self.scopes.last() {
+            Some(&scope) => self.declare(&node, scope),
+            None => Scope::Declarations {
+                parent: None,
+                file_level: true,
+            },
+        };
+        self.scopes.push(children);
+        self.calls.enter(&node, self.source);
+        true
     }
 
-    fn extract_using_declarations(
-        &self,
-        root: &TSNode,
-        source: &[u8],
-        file_path: &Path,
-        nodes: &mut Vec<Node>,
-        _edges: &mut Vec<Edge>,
-    ) {
-        let mut cursor = root.walk();
-
-        for child in root.children(&mut cursor) {
-            if child.kind() == "using_declaration" {
-                let using_text = extract_text(&child, source);
-                let line_number = child.start_position().row + 1;
-
-                let using_id = generate_node_id(file_path, "using", using_text, line_number);
-                let using_node = Node::new(
-                    using_id,
-                    using_text.to_string(),
-                    NodeType::Module,
-                    file_path.to_path_buf(),
-                    line_number,
-                    "cpp".to_string(),
-                );
-
-                nodes.push(using_node);
-            }
-        }
+    fn leave(&mut self, node: TSNode<'tree>) {
+        self.calls.leave(&node);
+        self.scopes.pop();
     }
 }
 
 impl LanguageParser for CppParser {
-    fn parse_file(&self, file_path: &Path) -> Result<ParseResult> {
-        let mut parser = TreeSitterParser::new(tree_sitter_cpp::language())?;
-        let tree = parser.parse_file(file_path)?;
-        let source = parser.get_source(file_path)?;
-        let source_bytes = source.as_bytes();
-
-        let root = tree.root_node();
-
-        let mut nodes = Vec::new();
-        let mut edges = Vec::new();
-
-        // Extract different types of C++ constructs
-        self.extract_includes(&root, source_bytes, file_path, &mut nodes, &mut edges);
-        self.extract_using_declarations(&root, source_bytes, file_path, &mut nodes, &mut edges);
-        self.extract_namespaces(&root, source_bytes, file_path, &mut nodes, &mut edges);
-        self.extract_classes(&root, source_bytes, file_path, &mut nodes, &mut edges);
-
-        // Extract global functions and templates
-        self.extract_from_declaration_list(
-            &root,
-            source_bytes,
-            file_path,
-            "",
-            &mut nodes,
-            &mut edges,
-        );
+    fn parse_source(&self, file_path: &Path, source_bytes: &[u8]) -> Result<ParseResult> {
+        let tree = self.parser.parse_source(source_bytes, file_path)?;
 
-        // Extract call sites using the new system
-        let call_sites = self.extract_call_sites(&root, source_bytes, file_path);
+        let mut visitor = CppVisitor {
+            parser: self,
+            source: source_bytes,
+            file_path,
+            nodes: Vec::new(),
+            edges: Vec::new(),
+            calls: CallSiteExtractor::new(self.parser.call_kinds()),
+            scopes: Vec::new(),
+        };
+        visitor.calls.begin(file_path);
+        walk_tree(tree.root_node(), &mut visitor);
+        let call_sites = visitor.calls.finish();
+        let CppVisitor { nodes, edges, .. } = visitor;
 
         Ok(ParseResult {
             nodes,
             edges,
             call_sites: Some(call_sites),
+            exports: Vec::new(),
+            limited: None,
         })
     }
 
+    fn parse_outline(
+        &self,
+        file_path: &Path,
+        source: &[u8],
+        timeout: Duration,
+    ) -> Result<Option<ParseResult>> {
+        self.parser.parse_outline(source, file_path, timeout)
+    }
+
     fn language_name(&self) -> &str {
         "cpp"
     }
@@ -1,5 +1,6 @@
 use anyhow::Result;
 use std::path::Path;
+use std::time::Duration;
 use tree_sitter::Node as TSNode;
 
 use super::common::{
@@ -7,17 +8,16 @@ use super::common::{
     TreeSitterParser,
 };
 use super::{LanguageParser, ParseResult};
-use crate::core::{CallSite, CallSiteExtractor, Edge, EdgeType, Node, NodeType};
+use crate::core::{CallSite, CallSiteExtractor, Edge, EdgeType, Node, NodeId, NodeType};
 
 pub struct CSharpParser {
-    #[allow(dead_code)]
     parser: TreeSitterParser,
 }
 
 impl CSharpParser {
     pub fn new() -> Result<Self> {
         let language = tree_sitter_c_sharp::language();
-        let parser = TreeSitterParser::new(language)?;
+        let parser = TreeSitterParser::new("csharp", language)?;
         Ok(Self { parser })
     }
 
@@ -82,7 +82,7 @@ impl CSharpParser {
                 generate_node_id(file_path, "namespace", &namespace_name, line_number);
 
             let namespace_node_obj = Node::new(
-                namespace_id.clone(),
+                namespace_id,
                 namespace_name.to_string(),
                 NodeType::Module,
                 file_path.to_path_buf(),
@@ -98,7 +98,7 @@ impl CSharpParser {
                     &declaration_list,
                     source,
                     file_path,
-                    &namespace_id,
+                    namespace_id,
                     nodes,
                     edges,
                 );
@@ -111,7 +111,7 @@ impl CSharpParser {
         declaration_list: &TSNode,
         source: &[u8],
         file_path: &Path,
-        namespace_id: &str,
+        namespace_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -170,7 +170,7 @@ impl CSharpParser {
         class_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        namespace_id: Option<&str>,
+        namespace_id: Option<NodeId>,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -180,7 +180,7 @@ impl CSharpParser {
             let class_id = generate_node_id(file_path, "class", &class_name, line_number);
 
             let mut class_node_obj = Node::new(
-                class_id.clone(),
+                class_id,
                 class_name.to_string(),
                 NodeType::Class,
                 file_path.to_path_buf(),
@@ -202,8 +202,7 @@ impl CSharpParser {
 
                         // For simplicity, treating all base types as inheritance
                         // In a more sophisticated parser, we'd distinguish between classes and interfaces
-                        let inheritance_edge =
-                            Edge::new(EdgeType::Inheritance, class_id.clone(), base_id);
+                        let inheritance_edge = Edge::new(EdgeType::Inheritance, class_id, base_id);
                         edges.push(inheritance_edge);
                     }
                 }
@@ -212,16 +211,12 @@ impl CSharpParser {
             nodes.push(class_node_obj);
 
             if let Some(namespace_id) = namespace_id {
-                let contains_edge = Edge::new(
-                    EdgeType::Contains,
-                    namespace_id.to_string(),
-                    class_id.clone(),
-                );
+                let contains_edge = Edge::new(EdgeType::Contains, namespace_id, class_id);
                 edges.push(contains_edge);
             }
 
             // Extract class members
-            self.extract_class_members(class_node, source, file_path, &class_id, nodes, edges);
+            self.extract_class_members(class_node, source, file_path, class_id, nodes, edges);
         }
     }
 
@@ -230,7 +225,7 @@ impl CSharpParser {
         struct_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        namespace_id: Option<&str>,
+        namespace_id: Option<NodeId>,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -240,7 +235,7 @@ impl CSharpParser {
             let struct_id = generate_node_id(file_path, "struct", &struct_name, line_number);
 
             let struct_node_obj = Node::new(
-                struct_id.clone(),
+                struct_id,
                 struct_name.to_string(),
                 NodeType::Class, // Using Class type for structs
                 file_path.to_path_buf(),
@@ -251,16 +246,12 @@ impl CSharpParser {
             nodes.push(struct_node_obj);
 
             if let Some(namespace_id) = namespace_id {
-                let contains_edge = Edge::new(
-                    EdgeType::Contains,
-                    namespace_id.to_string(),
-                    struct_id.clone(),
-                );
+                let contains_edge = Edge::new(EdgeType::Contains, namespace_id, struct_id);
                 edges.push(contains_edge);
             }
 
             // Extract struct members
-            self.extract_class_members(struct_node, source, file_path, &struct_id, nodes, edges);
+            self.extract_class_members(struct_node, source, file_path, struct_id, nodes, edges);
         }
     }
 
@@ -269,7 +260,7 @@ impl CSharpParser {
         enum_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        namespace_id: Option<&str>,
+        namespace_id: Option<NodeId>,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -279,7 +270,7 @@ impl CSharpParser {
             let enum_id = generate_node_id(file_path, "enum", &enum_name, line_number);
 
             let enum_node_obj = Node::new(
-                enum_id.clone(),
+                enum_id,
                 enum_name.to_string(),
                 NodeType::Class, // Using Class type for enums
                 file_path.to_path_buf(),
@@ -290,11 +281,7 @@ impl CSharpParser {
             nodes.push(enum_node_obj);
 
             if let Some(namespace_id) = namespace_id {
-                let contains_edge = Edge::new(
-                    EdgeType::Contains,
-                    namespace_id.to_string(),
-                    enum_id.clone(),
-                );
+                let contains_edge = Edge::new(EdgeType::Contains, namespace_id, enum_id);
                 edges.push(contains_edge);
             }
 
@@ -313,7 +300,7 @@ impl CSharpParser {
                                 generate_node_id(file_path, "variable", &member_name, member_line);
 
                             let member_node = Node::new(
-                                member_id.clone(),
+                                member_id,
                                 member_name.to_string(),
                                 NodeType::Variable,
                                 file_path.to_path_buf(),
@@ -324,8 +311,7 @@ impl CSharpParser {
 
                             nodes.push(member_node);
 
-                            let contains_edge =
-                                Edge::new(EdgeType::Contains, enum_id.clone(), member_id);
+                            let contains_edge = Edge::new(EdgeType::Contains, enum_id, member_id);
                             edges.push(contains_edge);
                         }
                     }
@@ -339,7 +325,7 @@ impl CSharpParser {
         class_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: &str,
+        class_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -386,7 +372,7 @@ impl CSharpParser {
         method_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: Option<&str>,
+        class_id: Option<NodeId>,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -403,7 +389,7 @@ impl CSharpParser {
             let visibility = self.extract_visibility_modifier(method_node, source);
 
             let mut method_node_obj = Node::new(
-                method_id.clone(),
+                method_id,
                 method_name.to_string(),
                 NodeType::Function,
                 file_path.to_path_buf(),
@@ -420,7 +406,7 @@ impl CSharpParser {
             nodes.push(method_node_obj);
 
             if let Some(class_id) = class_id {
-                let contains_edge = Edge::new(EdgeType::Contains, class_id.to_string(), method_id);
+                let contains_edge = Edge::new(EdgeType::Contains, class_id, method_id);
                 edges.push(contains_edge);
             }
         }
@@ -431,7 +417,7 @@ impl CSharpParser {
         constructor_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: Option<&str>,
+        class_id: Option<NodeId>,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -453,7 +439,7 @@ impl CSharpParser {
             let visibility = self.extract_visibility_modifier(constructor_node, source);
 
             let constructor_node_obj = Node::new(
-                constructor_id.clone(),
+                constructor_id,
                 constructor_name.to_string(),
                 NodeType::Function,
                 file_path.to_path_buf(),
@@ -466,8 +452,7 @@ impl CSharpParser {
             nodes.push(constructor_node_obj);
 
             if let Some(class_id) = class_id {
-                let contains_edge =
-                    Edge::new(EdgeType::Contains, class_id.to_string(), constructor_id);
+                let contains_edge = Edge::new(EdgeType::Contains, class_id, constructor_id);
                 edges.push(contains_edge);
             }
         }
@@ -478,7 +463,7 @@ impl CSharpParser {
         field_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: &str,
+        class_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -495,7 +480,7 @@ impl CSharpParser {
                     let visibility = self.extract_visibility_modifier(field_node, source);
 
                     let field_node_obj = Node::new(
-                        field_id.clone(),
+                        field_id,
                         field_name.to_string(),
                         NodeType::Variable,
                         file_path.to_path_buf(),
@@ -506,8 +491,7 @@ impl CSharpParser {
 
                     nodes.push(field_node_obj);
 
-                    let contains_edge =
-                        Edge::new(EdgeType::Contains, class_id.to_string(), field_id);
+                    let contains_edge = Edge::new(EdgeType::Contains, class_id, field_id);
                     edges.push(contains_edge);
                 }
             }
@@ -519,7 +503,7 @@ impl CSharpParser {
         property_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: &str,
+        class_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -531,7 +515,7 @@ impl CSharpParser {
             let visibility = self.extract_visibility_modifier(property_node, source);
 
             let property_node_obj = Node::new(
-                property_id.clone(),
+                property_id,
                 property_name.to_string(),
                 NodeType::Variable, // Using Variable type for properties
                 file_path.to_path_buf(),
@@ -542,7 +526,7 @@ impl CSharpParser {
 
             nodes.push(property_node_obj);
 
-            let contains_edge = Edge::new(EdgeType::Contains, class_id.to_string(), property_id);
+            let contains_edge = Edge::new(EdgeType::Contains, class_id, property_id);
             edges.push(contains_edge);
         }
     }
@@ -552,7 +536,7 @@ impl CSharpParser {
         event_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: &str,
+        class_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -568,7 +552,7 @@ impl CSharpParser {
                     let visibility = self.extract_visibility_modifier(event_node, source);
 
                     let event_node_obj = Node::new(
-                        event_id.clone(),
+                        event_id,
                         event_name.to_string(),
                         NodeType::Variable, // Using Variable type for events
                         file_path.to_path_buf(),
@@ -579,8 +563,7 @@ impl CSharpParser {
 
                     nodes.push(event_node_obj);
 
-                    let contains_edge =
-                        Edge::new(EdgeType::Contains, class_id.to_string(), event_id);
+                    let contains_edge = Edge::new(EdgeType::Contains, class_id, event_id);
                     edges.push(contains_edge);
                 }
             }
@@ -609,7 +592,7 @@ impl CSharpParser {
         interface_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        namespace_id: Option<&str>,
+        namespace_id: Option<NodeId>,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -620,7 +603,7 @@ impl CSharpParser {
                 generate_node_id(file_path, "interface", &interface_name, line_number);
 
             let interface_node_obj = Node::new(
-                interface_id.clone(),
+                interface_id,
                 interface_name.to_string(),
                 NodeType::Interface,
                 file_path.to_path_buf(),
@@ -631,11 +614,7 @@ impl CSharpParser {
             nodes.push(interface_node_obj);
 
             if let Some(namespace_id) = namespace_id {
-                let contains_edge = Edge::new(
-                    EdgeType::Contains,
-                    namespace_id.to_string(),
-                    interface_id.clone(),
-                );
+                let contains_edge = Edge::new(EdgeType::Contains, namespace_id, interface_id);
                 edges.push(contains_edge);
             }
 
@@ -647,7 +626,7 @@ impl CSharpParser {
                             &child,
                             source,
                             file_path,
-                            Some(&interface_id),
+                            Some(interface_id),
                             nodes,
                             edges,
                         );
@@ -682,17 +661,14 @@ impl CSharpParser {
         source: &[u8],
         file_path: &Path,
     ) -> Vec<CallSite> {
-        let mut extractor = CallSiteExtractor::new();
+        let mut extractor = CallSiteExtractor::new(self.parser.call_kinds());
         extractor.extract_from_ast(root_node, source, file_path)
     }
 }
 
 impl LanguageParser for CSharpParser {
-    fn parse_file(&self, file_path: &Path) -> Result<ParseResult> {
-        let mut parser = TreeSitterParser::new(tree_sitter_c_sharp::language())?;
-        let tree = parser.parse_file(file_path)?;
-        let source = parser.get_source(file_path)?;
-        let source_bytes = source.as_bytes();
+    fn parse_source(&self, file_path: &Path, source_bytes: &[u8]) -> Result<ParseResult> {
+        let tree = self.parser.parse_source(source_bytes, file_path)?;
 
         let root_node = tree.root_node();
         let mut nodes = Vec::new();
@@ -710,9 +686,20 @@ impl LanguageParser for CSharpParser {
             nodes,
             edges,
             call_sites: Some(call_sites),
+            exports: Vec::new(),
+            limited: None,
         })
     }
 
+    fn parse_outline(
+        &self,
+        file_path: &Path,
+        source: &[u8],
+        timeout: Duration,
+    ) -> Result<Option<ParseResult>> {
+        self.parser.parse_outline(source, file_path, timeout)
+    }
+
     fn language_name(&self) -> &str {
         "csharp"
     }
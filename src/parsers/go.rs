@@ -1,5 +1,6 @@
 use anyhow::Result;
 use std::path::Path;
+use std::time::Duration;
 use tree_sitter::Node as TSNode;
 
 use super::common::{
@@ -7,17 +8,16 @@ use super::common::{
     TreeSitterParser,
 };
 use super::{LanguageParser, ParseResult};
-use crate::core::{CallSite, CallSiteExtractor, Edge, EdgeType, Node, NodeType};
+use crate::core::{CallSite, CallSiteExtractor, Edge, EdgeType, Node, NodeId, NodeType};
 
 pub struct GoParser {
-    #[allow(dead_code)]
     parser: TreeSitterParser,
 }
 
 impl GoParser {
     pub fn new() -> Result<Self> {
         let language = tree_sitter_go::language();
-        let parser = TreeSitterParser::new(language)?;
+        let parser = TreeSitterParser::new("go", language)?;
         Ok(Self { parser })
     }
 
@@ -225,7 +225,7 @@ impl GoParser {
         let struct_id = generate_node_id(file_path, "struct", &struct_name, line_number);
 
         let struct_node_obj = Node::new(
-            struct_id.clone(),
+            struct_id,
             struct_name.to_string(),
             NodeType::Class,
             file_path.to_path_buf(),
@@ -245,7 +245,7 @@ impl GoParser {
                         &field_decl,
                         source,
                         file_path,
-                        &struct_id,
+                        struct_id,
                         nodes,
                         edges,
                     );
@@ -259,7 +259,7 @@ impl GoParser {
         field_decl: &TSNode,
         source: &[u8],
         file_path: &Path,
-        struct_id: &str,
+        struct_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -270,7 +270,7 @@ impl GoParser {
             let field_id = generate_node_id(file_path, "field", &field_name, line_number);
 
             let field_node_obj = Node::new(
-                field_id.clone(),
+                field_id,
                 field_name.to_string(),
                 NodeType::Variable,
                 file_path.to_path_buf(),
@@ -281,7 +281,7 @@ impl GoParser {
 
             nodes.push(field_node_obj);
 
-            let contains_edge = Edge::new(EdgeType::Contains, struct_id.to_string(), field_id);
+            let contains_edge = Edge::new(EdgeType::Contains, struct_id, field_id);
             edges.push(contains_edge);
         }
     }
@@ -300,7 +300,7 @@ impl GoParser {
         let interface_id = generate_node_id(file_path, "interface", &interface_name, line_number);
 
         let interface_node_obj = Node::new(
-            interface_id.clone(),
+            interface_id,
             interface_name.to_string(),
             NodeType::Interface,
             file_path.to_path_buf(),
@@ -323,7 +323,7 @@ impl GoParser {
                             generate_node_id(file_path, "function", &method_name, method_line);
 
                         let method_node_obj = Node::new(
-                            method_id.clone(),
+                            method_id,
                             method_name.to_string(),
                             NodeType::Function,
                             file_path.to_path_buf(),
@@ -333,8 +333,7 @@ impl GoParser {
 
                         nodes.push(method_node_obj);
 
-                        let contains_edge =
-                            Edge::new(EdgeType::Contains, interface_id.clone(), method_id);
+                        let contains_edge = Edge::new(EdgeType::Contains, interface_id, method_id);
                         edges.push(contains_edge);
                     }
                 }
@@ -416,7 +415,7 @@ impl GoParser {
             }
 
             let mut method_node_obj = Node::new(
-                method_id.clone(),
+                method_id,
                 method_name.to_string(),
                 NodeType::Function,
                 file_path.to_path_buf(),
@@ -576,17 +575,14 @@ impl GoParser {
         source: &[u8],
         file_path: &Path,
     ) -> Vec<CallSite> {
-        let mut extractor = CallSiteExtractor::new();
+        let mut extractor = CallSiteExtractor::new(self.parser.call_kinds());
         extractor.extract_from_ast(root_node, source, file_path)
     }
 }
 
 impl LanguageParser for GoParser {
-    fn parse_file(&self, file_path: &Path) -> Result<ParseResult> {
-        let mut parser = TreeSitterParser::new(tree_sitter_go::language())?;
-        let tree = parser.parse_file(file_path)?;
-        let source = parser.get_source(file_path)?;
-        let source_bytes = source.as_bytes();
+    fn parse_source(&self, file_path: &Path, source_bytes: &[u8]) -> Result<ParseResult> {
+        let tree = self.parser.parse_source(source_bytes, file_path)?;
 
         let root_node = tree.root_node();
         let mut nodes = Vec::new();
@@ -605,9 +601,20 @@ impl LanguageParser for GoParser {
             nodes,
             edges,
             call_sites: Some(call_sites),
+            exports: Vec::new(),
+            limited: None,
         })
     }
 
+    fn parse_outline(
+        &self,
+        file_path: &Path,
+        source: &[u8],
+        timeout: Duration,
+    ) -> Result<Option<ParseResult>> {
+        self.parser.parse_outline(source, file_path, timeout)
+    }
+
     fn language_name(&self) -> &str {
         "go"
     }
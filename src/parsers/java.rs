@@ -1,22 +1,22 @@
 use anyhow::Result;
 use std::path::Path;
+use std::time::Duration;
 use tree_sitter::Node as TSNode;
 
 use super::common::{
     extract_docstring, extract_text, find_child_by_kind, generate_node_id, TreeSitterParser,
 };
 use super::{LanguageParser, ParseResult};
-use crate::core::{CallSite, CallSiteExtractor, Edge, EdgeType, Node, NodeType};
+use crate::core::{CallSite, CallSiteExtractor, Edge, EdgeType, Node, NodeId, NodeType};
 
 pub struct JavaParser {
-    #[allow(dead_code)]
     parser: TreeSitterParser,
 }
 
 impl JavaParser {
     pub fn new() -> Result<Self> {
         let language = tree_sitter_java::language();
-        let parser = TreeSitterParser::new(language)?;
+        let parser = TreeSitterParser::new("java", language)?;
         Ok(Self { parser })
     }
 
@@ -129,7 +129,7 @@ impl JavaParser {
             let class_id = generate_node_id(file_path, "class", &class_name, line_number);
 
             let mut class_node_obj = Node::new(
-                class_id.clone(),
+                class_id,
                 class_name.to_string(),
                 NodeType::Class,
                 file_path.to_path_buf(),
@@ -147,8 +147,7 @@ impl JavaParser {
                 if let Some(type_node) = find_child_by_kind(&superclass, "type_identifier") {
                     let parent_class = extract_text(&type_node, source);
                     let parent_id = format!("external:class:{}:0", parent_class);
-                    let inheritance_edge =
-                        Edge::new(EdgeType::Inheritance, class_id.clone(), parent_id);
+                    let inheritance_edge = Edge::new(EdgeType::Inheritance, class_id, parent_id);
                     edges.push(inheritance_edge);
                 }
             }
@@ -163,7 +162,7 @@ impl JavaParser {
                                 let interface_id =
                                     format!("external:interface:{}:0", interface_name);
                                 let implements_edge =
-                                    Edge::new(EdgeType::Implements, class_id.clone(), interface_id);
+                                    Edge::new(EdgeType::Implements, class_id, interface_id);
                                 edges.push(implements_edge);
                             }
                         }
@@ -174,7 +173,7 @@ impl JavaParser {
             nodes.push(class_node_obj);
 
             // Extract class members
-            self.extract_class_members(class_node, source, file_path, &class_id, nodes, edges);
+            self.extract_class_members(class_node, source, file_path, class_id, nodes, edges);
         }
     }
 
@@ -192,7 +191,7 @@ impl JavaParser {
             let enum_id = generate_node_id(file_path, "enum", &enum_name, line_number);
 
             let enum_node_obj = Node::new(
-                enum_id.clone(),
+                enum_id,
                 enum_name.to_string(),
                 NodeType::Class, // Treating enums as classes for simplicity
                 file_path.to_path_buf(),
@@ -217,7 +216,7 @@ impl JavaParser {
                             );
 
                             let constant_node = Node::new(
-                                constant_id.clone(),
+                                constant_id,
                                 constant_name.to_string(),
                                 NodeType::Variable,
                                 file_path.to_path_buf(),
@@ -228,8 +227,7 @@ impl JavaParser {
 
                             nodes.push(constant_node);
 
-                            let contains_edge =
-                                Edge::new(EdgeType::Contains, enum_id.clone(), constant_id);
+                            let contains_edge = Edge::new(EdgeType::Contains, enum_id, constant_id);
                             edges.push(contains_edge);
                         }
                     }
@@ -243,7 +241,7 @@ impl JavaParser {
         class_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: &str,
+        class_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -278,7 +276,7 @@ impl JavaParser {
         field_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: &str,
+        class_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -307,7 +305,7 @@ impl JavaParser {
                 }
 
                 let field_node_obj = Node::new(
-                    field_id.clone(),
+                    field_id,
                     field_name.to_string(),
                     NodeType::Variable,
                     file_path.to_path_buf(),
@@ -318,7 +316,7 @@ impl JavaParser {
 
                 nodes.push(field_node_obj);
 
-                let contains_edge = Edge::new(EdgeType::Contains, class_id.to_string(), field_id);
+                let contains_edge = Edge::new(EdgeType::Contains, class_id, field_id);
                 edges.push(contains_edge);
             }
         }
@@ -356,7 +354,7 @@ impl JavaParser {
                 generate_node_id(file_path, "interface", &interface_name, line_number);
 
             let interface_node_obj = Node::new(
-                interface_id.clone(),
+                interface_id,
                 interface_name.to_string(),
                 NodeType::Interface,
                 file_path.to_path_buf(),
@@ -374,7 +372,7 @@ impl JavaParser {
                             &child,
                             source,
                             file_path,
-                            Some(&interface_id),
+                            Some(interface_id),
                             nodes,
                             edges,
                         );
@@ -406,7 +404,7 @@ impl JavaParser {
         method_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: Option<&str>,
+        class_id: Option<NodeId>,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -438,7 +436,7 @@ impl JavaParser {
             }
 
             let mut method_node_obj = Node::new(
-                method_id.clone(),
+                method_id,
                 method_name.to_string(),
                 NodeType::Function,
                 file_path.to_path_buf(),
@@ -455,7 +453,7 @@ impl JavaParser {
             nodes.push(method_node_obj);
 
             if let Some(class_id) = class_id {
-                let contains_edge = Edge::new(EdgeType::Contains, class_id.to_string(), method_id);
+                let contains_edge = Edge::new(EdgeType::Contains, class_id, method_id);
                 edges.push(contains_edge);
             }
         }
@@ -468,17 +466,14 @@ impl JavaParser {
         source: &[u8],
         file_path: &Path,
     ) -> Vec<CallSite> {
-        let mut extractor = CallSiteExtractor::new();
+        let mut extractor = CallSiteExtractor::new(self.parser.call_kinds());
         extractor.extract_from_ast(root_node, source, file_path)
     }
 }
 
 impl LanguageParser for JavaParser {
-    fn parse_file(&self, file_path: &Path) -> Result<ParseResult> {
-        let mut parser = TreeSitterParser::new(tree_sitter_java::language())?;
-        let tree = parser.parse_file(file_path)?;
-        let source = parser.get_source(file_path)?;
-        let source_bytes = source.as_bytes();
+    fn parse_source(&self, file_path: &Path, source_bytes: &[u8]) -> Result<ParseResult> {
+        let tree = self.parser.parse_source(source_bytes, file_path)?;
 
         let root_node = tree.root_node();
         let mut nodes = Vec::new();
@@ -497,9 +492,20 @@ impl LanguageParser for JavaParser {
             nodes,
             edges,
             call_sites: Some(call_sites),
+            exports: Vec::new(),
+            limited: None,
         })
     }
 
+    fn parse_outline(
+        &self,
+        file_path: &Path,
+        source: &[u8],
+        timeout: Duration,
+    ) -> Result<Option<ParseResult>> {
+        self.parser.parse_outline(source, file_path, timeout)
+    }
+
     fn language_name(&self) -> &str {
         "java"
     }
@@ -0,0 +1,224 @@
+//! Guardrails for oversized, minified and generated sources.
+//!
+//! A minified bundle or an amalgamated C++ file can cost more to parse and walk
+//! than the rest of a tree together while adding little the resolver can use.
+//! Files over the limits get an outline parse instead: declarations only, no
+//! function bodies and no call sites, under a parse timeout.
+
+use anyhow::Result;
+use serde::{Deserialize, Serialize};
+use std::fmt;
+use std::path::Path;
+use std::time::Duration;
+use xxhash_rust::xxh3::xxh3_64;
+
+use super::source::SourceBuffer;
+use super::{LanguageParser, ParseResult};
+
+pub const DEFAULT_MAX_BYTES: u64 = 2 * 1024 * 1024;
+pub const DEFAULT_MAX_LINES: usize = 50_000;
+pub const DEFAULT_OUTLINE_TIMEOUT: Duration = Duration::from_secs(2);
+
+/// Leading bytes searched for the header comment holding a generated-file marker
+const MARKER_WINDOW: usize = 4 * 1024;
+/// Leading bytes whose line lengths decide whether a file is minified
+const MINIFIED_WINDOW: usize = 64 * 1024;
+/// Files shorter than this are never considered minified
+const MINIFIED_MIN_BYTES: usize = 4 * 1024;
+const MINIFIED_AVG_LINE_LEN: usize = 500;
+
+/// Lower-cased header comments of generated sources (`// Code generated ... DO NOT EDIT.`)
+const GENERATED_MARKERS: [&str; 5] = [
+    "@generated",
+    "do not edit",
+    "code generated",
+    "auto-generated",
+    "autogenerated",
+];
+
+/// Prefixes of single-line comments and preprocessor or shebang lines in a file header
+const LINE_COMMENTS: [&str; 5] = ["//", "#", "--", ";", "*"];
+/// Openers and closers of block comments and docstrings
+const BLOCK_COMMENTS: [(&str, &str); 4] = [
+    ("/*", "*/"),
+    ("<!--", "-->"),
+    ("\"\"\"", "\"\"\""),
+    ("'''", "'''"),
+];
+
+/// Why a file was only outlined
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
+pub enum LimitReason {
+    /// File size in bytes, over `max_bytes`
+    Bytes(u64),
+    /// Line count, over `max_lines`
+    Lines(usize),
+    Minified,
+    Generated,
+    /// The outline parse ran past its timeout; nothing was extracted
+    Timeout,
+}
+
+impl fmt::Display for LimitReason {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match self {
+            LimitReason::Bytes(bytes) => write!(f, "{} KiB", bytes / 1024),
+            LimitReason::Lines(lines) => write!(f, "{} lines", lines),
+            LimitReason::Minified => f.write_str("minified"),
+            LimitReason::Generated => f.write_str("generated"),
+            LimitReason::Timeout => f.write_str("parse timed out"),
+        }
+    }
+}
+
+/// Size and content limits above which a file is outlined instead of parsed.
+#[derive(Debug, Clone, Copy)]
+pub struct ParseLimits {
+    pub max_bytes: u64,
+    pub max_lines: usize,
+    /// Outline minified and generated files regardless of size
+    pub detect_generated: bool,
+    /// Budget of one outline parse; zero waits for the parse to finish
+    pub outline_timeout: Duration,
+}
+
+impl Default for ParseLimits {
+    fn default() -> Self {
+        Self {
+            max_bytes: DEFAULT_MAX_BYTES,
+            max_lines: DEFAULT_MAX_LINES,
+            detect_generated: true,
+            outline_timeout: DEFAULT_OUTLINE_TIMEOUT,
+        }
+    }
+}
+
+impl ParseLimits {
+    /// Every file gets a full parse
+    pub fn unlimited() -> Self {
+        Self {
+            max_bytes: u64::MAX,
+            max_lines: usize::MAX,
+            detect_generated: false,
+            outline_timeout: Duration::ZERO,
+        }
+    }
+
+    /// Identifies the limits that decide which files are outlined.
+    ///
+    /// Cached and saved results are only reused under the same fingerprint; the
+    /// timeout is left out because timed-out results are never kept.
+    pub fn fingerprint(&self) -> u64 {
+        let mut key = Vec::with_capacity(17);
+        key.extend_from_slice(&self.max_bytes.to_le_bytes());
+        key.extend_from_slice(&(self.max_lines as u64).to_le_bytes());
+        key.push(self.detect_generated as u8);
+        xxh3_64(&key)
+    }
+
+    /// The first limit `source` exceeds, cheapest checks first
+    pub fn check(&self, file_path: &Path, source: &[u8]) -> Option<LimitReason> {
+        if source.len() as u64 > self.max_bytes {
+            return Some(LimitReason::Bytes(source.len() as u64));
+        }
+        if self.detect_generated {
+            if is_generated(source) {
+                return Some(LimitReason::Generated);
+            }
+            if is_minified(file_path, source) {
+                return Some(LimitReason::Minified);
+            }
+        }
+        if self.max_lines != usize::MAX {
+            let lines = line_count(source);
+            if lines > self.max_lines {
+                return Some(LimitReason::Lines(lines));
+            }
+        }
+        None
+    }
+}
+
+/// Loads `file_path` once and parses it in full, or outlines it when it is over `limits`.
+pub fn parse_limited(
+    parser: &dyn LanguageParser,
+    file_path: &Path,
+    limits: &ParseLimits,
+) -> Result<ParseResult> {
+    let source = SourceBuffer::load(file_path)?;
+    let Some(reason) = limits.check(file_path, &source) else {
+        return parser.parse_source(file_path, &source);
+    };
+    let outline = parser.parse_outline(file_path, &source, limits.outline_timeout)?;
+    Ok(match outline {
+        Some(result) => ParseResult {
+            limited: Some(reason),
+            ..result
+        },
+        None => ParseResult {
+            nodes: Vec::new(),
+            edges: Vec::new(),
+            call_sites: None,
+            exports: Vec::new(),
+            limited: Some(LimitReason::Timeout),
+        },
+    })
+}
+
+/// A generated-file marker in the leading comments or module docstring.
+///
+/// Only lines before the first line of code count, so a marker quoted in a
+/// string or in a comment further down does not make a file generated.
+pub fn is_generated(source: &[u8]) -> bool {
+    let header = &source[..source.len().min(MARKER_WINDOW)];
+    let header = String::from_utf8_lossy(header);
+    // Closer of the block comment or docstring the previous line left open
+    let mut open_block: Option<&str> = None;
+    for line in header.lines().map(str::trim) {
+        match open_block {
+            Some(close) => {
+                if line.contains(close) {
+                    open_block = None;
+                }
+            }
+            None if line.is_empty() => continue,
+            None => {
+                if let Some((open, close)) = BLOCK_COMMENTS
+                    .iter()
+                    .find(|(open, _)| line.starts_with(open))
+                {
+                    if !line[open.len()..].contains(close) {
+                        open_block = Some(close);
+                    }
+                } else if !LINE_COMMENTS.iter().any(|prefix| line.starts_with(prefix)) {
+                    return false;
+                }
+            }
+        }
+        let line = line.to_ascii_lowercase();
+        if GENERATED_MARKERS.iter().any(|marker| line.contains(marker)) {
+            return true;
+        }
+    }
+    false
+}
+
+/// A `.min.` file name, or leading lines far longer than hand-written code has
+pub fn is_minified(file_path: &Path, source: &[u8]) -> bool {
+    let name = file_path
+        .file_name()
+        .and_then(|name| name.to_str())
+        .unwrap_or("");
+    if name.contains(".min.") || name.contains("-min.") {
+        return true;
+    }
+    if source.len() < MINIFIED_MIN_BYTES {
+        return false;
+    }
+    let window = &source[..source.len().min(MINIFIED_WINDOW)];
+    window.len() / line_count(window) > MINIFIED_AVG_LINE_LEN
+}
+
+fn line_count(source: &[u8]) -> usize {
+    source.iter().filter(|&&byte| byte == b'\n').count() + 1
+}
@@ -5,45 +5,108 @@ pub mod csharp;
 pub mod go;
 pub mod java;
 pub mod javascript;
+pub mod limits;
+pub mod outline;
 pub mod python;
+pub mod query;
 pub mod rust;
+pub mod source;
 pub mod typescript;
 
 use anyhow::Result;
+use dashmap::DashMap;
 use std::path::Path;
+use std::sync::Arc;
+use std::time::Duration;
 
-use crate::core::{CallSite, Edge, Node};
+use self::limits::LimitReason;
+use self::source::SourceBuffer;
+use crate::core::{CallSite, Edge, Node, NodeExport};
 
 #[derive(Debug, Clone)]
 pub struct ParseResult {
     pub nodes: Vec<Node>,
     pub edges: Vec<Edge>,
     pub call_sites: Option<Vec<CallSite>>,
+    /// Entry points the file serves to other languages, e.g. HTTP routes
+    pub exports: Vec<NodeExport>,
+    /// Set when the file was over the parse limits and only outlined
+    pub limited: Option<LimitReason>,
 }
 
 pub trait LanguageParser {
-    fn parse_file(&self, file_path: &Path) -> Result<ParseResult>;
+    /// Full parse of a file already loaded into memory
+    fn parse_source(&self, file_path: &Path, source: &[u8]) -> Result<ParseResult>;
+
+    /// Declarations only, skipping function bodies and call sites.
+    ///
+    /// `None` when the parse ran past `timeout` (zero waits indefinitely).
+    fn parse_outline(
+        &self,
+        file_path: &Path,
+        source: &[u8],
+        timeout: Duration,
+    ) -> Result<Option<ParseResult>>;
+
+    #[allow(dead_code)]
+    fn parse_file(&self, file_path: &Path) -> Result<ParseResult> {
+        let source = SourceBuffer::load(file_path)?;
+        self.parse_source(file_path, &source)
+    }
+
     #[allow(dead_code)]
     fn language_name(&self) -> &str;
 }
 
-pub struct ParserFactory;
+/// Parser instance shared by every worker thread.
+pub type SharedParser = Arc<dyn LanguageParser + Send + Sync>;
+
+/// Hands out one shared parser per language, created on first request.
+pub struct ParserFactory {
+    parsers: DashMap<&'static str, SharedParser>,
+}
 
 impl ParserFactory {
     pub fn new() -> Self {
-        Self
+        Self {
+            parsers: DashMap::new(),
+        }
+    }
+
+    pub fn get_parser(&self, language: &str) -> Result<SharedParser> {
+        let key = Self::canonical_language(language)?;
+        if let Some(parser) = self.parsers.get(key) {
+            return Ok(Arc::clone(&parser));
+        }
+
+        let parser = Self::create_parser(key)?;
+        Ok(Arc::clone(&self.parsers.entry(key).or_insert(parser)))
+    }
+
+    fn canonical_language(language: &str) -> Result<&'static str> {
+        match language {
+            "python" => Ok("python"),
+            "typescript" => Ok("typescript"),
+            "javascript" => Ok("javascript"),
+            "cpp" | "c++" => Ok("cpp"),
+            "rust" => Ok("rust"),
+            "java" => Ok("java"),
+            "go" => Ok("go"),
+            "csharp" | "c#" => Ok("csharp"),
+            _ => anyhow::bail!("Unsupported language: {}", language),
+        }
     }
 
-    pub fn get_parser(&self, language: &str) -> Result<Box<dyn LanguageParser + Send + Sync>> {
+    fn create_parser(language: &'static str) -> Result<SharedParser> {
         match language {
-            "python" => Ok(Box::new(python::PythonParser::new()?)),
-            "typescript" => Ok(Box::new(typescript::TypeScriptParser::new()?)),
-            "javascript" => Ok(Box::new(javascript::JavaScriptParser::new()?)),
-            "cpp" | "c++" => Ok(Box::new(cpp::CppParser::new()?)),
-            "rust" => Ok(Box::new(rust::RustParser::new()?)),
-            "java" => Ok(Box::new(java::JavaParser::new()?)),
-            "go" => Ok(Box::new(go::GoParser::new()?)),
-            "csharp" | "c#" => Ok(Box::new(csharp::CSharpParser::new()?)),
+            "python" => Ok(Arc::new(python::PythonParser::new()?)),
+            "typescript" => Ok(Arc::new(typescript::TypeScriptParser::new()?)),
+            "javascript" => Ok(Arc::new(javascript::JavaScriptParser::new()?)),
+            "cpp" => Ok(Arc::new(cpp::CppParser::new()?)),
+            "rust" => Ok(Arc::new(rust::RustParser::new()?)),
+            "java" => Ok(Arc::new(java::JavaParser::new()?)),
+            "go" => Ok(Arc::new(go::GoParser::new()?)),
+            "csharp" => Ok(Arc::new(csharp::CSharpParser::new()?)),
             _ => anyhow::bail!("Unsupported language: {}", language),
         }
     }
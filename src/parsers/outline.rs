@@ -0,0 +1,235 @@
+//! Outline parse: the declarations of a file without its function bodies.
+//!
+//! Used for files over the [`ParseLimits`](super::limits::ParseLimits). The walk
+//! enters the root, namespaces and type bodies only, so a function is recorded
+//! from its header and its body is never visited; no call sites are extracted.
+
+use std::path::Path;
+use tree_sitter::{Node as TSNode, Tree};
+
+use super::common::{extract_text, generate_node_id, KindTable, Visitor};
+use super::ParseResult;
+use crate::core::{Edge, EdgeType, Node, NodeId, NodeType};
+
+/// Longest signature kept for an outlined declaration
+const MAX_SIGNATURE_LEN: usize = 200;
+
+/// What an outline walk does with a node kind
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum OutlineRole {
+    /// Recorded; its body is skipped
+    Function,
+    /// Recorded and entered, so its members are recorded too
+    Type(NodeType),
+    /// Entered without being recorded: namespaces, export wrappers, type bodies
+    Container,
+}
+
+/// Declaration kinds of each grammar, keyed by the parser's language name
+pub fn kinds(language_name: &str) -> &'static [(&'static str, OutlineRole)] {
+    use OutlineRole::*;
+    const CLASS: OutlineRole = Type(NodeType::Class);
+    const INTERFACE: OutlineRole = Type(NodeType::Interface);
+    const ENUM: OutlineRole = Type(NodeType::Enum);
+    match language_name {
+        "python" => &[
+            ("function_definition", Function),
+            ("class_definition", CLASS),
+            ("decorated_definition", Container),
+            ("block", Container),
+        ],
+        "typescript" | "javascript" => &[
+            ("function_declaration", Function),
+            ("generator_function_declaration", Function),
+            ("method_definition", Function),
+            ("class_declaration", CLASS),
+            ("abstract_class_declaration", CLASS),
+            ("interface_declaration", INTERFACE),
+            ("enum_declaration", ENUM),
+            ("export_statement", Container),
+            ("class_body", Container),
+        ],
+        "rust" => &[
+            ("function_item", Function),
+            ("struct_item", CLASS),
+            ("trait_item", INTERFACE),
+            ("enum_item", ENUM),
+            ("impl_item", Container),
+            ("mod_item", Container),
+            ("declaration_list", Container),
+        ],
+        "cpp" => &[
+            ("function_definition", Function),
+            ("class_specifier", CLASS),
+            ("struct_specifier", CLASS),
+            ("enum_specifier", ENUM),
+            ("namespace_definition", Container),
+            ("declaration_list", Container),
+            ("field_declaration_list", Container),
+            ("template_declaration", Container),
+            ("linkage_specification", Container),
+        ],
+        "java" => &[
+            ("method_declaration", Function),
+            ("constructor_declaration", Function),
+            ("class_declaration", CLASS),
+            ("interface_declaration", INTERFACE),
+            ("enum_declaration", ENUM),
+            ("class_body", Container),
+            ("interface_body", Container),
+        ],
+        "csharp" => &[
+            ("method_declaration", Function),
+            ("constructor_declaration", Function),
+            ("class_declaration", CLASS),
+            ("struct_declaration", CLASS),
+            ("interface_declaration", INTERFACE),
+            ("enum_declaration", ENUM),
+            ("namespace_declaration", Container),
+            ("file_scoped_namespace_declaration", Container),
+            ("declaration_list", Container),
+        ],
+        "go" => &[
+            ("function_declaration", Function),
+            ("method_declaration", Function),
+            ("type_spec", CLASS),
+            ("type_declaration", Container),
+        ],
+        _ => &[],
+    }
+}
+
+/// Declarations of `tree`, with `Contains` edges from each type to its members
+pub fn extract(
+    kinds: &KindTable<OutlineRole>,
+    tree: &Tree,
+    source: &[u8],
+    file_path: &Path,
+    language: &str,
+) -> ParseResult {
+    let mut visitor = OutlineVisitor {
+        kinds,
+        source,
+        file_path,
+        language,
+        root: tree.root_node().id(),
+        owners: Vec::new(),
+        nodes: Vec::new(),
+        edges: Vec::new(),
+    };
+    super::common::walk_tree(tree.root_node(), &mut visitor);
+    ParseResult {
+        nodes: visitor.nodes,
+        edges: visitor.edges,
+        call_sites: None,
+        exports: Vec::new(),
+        limited: None,
+    }
+}
+
+struct OutlineVisitor<'a> {
+    kinds: &'a KindTable<OutlineRole>,
+    source: &'a [u8],
+    file_path: &'a Path,
+    language: &'a str,
+    root: usize,
+    /// Recorded types being walked: tree-sitter node id and graph id
+    owners: Vec<(usize, NodeId)>,
+    nodes: Vec<Node>,
+    edges: Vec<Edge>,
+}
+
+impl OutlineVisitor<'_> {
+    fn record(&mut self, node: &TSNode, node_type: NodeType) -> Option<NodeId> {
+        let name = declared_name(node, self.source)?;
+        let line = node.start_position().row + 1;
+        let type_name = match node_type {
+            NodeType::Function => "function",
+            NodeType::Interface => "interface",
+            NodeType::Enum => "enum",
+            _ => "class",
+        };
+        let id = generate_node_id(self.file_path, type_name, name, line);
+        let mut outlined = Node::new(
+            id,
+            name.to_string(),
+            node_type,
+            self.file_path.to_path_buf(),
+            line,
+            self.language.to_string(),
+        );
+        if let Some(signature) = header(node, self.source) {
+            outlined = outlined.with_signature(signature);
+        }
+        self.nodes.push(outlined);
+        if let Some(&(_, owner)) = self.owners.last() {
+            self.edges.push(Edge::new(EdgeType::Contains, owner, id));
+        }
+        Some(id)
+    }
+}
+
+impl<'tree> Visitor<'tree> for OutlineVisitor<'_> {
+    fn enter(&mut self, node: TSNode<'tree>) -> bool {
+        match self.kinds.get(&node) {
+            Some(OutlineRole::Function) => {
+                self.record(&node, NodeType::Function);
+                false
+            }
+            Some(OutlineRole::Type(node_type)) => {
+                if let Some(id) = self.record(&node, node_type) {
+                    self.owners.push((node.id(), id));
+                }
+                true
+            }
+            Some(OutlineRole::Container) => true,
+            None => node.id() == self.root,
+        }
+    }
+
+    fn leave(&mut self, node: TSNode<'tree>) {
+        if self
+            .owners
+            .last()
+            .map_or(false, |&(ts_id, _)| ts_id == node.id())
+        {
+            self.owners.pop();
+        }
+    }
+}
+
+/// `name` field of a declaration, or the innermost C/C++ `declarator`
+fn declared_name<'s>(node: &TSNode, source: &'s [u8]) -> Option<&'s str> {
+    let name = match node.child_by_field_name("name") {
+        Some(name) => name,
+        None => {
+            let mut declarator = node.child_by_field_name("declarator")?;
+            while let Some(inner) = declarator.child_by_field_name("declarator") {
+                declarator = inner;
+            }
+            declarator
+        }
+    };
+    let name = extract_text(&name, source).trim();
+    (!name.is_empty()).then_some(name)
+}
+
+/// Declaration text up to its body, on one line
+fn header(node: &TSNode, source: &[u8]) -> Option<String> {
+    let start = node.start_byte();
+    let end = node
+        .child_by_field_name("body")
+        .map_or(node.end_byte(), |body| body.start_byte())
+        // Bodiless declarations (a Go struct type) can be long; look at the start only
+        .min(start + 4 * MAX_SIGNATURE_LEN);
+    let text = String::from_utf8_lossy(&source[start..end]);
+    let text = text.split_whitespace().collect::<Vec<_>>().join(" ");
+    if text.is_empty() {
+        return None;
+    }
+    let mut cut = text.len().min(MAX_SIGNATURE_LEN);
+    while !text.is_char_boundary(cut) {
+        cut -= 1;
+    }
+    Some(text[..cut].to_string())
+}
@@ -1,30 +1,48 @@
 use anyhow::Result;
 use std::collections::HashMap;
 use std::path::Path;
+use std::time::Duration;
 use tree_sitter::Node as TSNode;
 
 use super::common::{
-    extract_docstring, extract_text, find_child_by_kind, generate_node_id, TreeSitterParser,
+    extract_docstring, extract_text, find_child_by_kind, generate_node_id, walk_tree, KindTable,
+    TreeSitterParser, Visitor,
 };
 use super::{LanguageParser, ParseResult};
-use crate::core::{CallSite, CallSiteExtractor, Edge, EdgeType, Node, NodeType};
+use crate::core::{
+    CallSite, CallSiteExtractor, Edge, EdgeType, Node, NodeExport, NodeId, NodeType,
+};
+
+/// Definition kinds the nested-function walk acts on
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum PythonKind {
+    Function,
+    Class,
+}
 
 pub struct PythonParser {
-    #[allow(dead_code)]
     parser: TreeSitterParser,
+    kinds: KindTable<PythonKind>,
 }
 
 /// Context for tracking classes defined in the current file for inheritance resolution
 struct FileContext {
     /// Maps class name to its node ID
-    class_map: HashMap<String, String>,
+    class_map: HashMap<String, NodeId>,
 }
 
 impl PythonParser {
     pub fn new() -> Result<Self> {
         let language = tree_sitter_python::language();
-        let parser = TreeSitterParser::new(language)?;
-        Ok(Self { parser })
+        let parser = TreeSitterParser::new("python", language)?;
+        let kinds = KindTable::new(
+            language,
+            &[
+                ("function_definition", PythonKind::Function),
+                ("class_definition", PythonKind::Class),
+            ],
+        );
+        Ok(Self { parser, kinds })
     }
 
     fn extract_imports(
@@ -60,7 +78,7 @@ impl PythonParser {
 
         let module_id = generate_node_id(file_path, "import", import_text, line_number);
         let import_node = Node::new(
-            module_id.clone(),
+            module_id,
             import_text.to_string(),
             NodeType::Module,
             file_path.to_path_buf(),
@@ -120,7 +138,7 @@ impl PythonParser {
             let class_id = generate_node_id(file_path, "class", class_name, line_number);
 
             let mut class_node_obj = Node::new(
-                class_id.clone(),
+                class_id,
                 class_name.to_string(),
                 NodeType::Class,
                 file_path.to_path_buf(),
@@ -138,7 +156,7 @@ impl PythonParser {
                     &argument_list,
                     source,
                     file_path,
-                    &class_id,
+                    class_id,
                     nodes,
                     edges,
                     file_context,
@@ -148,9 +166,9 @@ impl PythonParser {
             nodes.push(class_node_obj);
 
             // Extract decorators
-            self.extract_decorators(class_node, source, file_path, &class_id, edges);
+            self.extract_decorators(class_node, source, file_path, class_id, edges);
 
-            self.extract_class_methods(class_node, source, file_path, &class_id, nodes, edges);
+            self.extract_class_methods(class_node, source, file_path, class_id, nodes, edges);
         }
     }
 
@@ -160,7 +178,7 @@ impl PythonParser {
         argument_list: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: &str,
+        class_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
         file_context: &FileContext,
@@ -185,14 +203,14 @@ impl PythonParser {
 
             // Try to resolve to a local class first
             let parent_id = if let Some(local_id) = file_context.class_map.get(&parent_class) {
-                local_id.clone()
+                *local_id
             } else {
                 // Create external reference and placeholder node
-                let external_id = format!("external:class:{}:0", parent_class);
+                let external_id = NodeId::intern(&format!("external:class:{}:0", parent_class));
                 
                 // Add placeholder node for external class if not already added
                 let placeholder = Node::new(
-                    external_id.clone(),
+                    external_id,
                     parent_class.clone(),
                     NodeType::Class,
                     file_path.to_path_buf(),
@@ -208,7 +226,7 @@ impl PythonParser {
                 external_id
             };
 
-            let inheritance_edge = Edge::new(EdgeType::Inheritance, class_id.to_string(), parent_id);
+            let inheritance_edge = Edge::new(EdgeType::Inheritance, class_id, parent_id);
             edges.push(inheritance_edge);
         }
     }
@@ -219,7 +237,7 @@ impl PythonParser {
         node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        target_id: &str,
+        target_id: NodeId,
         edges: &mut Vec<Edge>,
     ) {
         // Look for decorator nodes that are siblings before the function/class
@@ -253,7 +271,7 @@ impl PythonParser {
         decorator_node: &TSNode,
         source: &[u8],
         _file_path: &Path,
-        target_id: &str,
+        target_id: NodeId,
         edges: &mut Vec<Edge>,
     ) {
         // Extract decorator name (skip the @ symbol)
@@ -269,7 +287,7 @@ impl PythonParser {
 
         if !base_name.is_empty() {
             let decorator_id = format!("external:decorator:{}:0", base_name);
-            let uses_edge = Edge::new(EdgeType::Uses, target_id.to_string(), decorator_id);
+            let uses_edge = Edge::new(EdgeType::Uses, target_id, decorator_id);
             edges.push(uses_edge);
         }
     }
@@ -279,7 +297,7 @@ impl PythonParser {
         class_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: &str,
+        class_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -314,7 +332,7 @@ impl PythonParser {
         func_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: Option<&str>,
+        class_id: Option<NodeId>,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -340,7 +358,7 @@ impl PythonParser {
             };
 
             let mut func_node_obj = Node::new(
-                func_id.clone(),
+                func_id,
                 func_name.to_string(),
                 NodeType::Function,
                 file_path.to_path_buf(),
@@ -360,16 +378,15 @@ impl PythonParser {
             nodes.push(func_node_obj);
 
             // Extract decorators for this function
-            self.extract_decorators(func_node, source, file_path, &func_id, edges);
+            self.extract_decorators(func_node, source, file_path, func_id, edges);
 
             if let Some(class_id) = class_id {
-                let contains_edge =
-                    Edge::new(EdgeType::Contains, class_id.to_string(), func_id.clone());
+                let contains_edge = Edge::new(EdgeType::Contains, class_id, func_id);
                 edges.push(contains_edge);
             }
 
             // Extract nested functions
-            self.extract_nested_functions(func_node, source, file_path, &func_id, nodes, edges);
+            self.extract_nested_functions(func_node, source, file_path, func_id, nodes, edges);
         }
     }
 
@@ -379,126 +396,133 @@ impl PythonParser {
         func_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        parent_func_id: &str,
+        parent_func_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
         if let Some(body) = find_child_by_kind(func_node, "block") {
-            self.traverse_for_nested_functions(&body, source, file_path, parent_func_id, nodes, edges);
+            let mut visitor = NestedFunctions {
+                parser: self,
+                source,
+                file_path,
+                nodes,
+                edges,
+                parents: vec![(body.id(), parent_func_id)],
+            };
+            walk_tree(body, &mut visitor);
         }
     }
 
-    fn traverse_for_nested_functions(
+    /// Adds a function nested in `parent_func_id`; `None` if it has no name
+    fn process_nested_function(
         &self,
-        node: &TSNode,
+        func_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        parent_func_id: &str,
+        parent_func_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
-    ) {
-        let mut cursor = node.walk();
-        for child in node.children(&mut cursor) {
-            if child.kind() == "function_definition" {
-                // Process nested function
-                if let Some(name_node) = find_child_by_kind(&child, "identifier") {
-                    let func_name = extract_text(&name_node, source);
-                    let line_number = child.start_position().row + 1;
-                    let func_id = generate_node_id(file_path, "function", func_name, line_number);
-
-                    let mut signature = func_name.to_string();
-                    if let Some(params) = find_child_by_kind(&child, "parameters") {
-                        signature = format!("{}({})", func_name, extract_text(&params, source));
-                    }
+    ) -> Option<NodeId> {
+        let name_node = find_child_by_kind(func_node, "identifier")?;
+        let func_name = extract_text(&name_node, source);
+        let line_number = func_node.start_position().row + 1;
+        let func_id = generate_node_id(file_path, "function", func_name, line_number);
+
+        let mut signature = func_name.to_string();
+        if let Some(params) = find_child_by_kind(func_node, "parameters") {
+            signature = format!("{}({})", func_name, extract_text(&params, source));
+        }
 
-                    let mut func_node_obj = Node::new(
-                        func_id.clone(),
-                        func_name.to_string(),
-                        NodeType::Function,
-                        file_path.to_path_buf(),
-                        line_number,
-                        "python".to_string(),
-                    )
-                    .with_signature(signature)
-                    .with_visibility("nested".to_string());
-
-                    if let Some(docstring) = extract_docstring(&child, source) {
-                        func_node_obj = func_node_obj.with_docstring(docstring);
-                    }
+        let mut func_node_obj = Node::new(
+            func_id,
+            func_name.to_string(),
+            NodeType::Function,
+            file_path.to_path_buf(),
+            line_number,
+            "python".to_string(),
+        )
+        .with_signature(signature)
+        .with_visibility("nested".to_string());
 
-                    nodes.push(func_node_obj);
+        if let Some(docstring) = extract_docstring(func_node, source) {
+            func_node_obj = func_node_obj.with_docstring(docstring);
+        }
 
-                    // Create containment edge from parent function
-                    let contains_edge =
-                        Edge::new(EdgeType::Contains, parent_func_id.to_string(), func_id.clone());
-                    edges.push(contains_edge);
+        nodes.push(func_node_obj);
 
-                    // Recursively check for further nested functions
-                    self.extract_nested_functions(&child, source, file_path, &func_id, nodes, edges);
-                }
-            } else if child.kind() != "class_definition" {
-                // Continue traversing but don't go into class definitions
-                self.traverse_for_nested_functions(&child, source, file_path, parent_func_id, nodes, edges);
-            }
-        }
+        // Create containment edge from parent function
+        edges.push(Edge::new(EdgeType::Contains, parent_func_id, func_id));
+        Some(func_id)
     }
 
-    #[allow(dead_code)]
-    fn extract_function_calls_legacy(
+    /// Extract call sites using the new optimized CallSiteExtractor, along
+    /// with the routes the file registers for its functions in `nodes`
+    fn extract_call_sites(
         &self,
-        func_node: &TSNode,
+        root_node: &TSNode,
         source: &[u8],
-        _file_path: &Path,
-        func_id: &str,
-        edges: &mut Vec<Edge>,
-    ) {
-        // Legacy implementation - kept for compatibility but will be replaced by CallSiteExtractor
-        self.traverse_for_calls_legacy(func_node, source, func_id, edges);
+        file_path: &Path,
+        nodes: &[Node],
+    ) -> (Vec<CallSite>, Vec<NodeExport>) {
+        let mut extractor = CallSiteExtractor::new(self.parser.call_kinds());
+        let call_sites = extractor.extract_from_ast(root_node, source, file_path);
+        (call_sites, extractor.take_exports(nodes))
     }
+}
 
-    #[allow(dead_code)]
-    fn traverse_for_calls_legacy(
-        &self,
-        node: &TSNode,
-        source: &[u8],
-        caller_id: &str,
-        edges: &mut Vec<Edge>,
-    ) {
-        if node.kind() == "call" {
-            if let Some(function_node) = node.child(0) {
-                let called_function = extract_text(&function_node, source);
-                if !called_function.is_empty() {
-                    let called_id = format!("external:function:{}:0", called_function);
-                    let call_edge = Edge::new(EdgeType::Call, caller_id.to_string(), called_id);
-                    edges.push(call_edge);
+/// Walks a function body for nested definitions, iteratively.
+///
+/// Each function found is contained by the innermost named function around it.
+/// Class bodies are skipped: their methods belong to class extraction.
+struct NestedFunctions<'p, 's> {
+    parser: &'p PythonParser,
+    source: &'s [u8],
+    file_path: &'p Path,
+    nodes: &'p mut Vec<Node>,
+    edges: &'p mut Vec<Edge>,
+    /// Tree node id and node id of each enclosing function, innermost last
+    parents: Vec<(usize, NodeId)>,
+}
+
+impl<'tree> Visitor<'tree> for NestedFunctions<'_, '_> {
+    fn enter(&mut self, node: TSNode<'tree>) -> bool {
+        match self.parser.kinds.get(&node) {
+            Some(PythonKind::Class) => false,
+            Some(PythonKind::Function) => {
+                let Some(&(_, parent_func_id)) = self.parents.last() else {
+                    return false;
+                };
+                let func_id = self.parser.process_nested_function(
+                    &node,
+                    self.source,
+                    self.file_path,
+                    parent_func_id,
+                    self.nodes,
+                    self.edges,
+                );
+                // An unnamed definition is skipped along with its body
+                match func_id {
+                    Some(func_id) => {
+                        self.parents.push((node.id(), func_id));
+                        true
+                    }
+                    None => false,
                 }
             }
-        }
-
-        let mut cursor = node.walk();
-        for child in node.children(&mut cursor) {
-            self.traverse_for_calls_legacy(&child, source, caller_id, edges);
+            None => true,
         }
     }
 
-    /// Extract call sites using the new optimized CallSiteExtractor
-    fn extract_call_sites(
-        &self,
-        root_node: &TSNode,
-        source: &[u8],
-        file_path: &Path,
-    ) -> Vec<CallSite> {
-        let mut extractor = CallSiteExtractor::new();
-        extractor.extract_from_ast(root_node, source, file_path)
+    fn leave(&mut self, node: TSNode<'tree>) {
+        if self.parents.last().is_some_and(|&(id, _)| id == node.id()) {
+            self.parents.pop();
+        }
     }
 }
 
 impl LanguageParser for PythonParser {
-    fn parse_file(&self, file_path: &Path) -> Result<ParseResult> {
-        let mut parser = TreeSitterParser::new(tree_sitter_python::language())?;
-        let tree = parser.parse_file(file_path)?;
-        let source = parser.get_source(file_path)?;
-        let source_bytes = source.as_bytes();
+    fn parse_source(&self, file_path: &Path, source_bytes: &[u8]) -> Result<ParseResult> {
+        let tree = self.parser.parse_source(source_bytes, file_path)?;
 
         let root_node = tree.root_node();
         let mut nodes = Vec::new();
@@ -509,15 +533,27 @@ impl LanguageParser for PythonParser {
         self.extract_functions(&root_node, source_bytes, file_path, &mut nodes, &mut edges);
 
         // Extract call sites using the new system
-        let call_sites = self.extract_call_sites(&root_node, source_bytes, file_path);
+        let (call_sites, exports) =
+            self.extract_call_sites(&root_node, source_bytes, file_path, &nodes);
 
         Ok(ParseResult {
             nodes,
             edges,
             call_sites: Some(call_sites),
+            exports,
+            limited: None,
         })
     }
 
+    fn parse_outline(
+        &self,
+        file_path: &Path,
+        source: &[u8],
+        timeout: Duration,
+    ) -> Result<Option<ParseResult>> {
+        self.parser.parse_outline(source, file_path, timeout)
+    }
+
     fn language_name(&self) -> &str {
         "python"
     }
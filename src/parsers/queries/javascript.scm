@@ -0,0 +1,65 @@
+; Declarations extracted by the JavaScript parser; see parsers/query.rs for
+; the capture names. Only top-level statements and class bodies are scanned.
+
+; Imports and CommonJS requires
+(program
+  (import_statement) @definition.import)
+
+(program
+  (variable_declaration
+    (variable_declarator
+      value: (call_expression
+        function: (identifier) @_require) @name)) @definition.require
+  (#eq? @_require "require"))
+
+; Classes, their methods and fields
+(program
+  (class_declaration
+    name: (identifier) @name
+    (class_heritage
+      (identifier) @parent)?) @definition.class)
+
+(program
+  (class_declaration
+    body: (class_body
+      (method_definition
+        name: (property_identifier) @name
+        parameters: (formal_parameters) @params) @definition.function)))
+
+(program
+  (class_declaration
+    body: (class_body
+      (field_definition
+        property: (property_identifier) @name) @definition.variable)))
+
+; Functions, function-valued variables and prototype methods
+(program
+  (function_declaration
+    name: (identifier) @name
+    parameters: (formal_parameters) @params) @definition.function)
+
+(program
+  (variable_declaration
+    (variable_declarator
+      name: (identifier) @name
+      value: [(arrow_function) (function)]) @definition.function))
+
+(program
+  (expression_statement
+    (assignment_expression
+      left: (member_expression
+        object: (member_expression
+          object: (identifier) @owner
+          property: (property_identifier) @_prototype)
+        property: (property_identifier) @name)
+      right: (function))) @definition.function
+  (#eq? @_prototype "prototype"))
+
+; Methods of object literals assigned to variables
+(program
+  (variable_declaration
+    (variable_declarator
+      value: (object
+        (pair
+          key: (_) @name
+          value: (function)) @definition.function))))
@@ -0,0 +1,235 @@
+//! Query-driven declaration extraction.
+//!
+//! A language describes its declarations in a tree-sitter query file
+//! (`queries/<language>.scm`) that is compiled once, when its parser is
+//! created. Extraction runs the query through a per-thread `QueryCursor`, so
+//! tree-sitter's matcher does the filtering and a new language needs a query
+//! rather than a hand-written walker.
+//!
+//! Capture names understood by [`QueryExtractor`]:
+//!
+//! - `@definition.<kind>`: the declaration. `<kind>` is the type part of the
+//!   node id and picks the [`NodeType`]; the line is taken from this node.
+//! - `@name`: the declared name; defaults to the declaration's own text.
+//! - `@params`: parameter list, recorded as a `name(params)` signature.
+//! - `@parent`: a base type, recorded as an inheritance edge.
+//! - `@owner`: type the declaration is attached to from outside its body.
+//! - Captures starting with `_` are only used by predicates.
+//!
+//! Declarations nested in a class, enum or interface declaration get a
+//! containment edge from it.
+
+use anyhow::{anyhow, Result};
+use std::cell::RefCell;
+use std::cmp::Reverse;
+use std::collections::HashSet;
+use std::ops::Range;
+use std::path::Path;
+use tree_sitter::{Language, Node as TSNode, Query, QueryCursor, QueryMatch};
+
+use super::common::{extract_text, generate_node_id};
+use crate::core::{Edge, EdgeType, Node, NodeId, NodeType};
+
+thread_local! {
+    /// Match state is reused across files instead of being allocated per query run
+    static QUERY_CURSOR: RefCell<QueryCursor> = RefCell::new(QueryCursor::new());
+}
+
+#[derive(Debug, Clone, Copy)]
+enum Capture {
+    /// Index into `QueryExtractor::kinds`
+    Definition(usize),
+    Name,
+    Params,
+    Parent,
+    Owner,
+    Predicate,
+}
+
+/// One language's compiled declaration query.
+pub struct QueryExtractor {
+    language_name: &'static str,
+    query: Query,
+    /// Role of each capture, by capture index
+    captures: Vec<Capture>,
+    kinds: Vec<(String, NodeType)>,
+}
+
+/// A declaration found by one query match
+struct Definition {
+    kind: usize,
+    range: Range<usize>,
+    line_number: usize,
+    name: String,
+    signature: Option<String>,
+    parents: Vec<String>,
+    owner: Option<String>,
+}
+
+impl QueryExtractor {
+    pub fn new(language_name: &'static str, language: Language, source: &str) -> Result<Self> {
+        let query = Query::new(language, source).map_err(|err| {
+            anyhow!(
+                "Invalid {} query at {}:{}: {}",
+                language_name,
+                err.row + 1,
+                err.column + 1,
+                err.message
+            )
+        })?;
+
+        let mut kinds = Vec::new();
+        let captures = query
+            .capture_names()
+            .iter()
+            .map(|name| {
+                Ok(match name.as_str() {
+                    "name" => Capture::Name,
+                    "params" => Capture::Params,
+                    "parent" => Capture::Parent,
+                    "owner" => Capture::Owner,
+                    other if other.starts_with('_') => Capture::Predicate,
+                    other => {
+                        let kind = other.strip_prefix("definition.").ok_or_else(|| {
+                            anyhow!("Unknown capture @{} in {} query", other, language_name)
+                        })?;
+                        let node_type = node_type_for(kind).ok_or_else(|| {
+                            anyhow!(
+                                "Unknown definition kind @{} in {} query",
+                                other,
+                                language_name
+                            )
+                        })?;
+                        kinds.push((kind.to_string(), node_type));
+                        Capture::Definition(kinds.len() - 1)
+                    }
+                })
+            })
+            .collect::<Result<Vec<_>>>()?;
+
+        Ok(Self {
+            language_name,
+            query,
+            captures,
+            kinds,
+        })
+    }
+
+    /// Appends the declarations under `root`, in source order, and their edges
+    pub fn extract(
+        &self,
+        root: &TSNode,
+        source: &[u8],
+        file_path: &Path,
+        nodes: &mut Vec<Node>,
+        edges: &mut Vec<Edge>,
+    ) {
+        let mut definitions: Vec<Definition> = QUERY_CURSOR.with(|cursor| {
+            let mut cursor = cursor.borrow_mut();
+            cursor
+                .matches(&self.query, *root, source)
+                .filter_map(|query_match| self.definition(&query_match, source))
+                .collect()
+        });
+        // Outer declarations first, so a container is open before its members
+        definitions
+            .sort_by_key(|definition| (definition.range.start, Reverse(definition.range.end)));
+
+        let mut seen: HashSet<NodeId> = HashSet::new();
+        let mut containers: Vec<(usize, NodeId)> = Vec::new();
+        for definition in definitions {
+            let (kind, node_type) = &self.kinds[definition.kind];
+            let id = generate_node_id(file_path, kind, &definition.name, definition.line_number);
+            // Overlapping patterns may report the same declaration twice
+            if !seen.insert(id) {
+                continue;
+            }
+
+            while containers
+                .last()
+                .map_or(false, |&(end, _)| end <= definition.range.start)
+            {
+                containers.pop();
+            }
+
+            for parent in &definition.parents {
+                let parent_id = format!("external:class:{}:0", parent);
+                edges.push(Edge::new(EdgeType::Inheritance, id, parent_id));
+            }
+            if let Some(owner) = &definition.owner {
+                let owner_id = format!("external:class:{}:0", owner);
+                edges.push(Edge::new(EdgeType::Contains, owner_id, id));
+            } else if let Some(&(_, container_id)) = containers.last() {
+                edges.push(Edge::new(EdgeType::Contains, container_id, id));
+            }
+
+            if matches!(
+                node_type,
+                NodeType::Class | NodeType::Enum | NodeType::Interface
+            ) {
+                containers.push((definition.range.end, id));
+            }
+
+            let mut node = Node::new(
+                id,
+                definition.name,
+                *node_type,
+                file_path.to_path_buf(),
+                definition.line_number,
+                self.language_name.to_string(),
+            );
+            if let Some(signature) = definition.signature {
+                node = node.with_signature(signature);
+            }
+            nodes.push(node);
+        }
+    }
+
+    fn definition(&self, query_match: &QueryMatch, source: &[u8]) -> Option<Definition> {
+        let mut definition = None;
+        let mut name = None;
+        let mut params = None;
+        let mut parents = Vec::new();
+        let mut owner = None;
+        for capture in query_match.captures {
+            let node = capture.node;
+            match self.captures[capture.index as usize] {
+                Capture::Definition(kind) => definition = Some((node, kind)),
+                Capture::Name => name = Some(node),
+                Capture::Params => params = Some(node),
+                Capture::Parent => parents.push(extract_text(&node, source).to_string()),
+                Capture::Owner => owner = Some(extract_text(&node, source).to_string()),
+                Capture::Predicate => {}
+            }
+        }
+
+        let (node, kind) = definition?;
+        let name = extract_text(&name.unwrap_or(node), source);
+        if name.is_empty() {
+            return None;
+        }
+        Some(Definition {
+            kind,
+            range: node.byte_range(),
+            line_number: node.start_position().row + 1,
+            signature: params.map(|params| format!("{}({})", name, extract_text(&params, source))),
+            name: name.to_string(),
+            parents,
+            owner,
+        })
+    }
+}
+
+fn node_type_for(kind: &str) -> Option<NodeType> {
+    Some(match kind {
+        "import" | "require" | "include" | "using" | "package" | "namespace" | "module" => {
+            NodeType::Module
+        }
+        "class" | "struct" => NodeType::Class,
+        "enum" => NodeType::Enum,
+        "interface" | "trait" => NodeType::Interface,
+        "function" | "method" => NodeType::Function,
+        "variable" | "field" | "constant" => NodeType::Variable,
+        _ => return None,
+    })
+}
@@ -1,5 +1,6 @@
 use anyhow::Result;
 use std::path::Path;
+use std::time::Duration;
 use tree_sitter::Node as TSNode;
 
 use super::common::{
@@ -7,17 +8,16 @@ use super::common::{
     TreeSitterParser,
 };
 use super::{LanguageParser, ParseResult};
-use crate::core::{CallSite, CallSiteExtractor, Edge, EdgeType, Node, NodeType};
+use crate::core::{CallSite, CallSiteExtractor, Edge, EdgeType, Node, NodeId, NodeType};
 
 pub struct RustParser {
-    #[allow(dead_code)]
     parser: TreeSitterParser,
 }
 
 impl RustParser {
     pub fn new() -> Result<Self> {
         let language = tree_sitter_rust::language();
-        let parser = TreeSitterParser::new(language)?;
+        let parser = TreeSitterParser::new("rust", language)?;
         Ok(Self { parser })
     }
 
@@ -138,7 +138,7 @@ impl RustParser {
 
             let module_id = generate_node_id(file_path, "module", mod_name, line_number);
             let module_node = Node::new(
-                module_id.clone(),
+                module_id,
                 mod_name.to_string(),
                 NodeType::Module,
                 file_path.to_path_buf(),
@@ -163,7 +163,7 @@ impl RustParser {
 
         let import_id = generate_node_id(file_path, "import", &use_text, line_number);
         let import_node = Node::new(
-            import_id.clone(),
+            import_id,
             use_text.to_string(),
             NodeType::Module,
             file_path.to_path_buf(),
@@ -211,7 +211,7 @@ impl RustParser {
 
             let func_id = generate_node_id(file_path, "function", func_name, line_number);
             let func_node_obj = Node::new(
-                func_id.clone(),
+                func_id,
                 func_name.to_string(),
                 NodeType::Function,
                 file_path.to_path_buf(),
@@ -270,7 +270,7 @@ impl RustParser {
 
             let struct_id = generate_node_id(file_path, "struct", struct_name, line_number);
             let struct_node_obj = Node::new(
-                struct_id.clone(),
+                struct_id,
                 struct_name.to_string(),
                 NodeType::Class,
                 file_path.to_path_buf(),
@@ -283,14 +283,7 @@ impl RustParser {
 
             // Extract struct fields
             if let Some(field_list) = find_child_by_kind(struct_node, "field_declaration_list") {
-                self.extract_struct_fields(
-                    &field_list,
-                    source,
-                    file_path,
-                    &struct_id,
-                    nodes,
-                    edges,
-                );
+                self.extract_struct_fields(&field_list, source, file_path, struct_id, nodes, edges);
             }
         }
     }
@@ -300,7 +293,7 @@ impl RustParser {
         field_list: &TSNode,
         source: &[u8],
         file_path: &Path,
-        struct_id: &str,
+        struct_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -313,7 +306,7 @@ impl RustParser {
 
                 let field_id = generate_node_id(file_path, "field", field_name, line_number);
                 let field_node_obj = Node::new(
-                    field_id.clone(),
+                    field_id,
                     field_name.to_string(),
                     NodeType::Variable,
                     file_path.to_path_buf(),
@@ -324,7 +317,7 @@ impl RustParser {
                 nodes.push(field_node_obj);
 
                 // Create edge from struct to field
-                let edge = Edge::new(EdgeType::Contains, struct_id.to_string(), field_id);
+                let edge = Edge::new(EdgeType::Contains, struct_id, field_id);
                 edges.push(edge);
             }
         }
@@ -346,7 +339,7 @@ impl RustParser {
 
             let enum_id = generate_node_id(file_path, "enum", enum_name, line_number);
             let enum_node_obj = Node::new(
-                enum_id.clone(),
+                enum_id,
                 enum_name.to_string(),
                 NodeType::Class,
                 file_path.to_path_buf(),
@@ -375,7 +368,7 @@ impl RustParser {
 
             let trait_id = generate_node_id(file_path, "trait", trait_name, line_number);
             let trait_node_obj = Node::new(
-                trait_id.clone(),
+                trait_id,
                 trait_name.to_string(),
                 NodeType::Interface,
                 file_path.to_path_buf(),
@@ -392,7 +385,7 @@ impl RustParser {
                     &declaration_list,
                     source,
                     file_path,
-                    &trait_id,
+                    trait_id,
                     nodes,
                     edges,
                 );
@@ -405,7 +398,7 @@ impl RustParser {
         declaration_list: &TSNode,
         source: &[u8],
         file_path: &Path,
-        trait_id: &str,
+        trait_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -418,7 +411,7 @@ impl RustParser {
 
                 let method_id = generate_node_id(file_path, "method", method_name, line_number);
                 let method_node_obj = Node::new(
-                    method_id.clone(),
+                    method_id,
                     method_name.to_string(),
                     NodeType::Function,
                     file_path.to_path_buf(),
@@ -429,7 +422,7 @@ impl RustParser {
                 nodes.push(method_node_obj);
 
                 // Create edge from trait to method
-                let edge = Edge::new(EdgeType::Contains, trait_id.to_string(), method_id);
+                let edge = Edge::new(EdgeType::Contains, trait_id, method_id);
                 edges.push(edge);
             }
         }
@@ -491,7 +484,7 @@ impl RustParser {
                     line_number,
                 );
                 let method_node_obj = Node::new(
-                    method_id.clone(),
+                    method_id,
                     method_name.to_string(),
                     NodeType::Function,
                     file_path.to_path_buf(),
@@ -510,16 +503,14 @@ impl RustParser {
     }
 
     fn extract_call_sites(&self, root: &TSNode, source: &[u8], file_path: &Path) -> Vec<CallSite> {
-        let mut extractor = CallSiteExtractor::new();
+        let mut extractor = CallSiteExtractor::new(self.parser.call_kinds());
         extractor.extract_from_ast(root, source, file_path)
     }
 }
 
 impl LanguageParser for RustParser {
-    fn parse_file(&self, file_path: &Path) -> Result<ParseResult> {
-        let source = std::fs::read(file_path)?;
-        let mut parser = TreeSitterParser::new(tree_sitter_rust::language())?;
-        let tree = parser.parse_file(file_path)?;
+    fn parse_source(&self, file_path: &Path, source: &[u8]) -> Result<ParseResult> {
+        let tree = self.parser.parse_source(source, file_path)?;
         let root = tree.root_node();
 
         let mut nodes = Vec::new();
@@ -537,9 +528,20 @@ impl LanguageParser for RustParser {
             nodes,
             edges,
             call_sites: Some(call_sites),
+            exports: Vec::new(),
+            limited: None,
         })
     }
 
+    fn parse_outline(
+        &self,
+        file_path: &Path,
+        source: &[u8],
+        timeout: Duration,
+    ) -> Result<Option<ParseResult>> {
+        self.parser.parse_outline(source, file_path, timeout)
+    }
+
     #[allow(dead_code)]
     fn language_name(&self) -> &str {
         "rust"
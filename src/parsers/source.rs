@@ -0,0 +1,69 @@
+//! Source file loading shared by the tree-sitter parse and every extraction pass.
+//!
+//! Each file is read (or memory-mapped) exactly once; the parse and all `extract_*`
+//! walkers borrow the same bytes.
+
+use anyhow::Result;
+use memmap2::Mmap;
+use std::fs::File;
+use std::io::Read;
+use std::ops::Deref;
+use std::path::Path;
+
+/// Files at or above this size are memory-mapped instead of copied to the heap
+pub const MMAP_THRESHOLD: u64 = 256 * 1024;
+
+/// Immutable bytes of one source file.
+pub enum SourceBuffer {
+    /// Small files, read into an owned buffer
+    Heap(Vec<u8>),
+    /// Large files, mapped read-only
+    Mapped(Mmap),
+}
+
+impl SourceBuffer {
+    /// Loads a file with a single open and stat, choosing mmap or a heap read by size.
+    pub fn load(file_path: &Path) -> Result<Self> {
+        let mut file = File::open(file_path)?;
+        let file_size = file.metadata()?.len();
+
+        if file_size >= MMAP_THRESHOLD {
+            // SAFETY: the mapping is read-only and dropped once the file is parsed.
+            // A concurrent writer truncating the file is the usual mmap caveat, so
+            // fall back to a heap read if the mapping cannot be established.
+            if let Ok(mmap) = unsafe { Mmap::map(&file) } {
+                return Ok(SourceBuffer::Mapped(mmap));
+            }
+        }
+
+        let mut content = Vec::with_capacity(file_size as usize);
+        file.read_to_end(&mut content)?;
+        Ok(SourceBuffer::Heap(content))
+    }
+
+    pub fn as_bytes(&self) -> &[u8] {
+        match self {
+            SourceBuffer::Heap(bytes) => bytes,
+            SourceBuffer::Mapped(mmap) => mmap,
+        }
+    }
+
+    #[allow(dead_code)]
+    pub fn is_mapped(&self) -> bool {
+        matches!(self, SourceBuffer::Mapped(_))
+    }
+}
+
+impl Deref for SourceBuffer {
+    type Target = [u8];
+
+    fn deref(&self) -> &[u8] {
+        self.as_bytes()
+    }
+}
+
+impl AsRef<[u8]> for SourceBuffer {
+    fn as_ref(&self) -> &[u8] {
+        self.as_bytes()
+    }
+}
@@ -1,20 +1,22 @@
 use anyhow::Result;
 use std::path::Path;
+use std::time::Duration;
 use tree_sitter::Node as TSNode;
 
 use super::common::{extract_text, find_child_by_kind, generate_node_id, TreeSitterParser};
 use super::{LanguageParser, ParseResult};
-use crate::core::{CallSite, CallSiteExtractor, Edge, EdgeType, Node, NodeType};
+use crate::core::{
+    CallSite, CallSiteExtractor, Edge, EdgeType, Node, NodeExport, NodeId, NodeType,
+};
 
 pub struct TypeScriptParser {
-    #[allow(dead_code)]
     parser: TreeSitterParser,
 }
 
 impl TypeScriptParser {
     pub fn new() -> Result<Self> {
         let language = tree_sitter_typescript::language_typescript();
-        let parser = TreeSitterParser::new(language)?;
+        let parser = TreeSitterParser::new("typescript", language)?;
         Ok(Self { parser })
     }
 
@@ -51,7 +53,7 @@ impl TypeScriptParser {
 
         let module_id = generate_node_id(file_path, "import", import_text, line_number);
         let import_node_obj = Node::new(
-            module_id.clone(),
+            module_id,
             import_text.to_string(),
             NodeType::Module,
             file_path.to_path_buf(),
@@ -93,7 +95,7 @@ impl TypeScriptParser {
             let class_id = generate_node_id(file_path, "class", class_name, line_number);
 
             let class_node_obj = Node::new(
-                class_id.clone(),
+                class_id,
                 class_name.to_string(),
                 NodeType::Class,
                 file_path.to_path_buf(),
@@ -110,7 +112,7 @@ impl TypeScriptParser {
                             let parent_class = extract_text(&parent_type, source);
                             let parent_id = format!("external:class:{}:0", parent_class);
                             let inheritance_edge =
-                                Edge::new(EdgeType::Inheritance, class_id.clone(), parent_id);
+                                Edge::new(EdgeType::Inheritance, class_id, parent_id);
                             edges.push(inheritance_edge);
                         }
                     } else if heritage_clause.kind() == "implements_clause" {
@@ -120,7 +122,7 @@ impl TypeScriptParser {
                             let interface_name = extract_text(&interface_type, source);
                             let interface_id = format!("external:interface:{}:0", interface_name);
                             let implements_edge =
-                                Edge::new(EdgeType::Implements, class_id.clone(), interface_id);
+                                Edge::new(EdgeType::Implements, class_id, interface_id);
                             edges.push(implements_edge);
                         }
                     }
@@ -129,7 +131,7 @@ impl TypeScriptParser {
 
             nodes.push(class_node_obj);
 
-            self.extract_class_methods(class_node, source, file_path, &class_id, nodes, edges);
+            self.extract_class_methods(class_node, source, file_path, class_id, nodes, edges);
         }
     }
 
@@ -138,7 +140,7 @@ impl TypeScriptParser {
         class_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: &str,
+        class_id: NodeId,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -163,7 +165,7 @@ impl TypeScriptParser {
                                 generate_node_id(file_path, "variable", field_name, line_number);
 
                             let field_node = Node::new(
-                                field_id.clone(),
+                                field_id,
                                 field_name.to_string(),
                                 NodeType::Variable,
                                 file_path.to_path_buf(),
@@ -181,8 +183,7 @@ impl TypeScriptParser {
 
                             nodes.push(field_node);
 
-                            let contains_edge =
-                                Edge::new(EdgeType::Contains, class_id.to_string(), field_id);
+                            let contains_edge = Edge::new(EdgeType::Contains, class_id, field_id);
                             edges.push(contains_edge);
                         }
                     }
@@ -224,7 +225,7 @@ impl TypeScriptParser {
                 generate_node_id(file_path, "interface", interface_name, line_number);
 
             let interface_node_obj = Node::new(
-                interface_id.clone(),
+                interface_id,
                 interface_name.to_string(),
                 NodeType::Interface,
                 file_path.to_path_buf(),
@@ -372,7 +373,7 @@ impl TypeScriptParser {
         func_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: Option<&str>,
+        class_id: Option<NodeId>,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -387,7 +388,7 @@ impl TypeScriptParser {
             }
 
             let func_node_obj = Node::new(
-                func_id.clone(),
+                func_id,
                 func_name.to_string(),
                 NodeType::Function,
                 file_path.to_path_buf(),
@@ -399,13 +400,9 @@ impl TypeScriptParser {
             nodes.push(func_node_obj);
 
             if let Some(class_id) = class_id {
-                let contains_edge =
-                    Edge::new(EdgeType::Contains, class_id.to_string(), func_id.clone());
+                let contains_edge = Edge::new(EdgeType::Contains, class_id, func_id);
                 edges.push(contains_edge);
             }
-
-            // Note: Function calls are now extracted separately via extract_call_sites
-            // self.extract_function_calls_legacy(func_node, source, file_path, &func_id, edges);
         }
     }
 
@@ -414,7 +411,7 @@ impl TypeScriptParser {
         method_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-        class_id: Option<&str>,
+        class_id: Option<NodeId>,
         nodes: &mut Vec<Node>,
         edges: &mut Vec<Edge>,
     ) {
@@ -429,7 +426,7 @@ impl TypeScriptParser {
             }
 
             let method_node_obj = Node::new(
-                method_id.clone(),
+                method_id,
                 method_name.to_string(),
                 NodeType::Function,
                 file_path.to_path_buf(),
@@ -441,8 +438,7 @@ impl TypeScriptParser {
             nodes.push(method_node_obj);
 
             if let Some(class_id) = class_id {
-                let contains_edge =
-                    Edge::new(EdgeType::Contains, class_id.to_string(), method_id.clone());
+                let contains_edge = Edge::new(EdgeType::Contains, class_id, method_id);
                 edges.push(contains_edge);
             }
 
@@ -470,7 +466,7 @@ impl TypeScriptParser {
             let func_id = generate_node_id(file_path, "function", func_name, line_number);
 
             let func_node_obj = Node::new(
-                func_id.clone(),
+                func_id,
                 func_name.to_string(),
                 NodeType::Function,
                 file_path.to_path_buf(),
@@ -484,24 +480,24 @@ impl TypeScriptParser {
         }
     }
 
-    /// Extract call sites using the new optimized CallSiteExtractor
+    /// Extract call sites using the new optimized CallSiteExtractor, along
+    /// with the routes the file registers for its functions in `nodes`
     fn extract_call_sites(
         &self,
         root_node: &TSNode,
         source: &[u8],
         file_path: &Path,
-    ) -> Vec<CallSite> {
-        let mut extractor = CallSiteExtractor::new();
-        extractor.extract_from_ast(root_node, source, file_path)
+        nodes: &[Node],
+    ) -> (Vec<CallSite>, Vec<NodeExport>) {
+        let mut extractor = CallSiteExtractor::new(self.parser.call_kinds());
+        let call_sites = extractor.extract_from_ast(root_node, source, file_path);
+        (call_sites, extractor.take_exports(nodes))
     }
 }
 
 impl LanguageParser for TypeScriptParser {
-    fn parse_file(&self, file_path: &Path) -> Result<ParseResult> {
-        let mut parser = TreeSitterParser::new(tree_sitter_typescript::language_typescript())?;
-        let tree = parser.parse_file(file_path)?;
-        let source = parser.get_source(file_path)?;
-        let source_bytes = source.as_bytes();
+    fn parse_source(&self, file_path: &Path, source_bytes: &[u8]) -> Result<ParseResult> {
+        let tree = self.parser.parse_source(source_bytes, file_path)?;
 
         let root_node = tree.root_node();
         let mut nodes = Vec::new();
@@ -513,15 +509,27 @@ impl LanguageParser for TypeScriptParser {
         self.extract_functions(&root_node, source_bytes, file_path, &mut nodes, &mut edges);
 
         // Extract call sites using the new system
-        let call_sites = self.extract_call_sites(&root_node, source_bytes, file_path);
+        let (call_sites, exports) =
+            self.extract_call_sites(&root_node, source_bytes, file_path, &nodes);
 
         Ok(ParseResult {
             nodes,
             edges,
             call_sites: Some(call_sites),
+            exports,
+            limited: None,
         })
     }
 
+    fn parse_outline(
+        &self,
+        file_path: &Path,
+        source: &[u8],
+        timeout: Duration,
+    ) -> Result<Option<ParseResult>> {
+        self.parser.parse_outline(source, file_path, timeout)
+    }
+
     fn language_name(&self) -> &str {
         "typescript"
     }
@@ -0,0 +1,107 @@
+use embargo::core::graph::{Edge, EdgeType, GraphBuilder, Node, NodeType};
+use embargo::core::DependencyGraph;
+use embargo::formatters::{BinaryFormatter, GraphSnapshot, JsonCompactFormatter};
+use std::path::PathBuf;
+
+fn node(id: &str, name: &str, ty: NodeType, file: &str, line: usize) -> Node {
+    Node::new(
+        id.to_string(),
+        name.to_string(),
+        ty,
+        PathBuf::from(file),
+        line,
+        "rust".to_string(),
+    )
+}
+
+fn sample_graph() -> DependencyGraph {
+    let mut gb = GraphBuilder::new();
+    gb.add_node(node("m", "lib", NodeType::Module, "src/lib.rs", 1));
+    gb.add_node(
+        node("s", "Parser", NodeType::Class, "src/parse.rs", 3)
+            .with_visibility("pub".to_string())
+            .with_docstring("Parses things".to_string()),
+    );
+    gb.add_node(
+        node("f", "parse", NodeType::Function, "src/parse.rs", 10)
+            .with_signature("parse(&self, input: &str)".to_string()),
+    );
+    gb.add_node(node("g", "helper", NodeType::Function, "src/lib.rs", 20));
+    gb.add_edge(Edge::new(EdgeType::Contains, "s", "f"));
+    gb.add_edge(Edge::new(EdgeType::Call, "f", "g").with_context("line:12".to_string()));
+    gb.add_edge(Edge::new(EdgeType::Import, "m", "s"));
+    gb.add_edge(Edge::new(EdgeType::Call, "f", "f"));
+    gb.build()
+}
+
+fn json(graph: &DependencyGraph) -> Vec<u8> {
+    let mut out = Vec::new();
+    JsonCompactFormatter::new()
+        .write_to(graph, &mut out)
+        .unwrap();
+    out
+}
+
+#[test]
+fn snapshot_reloads_to_the_same_graph() {
+    let graph = sample_graph();
+    let dir = tempfile::TempDir::new().unwrap();
+    let path = dir.path().join("graph.bin");
+    BinaryFormatter::new()
+        .format_to_file(&graph, &path)
+        .unwrap();
+
+    let snapshot = GraphSnapshot::open(&path).unwrap();
+    assert_eq!(snapshot.node_count(), 4);
+    assert_eq!(snapshot.edge_count(), 4);
+    assert_eq!(snapshot.node_name(2), "parse");
+    assert_eq!(snapshot.node_type(1), Some(NodeType::Class));
+    assert_eq!(snapshot.node_file(3), "src/lib.rs");
+    assert_eq!(snapshot.node_line(2), 10);
+
+    let reloaded = snapshot.to_graph().unwrap();
+    assert_eq!(json(&reloaded), json(&graph));
+    let parse = &reloaded[petgraph::graph::NodeIndex::new(2)];
+    assert_eq!(
+        parse.signature.as_deref(),
+        Some("parse(&self, input: &str)")
+    );
+    let parser = &reloaded[petgraph::graph::NodeIndex::new(1)];
+    assert_eq!(parser.docstring.as_deref(), Some("Parses things"));
+    assert_eq!(parser.visibility.as_deref(), Some("pub"));
+}
+
+#[test]
+fn adjacency_is_queried_per_edge_type() {
+    let mut bytes = Vec::new();
+    BinaryFormatter::new()
+        .write_to(&sample_graph(), &mut bytes)
+        .unwrap();
+    let snapshot = GraphSnapshot::from_bytes(bytes).unwrap();
+
+    let calls: Vec<usize> = snapshot.targets(2, EdgeType::Call).collect();
+    assert_eq!(calls, vec![3, 2]);
+    assert_eq!(
+        snapshot.targets(1, EdgeType::Contains).collect::<Vec<_>>(),
+        vec![2]
+    );
+    assert_eq!(snapshot.targets(0, EdgeType::Call).count(), 0);
+    assert_eq!(snapshot.targets(99, EdgeType::Call).count(), 0);
+}
+
+#[test]
+fn corrupt_snapshots_are_rejected() {
+    let mut bytes = Vec::new();
+    BinaryFormatter::new()
+        .write_to(&sample_graph(), &mut bytes)
+        .unwrap();
+
+    assert!(GraphSnapshot::from_bytes(b"not a snapshot".to_vec()).is_err());
+
+    let mut wrong_version = bytes.clone();
+    wrong_version[8] = 99;
+    assert!(GraphSnapshot::from_bytes(wrong_version).is_err());
+
+    let truncated = bytes[..bytes.len() - 8].to_vec();
+    assert!(GraphSnapshot::from_bytes(truncated).is_err());
+}
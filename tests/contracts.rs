@@ -0,0 +1,104 @@
+use embargo::core::contracts::{http_call_context, route_path, RouteTrie};
+use embargo::core::graph::{GraphBuilder, Node};
+use embargo::core::resolver::{CallSite, CallType, FunctionResolver};
+use embargo::core::{NodeExport, NodeId, NodeType};
+use std::path::PathBuf;
+
+fn func_in(file: &str, language: &str, name: &str) -> Node {
+    Node::new(
+        format!("{file}:function:{name}:1"),
+        name.to_string(),
+        NodeType::Function,
+        PathBuf::from(file),
+        1,
+        language.to_string(),
+    )
+}
+
+#[test]
+fn route_paths_drop_quotes_hosts_and_queries() {
+    assert_eq!(route_path("\"/api/users/\"").as_deref(), Some("/api/users"));
+    assert_eq!(
+        route_path("'http://localhost:8000/api/users?page=2'").as_deref(),
+        Some("/api/users")
+    );
+    assert_eq!(
+        route_path("`${API_BASE}/users/${id}`").as_deref(),
+        Some("/users/${id}")
+    );
+    assert_eq!(
+        route_path("f\"/users/{user_id}\"").as_deref(),
+        Some("/users/{user_id}")
+    );
+    assert_eq!(route_path("\"/\"").as_deref(), Some("/"));
+    assert_eq!(route_path("\"users\""), None);
+    assert_eq!(route_path("path"), None);
+}
+
+#[test]
+fn route_trie_prefers_literal_segments_and_exact_methods() {
+    let ids: Vec<NodeId> = (0..4)
+        .map(|i| NodeId::intern(&format!("route{i}")))
+        .collect();
+    let mut trie = RouteTrie::default();
+    trie.insert("GET", "/api/users/{id}", ids[0]);
+    trie.insert("GET", "/api/users/me", ids[1]);
+    trie.insert("POST", "/api/users", ids[2]);
+    trie.insert("*", "/health", ids[3]);
+
+    let found = trie.lookup("GET", "/api/users/me").unwrap();
+    assert_eq!((found.target, found.exact), (ids[1], true));
+    let found = trie.lookup("GET", "/api/users/42").unwrap();
+    assert_eq!((found.target, found.exact), (ids[0], false));
+    assert_eq!(found.pattern, "/api/users/{id}");
+    // A client-side interpolation only matches a parameter
+    assert_eq!(
+        trie.lookup("GET", "/api/users/${id}").unwrap().target,
+        ids[0]
+    );
+    assert_eq!(trie.lookup("post", "/api/users").unwrap().target, ids[2]);
+    assert!(trie.lookup("DELETE", "/api/users").is_none());
+    assert_eq!(trie.lookup("HEAD", "/health").unwrap().target, ids[3]);
+    assert!(trie.lookup("GET", "/api").is_none());
+    assert!(trie.lookup("GET", "/api/users/42/posts").is_none());
+}
+
+#[test]
+fn outbound_requests_resolve_to_routes_in_other_languages() {
+    let nodes = vec![
+        func_in("api/users.py", "python", "get_user"),
+        func_in("web/client.ts", "typescript", "loadUser"),
+        // A near-miss name the fuzzy fallback would otherwise pick for `fetch`
+        func_in("web/util.ts", "typescript", "fetchy"),
+    ];
+    let mut gb = GraphBuilder::new();
+    for node in &nodes {
+        gb.add_node(node.clone());
+    }
+    let exports = [NodeExport::http(nodes[0].id, "GET", "/api/users/{user_id}")];
+    let call = CallSite {
+        caller_id: nodes[1].id,
+        called_name: "fetch".to_string(),
+        call_type: CallType::SimpleCall,
+        context: Some(http_call_context("GET", "/api/users/${id}")),
+        line_number: 12,
+    };
+
+    let mut resolver = FunctionResolver::new();
+    resolver.build_indexes(gb.graph()).unwrap();
+    assert!(!resolver.may_fuzzy_match(&call));
+    resolver.index_exports(&exports);
+    let (edges, stats) = resolver.resolve_calls_with_stats(gb.graph(), &[call.clone()]);
+    assert_eq!(edges.len(), 1);
+    assert_eq!(edges[0].target_id, nodes[0].id);
+    assert_eq!(
+        edges[0].context.as_deref(),
+        Some("protocol:http;confidence:medium;route:GET /api/users/{user_id};line:12")
+    );
+    assert_eq!(stats.contract_matches, 1);
+
+    let mut disabled = FunctionResolver::new().with_cross_language(false);
+    disabled.build_indexes(gb.graph()).unwrap();
+    disabled.index_exports(&exports);
+    assert!(disabled.resolve_calls(gb.graph(), &[call]).is_empty());
+}
@@ -0,0 +1,117 @@
+use embargo::core::focus::focus;
+use embargo::core::graph::{Edge, EdgeType, GraphBuilder, Node, NodeType};
+use embargo::core::DependencyGraph;
+use std::path::PathBuf;
+
+fn node(file: &str, name: &str, node_type: NodeType) -> Node {
+    Node::new(
+        format!("{}:{}", file, name),
+        name.to_string(),
+        node_type,
+        PathBuf::from(file),
+        1,
+        "rust".to_string(),
+    )
+}
+
+/// main -> Parser::parse -> lex -> read, and an unrelated helper;
+/// `Parser` contains `parse` and `reset`
+fn graph() -> DependencyGraph {
+    let mut gb = GraphBuilder::new();
+    let nodes = [
+        node("./src/main.rs", "main", NodeType::Function),
+        node("./src/parser.rs", "Parser", NodeType::Class),
+        node("./src/parser.rs", "parse", NodeType::Function),
+        node("./src/parser.rs", "reset", NodeType::Function),
+        node("./src/lexer.rs", "lex", NodeType::Function),
+        node("./src/io.rs", "read", NodeType::Function),
+        node("./src/util.rs", "helper", NodeType::Function),
+    ];
+    for node in &nodes {
+        gb.add_node(node.clone());
+    }
+    let id = |file: &str, name: &str| format!("{}:{}", file, name);
+    for (edge_type, from, to) in [
+        (
+            EdgeType::Call,
+            id("./src/main.rs", "main"),
+            id("./src/parser.rs", "parse"),
+        ),
+        (
+            EdgeType::Call,
+            id("./src/parser.rs", "parse"),
+            id("./src/lexer.rs", "lex"),
+        ),
+        (
+            EdgeType::Call,
+            id("./src/lexer.rs", "lex"),
+            id("./src/io.rs", "read"),
+        ),
+        (
+            EdgeType::Contains,
+            id("./src/parser.rs", "Parser"),
+            id("./src/parser.rs", "parse"),
+        ),
+        (
+            EdgeType::Contains,
+            id("./src/parser.rs", "Parser"),
+            id("./src/parser.rs", "reset"),
+        ),
+    ] {
+        gb.add_edge(Edge::new(edge_type, from.as_str(), to.as_str()));
+    }
+    gb.build()
+}
+
+fn names(graph: &DependencyGraph) -> Vec<String> {
+    let mut names: Vec<String> = graph.node_weights().map(|node| node.name.clone()).collect();
+    names.sort();
+    names
+}
+
+#[test]
+fn focus_walks_callers_and_callees_up_to_the_depth() {
+    let graph = graph();
+
+    let (focused, summary) = focus(&graph, &["lex".to_string()], 1).unwrap();
+    assert_eq!(names(&focused), ["lex", "parse", "read"]);
+    assert_eq!(summary.seeds, 1);
+    assert_eq!(summary.nodes, 3);
+    // Edges among the kept nodes survive; the one to `main` does not
+    assert_eq!(focused.edge_count(), 2);
+
+    let (focused, _) = focus(&graph, &["lex".to_string()], 0).unwrap();
+    assert_eq!(names(&focused), ["lex"]);
+    assert_eq!(focused.edge_count(), 0);
+
+    let (focused, _) = focus(&graph, &["lex".to_string()], 5).unwrap();
+    assert_eq!(names(&focused), ["lex", "main", "parse", "read"]);
+}
+
+#[test]
+fn focus_targets_name_files_types_and_qualified_members() {
+    let graph = graph();
+
+    // A path suffix names every node of the file
+    let (focused, summary) = focus(&graph, &["src/parser.rs".to_string()], 0).unwrap();
+    assert_eq!(names(&focused), ["Parser", "parse", "reset"]);
+    assert_eq!(summary.seeds, 3);
+
+    // A type brings its members
+    let (focused, _) = focus(&graph, &["Parser".to_string()], 0).unwrap();
+    assert_eq!(names(&focused), ["Parser", "parse", "reset"]);
+
+    let (focused, _) = focus(&graph, &["Parser::reset".to_string()], 1).unwrap();
+    assert_eq!(names(&focused), ["reset"]);
+    let (focused, _) = focus(
+        &graph,
+        &["Other.parse".to_string(), "helper".to_string()],
+        1,
+    )
+    .unwrap();
+    assert_eq!(names(&focused), ["helper"]);
+
+    let (_, summary) = focus(&graph, &["helper".to_string(), "missing".to_string()], 1).unwrap();
+    assert_eq!(summary.unmatched, ["missing"]);
+    assert!(focus(&graph, &["missing".to_string()], 1).is_err());
+}
@@ -1,6 +1,7 @@
 use embargo::core::graph::{Edge, EdgeType, GraphBuilder, Node, NodeType};
-use embargo::formatters::JsonCompactFormatter;
+use embargo::formatters::{write_file, JsonCompactFormatter};
 use serde_json::Value;
+use std::io::Write;
 use std::path::PathBuf;
 
 fn node(id: &str, name: &str, ty: NodeType) -> Node {
@@ -45,3 +46,82 @@ fn json_compact_formatter_outputs_valid_json() {
     let edge = &v["edges"][0];
     assert_eq!(edge[2].as_u64().unwrap(), 1);
 }
+
+#[test]
+fn unchanged_output_is_not_rewritten() {
+    let mut gb = GraphBuilder::new();
+    gb.add_node(node("A", "mod_a", NodeType::Module));
+    let graph = gb.build();
+
+    let dir = tempfile::TempDir::new().unwrap();
+    let path = dir.path().join("graph.json");
+    let fmt = JsonCompactFormatter::new();
+    fmt.format_to_file(&graph, &path).unwrap();
+
+    // Backdate the file; a no-op regeneration must leave the mtime alone
+    let past = std::time::SystemTime::now() - std::time::Duration::from_secs(3600);
+    std::fs::File::options()
+        .write(true)
+        .open(&path)
+        .unwrap()
+        .set_modified(past)
+        .unwrap();
+    fmt.format_to_file(&graph, &path).unwrap();
+    assert_eq!(std::fs::metadata(&path).unwrap().modified().unwrap(), past);
+}
+
+#[test]
+fn streamed_output_matches_file_and_replaces_longer_contents() {
+    let mut gb = GraphBuilder::new();
+    gb.add_node(node("A", "mod_a", NodeType::Module));
+    gb.add_node(node("B", "func_b", NodeType::Function));
+    let big = gb.build();
+    let mut gb = GraphBuilder::new();
+    gb.add_node(node("A", "mod_a", NodeType::Module));
+    let small = gb.build();
+
+    let dir = tempfile::TempDir::new().unwrap();
+    let path = dir.path().join("graph.json");
+    let fmt = JsonCompactFormatter::new();
+    fmt.format_to_file(&big, &path).unwrap();
+    fmt.format_to_file(&small, &path).unwrap();
+
+    // The file holds exactly the new document, not a tail of the old one
+    let mut streamed = Vec::new();
+    fmt.write_to(&small, &mut streamed).unwrap();
+    assert_eq!(std::fs::read(&path).unwrap(), streamed);
+    let v: Value = serde_json::from_slice(&streamed).unwrap();
+    assert_eq!(v["meta"]["nodes"].as_u64().unwrap(), 1);
+}
+
+#[test]
+fn failing_render_leaves_the_previous_output_intact() {
+    let mut gb = GraphBuilder::new();
+    gb.add_node(node("A", "mod_a", NodeType::Module));
+    let graph = gb.build();
+
+    let dir = tempfile::TempDir::new().unwrap();
+    let path = dir.path().join("graph.json");
+    let fmt = JsonCompactFormatter::new();
+    fmt.format_to_file(&graph, &path).unwrap();
+    let before = std::fs::read(&path).unwrap();
+
+    // Diverges from the old contents right away, then fails partway through
+    let failed = write_file(&path, |out| {
+        out.write_all(b"{\"partial\": ")?;
+        out.write_all(&vec![b' '; 64 * 1024])?;
+        anyhow::bail!("render failed")
+    });
+    assert!(failed.is_err());
+    assert_eq!(std::fs::read(&path).unwrap(), before);
+    let leftovers: Vec<_> = std::fs::read_dir(dir.path())
+        .unwrap()
+        .map(|entry| entry.unwrap().file_name())
+        .collect();
+    assert_eq!(leftovers, vec!["graph.json"]);
+
+    // A new file is only created once its render succeeds
+    let fresh = dir.path().join("fresh.json");
+    assert!(write_file(&fresh, |_| anyhow::bail!("render failed")).is_err());
+    assert!(!fresh.exists());
+}
@@ -58,3 +58,63 @@ fn llm_optimized_compact_mode_excludes_extras() {
     assert!(!s.contains("## DEPENDENCY_PATTERNS"));
     assert!(s.contains("# CODE_GRAPH"));
 }
+
+#[test]
+fn parallel_rendering_matches_a_single_thread() {
+    let dirs = ["services", "entities", "api", "utils", "core"];
+    let mut gb = GraphBuilder::new();
+    let mut ids = Vec::new();
+    for i in 0..120 {
+        let path = format!("proj/{}/file_{}.rs", dirs[i % dirs.len()], i % 17);
+        let ty = if i % 7 == 0 {
+            NodeType::Class
+        } else {
+            NodeType::Function
+        };
+        let n = Node::new(
+            format!("N{i}"),
+            format!("item_{i}"),
+            ty,
+            PathBuf::from(path),
+            i % 40 + 1,
+            "rust".to_string(),
+        );
+        ids.push(n.id);
+        gb.add_node(n);
+    }
+    for i in 0..ids.len() {
+        gb.add_edge(Edge::new(
+            EdgeType::Call,
+            ids[i],
+            ids[(i * 7 + 3) % ids.len()],
+        ));
+    }
+    let graph = gb.build();
+
+    let layouts: [fn() -> LLMOptimizedFormatter; 3] = [
+        || LLMOptimizedFormatter::new().with_verbosity(OutputVerbosity::Verbose),
+        || {
+            LLMOptimizedFormatter::new()
+                .with_semantic_clustering(false)
+                .with_hierarchical(true)
+        },
+        || {
+            LLMOptimizedFormatter::new()
+                .with_semantic_clustering(false)
+                .with_hierarchical(false)
+        },
+    ];
+    for layout in layouts {
+        let render = |threads: usize| {
+            let pool = rayon::ThreadPoolBuilder::new()
+                .num_threads(threads)
+                .build()
+                .unwrap();
+            let mut out = Vec::new();
+            pool.install(|| layout().write_to(&graph, &mut out))
+                .unwrap();
+            out
+        };
+        assert_eq!(render(1), render(8));
+    }
+}
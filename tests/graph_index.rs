@@ -0,0 +1,157 @@
+use embargo::core::graph::{Edge, EdgeType, GraphBuilder, Node, NodeType};
+use embargo::core::{DependencyGraph, GraphIndex, NodeId};
+use petgraph::graph::NodeIndex;
+use petgraph::visit::EdgeRef;
+use std::path::{Path, PathBuf};
+
+fn func(id: &str, file: &str) -> Node {
+    Node::new(
+        id.to_string(),
+        id.to_string(),
+        NodeType::Function,
+        PathBuf::from(file),
+        1,
+        "rust".to_string(),
+    )
+}
+
+/// a -> b -> c, a -> d, and a cycle d -> e -> f -> d
+fn graph() -> DependencyGraph {
+    let mut gb = GraphBuilder::new();
+    for (id, file) in [
+        ("a", "src/main.rs"),
+        ("b", "src/lib.rs"),
+        ("c", "src/lib.rs"),
+        ("d", "src/cycle.rs"),
+        ("e", "src/cycle.rs"),
+        ("f", "src/cycle.rs"),
+    ] {
+        gb.add_node(func(id, file));
+    }
+    for (from, to) in [
+        ("a", "b"),
+        ("b", "c"),
+        ("a", "d"),
+        ("d", "e"),
+        ("e", "f"),
+        ("f", "d"),
+    ] {
+        gb.add_edge(Edge::new(EdgeType::Call, from, to));
+    }
+    gb.add_edge(Edge::new(EdgeType::Contains, "a", "c"));
+    gb.add_edge(Edge::new(EdgeType::Call, "c", "c"));
+    gb.build()
+}
+
+#[test]
+fn adjacency_matches_petgraph_order_and_splits_by_type() {
+    let graph = graph();
+    let index = GraphIndex::new(&graph);
+
+    for node in graph.node_indices() {
+        let expected: Vec<(EdgeType, NodeId)> = graph
+            .edges(node)
+            .map(|edge| (edge.weight().edge_type, graph[edge.target()].id))
+            .collect();
+        let actual: Vec<(EdgeType, NodeId)> = index
+            .outgoing(node)
+            .map(|(edge, target)| (edge.edge_type, target.id))
+            .collect();
+        assert_eq!(actual, expected);
+        assert_eq!(index.out_degree(node), expected.len());
+    }
+
+    let a = NodeIndex::new(0);
+    let c = NodeIndex::new(2);
+    let calls: Vec<&str> = index
+        .outgoing_of(a, EdgeType::Call)
+        .map(|(_, target)| target.name.as_str())
+        .collect();
+    assert_eq!(calls.len(), 2);
+    assert!(calls.contains(&"b") && calls.contains(&"d"));
+    assert_eq!(index.sources_of(c, EdgeType::Contains), &[a]);
+    assert_eq!(index.in_degree(c), 3);
+    assert_eq!(index.edge_count_of(EdgeType::Call), 7);
+    assert_eq!(index.edge_count_of(EdgeType::Inheritance), 0);
+}
+
+#[test]
+fn nodes_are_grouped_by_file_in_path_order() {
+    let graph = graph();
+    let index = GraphIndex::new(&graph);
+    let files: Vec<(&Path, Vec<usize>)> = index
+        .files()
+        .map(|(path, nodes)| (path, nodes.iter().map(|node| node.index()).collect()))
+        .collect();
+    assert_eq!(
+        files,
+        vec![
+            (Path::new("src/cycle.rs"), vec![3, 4, 5]),
+            (Path::new("src/lib.rs"), vec![1, 2]),
+            (Path::new("src/main.rs"), vec![0]),
+        ]
+    );
+}
+
+/// Longest simple call chain from `node`, by exhaustive search
+fn longest_chain(graph: &DependencyGraph, node: NodeIndex, on_path: &mut Vec<NodeIndex>) -> usize {
+    if on_path.contains(&node) {
+        return 0;
+    }
+    on_path.push(node);
+    let deepest = graph
+        .edges(node)
+        .filter(|edge| edge.weight().edge_type == EdgeType::Call)
+        .map(|edge| longest_chain(graph, edge.target(), on_path))
+        .max()
+        .unwrap_or(0);
+    on_path.pop();
+    1 + deepest
+}
+
+#[test]
+fn call_depths_follow_a_cycle_around_to_its_exit() {
+    // a -> b -> c -> a with a -> x, reached from entry
+    let mut gb = GraphBuilder::new();
+    for id in ["entry", "a", "b", "c", "x"] {
+        gb.add_node(func(id, "src/ring.rs"));
+    }
+    for (from, to) in [
+        ("entry", "b"),
+        ("a", "b"),
+        ("b", "c"),
+        ("c", "a"),
+        ("a", "x"),
+    ] {
+        gb.add_edge(Edge::new(EdgeType::Call, from, to));
+    }
+    let graph = gb.build();
+    let index = GraphIndex::new(&graph);
+
+    let depths: Vec<usize> = graph
+        .node_indices()
+        .map(|node| index.call_depth(node))
+        .collect();
+    // a -> b -> c is as long as a -> x gets, b and c can exit through a
+    assert_eq!(depths, vec![5, 3, 4, 3, 1]);
+    for node in graph.node_indices() {
+        assert_eq!(
+            index.call_depth(node),
+            longest_chain(&graph, node, &mut Vec::new())
+        );
+    }
+}
+
+#[test]
+fn call_depths_count_each_cycle_member_once() {
+    let graph = graph();
+    let index = GraphIndex::new(&graph);
+    let depth = |node: usize| index.call_depth(NodeIndex::new(node));
+
+    // A self call does not add depth
+    assert_eq!(depth(2), 1);
+    assert_eq!(depth(1), 2);
+    // Every member of the three-node cycle reaches the other two
+    assert_eq!((depth(3), depth(4), depth(5)), (3, 3, 3));
+    assert_eq!(depth(0), 4);
+}
@@ -0,0 +1,188 @@
+use embargo::core::incremental::{AnalysisState, FileChange};
+use embargo::core::resolver::{CallSite, CallType};
+use embargo::core::{DependencyGraph, FunctionResolver, Node, NodeId, NodeType};
+use embargo::parsers::limits::{LimitReason, ParseLimits};
+use embargo::parsers::ParseResult;
+use std::path::{Path, PathBuf};
+
+fn func(file: &str, name: &str, line: usize) -> Node {
+    Node::new(
+        format!("{}:function:{}:{}", file.replace('/', "_"), name, line),
+        name.to_string(),
+        NodeType::Function,
+        PathBuf::from(file),
+        line,
+        "rust".to_string(),
+    )
+}
+
+fn call(caller: &Node, called_name: &str, line: usize) -> CallSite {
+    CallSite {
+        caller_id: caller.id,
+        called_name: called_name.to_string(),
+        call_type: CallType::SimpleCall,
+        context: None,
+        line_number: line,
+    }
+}
+
+fn updated(path: &str, nodes: Vec<Node>, call_sites: Vec<CallSite>) -> FileChange {
+    FileChange::Updated {
+        path: PathBuf::from(path),
+        result: ParseResult {
+            nodes,
+            edges: Vec::new(),
+            call_sites: Some(call_sites),
+            exports: Vec::new(),
+            limited: None,
+        },
+        stamp: None,
+    }
+}
+
+fn call_edges(graph: &DependencyGraph) -> Vec<(NodeId, NodeId, Option<String>)> {
+    graph
+        .raw_edges()
+        .iter()
+        .map(|edge| {
+            let edge = &edge.weight;
+            (edge.source_id, edge.target_id, edge.context.clone())
+        })
+        .collect()
+}
+
+fn project(helper_name: &str) -> Vec<FileChange> {
+    let main = func("src/a.rs", "main", 1);
+    let calls = vec![call(&main, "helper", 2), call(&main, "unknown_fn", 3)];
+    vec![
+        updated("src/a.rs", vec![main], calls),
+        updated(
+            "src/b.rs",
+            vec![func("src/b.rs", helper_name, 1)],
+            Vec::new(),
+        ),
+    ]
+}
+
+#[test]
+fn only_call_sites_touched_by_a_change_are_re_resolved() {
+    let resolver = FunctionResolver::new();
+    let mut state = AnalysisState::new(
+        Path::new("."),
+        &["rust"],
+        true,
+        true,
+        &ParseLimits::default(),
+    );
+
+    let (graph, summary) = state.apply(project("helper"), &resolver).unwrap();
+    assert_eq!(summary.call_sites_resolved, 2);
+    assert_eq!(summary.call_edges, 1);
+    let helper = func("src/b.rs", "helper", 1);
+    assert_eq!(call_edges(&graph)[0].1, helper.id);
+
+    // Renaming helper re-resolves its caller (now a fuzzy match) and nothing else
+    let renamed = func("src/b.rs", "helper2", 1);
+    let change = updated("src/b.rs", vec![renamed.clone()], Vec::new());
+    let (graph, summary) = state.apply(vec![change], &resolver).unwrap();
+    assert_eq!(summary.files_changed, 1);
+    assert_eq!(summary.call_sites_total, 2);
+    assert_eq!(summary.call_sites_resolved, 1);
+    let edges = call_edges(&graph);
+    assert_eq!(edges.len(), 1);
+    assert_eq!(edges[0].1, renamed.id);
+    assert_eq!(edges[0].2.as_deref(), Some("fuzzy_match:line:2"));
+
+    // Same graph as analyzing the edited project from scratch
+    let mut fresh = AnalysisState::new(
+        Path::new("."),
+        &["rust"],
+        true,
+        true,
+        &ParseLimits::default(),
+    );
+    let (clean, _) = fresh.apply(project("helper2"), &resolver).unwrap();
+    assert_eq!(call_edges(&clean), edges);
+    assert_eq!(clean.node_count(), graph.node_count());
+
+    // Deleting the file drops the edge into it
+    let (graph, summary) = state
+        .apply(
+            vec![FileChange::Removed(PathBuf::from("src/b.rs"))],
+            &resolver,
+        )
+        .unwrap();
+    assert_eq!(summary.call_sites_resolved, 1);
+    assert!(call_edges(&graph).is_empty());
+    assert_eq!(graph.node_count(), 1);
+}
+
+#[test]
+fn saved_state_round_trips_and_checks_its_inputs() {
+    let dir = tempfile::TempDir::new().unwrap();
+    let resolver = FunctionResolver::new();
+    let mut state = AnalysisState::new(
+        Path::new("proj"),
+        &["rust"],
+        true,
+        true,
+        &ParseLimits::default(),
+    );
+    state.apply(project("helper"), &resolver).unwrap();
+
+    let path = AnalysisState::path_in(dir.path(), Path::new("proj"), &["rust"]);
+    state.save(&path).unwrap();
+
+    let mut loaded = AnalysisState::load(&path).unwrap();
+    assert_eq!(loaded.file_count(), 2);
+    assert!(loaded.matches(
+        Path::new("proj"),
+        &["rust"],
+        true,
+        true,
+        &ParseLimits::default()
+    ));
+    let limits = ParseLimits::default();
+    assert!(!loaded.matches(Path::new("proj"), &["rust", "python"], true, true, &limits));
+    assert!(!loaded.matches(Path::new("proj"), &["rust"], false, true, &limits));
+    assert!(!loaded.matches(Path::new("proj"), &["rust"], true, false, &limits));
+    // Other limits outline other files, so the records are not reusable
+    let unlimited = ParseLimits::unlimited();
+    assert!(!loaded.matches(Path::new("proj"), &["rust"], true, true, &unlimited));
+
+    // Nothing changed: nothing to re-resolve, same edges as before saving
+    let (graph, summary) = loaded.apply(Vec::new(), &resolver).unwrap();
+    assert_eq!(summary.call_sites_resolved, 0);
+    assert_eq!(summary.call_edges, 1);
+    assert_eq!(graph.edge_count(), 1);
+
+    std::fs::write(&path, b"not a state file").unwrap();
+    assert!(AnalysisState::load(&path).is_none());
+}
+
+#[test]
+fn timed_out_outlines_are_not_recorded_as_current() {
+    let resolver = FunctionResolver::new();
+    let limits = ParseLimits::default();
+    let mut state = AnalysisState::new(Path::new("."), &["rust"], true, true, &limits);
+    let stamped = |path: &str, limited| FileChange::Updated {
+        path: PathBuf::from(path),
+        result: ParseResult {
+            nodes: Vec::new(),
+            edges: Vec::new(),
+            call_sites: None,
+            exports: Vec::new(),
+            limited,
+        },
+        stamp: Some((1, 1)),
+    };
+    let changes = vec![
+        stamped("src/big.rs", Some(LimitReason::Timeout)),
+        stamped("src/ok.rs", Some(LimitReason::Generated)),
+    ];
+    state.apply(changes, &resolver).unwrap();
+
+    // A rescan sees no stamp for the timed-out file and parses it again
+    assert_eq!(state.stamp(Path::new("src/big.rs")), Some(None));
+    assert_eq!(state.stamp(Path::new("src/ok.rs")), Some(Some((1, 1))));
+}
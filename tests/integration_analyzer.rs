@@ -25,3 +25,23 @@ fn analyzer_end_to_end_on_small_rust_file() {
     assert!(s.contains("NODES:"));
     assert!(s.contains("EDGES:"));
 }
+
+#[test]
+fn analyzer_parallel_parse_is_deterministic_across_job_counts() {
+    let dir = tempfile::TempDir::new().unwrap();
+    for i in 0..8 {
+        let src = dir.path().join(format!("m{}.rs", i));
+        fs::write(&src, format!("fn f{i}() {{ g{i}(); }}\nfn g{i}() {{}}\n")).unwrap();
+    }
+
+    let node_ids = |jobs: Option<usize>| -> Vec<String> {
+        let mut analyzer = CodebaseAnalyzer::new().with_jobs(jobs);
+        let graph = analyzer.analyze(dir.path(), &["rust"]).unwrap();
+        graph.node_weights().map(|n| n.id.to_string()).collect()
+    };
+
+    let single = node_ids(Some(1));
+    assert!(!single.is_empty());
+    assert_eq!(single, node_ids(Some(4)));
+    assert_eq!(single, node_ids(None));
+}
@@ -0,0 +1,147 @@
+use embargo::core::graph::{Edge, EdgeType, GraphBuilder, Node, NodeType};
+use embargo::core::DependencyGraph;
+use embargo::formatters::token_budget::estimate_tokens;
+use embargo::formatters::{LLMOptimizedFormatter, OutputVerbosity};
+use std::path::PathBuf;
+
+fn func(file: &str, name: &str, line: usize) -> Node {
+    Node::new(
+        format!("{}:function:{}:{}", file, name, line),
+        name.to_string(),
+        NodeType::Function,
+        PathBuf::from(file),
+        line,
+        "rust".to_string(),
+    )
+}
+
+/// A class, variable or other node the entity lines never render
+fn declaration(file: &str, name: &str, node_type: NodeType) -> Node {
+    Node::new(
+        format!("{}:{:?}:{}", file, node_type, name),
+        name.to_string(),
+        node_type,
+        PathBuf::from(file),
+        1,
+        "rust".to_string(),
+    )
+}
+
+/// Forty leaf files whose functions all call into one hub file
+fn hub_and_leaves() -> DependencyGraph {
+    let mut gb = GraphBuilder::new();
+    let hub = func("/repo/src/hub.rs", "dispatch", 1);
+    gb.add_node(hub.clone());
+    for i in 0..40 {
+        let file = format!("/repo/src/leaf_{i:02}.rs");
+        for f in 0..3 {
+            let leaf = func(&file, &format!("leaf_{i}_handler_{f}"), f * 10 + 1);
+            gb.add_node(leaf.clone());
+            gb.add_edge(Edge::new(EdgeType::Call, leaf.id, hub.id));
+        }
+    }
+    gb.build()
+}
+
+fn render(graph: &DependencyGraph, formatter: LLMOptimizedFormatter) -> String {
+    let mut out = Vec::new();
+    formatter.write_to(graph, &mut out).unwrap();
+    String::from_utf8(out).unwrap()
+}
+
+#[test]
+fn token_budget_bounds_output_and_keeps_the_most_called_file() {
+    let graph = hub_and_leaves();
+    let budget = 300;
+    let formatter = LLMOptimizedFormatter::new()
+        .with_verbosity(OutputVerbosity::Compact)
+        .with_max_tokens(Some(budget));
+    let s = render(&graph, formatter);
+
+    assert!(
+        estimate_tokens(&s) <= budget,
+        "{} tokens",
+        estimate_tokens(&s)
+    );
+    assert!(s.contains("NODES:121 EDGES:120 TOKEN_BUDGET:300"));
+    assert!(s.contains("ROOT: /repo/src/"));
+    assert!(s.contains("hub.rs→[dispatch"));
+    assert!(s.contains("## OMITTED"));
+    assert!(!s.contains("leaf_39.rs"));
+
+    // A sequential render of the same graph is byte-identical
+    let pool = rayon::ThreadPoolBuilder::new()
+        .num_threads(1)
+        .build()
+        .unwrap();
+    let formatter = LLMOptimizedFormatter::new()
+        .with_verbosity(OutputVerbosity::Compact)
+        .with_max_tokens(Some(budget));
+    assert_eq!(pool.install(|| render(&graph, formatter)), s);
+}
+
+#[test]
+fn token_budget_that_fits_everything_omits_nothing() {
+    let graph = hub_and_leaves();
+    let formatter = LLMOptimizedFormatter::new().with_max_tokens(Some(1_000_000));
+    let s = render(&graph, formatter);
+
+    // The interpretation key fits a large budget; every file is listed
+    assert!(s.contains("# EMBARGO: LLM-Optimized Codebase Dependency Graph"));
+    assert!(!s.contains("## OMITTED"));
+    assert!(s.contains("NODES:121/121"));
+    for i in 0..40 {
+        assert!(s.contains(&format!("leaf_{i:02}.rs→[")));
+    }
+
+    // A small budget drops the key rather than the graph
+    let s = render(
+        &graph,
+        LLMOptimizedFormatter::new().with_max_tokens(Some(400)),
+    );
+    assert!(!s.contains("## INTERPRETATION KEY"));
+    assert!(s.contains("hub.rs→["));
+}
+
+#[test]
+fn nodes_without_entities_are_neither_shown_nor_omitted() {
+    let mut gb = GraphBuilder::new();
+    gb.add_node(declaration(
+        "/repo/src/hub.rs",
+        "Dispatcher",
+        NodeType::Class,
+    ));
+    gb.add_node(declaration(
+        "/repo/src/hub.rs",
+        "ROUTES",
+        NodeType::Variable,
+    ));
+    gb.add_node(func("/repo/src/hub.rs", "dispatch", 5));
+    // A file of only declarations renders no line at all
+    gb.add_node(declaration("/repo/src/types.rs", "Config", NodeType::Class));
+    let graph = gb.build();
+    let formatter = LLMOptimizedFormatter::new()
+        .with_verbosity(OutputVerbosity::Compact)
+        .with_max_tokens(Some(1_000_000));
+    let s = render(&graph, formatter);
+    assert!(s.contains("NODES:4 EDGES:0"));
+    assert!(s.contains("NODES:1/1"), "{s}");
+    assert!(!s.contains("## OMITTED"), "{s}");
+
+    // Over budget, shown and omitted add up to the functions and their files
+    let mut graph = hub_and_leaves();
+    graph.add_node(declaration("/repo/src/types.rs", "Config", NodeType::Class));
+    let formatter = LLMOptimizedFormatter::new()
+        .with_verbosity(OutputVerbosity::Compact)
+        .with_max_tokens(Some(300));
+    let s = render(&graph, formatter);
+    let shown_nodes: usize = s
+        .lines()
+        .filter_map(|line| line.strip_prefix("NODES:")?.split_once('/'))
+        .map(|(shown, _)| shown.parse::<usize>().unwrap())
+        .sum();
+    let shown_files = s.lines().filter(|line| line.contains(".rs→[")).count();
+    let footer = s.split("## OMITTED\n").nth(1).unwrap();
+    let omitted = format!("FILES:{} NODES:{} ", 41 - shown_files, 121 - shown_nodes);
+    assert!(footer.starts_with(&omitted), "{s}");
+}
@@ -0,0 +1,180 @@
+use embargo::core::graph::{Edge, EdgeType, GraphBuilder, Node, NodeType};
+use embargo::core::{FilePath, Language, NodeId, Visibility};
+use std::path::{Path, PathBuf};
+
+#[test]
+fn equal_strings_intern_to_the_same_id() {
+    let a = NodeId::intern("src_lib.rs:function:alpha:1");
+    let b = NodeId::from(String::from("src_lib.rs:function:alpha:1"));
+    let c = NodeId::intern("src_lib.rs:function:beta:2");
+
+    assert_eq!(a, b);
+    assert_ne!(a, c);
+    assert_eq!(a.as_str(), "src_lib.rs:function:alpha:1");
+    assert_eq!(a.to_string(), "src_lib.rs:function:alpha:1");
+    assert!(NodeId::lookup("src_lib.rs:function:never_interned:9").is_none());
+}
+
+#[test]
+fn node_ids_serialize_as_their_string_form() {
+    let node = Node::new(
+        "src_app.py:function:run:3",
+        "run".to_string(),
+        NodeType::Function,
+        PathBuf::from("src/app.py"),
+        3,
+        "python".to_string(),
+    );
+
+    let json = serde_json::to_value(&node).unwrap();
+    assert_eq!(json["id"], "src_app.py:function:run:3");
+
+    let back: Node = serde_json::from_value(json).unwrap();
+    assert_eq!(back.id, node.id);
+
+    let bytes = bincode::serialize(&node).unwrap();
+    let back: Node = bincode::deserialize(&bytes).unwrap();
+    assert_eq!(back.id, node.id);
+}
+
+#[test]
+fn graph_builder_resolves_edges_by_interned_id() {
+    let mut gb = GraphBuilder::new();
+    let caller = Node::new(
+        "m.rs:function:caller:1",
+        "caller".to_string(),
+        NodeType::Function,
+        PathBuf::from("m.rs"),
+        1,
+        "rust".to_string(),
+    );
+    let callee = Node::new(
+        "m.rs:function:callee:5",
+        "callee".to_string(),
+        NodeType::Function,
+        PathBuf::from("m.rs"),
+        5,
+        "rust".to_string(),
+    );
+    let callee_index = gb.add_node(callee);
+    gb.add_node(caller);
+
+    // Ids formatted independently still find the same nodes
+    let edge = Edge::new(
+        EdgeType::Call,
+        format!("m.rs:function:{}:1", "caller"),
+        "m.rs:function:callee:5",
+    );
+    assert!(gb.add_edge(edge).is_some());
+    assert_eq!(
+        gb.get_node_index("m.rs:function:callee:5"),
+        Some(callee_index)
+    );
+    assert_eq!(gb.get_node_index("m.rs:function:missing:0"), None);
+}
+
+#[test]
+fn nodes_share_interned_paths_and_name_languages_and_visibility() {
+    let a = Node::new(
+        "src_a.rs:function:a:1",
+        "a".to_string(),
+        NodeType::Function,
+        PathBuf::from("src/a.rs"),
+        1,
+        "rust".to_string(),
+    )
+    .with_visibility("public".to_string());
+    let b = Node::new(
+        "src_a.rs:function:b:2",
+        "b".to_string(),
+        NodeType::Function,
+        Path::new("src/a.rs"),
+        2,
+        "kotlin",
+    )
+    .with_visibility("pub(crate)".to_string());
+
+    assert_eq!(a.file_path, b.file_path);
+    assert_eq!(a.file_path, PathBuf::from("src/a.rs"));
+    assert_eq!(a.file_path.display().to_string(), "src/a.rs");
+    assert!(FilePath::from("src/b.rs") > a.file_path);
+
+    assert_eq!(a.language, Language::Rust);
+    assert_eq!(a.language.as_str(), "rust");
+    assert_eq!(b.language, Language::Unknown);
+
+    assert_eq!(a.visibility, Some(Visibility::Public));
+    assert_eq!(b.visibility.as_deref(), Some("pub(crate)"));
+
+    let bytes = bincode::serialize(&b).unwrap();
+    let back: Node = bincode::deserialize(&bytes).unwrap();
+    assert_eq!(back.file_path, b.file_path);
+    assert_eq!(back.visibility, b.visibility);
+    let json = serde_json::to_value(&a).unwrap();
+    assert_eq!(json["file_path"], "src/a.rs");
+}
+
+#[test]
+fn file_paths_are_equal_exactly_when_they_compare_equal() {
+    let paths = [
+        "src/a.rs",
+        "src//a.rs",
+        "src/./a.rs",
+        "src/a.rs/",
+        "./src/a.rs",
+        "src/a",
+    ];
+    let handles: Vec<FilePath> = paths.iter().map(|&path| FilePath::from(path)).collect();
+    for (a, &path_a) in handles.iter().zip(&paths) {
+        for (b, &path_b) in handles.iter().zip(&paths) {
+            assert_eq!(a == b, Path::new(path_a) == Path::new(path_b));
+            assert_eq!(a.cmp(b), Path::new(path_a).cmp(Path::new(path_b)));
+        }
+    }
+    // Other spellings resolve to the normalized path
+    assert_eq!(handles[1].as_path(), Path::new("src/a.rs"));
+    assert_eq!(handles[1].to_str(), Some("src/a.rs"));
+}
+
+#[cfg(unix)]
+#[test]
+fn non_utf8_file_paths_stay_distinct() {
+    use std::ffi::OsStr;
+    use std::os::unix::ffi::OsStrExt;
+
+    // Both decode lossily to the same string
+    let a = FilePath::intern(Path::new(OsStr::from_bytes(b"src/\xff.rs")));
+    let b = FilePath::intern(Path::new(OsStr::from_bytes(b"src/\xfe.rs")));
+    assert_ne!(a, b);
+    assert_eq!(a.as_path().as_os_str().as_bytes(), b"src/\xff.rs");
+    assert_eq!(a.to_str(), None);
+    assert!(bincode::serialize(&a).is_err());
+}
+
+#[test]
+fn ids_interned_concurrently_resolve_on_every_thread() {
+    // Enough ids per thread to fill several arena chunks while others read
+    let ids: Vec<Vec<NodeId>> = std::thread::scope(|scope| {
+        let workers: Vec<_> = (0..8)
+            .map(|worker| {
+                scope.spawn(move || {
+                    (0..3000)
+                        .map(|i| {
+                            let id = NodeId::intern(&format!("concurrent:{worker}:{i}"));
+                            assert_eq!(id.as_str(), format!("concurrent:{worker}:{i}"));
+                            id
+                        })
+                        .collect::<Vec<_>>()
+                })
+            })
+            .collect();
+        workers.into_iter().map(|w| w.join().unwrap()).collect()
+    });
+
+    for (worker, ids) in ids.iter().enumerate() {
+        for (i, id) in ids.iter().enumerate() {
+            assert_eq!(id.as_str(), format!("concurrent:{worker}:{i}"));
+            assert_eq!(NodeId::lookup(id.as_str()), Some(*id));
+        }
+    }
+}
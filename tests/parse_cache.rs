@@ -1,6 +1,13 @@
+use embargo::core::{Language, Node, NodeType, Visibility};
+use embargo::parsers::cache::{
+    CacheLookup, CacheValidation, ParseCache, ParsedFileEntry, PACK_FILE_NAME,
+};
+use embargo::parsers::limits::{LimitReason, ParseLimits};
 use embargo::parsers::rust::RustParser;
-use embargo::parsers::{cache::ParseCache, LanguageParser};
+use embargo::parsers::{LanguageParser, ParseResult};
 use std::fs;
+use std::io::Write;
+use std::path::Path;
 use std::time::Duration;
 
 #[test]
@@ -14,21 +21,465 @@ fn parse_cache_stores_and_detects_updates() {
 
     let cache = ParseCache::new(None).unwrap();
 
-    // Initially no cache, needs update should be true
-    assert!(cache.needs_update(&file).unwrap());
+    // Initially nothing is cached
+    assert!(cached(&cache, &file).is_none());
 
-    cache.store(&file, &result).unwrap();
+    store(&cache, &file, result);
 
-    // Immediately after store, should not need update
-    assert!(!cache.needs_update(&file).unwrap());
-    assert!(cache.get(&file).is_some());
+    // Immediately after store, the entry is served
+    assert!(cached(&cache, &file).is_some());
 
     // Modify file to force update
     std::thread::sleep(Duration::from_millis(5));
     fs::write(&file, "fn a() {}\nfn b() {}\n").unwrap();
 
-    assert!(cache.needs_update(&file).unwrap());
+    assert!(cached(&cache, &file).is_none());
     let new_result = parser.parse_file(&file).unwrap();
-    cache.store(&file, &new_result).unwrap();
-    assert!(cache.get(&file).is_some());
+    store(&cache, &file, new_result);
+    assert!(cached(&cache, &file).is_some());
+}
+
+/// Caches `result` as the parse of `file`, which must not be cached yet
+fn store(cache: &ParseCache, file: &Path, result: ParseResult) {
+    let lookup = cache.lookup_or_parse(file, || Ok(result)).unwrap();
+    assert!(matches!(lookup, CacheLookup::Parsed(_)));
+}
+
+/// The valid cached result for `file`, without parsing on a miss
+fn cached(cache: &ParseCache, file: &Path) -> Option<ParseResult> {
+    match cache.lookup_or_parse(file, || Err(anyhow::anyhow!("not cached"))) {
+        Ok(CacheLookup::Hit(result)) => Some(result),
+        _ => None,
+    }
+}
+
+fn sample_result(file: &Path, name: &str) -> ParseResult {
+    ParseResult {
+        nodes: vec![Node {
+            id: format!("{}:function:{name}:1", file.display()).into(),
+            name: name.to_string(),
+            node_type: NodeType::Function,
+            file_path: file.into(),
+            line_number: 1,
+            language: "rust".into(),
+            signature: None,
+            docstring: None,
+            visibility: None,
+        }],
+        edges: Vec::new(),
+        call_sites: None,
+        exports: Vec::new(),
+        limited: None,
+    }
+}
+
+#[test]
+fn pack_file_is_shared_by_later_cache_instances() {
+    let src = tempfile::TempDir::new().unwrap();
+    let cache_dir = tempfile::TempDir::new().unwrap();
+    let file = src.path().join("lib.rs");
+    fs::write(&file, "fn a() {}\n").unwrap();
+
+    let cache = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    store(&cache, &file, sample_result(&file, "a"));
+    drop(cache);
+
+    // One pack file (and its lock) instead of a file per source
+    let entries: Vec<_> = fs::read_dir(cache_dir.path())
+        .unwrap()
+        .map(|entry| entry.unwrap().file_name())
+        .filter(|name| name != "parse_cache.pack.lock")
+        .collect();
+    assert_eq!(entries.len(), 1);
+    assert!(cache_dir.path().join(PACK_FILE_NAME).exists());
+
+    let reopened = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    assert_eq!(reopened.stats().disk_cache_size, 1);
+    let cached = cached(&reopened, &file).unwrap();
+    assert_eq!(cached.nodes[0].name, "a");
+}
+
+#[test]
+fn pack_round_trips_every_node_field() {
+    let src = tempfile::TempDir::new().unwrap();
+    let cache_dir = tempfile::TempDir::new().unwrap();
+    let file = src.path().join("lib.rs");
+    fs::write(&file, "pub fn a() {}\n").unwrap();
+
+    let mut result = sample_result(&file, "a");
+    let header = src.path().join("lib.h");
+    result.nodes[0] = result.nodes[0]
+        .clone()
+        .with_signature("pub fn a()".to_string())
+        .with_docstring("Does a".to_string())
+        .with_visibility("pub(crate)".to_string());
+    result.nodes.push(
+        Node::new(
+            format!("{}:class:B:3", header.display()),
+            "B".to_string(),
+            NodeType::Class,
+            header.clone(),
+            3,
+            "cpp",
+        )
+        .with_visibility("public"),
+    );
+    let cache = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    store(&cache, &file, result.clone());
+    drop(cache);
+
+    let reopened = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    let cached = cached(&reopened, &file).unwrap();
+    assert_eq!(cached.nodes.len(), 2);
+    let (a, b) = (&cached.nodes[0], &cached.nodes[1]);
+    assert_eq!(a.id, result.nodes[0].id);
+    assert_eq!(a.file_path, file);
+    assert_eq!(a.language, Language::Rust);
+    assert_eq!(a.signature.as_deref(), Some("pub fn a()"));
+    assert_eq!(a.docstring.as_deref(), Some("Does a"));
+    assert_eq!(a.visibility.as_deref(), Some("pub(crate)"));
+    assert_eq!(b.file_path, header);
+    assert_eq!(b.language, Language::Cpp);
+    assert_eq!(b.visibility, Some(Visibility::Public));
+    assert_eq!(b.line_number, 3);
+}
+
+#[test]
+fn content_hash_validation_survives_mtime_changes() {
+    let src = tempfile::TempDir::new().unwrap();
+    let cache_dir = tempfile::TempDir::new().unwrap();
+    let file = src.path().join("lib.rs");
+    fs::write(&file, "fn a() {}\n").unwrap();
+
+    let cache = ParseCache::new(Some(cache_dir.path().to_path_buf()))
+        .unwrap()
+        .with_validation(CacheValidation::ContentHash);
+    store(&cache, &file, sample_result(&file, "a"));
+    drop(cache);
+
+    // Rewrite identical bytes, as a checkout would
+    std::thread::sleep(Duration::from_millis(20));
+    fs::write(&file, "fn a() {}\n").unwrap();
+
+    let by_mtime = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    assert!(cached(&by_mtime, &file).is_none());
+
+    let by_hash = ParseCache::new(Some(cache_dir.path().to_path_buf()))
+        .unwrap()
+        .with_validation(CacheValidation::ContentHash);
+    assert!(cached(&by_hash, &file).is_some());
+
+    // Same size, different contents
+    std::thread::sleep(Duration::from_millis(20));
+    fs::write(&file, "fn b() {}\n").unwrap();
+    assert!(cached(&by_hash, &file).is_none());
+}
+
+#[test]
+fn content_hash_hits_take_the_files_new_mtime() {
+    let src = tempfile::TempDir::new().unwrap();
+    let cache_dir = tempfile::TempDir::new().unwrap();
+    let file = src.path().join("lib.rs");
+    fs::write(&file, "fn a() {}\n").unwrap();
+
+    let cache = ParseCache::new(Some(cache_dir.path().to_path_buf()))
+        .unwrap()
+        .with_validation(CacheValidation::ContentHash);
+    cache
+        .lookup_or_parse(&file, || Ok(sample_result(&file, "a")))
+        .unwrap();
+
+    // Rewrite identical bytes under a later mtime, as a checkout would
+    let touched = fs::metadata(&file).unwrap().modified().unwrap() + Duration::from_secs(60);
+    fs::write(&file, "fn a() {}\n").unwrap();
+    fs::File::options()
+        .write(true)
+        .open(&file)
+        .unwrap()
+        .set_modified(touched)
+        .unwrap();
+    let hit = cache
+        .lookup_or_parse(&file, || panic!("unchanged contents must not parse"))
+        .unwrap();
+    assert!(matches!(hit, CacheLookup::Hit(_)));
+
+    // The pack record now matches by metadata alone
+    let by_mtime = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    let from_pack = by_mtime
+        .lookup_or_parse(&file, || panic!("restamped record must match by mtime"))
+        .unwrap();
+    assert!(matches!(from_pack, CacheLookup::Hit(_)));
+
+    // So does the memory entry: identical mtime and size skip the hash
+    fs::write(&file, "fn b() {}\n").unwrap();
+    fs::File::options()
+        .write(true)
+        .open(&file)
+        .unwrap()
+        .set_modified(touched)
+        .unwrap();
+    let from_memory = cache
+        .lookup_or_parse(&file, || panic!("restamped entry must match by mtime"))
+        .unwrap();
+    assert!(matches!(from_memory, CacheLookup::Hit(ref r) if r.nodes[0].name == "a"));
+}
+
+#[test]
+fn compaction_keeps_only_the_latest_record() {
+    let src = tempfile::TempDir::new().unwrap();
+    let cache_dir = tempfile::TempDir::new().unwrap();
+    let file = src.path().join("lib.rs");
+    fs::write(&file, "fn a() {}\n").unwrap();
+    let pack_path = cache_dir.path().join(PACK_FILE_NAME);
+
+    let mut cache = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    for i in 0..10 {
+        // A new size per round, so each store supersedes the last record
+        fs::write(&file, format!("fn a() {{}}\n{}", "\n".repeat(i))).unwrap();
+        store(&cache, &file, sample_result(&file, &format!("f{i}")));
+    }
+    let before = fs::metadata(&pack_path).unwrap().len();
+    cache.compact().unwrap();
+    let after = fs::metadata(&pack_path).unwrap().len();
+    assert!(after * 5 < before, "{after} vs {before}");
+
+    let reopened = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    assert_eq!(cached(&reopened, &file).unwrap().nodes[0].name, "f9");
+}
+
+#[test]
+fn caches_sharing_a_directory_keep_each_others_records() {
+    let src = tempfile::TempDir::new().unwrap();
+    let cache_dir = tempfile::TempDir::new().unwrap();
+    let first = src.path().join("first.rs");
+    let second = src.path().join("second.rs");
+    fs::write(&first, "fn a() {}\n").unwrap();
+    fs::write(&second, "fn b() {}\n").unwrap();
+
+    // Two open stores appending to one pack, as concurrent runs would
+    let one = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    let two = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    store(&one, &first, sample_result(&first, "a"));
+    store(&two, &second, sample_result(&second, "b"));
+    fs::write(&first, "fn a2() {}\n").unwrap();
+    store(&one, &first, sample_result(&first, "a2"));
+    drop((one, two));
+
+    let reopened = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    assert_eq!(reopened.stats().disk_cache_size, 2);
+    assert_eq!(cached(&reopened, &first).unwrap().nodes[0].name, "a2");
+    assert_eq!(cached(&reopened, &second).unwrap().nodes[0].name, "b");
+}
+
+#[test]
+fn truncated_pack_tail_is_discarded() {
+    let src = tempfile::TempDir::new().unwrap();
+    let cache_dir = tempfile::TempDir::new().unwrap();
+    let file = src.path().join("lib.rs");
+    fs::write(&file, "fn a() {}\n").unwrap();
+    let pack_path = cache_dir.path().join(PACK_FILE_NAME);
+
+    let cache = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    store(&cache, &file, sample_result(&file, "a"));
+    drop(cache);
+    let intact_len = fs::metadata(&pack_path).unwrap().len();
+
+    // Simulate a write interrupted partway through a record
+    let mut pack = fs::OpenOptions::new()
+        .append(true)
+        .open(&pack_path)
+        .unwrap();
+    pack.write_all(&[7, 0, 0, 0, b'p']).unwrap();
+    drop(pack);
+
+    let reopened = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    assert_eq!(fs::metadata(&pack_path).unwrap().len(), intact_len);
+    assert_eq!(cached(&reopened, &file).unwrap().nodes[0].name, "a");
+}
+
+#[test]
+fn lookup_or_parse_only_parses_on_a_miss() {
+    let src = tempfile::TempDir::new().unwrap();
+    let cache_dir = tempfile::TempDir::new().unwrap();
+    let file = src.path().join("lib.rs");
+    fs::write(&file, "fn a() {}\n").unwrap();
+
+    let cache = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    let first = cache
+        .lookup_or_parse(&file, || Ok(sample_result(&file, "a")))
+        .unwrap();
+    assert!(matches!(first, CacheLookup::Parsed(_)));
+
+    let second = cache
+        .lookup_or_parse(&file, || panic!("memory hit must not parse"))
+        .unwrap();
+    assert!(matches!(second, CacheLookup::Hit(ref r) if r.nodes[0].name == "a"));
+    drop(cache);
+
+    let reopened = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    let from_pack = reopened
+        .lookup_or_parse(&file, || panic!("pack hit must not parse"))
+        .unwrap();
+    assert!(matches!(from_pack, CacheLookup::Hit(ref r) if r.nodes[0].name == "a"));
+
+    std::thread::sleep(Duration::from_millis(20));
+    fs::write(&file, "fn b() {}\nfn c() {}\n").unwrap();
+    let stale = reopened
+        .lookup_or_parse(&file, || Ok(sample_result(&file, "b")))
+        .unwrap();
+    assert!(matches!(stale, CacheLookup::Parsed(_)));
+}
+
+#[test]
+fn memory_tier_evicts_unreferenced_entries_first() {
+    let src = tempfile::TempDir::new().unwrap();
+    let files: Vec<_> = ["a.rs", "b.rs", "c.rs"]
+        .iter()
+        .map(|name| {
+            let file = src.path().join(name);
+            fs::write(&file, "fn f() {}\n").unwrap();
+            file
+        })
+        .collect();
+
+    let cache = ParseCache::in_memory_only().with_memory_limits(usize::MAX, Some(2));
+    store(&cache, &files[0], sample_result(&files[0], "a"));
+    store(&cache, &files[1], sample_result(&files[1], "b"));
+
+    // Touching `a` gives it a second chance, so `b` is the victim
+    assert!(cached(&cache, &files[0]).is_some());
+    store(&cache, &files[2], sample_result(&files[2], "c"));
+
+    assert_eq!(cache.stats().memory_entries, 2);
+    assert!(cached(&cache, &files[0]).is_some());
+    assert!(cached(&cache, &files[1]).is_none());
+    assert!(cached(&cache, &files[2]).is_some());
+}
+
+#[test]
+fn entries_too_large_for_memory_leave_no_key_behind() {
+    let src = tempfile::TempDir::new().unwrap();
+    let [p, q, r] = ["p.rs", "q.rs", "r.rs"].map(|name| src.path().join(name));
+    for file in [&p, &q, &r] {
+        fs::write(file, "fn f() {}\n").unwrap();
+    }
+    let cache = ParseCache::in_memory_only().with_memory_limits(4096, Some(2));
+
+    store(&cache, &p, sample_result(&p, "p"));
+    fs::write(&p, "fn f() {}\n\n").unwrap();
+    store(&cache, &p, sample_result(&p, &"x".repeat(8192)));
+    store(&cache, &q, sample_result(&q, "q"));
+    fs::write(&p, "fn f() {}\n\n\n").unwrap();
+    store(&cache, &p, sample_result(&p, "p2"));
+
+    // `q` is now the oldest entry, so it goes first
+    store(&cache, &r, sample_result(&r, "r"));
+    assert!(cached(&cache, &q).is_none());
+    assert!(cached(&cache, &p).is_some());
+    assert!(cached(&cache, &r).is_some());
+}
+
+#[test]
+fn memory_tier_respects_byte_budget_and_falls_back_to_pack() {
+    let src = tempfile::TempDir::new().unwrap();
+    let cache_dir = tempfile::TempDir::new().unwrap();
+    let file = src.path().join("a.rs");
+    fs::write(&file, "fn f() {}\n").unwrap();
+
+    let entry_size = ParsedFileEntry {
+        nodes: sample_result(&file, "f0").nodes,
+        edges: Vec::new(),
+        call_sites: None,
+        exports: Vec::new(),
+        limited: None,
+        timestamp: 0,
+        file_size: 0,
+        content_hash: 0,
+        limits: 0,
+    }
+    .approx_size();
+    let budget = entry_size * 3;
+
+    let cache = ParseCache::new(Some(cache_dir.path().to_path_buf()))
+        .unwrap()
+        .with_memory_limits(budget, None);
+    let mut files = Vec::new();
+    for i in 0..8 {
+        let file = src.path().join(format!("f{i}.rs"));
+        fs::write(&file, "fn f() {}\n").unwrap();
+        store(&cache, &file, sample_result(&file, &format!("f{i}")));
+        files.push(file);
+    }
+
+    let stats = cache.stats();
+    assert!(stats.memory_bytes <= budget);
+    assert!(stats.memory_entries < files.len());
+
+    // Evicted entries are still served from the pack
+    for (i, file) in files.iter().enumerate() {
+        let hit = cache
+            .lookup_or_parse(file, || panic!("{} should be cached", file.display()))
+            .unwrap();
+        assert!(matches!(hit, CacheLookup::Hit(ref r) if r.nodes[0].name == format!("f{i}")));
+    }
+}
+
+#[test]
+fn entries_are_only_served_under_the_limits_they_were_parsed_with() {
+    let src = tempfile::TempDir::new().unwrap();
+    let cache_dir = tempfile::TempDir::new().unwrap();
+    let file = src.path().join("lib.rs");
+    fs::write(&file, "fn a() {}\n").unwrap();
+    let open = |limits: &ParseLimits| {
+        ParseCache::new(Some(cache_dir.path().to_path_buf()))
+            .unwrap()
+            .with_parse_limits(limits)
+    };
+
+    let limited = open(&ParseLimits::default());
+    let outlined = ParseResult {
+        limited: Some(LimitReason::Generated),
+        ..sample_result(&file, "a")
+    };
+    let first = limited.lookup_or_parse(&file, || Ok(outlined)).unwrap();
+    assert!(matches!(first, CacheLookup::Parsed(_)));
+    assert!(cached(&limited, &file).is_some());
+    drop(limited);
+
+    // Without limits the outline is stale and the file gets a full parse
+    let unlimited = open(&ParseLimits::unlimited());
+    assert!(cached(&unlimited, &file).is_none());
+    let full = unlimited
+        .lookup_or_parse(&file, || Ok(sample_result(&file, "full")))
+        .unwrap();
+    assert!(matches!(full, CacheLookup::Parsed(ref r) if r.limited.is_none()));
+    let again = unlimited
+        .lookup_or_parse(&file, || panic!("same limits must hit"))
+        .unwrap();
+    assert!(matches!(again, CacheLookup::Hit(ref r) if r.nodes[0].name == "full"));
+}
+
+#[test]
+fn timed_out_outlines_are_not_cached() {
+    let src = tempfile::TempDir::new().unwrap();
+    let cache_dir = tempfile::TempDir::new().unwrap();
+    let file = src.path().join("lib.rs");
+    fs::write(&file, "fn a() {}\n").unwrap();
+    let timed_out = || {
+        Ok(ParseResult {
+            nodes: Vec::new(),
+            edges: Vec::new(),
+            call_sites: None,
+            exports: Vec::new(),
+            limited: Some(LimitReason::Timeout),
+        })
+    };
+
+    let cache = ParseCache::new(Some(cache_dir.path().to_path_buf())).unwrap();
+    for _ in 0..2 {
+        let lookup = cache.lookup_or_parse(&file, timed_out).unwrap();
+        assert!(matches!(lookup, CacheLookup::Parsed(_)));
+    }
+    assert_eq!(cache.stats().memory_entries, 0);
+    assert_eq!(cache.stats().disk_cache_size, 0);
 }
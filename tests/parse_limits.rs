@@ -0,0 +1,141 @@
+use anyhow::Result;
+use embargo::core::{Node, NodeType};
+use embargo::parsers::limits::{
+    is_generated, is_minified, parse_limited, LimitReason, ParseLimits,
+};
+use embargo::parsers::{LanguageParser, ParseResult};
+use std::path::Path;
+use std::time::Duration;
+
+/// Records which entry point ran as the single node's name
+struct FakeParser {
+    outline_times_out: bool,
+}
+
+fn result_named(file_path: &Path, name: &str) -> ParseResult {
+    ParseResult {
+        nodes: vec![Node::new(
+            format!("{}:function:{name}:1", file_path.display()),
+            name.to_string(),
+            NodeType::Function,
+            file_path.to_path_buf(),
+            1,
+            "javascript".to_string(),
+        )],
+        edges: Vec::new(),
+        call_sites: Some(Vec::new()),
+        exports: Vec::new(),
+        limited: None,
+    }
+}
+
+impl LanguageParser for FakeParser {
+    fn parse_source(&self, file_path: &Path, _source: &[u8]) -> Result<ParseResult> {
+        Ok(result_named(file_path, "full"))
+    }
+
+    fn parse_outline(
+        &self,
+        file_path: &Path,
+        _source: &[u8],
+        _timeout: Duration,
+    ) -> Result<Option<ParseResult>> {
+        Ok((!self.outline_times_out).then(|| result_named(file_path, "outline")))
+    }
+
+    fn language_name(&self) -> &str {
+        "javascript"
+    }
+}
+
+fn strict_limits() -> ParseLimits {
+    ParseLimits {
+        max_bytes: 8 * 1024,
+        max_lines: 100,
+        ..ParseLimits::default()
+    }
+}
+
+#[test]
+fn limits_flag_large_long_generated_and_minified_sources() {
+    let limits = strict_limits();
+    let path = Path::new("src/app.js");
+    let ordinary = "function f() {\n  return 1;\n}\n".repeat(20);
+    assert_eq!(limits.check(path, ordinary.as_bytes()), None);
+
+    let large = "x".repeat(9 * 1024);
+    assert_eq!(
+        limits.check(path, large.as_bytes()),
+        Some(LimitReason::Bytes(9 * 1024))
+    );
+    let long = "a();\n".repeat(150);
+    assert_eq!(
+        limits.check(path, long.as_bytes()),
+        Some(LimitReason::Lines(151))
+    );
+
+    let generated = format!("// Code generated by protoc-gen-go. DO NOT EDIT.\n{ordinary}");
+    assert!(is_generated(generated.as_bytes()));
+    assert_eq!(
+        limits.check(path, generated.as_bytes()),
+        Some(LimitReason::Generated)
+    );
+    assert!(is_generated(b"/* @generated */\nint x;\n"));
+    assert!(is_generated(
+        b"#!/usr/bin/env python\n\"\"\"Stubs.\n\nAuto-generated by grpc_tools. Do not edit.\n\"\"\"\nimport grpc\n"
+    ));
+    assert!(!is_generated(ordinary.as_bytes()));
+
+    // Markers below the header, in code or later comments, are not headers
+    let quoted = "fn main() {\n    println!(\"Do not edit the config by hand\");\n}\n";
+    assert!(!is_generated(quoted.as_bytes()));
+    let later = "import os\n\n# Values below are auto-generated at startup\nVALUES = {}\n";
+    assert!(!is_generated(later.as_bytes()));
+    assert_eq!(limits.check(path, quoted.as_bytes()), None);
+
+    let bundle = format!("/*! license */\n{}\n", "var a=1;".repeat(700));
+    assert!(is_minified(path, bundle.as_bytes()));
+    assert_eq!(
+        limits.check(path, bundle.as_bytes()),
+        Some(LimitReason::Minified)
+    );
+    assert!(is_minified(Path::new("vendor/jquery.min.js"), b"x"));
+    assert!(!is_minified(path, ordinary.as_bytes()));
+
+    let relaxed = ParseLimits {
+        detect_generated: false,
+        ..limits
+    };
+    assert_eq!(relaxed.check(path, bundle.as_bytes()), None);
+    assert_eq!(ParseLimits::unlimited().check(path, long.as_bytes()), None);
+}
+
+#[test]
+fn over_limit_files_are_outlined_and_timeouts_reported() {
+    let dir = tempfile::tempdir().unwrap();
+    let small = dir.path().join("small.js");
+    std::fs::write(&small, "function f() {}\n").unwrap();
+    let bundle = dir.path().join("bundle.min.js");
+    std::fs::write(&bundle, "function f(){return 1}").unwrap();
+
+    let parser = FakeParser {
+        outline_times_out: false,
+    };
+    let limits = strict_limits();
+
+    let result = parse_limited(&parser, &small, &limits).unwrap();
+    assert_eq!(result.nodes[0].name, "full");
+    assert_eq!(result.limited, None);
+
+    let result = parse_limited(&parser, &bundle, &limits).unwrap();
+    assert_eq!(result.nodes[0].name, "outline");
+    assert_eq!(result.limited, Some(LimitReason::Minified));
+
+    let stuck = FakeParser {
+        outline_times_out: true,
+    };
+    let result = parse_limited(&stuck, &bundle, &limits).unwrap();
+    assert!(result.nodes.is_empty());
+    assert!(result.call_sites.is_none());
+    assert_eq!(result.limited, Some(LimitReason::Timeout));
+}
@@ -0,0 +1,48 @@
+use embargo::core::NodeType;
+use embargo::parsers::cpp::CppParser;
+use embargo::parsers::LanguageParser;
+use std::fs;
+
+#[test]
+fn cpp_parser_extracts_each_declaration_once() {
+    let dir = tempfile::TempDir::new().unwrap();
+    let file = dir.path().join("sample.cpp");
+    let code = r#"
+        #include <vector>
+
+        struct Point { int x; };
+
+        int helper(int a) { return a; }
+
+        int run() { return helper(1); }
+    "#;
+    fs::write(&file, code).unwrap();
+
+    let parser = CppParser::new().unwrap();
+    let result = parser.parse_file(&file).unwrap();
+
+    let count = |name: &str, node_type: NodeType| {
+        result
+            .nodes
+            .iter()
+            .filter(|n| n.name == name && n.node_type == node_type)
+            .count()
+    };
+    let includes = result
+        .nodes
+        .iter()
+        .filter(|n| n.name.starts_with("#include <vector>"))
+        .count();
+    assert_eq!(includes, 1);
+    assert_eq!(count("Point", NodeType::Class), 1);
+    assert_eq!(count("helper", NodeType::Function), 1);
+    assert_eq!(count("run", NodeType::Function), 1);
+
+    // Call sites come from the same traversal and know their caller
+    let call_sites = result.call_sites.unwrap();
+    let call = call_sites
+        .iter()
+        .find(|site| site.called_name == "helper")
+        .unwrap();
+    assert!(call.caller_id.as_str().contains(":function:run:"));
+}
@@ -0,0 +1,48 @@
+use embargo::parsers::ParserFactory;
+use std::fs;
+use std::sync::Arc;
+
+#[test]
+fn parser_factory_returns_shared_instances_per_language() {
+    let factory = ParserFactory::new();
+
+    let a = factory.get_parser("cpp").unwrap();
+    let b = factory.get_parser("c++").unwrap();
+    assert!(Arc::ptr_eq(&a, &b));
+    assert_eq!(a.language_name(), "cpp");
+
+    let py = factory.get_parser("python").unwrap();
+    assert!(!Arc::ptr_eq(&a, &py));
+
+    assert!(factory.get_parser("cobol").is_err());
+}
+
+#[test]
+fn shared_parser_is_reused_across_files_and_threads() {
+    let dir = tempfile::TempDir::new().unwrap();
+    let files: Vec<_> = (0..6)
+        .map(|i| {
+            let path = dir.path().join(format!("f{i}.rs"));
+            fs::write(&path, format!("fn f{i}() {{}}\n")).unwrap();
+            path
+        })
+        .collect();
+
+    let factory = ParserFactory::new();
+    let parser = factory.get_parser("rust").unwrap();
+
+    std::thread::scope(|scope| {
+        for chunk in files.chunks(2) {
+            let parser = Arc::clone(&parser);
+            scope.spawn(move || {
+                for path in chunk {
+                    // Parse twice on the same thread to exercise the pooled parser
+                    for _ in 0..2 {
+                        let result = parser.parse_file(path).unwrap();
+                        assert!(result.nodes.iter().any(|n| n.name.starts_with('f')));
+                    }
+                }
+            });
+        }
+    });
+}
@@ -0,0 +1,76 @@
+use embargo::core::{EdgeType, NodeType};
+use embargo::parsers::javascript::JavaScriptParser;
+use embargo::parsers::LanguageParser;
+use std::fs;
+
+#[test]
+fn javascript_parser_extracts_declarations_from_queries() {
+    let dir = tempfile::TempDir::new().unwrap();
+    let file = dir.path().join("sample.js");
+    let code = r#"
+        const fs = require('fs');
+
+        class Dog extends Animal {
+            name = 'rex';
+            bark(times) { return times; }
+        }
+
+        function main(argv) { new Dog().bark(1); }
+
+        var handler = () => 1;
+
+        Dog.prototype.sit = function () {};
+    "#;
+    fs::write(&file, code).unwrap();
+
+    let parser = JavaScriptParser::new().unwrap();
+    let result = parser.parse_file(&file).unwrap();
+
+    let node = |name: &str| result.nodes.iter().find(|n| n.name == name).unwrap();
+    assert_eq!(node("require('fs')").node_type, NodeType::Module);
+    assert_eq!(node("Dog").node_type, NodeType::Class);
+    assert_eq!(node("name").node_type, NodeType::Variable);
+    assert_eq!(node("bark").signature.as_deref(), Some("bark((times))"));
+    assert_eq!(node("main").node_type, NodeType::Function);
+    assert_eq!(node("handler").node_type, NodeType::Function);
+    assert_eq!(node("sit").node_type, NodeType::Function);
+
+    // Declarations come out in source order, each once
+    let names: Vec<&str> = result.nodes.iter().map(|n| n.name.as_str()).collect();
+    assert_eq!(
+        names,
+        [
+            "require('fs')",
+            "Dog",
+            "name",
+            "bark",
+            "main",
+            "handler",
+            "sit"
+        ]
+    );
+
+    let dog = node("Dog").id;
+    let has_edge = |edge_type: EdgeType, source: &str, target: &str| {
+        result.edges.iter().any(|e| {
+            e.edge_type == edge_type
+                && e.source_id.as_str() == source
+                && e.target_id.as_str() == target
+        })
+    };
+    assert!(has_edge(
+        EdgeType::Inheritance,
+        dog.as_str(),
+        "external:class:Animal:0"
+    ));
+    assert!(has_edge(
+        EdgeType::Contains,
+        dog.as_str(),
+        node("bark").id.as_str()
+    ));
+    assert!(has_edge(
+        EdgeType::Contains,
+        "external:class:Dog:0",
+        node("sit").id.as_str()
+    ));
+}
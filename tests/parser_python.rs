@@ -126,6 +126,76 @@ def outer():
     assert_eq!(contains_edges.len(), 2); // outer->inner, inner->deeply_nested
 }
 
+#[test]
+fn python_parser_nests_functions_under_the_innermost_enclosing_function() {
+    let dir = tempfile::TempDir::new().unwrap();
+    let file = dir.path().join("scopes.py");
+    let code = r#"
+def outer():
+    if flag:
+        def in_branch():
+            pass
+    class Local:
+        def method(self):
+            pass
+    def sibling():
+        def leaf():
+            pass
+"#;
+    fs::write(&file, code).unwrap();
+
+    let parser = PythonParser::new().unwrap();
+    let result = parser.parse_file(&file).unwrap();
+    let name_of = |id| {
+        result
+            .nodes
+            .iter()
+            .find(|n| n.id == id)
+            .map(|n| n.name.as_str())
+            .unwrap()
+    };
+
+    // Methods of a class inside a function are not nested functions
+    let mut functions: Vec<&str> = result
+        .nodes
+        .iter()
+        .filter(|n| n.node_type == NodeType::Function)
+        .map(|n| n.name.as_str())
+        .collect();
+    functions.sort();
+    assert_eq!(functions, ["in_branch", "leaf", "outer", "sibling"]);
+
+    let contains: Vec<(&str, &str)> = result
+        .edges
+        .iter()
+        .filter(|e| e.edge_type == EdgeType::Contains)
+        .map(|e| (name_of(e.source_id), name_of(e.target_id)))
+        .collect();
+    assert_eq!(
+        contains,
+        [
+            ("outer", "in_branch"),
+            ("outer", "sibling"),
+            ("sibling", "leaf")
+        ]
+    );
+
+    // Deep nesting is walked without recursion
+    let depth = 200;
+    let code: String = (0..depth)
+        .map(|level| format!("{}def f{}():\n", "    ".repeat(level), level))
+        .chain([format!("{}pass\n", "    ".repeat(depth))])
+        .collect();
+    fs::write(&file, code).unwrap();
+    let result = parser.parse_file(&file).unwrap();
+    let contains = result
+        .edges
+        .iter()
+        .filter(|e| e.edge_type == EdgeType::Contains)
+        .count();
+    assert_eq!(contains, depth - 1);
+}
+
 #[test]
 fn python_parser_extracts_function_signatures_with_types() {
     let dir = tempfile::TempDir::new().unwrap();
@@ -0,0 +1,210 @@
+use embargo::core::graph::GraphBuilder;
+use embargo::core::pipeline::{run_stages, GraphAssembly};
+use embargo::core::resolver::{CallSite, CallType};
+use embargo::core::{DependencyGraph, Edge, EdgeType, Node, NodeType};
+use embargo::parsers::limits::LimitReason;
+use embargo::parsers::ParseResult;
+use std::path::PathBuf;
+
+fn node(id: &str, file: &str) -> Node {
+    Node::new(
+        id.to_string(),
+        id.to_string(),
+        NodeType::Function,
+        PathBuf::from(file),
+        1,
+        "rust".to_string(),
+    )
+}
+
+fn edge(source: &str, target: &str) -> Edge {
+    Edge::new(EdgeType::Uses, source.to_string(), target.to_string())
+}
+
+fn result(nodes: Vec<Node>, edges: Vec<Edge>) -> ParseResult {
+    let call_sites = nodes
+        .iter()
+        .map(|caller| CallSite {
+            caller_id: caller.id,
+            called_name: "callee".to_string(),
+            call_type: CallType::SimpleCall,
+            context: None,
+            line_number: 1,
+        })
+        .collect();
+    ParseResult {
+        nodes,
+        edges,
+        call_sites: Some(call_sites),
+        exports: Vec::new(),
+        limited: None,
+    }
+}
+
+/// Each file refers back to an earlier file, forward to a later one, and to a
+/// module node that two files both emit
+fn files() -> Vec<(PathBuf, ParseResult)> {
+    let mut outlined = result(
+        vec![node("c::main", "c.rs"), node("ext::module", "c.rs")],
+        vec![edge("c::main", "a::f"), edge("c::main", "ext::module")],
+    );
+    outlined.limited = Some(LimitReason::Minified);
+    vec![
+        (
+            PathBuf::from("a.rs"),
+            result(
+                vec![node("a::f", "a.rs"), node("ext::module", "a.rs")],
+                vec![
+                    edge("a::f", "ext::module"),
+                    edge("a::f", "b::g"),
+                    edge("a::f", "c::main"),
+                ],
+            ),
+        ),
+        (
+            PathBuf::from("b.rs"),
+            result(
+                vec![node("b::g", "b.rs"), node("b::h", "b.rs")],
+                vec![
+                    edge("b::g", "a::f"),
+                    edge("b::h", "b::g"),
+                    edge("b::h", "ext::module"),
+                ],
+            ),
+        ),
+        (PathBuf::from("c.rs"), outlined),
+    ]
+}
+
+/// The builder and call sites of adding the files one by one in path order
+fn sequential(files: Vec<(PathBuf, ParseResult)>) -> (GraphBuilder, Vec<CallSite>) {
+    let mut graph_builder = GraphBuilder::new();
+    let mut call_sites = Vec::new();
+    for (_, result) in files {
+        for node in result.nodes {
+            graph_builder.add_node(node);
+        }
+        for edge in result.edges {
+            graph_builder.add_edge(edge);
+        }
+        call_sites.extend(result.call_sites.unwrap_or_default());
+    }
+    (graph_builder, call_sites)
+}
+
+fn layout(graph: &DependencyGraph) -> (Vec<(String, PathBuf)>, Vec<String>) {
+    let nodes = graph
+        .node_weights()
+        .map(|node| (node.id.as_str().to_string(), node.file_path.to_path_buf()))
+        .collect();
+    let edges = graph
+        .raw_edges()
+        .iter()
+        .map(|edge| format!("{}->{}", edge.source().index(), edge.target().index()))
+        .collect();
+    (nodes, edges)
+}
+
+#[test]
+fn assembly_in_any_arrival_order_matches_adding_files_in_path_order() {
+    let (expected, expected_calls) = sequential(files());
+    let expected_calls: Vec<_> = expected_calls.iter().map(|site| site.caller_id).collect();
+
+    for arrival in [[0, 1, 2], [2, 0, 1], [1, 2, 0], [2, 1, 0]] {
+        let mut pending: Vec<Option<(PathBuf, ParseResult)>> =
+            files().into_iter().map(Some).collect();
+        let mut assembly = GraphAssembly::new();
+        for i in arrival {
+            let (path, result) = pending[i].take().unwrap();
+            assembly.add(path, result);
+        }
+        let assembled = assembly.finish();
+
+        let calls: Vec<_> = assembled
+            .call_sites
+            .iter()
+            .map(|site| site.caller_id)
+            .collect();
+        assert_eq!(calls, expected_calls, "arrival order {:?}", arrival);
+        assert_eq!(
+            assembled.limited,
+            vec![(PathBuf::from("c.rs"), LimitReason::Minified)]
+        );
+        let graph = assembled.builder.build();
+        assert_eq!(
+            layout(&graph),
+            layout(expected.graph()),
+            "arrival order {:?}",
+            arrival
+        );
+    }
+}
+
+#[test]
+fn assembled_builder_resolves_ids_to_their_last_copy_in_path_order() {
+    let (expected, _) = sequential(files());
+    let mut assembly = GraphAssembly::new();
+    for (path, result) in files().into_iter().rev() {
+        assembly.add(path, result);
+    }
+    let builder = assembly.finish().builder;
+    assert_eq!(
+        builder.get_node_index("ext::module"),
+        expected.get_node_index("ext::module")
+    );
+}
+
+#[test]
+fn stages_hand_every_result_to_the_consumer() {
+    let mut seen = Vec::new();
+    run_stages(
+        2,
+        None,
+        |send| {
+            (0..100u32).for_each(send);
+            Ok(())
+        },
+        |n| n * 2,
+        |n| seen.push(n),
+    )
+    .unwrap();
+    seen.sort_unstable();
+    assert_eq!(seen, (0..100u32).map(|n| n * 2).collect::<Vec<_>>());
+}
+
+#[test]
+fn stages_report_a_producer_error() {
+    let err = run_stages(
+        2,
+        None,
+        |send| {
+            send(1u32);
+            Err(anyhow::anyhow!("walk failed"))
+        },
+        |n| n,
+        |_| {},
+    )
+    .unwrap_err();
+    assert_eq!(err.to_string(), "walk failed");
+}
+
+#[test]
+fn stages_report_a_panicking_worker() {
+    let err = run_stages(
+        2,
+        None,
+        |send| {
+            (0..100u32).for_each(send);
+            Ok(())
+        },
+        |n| {
+            if n == 7 {
+                panic!("parser crashed");
+            }
+            n
+        },
+        |_| {},
+    )
+    .unwrap_err();
+    assert!(err.to_string().contains("panicked"), "{}", err);
+}
@@ -0,0 +1,139 @@
+use embargo::core::graph::{GraphBuilder, Node};
+use embargo::core::resolver::{CallSite, CallType, FunctionResolver};
+use embargo::core::{CodebaseAnalyzer, NodeType, Profiler};
+use std::path::PathBuf;
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+#[test]
+fn summary_aggregates_spans_times_and_counters() {
+    let profiler = Profiler::new();
+    for language in ["python", "python", "rust"] {
+        let _span = profiler.span_with("parse", language);
+    }
+    drop(profiler.span("graph_build"));
+    profiler.add_time("resolve_cpu", "simple", Duration::from_millis(4));
+    profiler.add_time("resolve_cpu", "method", Duration::from_millis(2));
+    profiler.add("cache.hits", 3);
+    profiler.add("cache.misses", 1);
+    profiler.add("cache.hits", 0);
+
+    let summary = profiler.summary();
+    let parse = &summary.phases["parse"];
+    assert_eq!(parse.stats.count, 3);
+    assert_eq!(parse.by["python"].count, 2);
+    assert_eq!(parse.by["rust"].count, 1);
+    assert!(summary.phases["graph_build"].by.is_empty());
+
+    let resolve = &summary.phases["resolve_cpu"];
+    assert_eq!(resolve.stats.count, 2);
+    assert!((resolve.stats.total_ms - 6.0).abs() < 1e-9);
+    assert!((resolve.stats.max_ms - 4.0).abs() < 1e-9);
+
+    assert_eq!(summary.counters["cache.hits"], 3);
+    assert_eq!(summary.cache_hit_ratio, Some(0.75));
+    assert_eq!(summary.memo_hit_ratio, None);
+}
+
+#[test]
+fn chrome_trace_has_one_complete_event_per_span() {
+    let profiler = Profiler::new();
+    let start = Instant::now();
+    profiler.record("scan", None, start, Duration::from_micros(1500));
+    std::thread::scope(|scope| {
+        scope.spawn(|| drop(profiler.span_with("parse", "go")));
+    });
+    profiler.add("graph.nodes", 12);
+
+    let mut out = Vec::new();
+    profiler.write_chrome_trace(&mut out).unwrap();
+    let trace: serde_json::Value = serde_json::from_slice(&out).unwrap();
+    let events = trace["traceEvents"].as_array().unwrap();
+    assert_eq!(events.len(), 2);
+    assert!(events.iter().all(|event| event["ph"] == "X"));
+    assert_eq!(events[0]["name"], "scan");
+    assert_eq!(events[0]["dur"], 1500.0);
+    assert_eq!(events[1]["args"]["detail"], "go");
+    assert_ne!(events[0]["tid"], events[1]["tid"]);
+    assert_eq!(trace["otherData"]["graph.nodes"], 12);
+
+    let mut stats = Vec::new();
+    profiler.write_stats_json(&mut stats).unwrap();
+    let stats: serde_json::Value = serde_json::from_slice(&stats).unwrap();
+    assert_eq!(stats["version"], 1);
+    assert_eq!(stats["phases"]["parse"]["by"]["go"]["count"], 1);
+}
+
+#[test]
+fn resolution_stats_split_by_call_type() {
+    let node = |id: &str, name: &str| {
+        Node::new(
+            id.to_string(),
+            name.to_string(),
+            NodeType::Function,
+            PathBuf::from("/tmp/mod.py"),
+            1,
+            "python".to_string(),
+        )
+    };
+    let nodes = [
+        node("mod.py:function:main:1", "main"),
+        node("mod.py:function:compute_total:5", "compute_total"),
+    ];
+    let mut gb = GraphBuilder::new();
+    for node in &nodes {
+        gb.add_node(node.clone());
+    }
+    let mut resolver = FunctionResolver::new();
+    resolver.build_indexes(gb.graph()).unwrap();
+
+    let call = |called_name: &str, call_type: CallType| CallSite {
+        caller_id: nodes[0].id,
+        called_name: called_name.to_string(),
+        call_type,
+        context: None,
+        line_number: 3,
+    };
+    let calls = [
+        call("compute_total", CallType::SimpleCall),
+        call("compute_total", CallType::SimpleCall),
+        call("compute_totl", CallType::SimpleCall),
+        call("missing.method", CallType::MethodCall),
+    ];
+    let (_, stats) = resolver.resolve_calls_with_stats(gb.graph(), &calls);
+
+    let simple = stats.by_call_type[CallType::SimpleCall as usize];
+    assert_eq!((simple.sites, simple.resolved), (3, 3));
+    let method = stats.by_call_type[CallType::MethodCall as usize];
+    assert_eq!((method.sites, method.resolved), (1, 0));
+    assert_eq!(stats.by_call_type[CallType::DynamicCall as usize].sites, 0);
+    assert_eq!((stats.fuzzy_lookups, stats.fuzzy_matches), (1, 1));
+}
+
+#[test]
+fn analyzer_reports_every_phase() {
+    let root = PathBuf::from(env!("CARGO_MANIFEST_DIR"))
+        .join("test_apps")
+        .join("python_app");
+    let cache_dir = tempfile::TempDir::new().unwrap();
+    let profiler = Arc::new(Profiler::new());
+    let mut analyzer = CodebaseAnalyzer::new()
+        .with_cache_options(Some(cache_dir.path().to_path_buf()), Default::default())
+        .with_profiler(Arc::clone(&profiler));
+    let graph = analyzer.analyze(&root, &["python"]).unwrap();
+
+    let summary = profiler.summary();
+    for phase in [
+        "scan",
+        "parse",
+        "cache_lookup",
+        "graph_build",
+        "index_build",
+    ] {
+        assert!(summary.phases.contains_key(phase), "missing phase {phase}");
+    }
+    assert!(summary.phases["parse"].by.contains_key("python"));
+    assert_eq!(summary.counters["graph.nodes"], graph.node_count() as u64);
+    assert!(summary.counters["bytes.parsed"] > 0);
+    assert_eq!(summary.cache_hit_ratio, Some(0.0));
+}
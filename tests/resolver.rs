@@ -1,5 +1,6 @@
+use embargo::core::graph::{GraphBuilder, Node};
 use embargo::core::resolver::{CallSite, CallType, FunctionResolver};
-use embargo::core::{graph::Node, EdgeType, NodeType};
+use embargo::core::{Edge, EdgeType, NodeType};
 use std::path::PathBuf;
 
 fn func(id: &str, name: &str) -> Node {
@@ -20,8 +21,13 @@ fn resolver_simple_call_matches_function() {
         func("id:function:bar:2", "bar"),
     ];
 
+    let mut gb = GraphBuilder::new();
+    for node in &nodes {
+        gb.add_node(node.clone());
+    }
+
     let mut resolver = FunctionResolver::new();
-    resolver.build_indexes(&nodes).unwrap();
+    resolver.build_indexes(gb.graph()).unwrap();
 
     let call = CallSite {
         caller_id: nodes[0].id.clone(),
@@ -31,10 +37,300 @@ fn resolver_simple_call_matches_function() {
         line_number: 42,
     };
 
-    let edges = resolver.resolve_calls(&[call]);
+    let edges = resolver.resolve_calls(gb.graph(), &[call]);
     assert_eq!(edges.len(), 1);
     let e = &edges[0];
     assert_eq!(e.edge_type, EdgeType::Call);
     assert_eq!(e.source_id, nodes[0].id);
     assert_eq!(e.target_id, nodes[1].id);
 }
+
+fn simple_call(caller: &Node, called_name: &str) -> CallSite {
+    CallSite {
+        caller_id: caller.id,
+        called_name: called_name.to_string(),
+        call_type: CallType::SimpleCall,
+        context: None,
+        line_number: 7,
+    }
+}
+
+#[test]
+fn fuzzy_fallback_picks_the_closest_name() {
+    let nodes = vec![
+        func("id:function:main:1", "main"),
+        func("id:function:load_config:2", "load_config"),
+        func("id:function:load_confs:3", "load_confs"),
+        func("id:function:save_config:4", "save_config"),
+    ];
+
+    let mut gb = GraphBuilder::new();
+    for node in &nodes {
+        gb.add_node(node.clone());
+    }
+
+    let mut resolver = FunctionResolver::new();
+    resolver.build_indexes(gb.graph()).unwrap();
+
+    let edges = resolver.resolve_calls(
+        gb.graph(),
+        &[
+            simple_call(&nodes[0], "Load_Confg"),
+            simple_call(&nodes[0], "unrelated_name"),
+        ],
+    );
+    assert_eq!(edges.len(), 1);
+    assert_eq!(edges[0].target_id, nodes[1].id);
+    assert_eq!(edges[0].context.as_deref(), Some("fuzzy_match:line:7"));
+}
+
+#[test]
+fn fuzzy_fallback_can_be_disabled() {
+    let nodes = vec![
+        func("id:function:main:1", "main"),
+        func("id:function:load_config:2", "load_config"),
+    ];
+
+    let mut gb = GraphBuilder::new();
+    for node in &nodes {
+        gb.add_node(node.clone());
+    }
+
+    let mut resolver = FunctionResolver::new().with_fuzzy_matching(false);
+    resolver.build_indexes(gb.graph()).unwrap();
+
+    let edges = resolver.resolve_calls(
+        gb.graph(),
+        &[
+            simple_call(&nodes[0], "load_confg"),
+            simple_call(&nodes[0], "load_config"),
+        ],
+    );
+    assert_eq!(edges.len(), 1);
+    assert_eq!(edges[0].context.as_deref(), Some("line:7"));
+}
+
+#[test]
+fn bounded_levenshtein_saturates_past_the_bound() {
+    use embargo::core::fuzzy::bounded_levenshtein;
+
+    assert_eq!(bounded_levenshtein(b"kitten", b"sitting", 5), 3);
+    assert_eq!(bounded_levenshtein(b"kitten", b"sitting", 2), 3);
+    assert_eq!(bounded_levenshtein(b"abc", b"abcdefgh", 2), 3);
+    assert_eq!(bounded_levenshtein(b"", b"ab", 4), 2);
+    assert_eq!(bounded_levenshtein(b"same", b"same", 0), 0);
+}
+
+#[test]
+fn repeated_call_names_are_served_from_the_memo() {
+    let nodes = vec![
+        func("id:function:main:1", "main"),
+        func("id:function:helper:2", "helper"),
+    ];
+
+    let mut gb = GraphBuilder::new();
+    for node in &nodes {
+        gb.add_node(node.clone());
+    }
+
+    let mut resolver = FunctionResolver::new();
+    resolver.build_indexes(gb.graph()).unwrap();
+
+    let mut calls = Vec::new();
+    for line in 1..=4 {
+        let mut call = simple_call(&nodes[0], "helper");
+        call.line_number = line;
+        calls.push(call);
+        calls.push(simple_call(&nodes[0], "missing"));
+    }
+
+    // One worker so the miss/hit split is deterministic
+    let pool = rayon::ThreadPoolBuilder::new()
+        .num_threads(1)
+        .build()
+        .unwrap();
+    let (edges, stats) = pool.install(|| resolver.resolve_calls_with_stats(gb.graph(), &calls));
+    assert_eq!(edges.len(), 4);
+    assert!(edges.iter().all(|e| e.target_id == nodes[1].id));
+    let mut lines: Vec<_> = edges.iter().map(|e| e.context.clone().unwrap()).collect();
+    lines.sort();
+    assert_eq!(lines, ["line:1", "line:2", "line:3", "line:4"]);
+
+    // Two distinct keys; everything else, including the misses, is a memo hit
+    assert_eq!(stats.lookups, 8);
+    assert_eq!(stats.hits, 6);
+    assert_eq!(
+        resolver.resolve_calls(gb.graph(), &calls).len(),
+        edges.len()
+    );
+}
+
+fn func_in(file: &str, language: &str, name: &str) -> Node {
+    Node::new(
+        format!("{file}:function:{name}:1"),
+        name.to_string(),
+        NodeType::Function,
+        PathBuf::from(file),
+        1,
+        language.to_string(),
+    )
+}
+
+#[test]
+fn common_names_resolve_in_the_callers_file_then_language() {
+    let nodes = vec![
+        func_in("src/x.rs", "rust", "run"),
+        func_in("app/a.py", "python", "run"),
+        func_in("app/b.py", "python", "run"),
+        func_in("app/b.py", "python", "main"),
+        func_in("app/c.py", "python", "entry"),
+        func_in("src/y.rs", "rust", "start"),
+        func_in("web/app.ts", "typescript", "boot"),
+        func_in("web/run.js", "javascript", "run"),
+    ];
+
+    let mut gb = GraphBuilder::new();
+    for node in &nodes {
+        gb.add_node(node.clone());
+    }
+    let mut resolver = FunctionResolver::new();
+    resolver.build_indexes(gb.graph()).unwrap();
+
+    let target = |caller: usize| {
+        let edges = resolver.resolve_calls(gb.graph(), &[simple_call(&nodes[caller], "run")]);
+        assert_eq!(edges.len(), 1);
+        edges[0].target_id
+    };
+    // Same file first
+    assert_eq!(target(3), nodes[2].id);
+    // Same language next, in path order
+    assert_eq!(target(4), nodes[1].id);
+    assert_eq!(target(5), nodes[0].id);
+    // TypeScript and JavaScript share a shard
+    assert_eq!(target(6), nodes[7].id);
+
+    // One batch: the memo must not hand one caller's scope to another
+    let calls: Vec<_> = [3, 4, 5]
+        .iter()
+        .map(|&i| simple_call(&nodes[i], "run"))
+        .collect();
+    let targets: Vec<_> = resolver
+        .resolve_calls(gb.graph(), &calls)
+        .iter()
+        .map(|edge| edge.target_id)
+        .collect();
+    assert_eq!(targets, [nodes[2].id, nodes[1].id, nodes[0].id]);
+}
+
+#[test]
+fn memo_entries_are_shared_by_callers_in_other_files() {
+    let nodes = vec![
+        func_in("app/a.py", "python", "first"),
+        func_in("app/b.py", "python", "second"),
+        func_in("tools/c.py", "python", "third"),
+        func_in("lib/util.py", "python", "helper"),
+        func_in("tools/c.py", "python", "helper"),
+    ];
+    let mut gb = GraphBuilder::new();
+    for node in &nodes {
+        gb.add_node(node.clone());
+    }
+    let mut resolver = FunctionResolver::new();
+    resolver.build_indexes(gb.graph()).unwrap();
+
+    let calls: Vec<_> = (0..3).map(|i| simple_call(&nodes[i], "helper")).collect();
+    let pool = rayon::ThreadPoolBuilder::new()
+        .num_threads(1)
+        .build()
+        .unwrap();
+    let (edges, stats) = pool.install(|| resolver.resolve_calls_with_stats(gb.graph(), &calls));
+    let targets: Vec<_> = edges.iter().map(|edge| edge.target_id).collect();
+    // c.py defines its own helper, so only a.py and b.py share an entry
+    assert_eq!(targets, [nodes[3].id, nodes[3].id, nodes[4].id]);
+    assert_eq!(stats.lookups, 3);
+    assert_eq!(stats.hits, 1);
+}
+
+fn qualified_call(caller: &Node, called_name: &str, call_type: CallType) -> CallSite {
+    CallSite {
+        call_type,
+        ..simple_call(caller, called_name)
+    }
+}
+
+#[test]
+fn qualified_calls_resolve_through_modules_types_and_aliases() {
+    let import = |file: &str, language: &str, statement: &str| {
+        Node::new(
+            format!("{file}:import:{statement}:1"),
+            statement.to_string(),
+            NodeType::Module,
+            PathBuf::from(file),
+            1,
+            language.to_string(),
+        )
+    };
+    let nodes = vec![
+        func_in("app/numpy/__init__.py", "python", "norm"),
+        func_in("app/other.py", "python", "norm"),
+        func_in("app/main.py", "python", "run"),
+        import("app/main.py", "python", "import numpy as np"),
+        Node::new(
+            "app/geo.py:class:Shape:1".to_string(),
+            "Shape".to_string(),
+            NodeType::Class,
+            PathBuf::from("app/geo.py"),
+            1,
+            "python".to_string(),
+        ),
+        func_in("app/geo.py", "python", "area"),
+        func_in("app/util.py", "python", "area"),
+        func_in("web/utils.ts", "typescript", "fmt"),
+        func_in("web/app.ts", "typescript", "boot"),
+        import(
+            "web/app.ts",
+            "typescript",
+            "import * as u from \"./utils\";",
+        ),
+    ];
+
+    let mut gb = GraphBuilder::new();
+    for node in &nodes {
+        gb.add_node(node.clone());
+    }
+    gb.add_edge(Edge::new(EdgeType::Contains, nodes[4].id, nodes[5].id));
+    let mut resolver = FunctionResolver::new();
+    resolver.build_indexes(gb.graph()).unwrap();
+
+    let (run, boot) = (&nodes[2], &nodes[8]);
+    let calls = [
+        qualified_call(run, "np.norm", CallType::QualifiedCall),
+        qualified_call(run, "numpy.norm", CallType::QualifiedCall),
+        qualified_call(run, "other.norm", CallType::QualifiedCall),
+        qualified_call(run, "Shape.area", CallType::QualifiedCall),
+        qualified_call(run, "Shape::area", CallType::QualifiedCall),
+        qualified_call(run, "util.area", CallType::QualifiedCall),
+        qualified_call(run, "os.path.join", CallType::QualifiedCall),
+        qualified_call(run, "shape.area", CallType::MethodCall),
+        qualified_call(boot, "u.fmt", CallType::QualifiedCall),
+    ];
+    let sites: Vec<&CallSite> = calls.iter().collect();
+    let (edges, _) = resolver.resolve_call_sites(gb.graph(), &sites);
+    let targets: Vec<_> = edges
+        .iter()
+        .map(|edge| edge.as_ref().map(|edge| edge.target_id))
+        .collect();
+    let expected = [0, 0, 1, 5, 5, 6].map(|i| Some(nodes[i].id));
+    assert_eq!(targets[..6], expected);
+    assert_eq!(targets[6], None);
+    // A receiver that names no type or module falls back to the methods of that name
+    assert_eq!(targets[7], Some(nodes[5].id));
+    assert_eq!(targets[8], Some(nodes[7].id));
+    assert_eq!(
+        edges[0].as_ref().unwrap().context.as_deref(),
+        Some("qualified_call:line:7")
+    );
+
+    assert_eq!(FunctionResolver::lookup_name(&calls[4]), "area");
+    assert!(!resolver.may_fuzzy_match(&calls[6]));
+}
@@ -28,3 +28,92 @@ fn scanner_filters_by_language_extensions() {
     langs.sort();
     assert_eq!(langs, vec!["javascript", "python", "rust"]);
 }
+
+#[test]
+fn scanner_respects_gitignore_and_embargoignore() {
+    let dir = tempfile::TempDir::new().unwrap();
+    let root = dir.path();
+    for sub in ["src", "target", "vendor", ".git", "node_modules/pkg"] {
+        fs::create_dir_all(root.join(sub)).unwrap();
+    }
+    fs::write(root.join(".gitignore"), "target/\nnode_modules/\n").unwrap();
+    fs::write(root.join("src/.embargoignore"), "generated.rs\n").unwrap();
+
+    touch(root.join("src/lib.rs"));
+    touch(root.join("src/generated.rs"));
+    touch(root.join("target/build.rs"));
+    touch(root.join("node_modules/pkg/index.rs"));
+    touch(root.join(".git/hook.rs"));
+    touch(root.join("vendor/dep.rs"));
+
+    let scanner = FileScanner::new();
+    let files = scanner.scan_directory(root, &["rust"]).unwrap();
+    let found: Vec<_> = files
+        .iter()
+        .map(|f| {
+            f.path
+                .strip_prefix(root)
+                .unwrap()
+                .to_string_lossy()
+                .replace('\\', "/")
+        })
+        .collect();
+    assert_eq!(found, vec!["src/lib.rs", "vendor/dep.rs"]);
+
+    // Streaming entry point sees the same files
+    let streamed = std::sync::atomic::AtomicUsize::new(0);
+    scanner
+        .scan_with(root, &["rust"], |_| {
+            streamed.fetch_add(1, std::sync::atomic::Ordering::Relaxed);
+        })
+        .unwrap();
+    assert_eq!(streamed.into_inner(), 2);
+}
+
+#[test]
+fn classified_paths_follow_the_same_ignore_rules_as_a_scan() {
+    let dir = tempfile::TempDir::new().unwrap();
+    let root = dir.path();
+    for sub in ["src", "target/debug", ".git", "node_modules/pkg", "vendor"] {
+        fs::create_dir_all(root.join(sub)).unwrap();
+    }
+    fs::write(root.join(".gitignore"), "target/\nnode_modules/\n").unwrap();
+    fs::write(root.join("src/.embargoignore"), "generated.rs\n").unwrap();
+    touch(root.join("src/lib.rs"));
+    touch(root.join("src/generated.rs"));
+    touch(root.join("target/debug/build.rs"));
+    touch(root.join(".git/hook.rs"));
+    touch(root.join("vendor/dep.rs"));
+
+    // As a watcher or `git diff` would report them, a deleted file included
+    let reported: Vec<_> = [
+        "src/lib.rs",
+        "src/generated.rs",
+        "src/deleted.rs",
+        "target/debug/build.rs",
+        "node_modules/pkg/index.rs",
+        ".git/hook.rs",
+        "vendor/dep.rs",
+        "vendor/notes.txt",
+    ]
+    .iter()
+    .map(|path| root.join(path))
+    .collect();
+
+    let scanner = FileScanner::new();
+    let classified: Vec<_> = scanner
+        .classify_paths(root, &reported, &["rust"])
+        .iter()
+        .map(|f| {
+            f.path
+                .strip_prefix(root)
+                .unwrap()
+                .to_string_lossy()
+                .replace('\\', "/")
+        })
+        .collect();
+    assert_eq!(
+        classified,
+        vec!["src/lib.rs", "src/deleted.rs", "vendor/dep.rs"]
+    );
+}
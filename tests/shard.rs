@@ -0,0 +1,258 @@
+use embargo::core::graph::GraphBuilder;
+use embargo::core::resolver::{CallSite, CallType};
+use embargo::core::shard::{merge, GraphShard};
+use embargo::core::{DependencyGraph, Edge, EdgeType, FunctionResolver, Node, NodeId, NodeType};
+use embargo::parsers::ParseResult;
+use std::path::{Path, PathBuf};
+
+fn func(file: &str, name: &str, line: usize) -> Node {
+    Node::new(
+        format!("{}:function:{}:{}", file.replace('/', "_"), name, line),
+        name.to_string(),
+        NodeType::Function,
+        PathBuf::from(file),
+        line,
+        "rust".to_string(),
+    )
+}
+
+fn call(caller: &Node, called_name: &str, line: usize) -> CallSite {
+    CallSite {
+        caller_id: caller.id,
+        called_name: called_name.to_string(),
+        call_type: CallType::SimpleCall,
+        context: None,
+        line_number: line,
+    }
+}
+
+fn method_call(caller: &Node, called_name: &str, line: usize) -> CallSite {
+    CallSite {
+        call_type: CallType::MethodCall,
+        ..call(caller, called_name, line)
+    }
+}
+
+fn parsed(nodes: Vec<Node>, call_sites: Vec<CallSite>) -> ParseResult {
+    ParseResult {
+        nodes,
+        edges: Vec::new(),
+        call_sites: Some(call_sites),
+        exports: Vec::new(),
+        limited: None,
+    }
+}
+
+fn call_targets(graph: &DependencyGraph) -> Vec<(NodeId, NodeId)> {
+    let mut targets: Vec<(NodeId, NodeId)> = graph
+        .raw_edges()
+        .iter()
+        .filter(|edge| edge.weight.edge_type == EdgeType::Call)
+        .map(|edge| (edge.weight.source_id, edge.weight.target_id))
+        .collect();
+    targets.sort_by_key(|&(source, target)| (source.as_str(), target.as_str()));
+    targets
+}
+
+/// `pkg/web` calls into `pkg/core`, and has a local near-miss of the callee's name
+fn shards(resolver: &FunctionResolver) -> (GraphShard, GraphShard) {
+    let main = func("pkg/web/main.rs", "main", 1);
+    let render = func("pkg/web/main.rs", "render", 5);
+    let near_miss = func("pkg/web/util.rs", "helpers", 1);
+    let calls = vec![call(&main, "render", 2), call(&main, "helper", 3)];
+    let (web, _) = GraphShard::from_results(
+        Path::new("pkg/web"),
+        &["rust"],
+        vec![
+            parsed(vec![main, render], calls),
+            parsed(vec![near_miss], Vec::new()),
+        ],
+        resolver,
+    )
+    .unwrap();
+    let (core, _) = GraphShard::from_results(
+        Path::new("pkg/core"),
+        &["rust"],
+        vec![parsed(
+            vec![func("pkg/core/lib.rs", "helper", 1)],
+            Vec::new(),
+        )],
+        resolver,
+    )
+    .unwrap();
+    (web, core)
+}
+
+#[test]
+fn shards_defer_unmatched_calls_and_merge_resolves_them_across_shards() {
+    let resolver = FunctionResolver::new();
+    let (web, core) = shards(&resolver);
+
+    // The local call resolved; the call into core stayed open instead of
+    // fuzzy-matching `helpers` inside the shard
+    assert_eq!(web.edge_count(), 1);
+    let open: Vec<&CallSite> = web.unresolved().collect();
+    assert_eq!(open.len(), 1);
+    assert_eq!(open[0].called_name, "helper");
+    assert_eq!(core.unresolved().count(), 0);
+
+    let main = func("pkg/web/main.rs", "main", 1);
+    let render = func("pkg/web/main.rs", "render", 5);
+    let helper = func("pkg/core/lib.rs", "helper", 1);
+    let (graph, summary) = merge(vec![web.clone(), core.clone()], &resolver).unwrap();
+    assert_eq!(summary.shards, 2);
+    assert_eq!(summary.cross_shard_sites, 1);
+    assert_eq!(summary.cross_shard_edges, 1);
+    assert_eq!(summary.duplicate_nodes, 0);
+    assert_eq!(
+        call_targets(&graph),
+        vec![(main.id, helper.id), (main.id, render.id)]
+    );
+
+    // Nodes come out in file order whatever order the shards are given in
+    let (reversed, _) = merge(vec![core, web.clone()], &resolver).unwrap();
+    let files = |graph: &DependencyGraph| -> Vec<PathBuf> {
+        graph
+            .node_weights()
+            .map(|node| node.file_path.to_path_buf())
+            .collect()
+    };
+    assert_eq!(files(&graph), files(&reversed));
+    assert_eq!(files(&graph)[0], PathBuf::from("pkg/core/lib.rs"));
+
+    // A shard merged with itself keeps one copy of each node
+    let (graph, summary) = merge(vec![web.clone(), web], &resolver).unwrap();
+    assert_eq!(summary.duplicate_nodes, 3);
+    assert_eq!(graph.node_count(), 3);
+}
+
+#[test]
+fn shards_round_trip_through_disk() {
+    let dir = tempfile::TempDir::new().unwrap();
+    let resolver = FunctionResolver::new();
+    let (web, _) = shards(&resolver);
+
+    let path = dir.path().join("web.shard");
+    web.save(&path).unwrap();
+    let loaded = GraphShard::load(&path).unwrap();
+    assert_eq!(loaded.root, PathBuf::from("pkg/web"));
+    assert_eq!(loaded.languages, vec!["rust".to_string()]);
+    assert_eq!(loaded.nodes.len(), web.nodes.len());
+    assert_eq!(loaded.edge_count(), web.edge_count());
+    assert_eq!(loaded.unresolved().count(), 1);
+
+    std::fs::write(&path, b"not a shard").unwrap();
+    assert!(GraphShard::load(&path).is_err());
+}
+
+/// Graph a single run over all of `results` builds: nodes and parsed edges in
+/// file order, then the resolved call edges
+fn analyze_union(results: Vec<ParseResult>, resolver: &FunctionResolver) -> DependencyGraph {
+    let mut graph_builder = GraphBuilder::new();
+    let mut call_sites = Vec::new();
+    for result in results {
+        for node in result.nodes {
+            graph_builder.add_node(node);
+        }
+        for edge in result.edges {
+            graph_builder.add_edge(edge);
+        }
+        call_sites.extend(result.call_sites.unwrap_or_default());
+    }
+    let mut resolver = resolver.clone();
+    resolver.build_indexes(graph_builder.graph()).unwrap();
+    let (edges, _) = resolver.resolve_calls_with_stats(graph_builder.graph(), &call_sites);
+    for edge in edges {
+        graph_builder.add_edge(edge);
+    }
+    graph_builder.build()
+}
+
+fn layout(graph: &DependencyGraph) -> (Vec<NodeId>, Vec<String>) {
+    let nodes = graph.node_weights().map(|node| node.id).collect();
+    let edges = graph
+        .raw_edges()
+        .iter()
+        .map(|edge| {
+            let edge = &edge.weight;
+            format!(
+                "{:?} {}->{} {:?}",
+                edge.edge_type,
+                edge.source_id.as_str(),
+                edge.target_id.as_str(),
+                edge.context
+            )
+        })
+        .collect();
+    (nodes, edges)
+}
+
+#[test]
+fn merging_shards_builds_the_graph_of_one_run_over_their_union() {
+    // `api` and `db` both define `parse` outside the caller's file, and a
+    // method `save` lives in another shard than its caller
+    let parse_api = func("pkg/api/parse.rs", "parse", 1);
+    let handle = func("pkg/api/routes.rs", "handle", 1);
+    let respond = func("pkg/api/routes.rs", "respond", 9);
+    let parse_db = func("pkg/db/codec.rs", "parse", 1);
+    let save = func("pkg/db/store.rs", "save", 1);
+    let load = func("pkg/db/store.rs", "load", 7);
+    let main = func("pkg/web/main.rs", "main", 1);
+    let contains = |from: &Node, to: &Node| Edge::new(EdgeType::Contains, from.id, to.id);
+
+    let files = || {
+        vec![
+            ("pkg/api", parsed(vec![parse_api.clone()], Vec::new())),
+            (
+                "pkg/api",
+                ParseResult {
+                    edges: vec![contains(&handle, &respond)],
+                    ..parsed(
+                        vec![handle.clone(), respond.clone()],
+                        vec![
+                            call(&handle, "parse", 2),
+                            call(&handle, "respond", 3),
+                            method_call(&handle, "record.save", 4),
+                        ],
+                    )
+                },
+            ),
+            ("pkg/db", parsed(vec![parse_db.clone()], Vec::new())),
+            (
+                "pkg/db",
+                ParseResult {
+                    edges: vec![contains(&save, &load)],
+                    ..parsed(
+                        vec![save.clone(), load.clone()],
+                        vec![call(&load, "parse", 8), call(&save, "load", 2)],
+                    )
+                },
+            ),
+            (
+                "pkg/web",
+                parsed(
+                    vec![main.clone()],
+                    vec![call(&main, "handle", 2), call(&main, "parse", 3)],
+                ),
+            ),
+        ]
+    };
+    let resolver = FunctionResolver::new();
+    let union = analyze_union(files().into_iter().map(|(_, r)| r).collect(), &resolver);
+
+    let mut shards = Vec::new();
+    for root in ["pkg/web", "pkg/db", "pkg/api"] {
+        let results = files()
+            .into_iter()
+            .filter(|(shard_root, _)| *shard_root == root)
+            .map(|(_, result)| result)
+            .collect();
+        let (shard, _) =
+            GraphShard::from_results(Path::new(root), &["rust"], results, &resolver).unwrap();
+        shards.push(shard);
+    }
+    let (merged, summary) = merge(shards, &resolver).unwrap();
+    assert_eq!(layout(&merged), layout(&union));
+    // Only the two calls within their own file were settled by the shards
+    assert_eq!(summary.cross_shard_sites, 5);
+}
@@ -0,0 +1,27 @@
+use embargo::parsers::source::{SourceBuffer, MMAP_THRESHOLD};
+use std::fs;
+
+#[test]
+fn small_files_are_read_into_the_heap() {
+    let dir = tempfile::TempDir::new().unwrap();
+    let file = dir.path().join("small.py");
+    fs::write(&file, "def f():\n    return 1\n").unwrap();
+
+    let source = SourceBuffer::load(&file).unwrap();
+    assert!(!source.is_mapped());
+    assert_eq!(source.as_bytes(), b"def f():\n    return 1\n");
+}
+
+#[test]
+fn large_files_are_memory_mapped_with_identical_bytes() {
+    let dir = tempfile::TempDir::new().unwrap();
+    let file = dir.path().join("bundle.js");
+    let line = "function f() { return 42; }\n";
+    let content = line.repeat(MMAP_THRESHOLD as usize / line.len() + 1);
+    fs::write(&file, &content).unwrap();
+
+    let source = SourceBuffer::load(&file).unwrap();
+    assert!(source.is_mapped());
+    assert_eq!(source.len(), content.len());
+    assert_eq!(&source[..], content.as_bytes());
+}